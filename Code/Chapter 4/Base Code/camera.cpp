@@ -282,3 +282,31 @@ bool CCAMERA::SphereInFrustum( float x, float y, float z, float fRadius )
 	return true;
 }
 
+//--------------------------------------------------------------
+// Name:			CCAMERA::BoxFrustumTest - public
+// Description:		Test an axis-aligned bounding box for inclusion in
+//					the viewing frustum (only the corner that is furthest
+//					along each plane's normal needs to be checked)
+// Arguments:		-fMinX, fMinY, fMinZ: the box's minimum corner
+//					-fMaxX, fMaxY, fMaxZ: the box's maximum corner
+// Return Value:	A boolean value: -true: the box is (at least partly) visible
+//									 -false: the box is not visible
+//--------------------------------------------------------------
+bool CCAMERA::BoxFrustumTest( float fMinX, float fMinY, float fMinZ, float fMaxX, float fMaxY, float fMaxZ )
+{
+	float x, y, z;
+	int i;
+
+	for( i=0; i<6; i++ )
+	{
+		x= ( m_viewFrustum[i][0]>0.0f ) ? fMaxX : fMinX;
+		y= ( m_viewFrustum[i][1]>0.0f ) ? fMaxY : fMinY;
+		z= ( m_viewFrustum[i][2]>0.0f ) ? fMaxZ : fMinZ;
+
+		if( m_viewFrustum[i][0]*x + m_viewFrustum[i][1]*y + m_viewFrustum[i][2]*z + m_viewFrustum[i][3] <= 0 )
+			return false;
+	}
+
+	return true;
+}
+
@@ -87,6 +87,7 @@ class CCAMERA
 	bool VertexFrustumTest( float x, float y, float z, bool bTestLR= true, bool bTestTB= true, bool bTestNF= true );
 	bool CubeFrustumTest( float x, float y, float z, float size );
 	bool SphereInFrustum( float x, float y, float z, float fRadius );
+	bool BoxFrustumTest( float fMinX, float fMinY, float fMinZ, float fMaxX, float fMaxY, float fMaxZ );
 
 	//--------------------------------------------------------------
 	// Name:			CCAMERA::CCAMERA - public
@@ -0,0 +1,129 @@
+//==============================================================
+//==============================================================
+//= render_stats.cpp ===========================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= Counts what each part of a frame asks the driver to do	   =
+//= (batches, texture binds, state changes).  Define		   =
+//= RENDER_STATS in the project settings to turn the counting  =
+//= on; without it, the STATS_* macros compile to nothing.	   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <string.h>
+
+#include "log.h"
+#include "render_stats.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+CRENDER_STATS g_renderStats;
+
+//the names of the subsystems, for the log (global (this file only))
+static char* g_szSubsystems[STATS_NUM_SUBSYSTEMS]= { "Other", "Sky", "Terrain", "Water", "Particles" };
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CRENDER_STATS::CRENDER_STATS - public
+// Description:		Start with every count at zero
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+CRENDER_STATS::CRENDER_STATS( void )
+{
+	memset( m_current, 0, sizeof( m_current ) );
+	memset( m_lastFrame, 0, sizeof( m_lastFrame ) );
+
+	m_iSubsystem= STATS_OTHER;
+	m_iNumFrames= 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_STATS::EndFrame - public
+// Description:		Finish the frame: its counts become the ones that
+//					GetFrameStats returns, and the next frame starts at
+//					zero
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_STATS::EndFrame( void )
+{
+	memcpy( m_lastFrame, m_current, sizeof( m_current ) );
+	memset( m_current, 0, sizeof( m_current ) );
+
+	m_iSubsystem= STATS_OTHER;
+	m_iNumFrames++;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_STATS::GetFrameTotals - public
+// Description:		Add up the last frame's counts for every subsystem
+// Arguments:		-pTotals: storage for the totals
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_STATS::GetFrameTotals( SRENDER_STATS* pTotals )
+{
+	int i;
+
+	memset( pTotals, 0, sizeof( SRENDER_STATS ) );
+
+	for( i=0; i<STATS_NUM_SUBSYSTEMS; i++ )
+	{
+		pTotals->m_iBatches			+= m_lastFrame[i].m_iBatches;
+		pTotals->m_iImmediateBatches+= m_lastFrame[i].m_iImmediateBatches;
+		pTotals->m_iTriangles		+= m_lastFrame[i].m_iTriangles;
+		pTotals->m_iVertices		+= m_lastFrame[i].m_iVertices;
+		pTotals->m_iTextureBinds	+= m_lastFrame[i].m_iTextureBinds;
+		pTotals->m_iStateToggles	+= m_lastFrame[i].m_iStateToggles;
+		pTotals->m_iStateChanges	+= m_lastFrame[i].m_iStateChanges;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_STATS::LogFrame - public
+// Description:		Write the last frame's counts to the log, a line
+//					for each subsystem and then the totals
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_STATS::LogFrame( void )
+{
+	SRENDER_STATS totals;
+	SRENDER_STATS* pStats;
+	int i;
+
+	g_log.Write( LOG_PLAINTEXT, "Render stats for frame %d (batches (immediate), triangles, vertices, binds, toggles, other state):",
+				 m_iNumFrames );
+
+	for( i=0; i<=STATS_NUM_SUBSYSTEMS; i++ )
+	{
+		if( i<STATS_NUM_SUBSYSTEMS )
+			pStats= &m_lastFrame[i];
+		else
+		{
+			GetFrameTotals( &totals );
+			pStats= &totals;
+		}
+
+		g_log.Write( LOG_PLAINTEXT, "%-10s %5d (%d), %7d, %7d, %4d, %4d, %4d",
+					 ( i<STATS_NUM_SUBSYSTEMS ) ? g_szSubsystems[i] : "Total",
+					 pStats->m_iBatches, pStats->m_iImmediateBatches, pStats->m_iTriangles, pStats->m_iVertices,
+					 pStats->m_iTextureBinds, pStats->m_iStateToggles, pStats->m_iStateChanges );
+	}
+}
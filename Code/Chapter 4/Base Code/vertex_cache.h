@@ -0,0 +1,102 @@
+//==============================================================
+//==============================================================
+//= vertex_cache.h =============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= The video card keeps the last few vertices it transformed, =
+//= so a triangle order that reuses them transforms fewer	   =
+//= vertices.  This simulates that cache (to score an index	   =
+//= stream), and reorders triangle lists to make better use of =
+//= it (Tom Forsyth's "Linear-Speed Vertex Cache			   =
+//= Optimisation").											   =
+//==============================================================
+//==============================================================
+#ifndef __VERTEX_CACHE_H__
+#define __VERTEX_CACHE_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include "render_backend.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#define VCACHE_MAX_SIZE 64
+
+//the caches that index streams are scored with: the FIFO that most
+//cards have, and the LRU cache that the optimizer plans for
+#define VCACHE_FIFO_SIZE 16
+#define VCACHE_LRU_SIZE	 32
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+enum EVCACHE_TYPES
+{
+	VCACHE_FIFO= 0,		//a miss pushes the oldest vertex out, a hit changes nothing
+	VCACHE_LRU			//a hit moves the vertex to the front again
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//a simulated post-transform vertex cache
+class CVERTEX_CACHE
+{
+	private:
+		unsigned int m_uiEntries[VCACHE_MAX_SIZE];
+		int m_iNumEntries;
+		int m_iSize;
+		int m_iNext;		//where the FIFO's next miss goes
+		EVCACHE_TYPES m_type;
+
+	public:
+
+	bool Access( unsigned int uiIndex );
+
+	//--------------------------------------------------------------
+	// Name:			CVERTEX_CACHE::Flush - public
+	// Description:		Empty the cache (the card does this between draws)
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void Flush( void )
+	{
+		m_iNumEntries= 0;
+		m_iNext		 = 0;
+	}
+
+	CVERTEX_CACHE( EVCACHE_TYPES type, int iSize ) : m_iNumEntries( 0 ), m_iNext( 0 ), m_type( type )
+	{	m_iSize= ( iSize<1 ) ? 1 : ( ( iSize>VCACHE_MAX_SIZE ) ? VCACHE_MAX_SIZE : iSize );	}
+	~CVERTEX_CACHE( void )
+	{	}
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DECLARATIONS -----------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+int MakeTriangleList( EBACKEND_PRIMITIVES primitive, const unsigned int* uipIndices, int iCount, unsigned int* uipList );
+
+int CountCacheMisses( const unsigned int* uipList, int iNumIndices, EVCACHE_TYPES type, int iCacheSize );
+int CountUniqueVertices( const unsigned int* uipList, int iNumIndices, int iNumVertices );
+
+void OptimizeVertexCache( unsigned int* uipList, int iNumIndices, int iNumVertices );
+
+
+#endif	//__VERTEX_CACHE_H__
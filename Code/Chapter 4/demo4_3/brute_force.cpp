@@ -17,6 +17,7 @@
 #include <stdio.h>
 
 #include "../Base Code/gl_app.h"
+#include "../Base Code/log.h"
 
 #include "brute_force.h"
 
@@ -27,6 +28,35 @@
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::Update - public
+// Description:		Cull the terrain's chunks against the camera's view
+//					frustum (only needed when chunking is turned on)
+// Arguments:		-camera: the camera (its frustum has to be calculated
+//							 in the terrain's space)
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::Update( CCAMERA camera )
+{
+	SBRUTE_FORCE_CHUNK* pChunk;
+	int i;
+
+	if( !m_bChunking )
+		return;
+
+	//the chunks' boxes have to be up to date before they can be tested
+	PrepareBuffers( );
+
+	m_iNumVisibleChunks= 0;
+	for( i=0, pChunk=m_pChunks; i<m_iNumChunks; i++, pChunk++ )
+	{
+		pChunk->m_bVisible= camera.BoxFrustumTest( pChunk->m_fMin[0], pChunk->m_fMin[1], pChunk->m_fMin[2],
+												   pChunk->m_fMax[0], pChunk->m_fMax[1], pChunk->m_fMax[2] );
+		if( pChunk->m_bVisible )
+			m_iNumVisibleChunks++;
+	}
+}
+
 //--------------------------------------------------------------
 // Name:			CBRUTE_FORCE::Render - public
 // Description:		Render the terrain height field
@@ -35,90 +65,42 @@
 //--------------------------------------------------------------
 void CBRUTE_FORCE::Render( void )
 {
-	float fTexLeft, fTexBottom, fTexTop;
-	unsigned char ucShadeLow, ucShadeHigh;	
-	int	x, z;
-
 	//reset the counting variables
 	m_iVertsPerFrame= 0;
 	m_iTrisPerFrame = 0;
 
+	//without static buffers the mesh is built again every frame, but only
+	//once, no matter how many passes draw it
+	if( !m_bStaticBuffers && !m_bChunking )
+		m_bMeshDirty= true;
+
+	PrepareBuffers( );
+
 	//cull non camera-facing polygons
-	glEnable( GL_CULL_FACE );
+	m_pBackend->SetState( BACKEND_CULL_FACE, true );
 
 	if( m_bMultitexture && m_bDetailMapping && m_bTextureMapping )
 	{
-		glDisable( GL_BLEND );
+		m_pBackend->SetState( BACKEND_BLEND, false );
 
 		//bind the primary color texture to the first texture unit
-		glActiveTextureARB( GL_TEXTURE0_ARB );
-		glEnable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
+		m_pBackend->SetState( BACKEND_TEXTURE0, true );
+		m_pBackend->BindTexture( 0, m_texture.GetID( ) );
 
 		//bind the detail color texture to the second texture unit
-		glActiveTextureARB( GL_TEXTURE1_ARB );
-		glEnable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, m_detailMap.GetID( ) );
-		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB );
-		glTexEnvi( GL_TEXTURE_ENV, GL_RGB_SCALE_ARB, 2 );
-
-		//loop through the Z-axis of the terrain
-		for( z=0; z<m_iSize-1; z++ )
-		{
-			//begin a new triangle strip
-			glBegin( GL_TRIANGLE_STRIP );
+		m_pBackend->SetState( BACKEND_TEXTURE1, true );
+		m_pBackend->BindTexture( 1, m_detailMap.GetID( ) );
+		m_pBackend->SetCombineMode( 1, BACKEND_COMBINE_DETAIL );
 
-				//loop through the X-axis of the terrain
-				//this is where the triangle strip is constructed
-				for( x=0; x<m_iSize-1; x++ )
-				{
-					//calculate the texture coordinates
-					fTexLeft  = ( float )x/m_iSize;
-					fTexBottom= ( float )z/m_iSize;
-					fTexTop	  = ( float )( z+1 )/m_iSize;
-
-					//get the brightness for the two points to be rendered
-					ucShadeLow = GetBrightnessAtPoint( x, z );
-					ucShadeHigh= GetBrightnessAtPoint( x, z+1 );
-
-					//set the color with OpenGL, and render the point
-					glColor4ub( ( unsigned char )( ucShadeLow*m_vecLightColor[0] ),
-							    ( unsigned char )( ucShadeLow*m_vecLightColor[1] ),
-							    ( unsigned char )( ucShadeLow*m_vecLightColor[2] ), 255 );
-					glMultiTexCoord2fARB( GL_TEXTURE0_ARB, fTexLeft, fTexBottom );
-					glMultiTexCoord2fARB( GL_TEXTURE1_ARB, fTexLeft*m_iRepeatDetailMap, fTexBottom*m_iRepeatDetailMap );
-					glVertex3f( ( float )x, GetScaledHeightAtPoint( x, z ), ( float )z );		
-
-					//set the color with OpenGL, and render the point
-					glColor4ub( ( unsigned char )( ucShadeHigh*m_vecLightColor[0] ),
-							    ( unsigned char )( ucShadeHigh*m_vecLightColor[1] ),
-							    ( unsigned char )( ucShadeHigh*m_vecLightColor[2] ), 255 );
-					glMultiTexCoord2fARB( GL_TEXTURE0_ARB, fTexLeft, fTexTop );
-					glMultiTexCoord2fARB( GL_TEXTURE1_ARB, fTexLeft*m_iRepeatDetailMap, fTexTop*m_iRepeatDetailMap );
-					glVertex3f( ( float )x, GetScaledHeightAtPoint( x, z+1 ), ( float )z+1 );
-
-					//increase the vertex count by two (which is how many we sent to the API)
-					m_iVertsPerFrame+= 2;
-
-					//there are no triangles being rendered on the first X-loop, they just start the
-					//triangle strip off
-					if( x!= 0 )
-						m_iTrisPerFrame+= 2;
-				}
-
-			//end the triangle strip
-			glEnd( );
-		}
+		RenderBuffers( true, 1.0f );
 
 		//unbind the texture occupying the second texture unit
-		glActiveTextureARB( GL_TEXTURE1_ARB );
-		glDisable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, 0 );
+		m_pBackend->SetState( BACKEND_TEXTURE1, false );
+		m_pBackend->BindTexture( 1, 0 );
 
 		//unbind the texture occupying the first texture unit
-		glActiveTextureARB( GL_TEXTURE0_ARB );
-		glDisable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, 0 );
+		m_pBackend->SetState( BACKEND_TEXTURE0, false );
+		m_pBackend->BindTexture( 0, 0 );
 	}
 
 	//multitexturing is not enabled, which means we'll have to do a seperate texture
@@ -128,69 +110,24 @@ void CBRUTE_FORCE::Render( void )
 		if( m_bTextureMapping )
 		{
 			//bind the primary color texture (FOR THE PRIMARY TEXTURE PASS)
-			glActiveTextureARB( GL_TEXTURE0_ARB );
-			glEnable( GL_TEXTURE_2D );
-			glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
+			m_pBackend->SetState( BACKEND_TEXTURE0, true );
+			m_pBackend->BindTexture( 0, m_texture.GetID( ) );
 
-			//loop through the Z-axis of the terrain
-			for( z=0; z<m_iSize-1; z++ )
-			{
-				//begin a new triangle strip
-				glBegin( GL_TRIANGLE_STRIP );
-
-					//loop through the X-axis of the terrain
-					//this is where the triangle strip is constructed
-					for( x=0; x<m_iSize-1; x++ )
-					{
-						//calculate the texture coordinates
-						fTexLeft  = ( float )x/m_iSize;
-						fTexBottom= ( float )z/m_iSize;
-						fTexTop	  = ( float )( z+1 )/m_iSize;
-							
-						//get the brightness for the two points to be rendered
-						ucShadeLow = GetBrightnessAtPoint( x, z );
-						ucShadeHigh= GetBrightnessAtPoint( x, z+1 );
-
-						//set the color with OpenGL, and render the point
-						glColor4ub( ( unsigned char )( ucShadeLow*m_vecLightColor[0] ),
-									( unsigned char )( ucShadeLow*m_vecLightColor[1] ),
-									( unsigned char )( ucShadeLow*m_vecLightColor[2] ), 255 );
-						glMultiTexCoord2fARB( GL_TEXTURE0_ARB, fTexLeft, fTexBottom );
-						glVertex3f( ( float )x, GetScaledHeightAtPoint( x, z ), ( float )z );
-
-						//set the color with OpenGL, and render the point
-						glColor4ub( ( unsigned char )( ucShadeHigh*m_vecLightColor[0] ),
-									( unsigned char )( ucShadeHigh*m_vecLightColor[1] ),
-									( unsigned char )( ucShadeHigh*m_vecLightColor[2] ), 255 );
-						glMultiTexCoord2fARB( GL_TEXTURE0_ARB, fTexLeft, fTexTop );
-						glVertex3f( ( float )x, GetScaledHeightAtPoint( x, z+1 ), ( float )z+1 );
-
-						//increase the vertex count by two (which is how many we sent to the API)
-						m_iVertsPerFrame+= 2;
-
-						//there are no triangles being rendered on the first X-loop, they just start the
-						//triangle strip off
-						if( x!= 0 )
-							m_iTrisPerFrame+= 2;
-					}
-				//end the triangle strip
-				glEnd( );
-			}
+			RenderBuffers( false, 1.0f );
 		}
 
 		//if the user wants detail mapping, we need to set some things up
 		if( m_bDetailMapping )
 		{
 			//bind the detail texture
-			glActiveTextureARB( GL_TEXTURE0_ARB );
-			glEnable( GL_TEXTURE_2D );
-			glBindTexture( GL_TEXTURE_2D, m_detailMap.GetID( ) );
+			m_pBackend->SetState( BACKEND_TEXTURE0, true );
+			m_pBackend->BindTexture( 0, m_detailMap.GetID( ) );
 		
 			//only use blending if a texture pass was made
 			if( m_bTextureMapping )
 			{
-				glEnable( GL_BLEND );
-				glBlendFunc( GL_ZERO, GL_SRC_COLOR );
+				m_pBackend->SetState( BACKEND_BLEND, true );
+				m_pBackend->SetBlendMode( BACKEND_BLEND_MULTIPLY );
 			}
 		}
 
@@ -204,57 +141,415 @@ void CBRUTE_FORCE::Render( void )
 		else
 		{
 			//unbind the first texture unit
-			glActiveTextureARB( GL_TEXTURE0_ARB );
-			glDisable( GL_TEXTURE_2D );
-			glBindTexture( GL_TEXTURE_2D, 0 );
+			m_pBackend->SetState( BACKEND_TEXTURE0, false );
+			m_pBackend->BindTexture( 0, 0 );
+		}
+
+		//the detail map is stretched across the terrain the same way
+		//that the multitextured pass does it
+		RenderBuffers( false, ( float )m_iRepeatDetailMap );
+
+		m_pBackend->SetState( BACKEND_BLEND, false );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::RenderBuffers - private
+// Description:		Draw the height field from the vertex and index
+//					buffers (either the whole height field, or every
+//					visible chunk)
+// Arguments:		-bMultiTex: send the detail map's texture coordinates
+//								to the second texture unit or not
+//					-fTexScale: scale for the first texture unit's
+//								texture coordinates
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::RenderBuffers( bool bMultiTex, float fTexScale )
+{
+	int iFormat;
+
+	iFormat= BACKEND_COLOR | BACKEND_TEXCOORD0;
+	if( bMultiTex )
+		iFormat|= BACKEND_TEXCOORD1;
+
+	//the buffers only have the color map's texture coordinates, so let
+	//the texture matrix stretch them for a single-texture detail pass
+	if( fTexScale!=1.0f )
+		m_pBackend->SetTextureScale( 0, fTexScale );
+
+	//a draw for every chunk that survived the last cull
+	if( m_bChunking )
+	{
+		SBRUTE_FORCE_CHUNK* pChunk;
+		int i;
+
+		for( i=0, pChunk=m_pChunks; i<m_iNumChunks; i++, pChunk++ )
+		{
+			if( !pChunk->m_bVisible )
+				continue;
+
+			m_pBackend->Draw( m_bufferPrimitive, iFormat, m_pVertexBuffer, m_iNumBufferVertices,
+							  m_uipChunkIndices+pChunk->m_iFirstIndex, pChunk->m_iNumIndices );
+
+			m_iVertsPerFrame+= pChunk->m_iNumVertices;
+			m_iTrisPerFrame += pChunk->m_iNumTriangles;
+		}
+	}
+
+	//the whole height field with one call
+	else
+	{
+		m_pBackend->Draw( m_bufferPrimitive, iFormat, m_pVertexBuffer, m_iNumBufferVertices,
+						  m_uipIndexBuffer, m_iNumBufferIndices );
+
+		//count the same triangles that the per-row strips would have
+		m_iVertsPerFrame+= m_iNumBufferVertices;
+		m_iTrisPerFrame += ( m_iSize-1 )*( m_iSize-2 )*2;
+	}
+
+	if( fTexScale!=1.0f )
+		m_pBackend->SetTextureScale( 0, 1.0f );
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::PrepareBuffers - private
+// Description:		(Re)build the static buffers and the chunks, if they
+//					are missing or out of date
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::PrepareBuffers( void )
+{
+	if( m_bMeshDirty || m_pVertexBuffer==NULL || m_iBufferRepeat!=m_iRepeatDetailMap ||
+		m_bBufferOptimized!=m_bCacheOptimize )
+		BuildBuffers( );
+
+	if( m_bChunking && ( m_pChunks==NULL || m_iBufferChunkSize!=m_iChunkSize ) )
+		BuildChunks( );
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::BuildBuffers - private
+// Description:		Build the vertex buffer for the height field, and
+//					the index buffer if the height field's size (or the
+//					vertex cache option) changed
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::BuildBuffers( void )
+{
+	SBACKEND_VERTEX* pVertex;
+	unsigned char ucShade;
+	int iWidth;
+	int x, z;
+
+	//the rows stop one point short of the edge
+	iWidth= m_iSize-1;
+
+	//the buffers are built every frame when they aren't static, so keep
+	//their memory if the height field is still the same size
+	if( m_pVertexBuffer==NULL || m_iNumBufferVertices!=iWidth*m_iSize )
+	{
+		FreeBuffers( );
+
+		m_iNumBufferVertices= iWidth*m_iSize;
+		m_pVertexBuffer		= new SBACKEND_VERTEX [m_iNumBufferVertices];
+	}
+
+	//the chunks' boxes came from the old heights
+	else if( m_pChunks )
+	{
+		delete[] m_pChunks;
+		delete[] m_uipChunkIndices;
+
+		m_pChunks		   = NULL;
+		m_uipChunkIndices  = NULL;
+		m_iNumChunks	   = 0;
+		m_iNumVisibleChunks= 0;
+	}
+
+	//one vertex for every point, shared by the two rows that use it
+	pVertex= m_pVertexBuffer;
+	for( z=0; z<m_iSize; z++ )
+	{
+		for( x=0; x<iWidth; x++ )
+		{
+			ucShade= GetBrightnessAtPoint( x, z );
+
+			pVertex->m_fPosition[0]	= ( float )x;
+			pVertex->m_fPosition[1]	= GetScaledHeightAtPoint( x, z );
+			pVertex->m_fPosition[2]	= ( float )z;
+			pVertex->m_ucColor[0]	= ( unsigned char )( ucShade*m_vecLightColor[0] );
+			pVertex->m_ucColor[1]	= ( unsigned char )( ucShade*m_vecLightColor[1] );
+			pVertex->m_ucColor[2]	= ( unsigned char )( ucShade*m_vecLightColor[2] );
+			pVertex->m_ucColor[3]	= 255;
+			pVertex->m_fTexCoord0[0]= ( float )x/m_iSize;
+			pVertex->m_fTexCoord0[1]= ( float )z/m_iSize;
+			pVertex->m_fTexCoord1[0]= pVertex->m_fTexCoord0[0]*m_iRepeatDetailMap;
+			pVertex->m_fTexCoord1[1]= pVertex->m_fTexCoord0[1]*m_iRepeatDetailMap;
+			pVertex++;
+		}
+	}
+
+	//the indices only depend on the height field's size
+	if( m_uipIndexBuffer==NULL || m_bBufferOptimized!=m_bCacheOptimize )
+		BuildIndices( );
+
+	m_iBufferRepeat= m_iRepeatDetailMap;
+	m_bMeshDirty   = false;
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::BuildIndices - private
+// Description:		Build the index buffer for the height field: a triangle
+//					strip for each row, joined together, which is turned
+//					into an optimized triangle list if the vertex cache
+//					option is on
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::BuildIndices( void )
+{
+	unsigned int* uipStrip;
+	unsigned int* uipIndex;
+	int iNumStripIndices;
+	int iWidth;
+	int x, z;
+
+	delete[] m_uipIndexBuffer;
+
+	//the rows stop one point short of the edge
+	iWidth			= m_iSize-1;
+	iNumStripIndices= ( m_iSize-1 )*iWidth*2+( m_iSize-2 )*2;
+
+	//a strip for each row, with the last index of a row and the first
+	//index of the next one repeated, to restart the strip
+	uipStrip= new unsigned int [iNumStripIndices];
+	uipIndex= uipStrip;
+	for( z=0; z<m_iSize-1; z++ )
+	{
+		if( z>0 )
+			*uipIndex++= z*iWidth;
+
+		for( x=0; x<iWidth; x++ )
+		{
+			*uipIndex++= z*iWidth+x;
+			*uipIndex++= ( z+1 )*iWidth+x;
 		}
 
-		//loop through the Z-axis of the terrain
-		for( z=0; z<m_iSize-1; z++ )
+		if( z<m_iSize-2 )
+			*uipIndex++= ( z+1 )*iWidth+iWidth-1;
+	}
+
+	if( m_bCacheOptimize )
+	{
+		m_uipIndexBuffer   = new unsigned int [iNumStripIndices*3];
+		m_iNumBufferIndices= OptimizeStrip( uipStrip, iNumStripIndices, m_uipIndexBuffer );
+		m_bufferPrimitive  = BACKEND_TRIANGLES;
+
+		//the average number of vertices transformed for each triangle
+		g_log.Write( LOG_PLAINTEXT, "Ordered %d triangles for the vertex cache: ACMR %.3f (strips), %.3f (ordered)\n",
+					 m_iNumBufferIndices/3,
+					 ( float )CountCacheMisses( uipStrip, iNumStripIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE )*3/m_iNumBufferIndices,
+					 ( float )CountCacheMisses( m_uipIndexBuffer, m_iNumBufferIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE )*3/m_iNumBufferIndices );
+
+		delete[] uipStrip;
+	}
+	else
+	{
+		m_uipIndexBuffer   = uipStrip;
+		m_iNumBufferIndices= iNumStripIndices;
+		m_bufferPrimitive  = BACKEND_TRIANGLE_STRIP;
+	}
+
+	m_bBufferOptimized= m_bCacheOptimize;
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::OptimizeStrip - private
+// Description:		Turn a strip into a triangle list, and reorder it for
+//					the vertex cache
+// Arguments:		-uipStrip: the strip's indices
+//					-iNumIndices: the number of indices in the strip
+//					-uipList: storage for the list (three times the
+//							  strip's size is always enough)
+// Return Value:	An integer value: the number of indices in the list
+//--------------------------------------------------------------
+int CBRUTE_FORCE::OptimizeStrip( const unsigned int* uipStrip, int iNumIndices, unsigned int* uipList )
+{
+	int iNumListIndices;
+
+	iNumListIndices= MakeTriangleList( BACKEND_TRIANGLE_STRIP, uipStrip, iNumIndices, uipList );
+	OptimizeVertexCache( uipList, iNumListIndices, m_iNumBufferVertices );
+
+	return iNumListIndices;
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::BuildChunks - private
+// Description:		Split the height field into chunks: find each one's
+//					bounding box, and build its strip (into the vertex
+//					buffer that BuildBuffers made), which is optimized the
+//					same way as the whole height field's
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::BuildChunks( void )
+{
+	SBRUTE_FORCE_CHUNK* pChunk;
+	unsigned int* uipStrip;
+	unsigned int* uipIndex;
+	int iNumListIndices;
+	float fHeight;
+	int iWidth, iQuadsX, iQuadsZ;
+	int iChunksX, iChunksZ;
+	int iStartX, iStartZ, iEndX, iEndZ;
+	int iTotalIndices;
+	int cx, cz, x, z;
+
+	delete[] m_pChunks;
+	delete[] m_uipChunkIndices;
+
+	//the quads that the static buffers cover (the rows stop one point
+	//short of the edge)
+	iWidth = m_iSize-1;
+	iQuadsX= m_iSize-2;
+	iQuadsZ= m_iSize-1;
+
+	iChunksX	= ( iQuadsX+m_iChunkSize-1 )/m_iChunkSize;
+	iChunksZ	= ( iQuadsZ+m_iChunkSize-1 )/m_iChunkSize;
+	m_iNumChunks= iChunksX*iChunksZ;
+
+	//every chunk gets a strip of its own (with its rows joined by
+	//degenerate triangles), so any set of them can be drawn
+	iTotalIndices= 0;
+	for( cz=0; cz<iChunksZ; cz++ )
+	{
+		for( cx=0; cx<iChunksX; cx++ )
 		{
-			//begin a new triangle strip
-			glBegin( GL_TRIANGLE_STRIP );
+			iEndX= MIN( ( cx+1 )*m_iChunkSize, iQuadsX )-cx*m_iChunkSize;
+			iEndZ= MIN( ( cz+1 )*m_iChunkSize, iQuadsZ )-cz*m_iChunkSize;
 
-				//loop through the X-axis of the terrain
-				//this is where the triangle strip is constructed
-				for( x=0; x<m_iSize-1; x++ )
+			iTotalIndices+= iEndZ*( iEndX+1 )*2+( iEndZ-1 )*2;
+		}
+	}
+
+	m_pChunks= new SBRUTE_FORCE_CHUNK [m_iNumChunks];
+
+	//the optimized lists need room for three indices a triangle, and
+	//each chunk's strip is built somewhere else first
+	if( m_bBufferOptimized )
+	{
+		m_uipChunkIndices= new unsigned int [iTotalIndices*3];
+		uipStrip		 = new unsigned int [iTotalIndices];
+	}
+	else
+	{
+		m_uipChunkIndices= new unsigned int [iTotalIndices];
+		uipStrip		 = m_uipChunkIndices;
+	}
+
+	pChunk			= m_pChunks;
+	uipIndex		= uipStrip;
+	iNumListIndices	= 0;
+	for( cz=0; cz<iChunksZ; cz++ )
+	{
+		for( cx=0; cx<iChunksX; cx++ )
+		{
+			iStartX= cx*m_iChunkSize;
+			iStartZ= cz*m_iChunkSize;
+			iEndX  = MIN( iStartX+m_iChunkSize, iQuadsX );
+			iEndZ  = MIN( iStartZ+m_iChunkSize, iQuadsZ );
+
+			//the box's heights come from every point in the chunk, so the
+			//box is as tight as it can be
+			pChunk->m_fMin[0]= ( float )iStartX;
+			pChunk->m_fMin[1]= GetScaledHeightAtPoint( iStartX, iStartZ );
+			pChunk->m_fMin[2]= ( float )iStartZ;
+			pChunk->m_fMax[0]= ( float )iEndX;
+			pChunk->m_fMax[1]= pChunk->m_fMin[1];
+			pChunk->m_fMax[2]= ( float )iEndZ;
+
+			for( z=iStartZ; z<=iEndZ; z++ )
+			{
+				for( x=iStartX; x<=iEndX; x++ )
 				{
-					//calculate the texture coordinates
-					fTexLeft  = ( float )x/m_iSize;
-					fTexBottom= ( float )z/m_iSize;
-					fTexTop	  = ( float )( z+1 )/m_iSize;
-					
-					//get the brightness for the two points to be rendered
-					ucShadeLow = GetBrightnessAtPoint( x, z );
-					ucShadeHigh= GetBrightnessAtPoint( x, z+1 );
-
-					//set the color with OpenGL, and render the point
-					glColor4ub( ( unsigned char )( ucShadeLow*m_vecLightColor[0] ),
-							    ( unsigned char )( ucShadeLow*m_vecLightColor[1] ),
-							    ( unsigned char )( ucShadeLow*m_vecLightColor[2] ), 255 );
-					glMultiTexCoord2fARB( GL_TEXTURE0_ARB, fTexLeft*m_iRepeatDetailMap, fTexBottom*m_iRepeatDetailMap );
-					glVertex3f( ( float )x, GetScaledHeightAtPoint( x, z ), ( float )z );
-
-					//set the color with OpenGL, and render the point
-					glColor4ub( ( unsigned char )( ucShadeHigh*m_vecLightColor[0] ),
-							    ( unsigned char )( ucShadeHigh*m_vecLightColor[1] ),
-							    ( unsigned char )( ucShadeHigh*m_vecLightColor[2] ), 255 );
-					glMultiTexCoord2fARB( GL_TEXTURE0_ARB, fTexLeft*m_iRepeatDetailMap, fTexTop*m_iRepeatDetailMap );
-					glVertex3f( ( float )x, GetScaledHeightAtPoint( x, z+1 ), ( float )z+1 );
-
-					//increase the vertex count by two (which is how many we sent to the API)
-					m_iVertsPerFrame+= 2;
-
-					//there are no triangles being rendered on the first X-loop, they just start the
-					//triangle strip off
-					if( x!= 0 )
-						m_iTrisPerFrame+= 2;
+					fHeight= GetScaledHeightAtPoint( x, z );
+
+					if( fHeight<pChunk->m_fMin[1] )
+						pChunk->m_fMin[1]= fHeight;
+					if( fHeight>pChunk->m_fMax[1] )
+						pChunk->m_fMax[1]= fHeight;
 				}
+			}
 
-			//end the triangle strip
-			glEnd( );
-		}
+			//the chunk's rows, in the same order that the whole strip has them
+			pChunk->m_iFirstIndex= ( int )( uipIndex-uipStrip );
+			for( z=iStartZ; z<iEndZ; z++ )
+			{
+				if( z>iStartZ )
+					*uipIndex++= z*iWidth+iStartX;
 
-		glDisable( GL_BLEND );
+				for( x=iStartX; x<=iEndX; x++ )
+				{
+					*uipIndex++= z*iWidth+x;
+					*uipIndex++= ( z+1 )*iWidth+x;
+				}
+
+				if( z<iEndZ-1 )
+					*uipIndex++= ( z+1 )*iWidth+iEndX;
+			}
+			pChunk->m_iNumIndices= ( int )( uipIndex-uipStrip )-pChunk->m_iFirstIndex;
+
+			if( m_bBufferOptimized )
+			{
+				pChunk->m_iNumIndices= OptimizeStrip( uipStrip+pChunk->m_iFirstIndex, pChunk->m_iNumIndices,
+													  m_uipChunkIndices+iNumListIndices );
+				pChunk->m_iFirstIndex= iNumListIndices;
+				iNumListIndices		+= pChunk->m_iNumIndices;
+			}
+
+			pChunk->m_iNumVertices = ( iEndX-iStartX+1 )*( iEndZ-iStartZ+1 );
+			pChunk->m_iNumTriangles= ( iEndX-iStartX )*( iEndZ-iStartZ )*2;
+
+			//everything is drawn until the first cull
+			pChunk->m_bVisible= true;
+			pChunk++;
+		}
 	}
-}
\ No newline at end of file
+
+	if( m_bBufferOptimized )
+		delete[] uipStrip;
+
+	m_iNumVisibleChunks= m_iNumChunks;
+	m_iBufferChunkSize = m_iChunkSize;
+
+	g_log.Write( LOG_SUCCESS, "Split the terrain into %d chunks (%dx%d), %d quads per side\n",
+				 m_iNumChunks, iChunksX, iChunksZ, m_iChunkSize );
+}
+
+//--------------------------------------------------------------
+// Name:			CBRUTE_FORCE::FreeBuffers - public
+// Description:		Free the static vertex and index buffers (they are
+//					built again the next time they are needed)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CBRUTE_FORCE::FreeBuffers( void )
+{
+	delete[] m_pVertexBuffer;
+	delete[] m_uipIndexBuffer;
+	delete[] m_pChunks;
+	delete[] m_uipChunkIndices;
+
+	m_pVertexBuffer		= NULL;
+	m_uipIndexBuffer	= NULL;
+	m_iNumBufferVertices= 0;
+	m_iNumBufferIndices = 0;
+
+	//the chunks index into the vertex buffer, so they go with it
+	m_pChunks		   = NULL;
+	m_uipChunkIndices  = NULL;
+	m_iNumChunks	   = 0;
+	m_iNumVisibleChunks= 0;
+}
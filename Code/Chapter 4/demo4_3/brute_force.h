@@ -16,9 +16,35 @@
 //- HEADERS AND LIBRARIES --------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
+#include "../Base Code/camera.h"
+#include "../Base Code/vertex_cache.h"
+
 #include "terrain.h"
 
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+struct SBRUTE_FORCE_CHUNK
+{
+	//the chunk's bounding box (the heights are the exact lowest and
+	//highest points inside of the chunk)
+	float m_fMin[3];
+	float m_fMax[3];
+
+	//the chunk's indices, in the chunk index buffer
+	int m_iFirstIndex;
+	int m_iNumIndices;
+
+	int m_iNumVertices;
+	int m_iNumTriangles;
+
+	bool m_bVisible;
+};
+
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- CLASS ------------------------------------------------------
@@ -27,18 +53,107 @@
 class CBRUTE_FORCE : public CTERRAIN
 {
 	private:
+		//the whole height field, built once: one vertex for each point,
+		//and the rows joined into a single triangle strip (with degenerate
+		//triangles between them), or a triangle list that is ordered for
+		//the vertex cache
+		SBACKEND_VERTEX* m_pVertexBuffer;
+		unsigned int*	 m_uipIndexBuffer;
+		int	 m_iNumBufferVertices;
+		int	 m_iNumBufferIndices;
+		int	 m_iBufferRepeat;		//the detail map repeat that the buffers were built with
+		bool m_bStaticBuffers;
+		EBACKEND_PRIMITIVES m_bufferPrimitive;
+		bool m_bCacheOptimize;
+		bool m_bBufferOptimized;	//the vertex cache option that the indices were built with
+
+		//the height field split into square chunks, each with its own strip
+		//into the vertex buffer, which is only drawn when the chunk's box is
+		//inside of the view frustum
+		SBRUTE_FORCE_CHUNK* m_pChunks;
+		unsigned int* m_uipChunkIndices;
+		int	 m_iNumChunks;
+		int	 m_iNumVisibleChunks;
+		int	 m_iChunkSize;			//the size of a chunk's side, in quads
+		int	 m_iBufferChunkSize;	//the chunk size that the chunks were built with
+		bool m_bChunking;
 
+	void PrepareBuffers( void );
+	void BuildBuffers( void );
+	void BuildIndices( void );
+	void BuildChunks( void );
+	int	 OptimizeStrip( const unsigned int* uipStrip, int iNumIndices, unsigned int* uipList );
+	void RenderBuffers( bool bMultiTex, float fTexScale );
 	
 	public:
 
-	
+	void Update( CCAMERA camera );
 	void Render( void );
 
+	void FreeBuffers( void );
+
+	//--------------------------------------------------------------
+	// Name:			CBRUTE_FORCE::DoStaticBuffers - public
+	// Description:		Only build the vertex/index buffers when the terrain
+	//					changes, instead of building them again every frame
+	// Arguments:		-bDo: use the static buffers or not
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoStaticBuffers( bool bDo )
+	{	m_bStaticBuffers= bDo;	}
 
-	CBRUTE_FORCE( void )
+	//--------------------------------------------------------------
+	// Name:			CBRUTE_FORCE::DoCacheOptimization - public
+	// Description:		Draw the buffers (and the chunks) as triangle lists
+	//					that are ordered for the vertex cache, instead of as
+	//					row strips (which transform almost every vertex twice)
+	// Arguments:		-bDo: optimize the buffers or not
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoCacheOptimization( bool bDo )
+	{	m_bCacheOptimize= bDo;	}
+
+	//--------------------------------------------------------------
+	// Name:			CBRUTE_FORCE::DoChunking - public
+	// Description:		Split the terrain into chunks that are culled
+	//					against the view frustum (in Update) before they
+	//					are drawn.  The chunks use the static buffers.
+	// Arguments:		-bDo: use chunks or not
+	//					-iChunkSize: the size of a chunk's side, in quads
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoChunking( bool bDo, int iChunkSize= 32 )
+	{
+		m_bChunking = bDo;
+		m_iChunkSize= ( iChunkSize>0 ) ? iChunkSize : 1;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CBRUTE_FORCE::GetNumChunks - public
+	// Description:		Get the number of chunks that the terrain is split into
+	// Arguments:		None
+	// Return Value:	An integer value: the number of chunks
+	//--------------------------------------------------------------
+	inline int GetNumChunks( void )
+	{	return m_iNumChunks;	}
+
+	//--------------------------------------------------------------
+	// Name:			CBRUTE_FORCE::GetNumVisibleChunks - public
+	// Description:		Get the number of chunks that passed the last cull
+	// Arguments:		None
+	// Return Value:	An integer value: the number of visible chunks
+	//--------------------------------------------------------------
+	inline int GetNumVisibleChunks( void )
+	{	return m_iNumVisibleChunks;	}
+
+	CBRUTE_FORCE( void ) : m_pVertexBuffer( NULL ), m_uipIndexBuffer( NULL ), m_iNumBufferVertices( 0 ),
+						   m_iNumBufferIndices( 0 ), m_iBufferRepeat( 0 ), m_bStaticBuffers( false ),
+						   m_bufferPrimitive( BACKEND_TRIANGLE_STRIP ), m_bCacheOptimize( false ), m_bBufferOptimized( false ),
+						   m_pChunks( NULL ), m_uipChunkIndices( NULL ), m_iNumChunks( 0 ), m_iNumVisibleChunks( 0 ),
+						   m_iChunkSize( 32 ), m_iBufferChunkSize( 0 ), m_bChunking( false )
 	{	}
 	~CBRUTE_FORCE( void )
-	{	}
+	{	FreeBuffers( );	}
 };
 
 #endif	//__BRUTE_FORCE_H__
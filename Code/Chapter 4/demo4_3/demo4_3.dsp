@@ -162,8 +162,32 @@ SOURCE="..\Base Code\math_ops.h"
 # End Source File
 # Begin Source File
 
+SOURCE="..\Base Code\render_backend.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_backend.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_stats.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_stats.h"
+# End Source File
+# Begin Source File
+
 SOURCE="..\Base Code\timer.h"
 # End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\vertex_cache.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\vertex_cache.h"
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
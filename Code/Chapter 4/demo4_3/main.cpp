@@ -60,6 +60,10 @@ int g_iCurrentHeightmap= 0;
 
 bool g_bTexture= true;
 bool g_bDetail = true;
+bool g_bStaticBuffers= true;
+bool g_bChunking	 = true;
+int  g_iChunkSize	 = 32;
+bool g_bCacheOrder	 = true;
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -148,10 +152,19 @@ void DemoRender( void )
 	//setup the terrain
 	g_bruteForce.DoTextureMapping( g_bTexture );
 	g_bruteForce.DoDetailMapping( g_bDetail, 8 );
+	g_bruteForce.DoStaticBuffers( g_bStaticBuffers );
+	g_bruteForce.DoChunking( g_bChunking, g_iChunkSize );
+	g_bruteForce.DoCacheOptimization( g_bCacheOrder );
 
 	//render the simple terrain!
 	glPushMatrix( );
 		glScalef( 2.0f, 2.0f, 2.0f );
+
+		//the frustum is calculated after the scale, so that it is in the
+		//terrain's own space (which is where the chunks' boxes are)
+		g_camera.CalculateViewFrustum( );
+		g_bruteForce.Update( g_camera );
+
 		g_bruteForce.Render( );
 	glPopMatrix( );
 
@@ -179,6 +192,22 @@ void DemoRender( void )
 			g_glApp.Print( 0, g_iScreenHeight-90, CVECTOR( 0.0f, 1.0f, 0.0f), "Detail Mapping: Enabled", g_glApp.GetFPS( ) );
 		else
 			g_glApp.Print( 0, g_iScreenHeight-90, CVECTOR( 0.0f, 1.0f, 0.0f), "Detail Mapping: Disabled", g_glApp.GetFPS( ) );
+
+		if( g_bStaticBuffers )
+			g_glApp.Print( 0, g_iScreenHeight-110, CVECTOR( 0.0f, 1.0f, 0.0f), "Static Buffers: Enabled" );
+		else
+			g_glApp.Print( 0, g_iScreenHeight-110, CVECTOR( 0.0f, 1.0f, 0.0f), "Static Buffers: Disabled" );
+
+		if( g_bChunking )
+			g_glApp.Print( 0, g_iScreenHeight-130, CVECTOR( 0.0f, 1.0f, 0.0f), "Chunks (%d quads): %d/%d visible",
+						   g_iChunkSize, g_bruteForce.GetNumVisibleChunks( ), g_bruteForce.GetNumChunks( ) );
+		else
+			g_glApp.Print( 0, g_iScreenHeight-130, CVECTOR( 0.0f, 1.0f, 0.0f), "Chunks: Disabled" );
+
+		if( g_bCacheOrder )
+			g_glApp.Print( 0, g_iScreenHeight-150, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Enabled" );
+		else
+			g_glApp.Print( 0, g_iScreenHeight-150, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Disabled" );
 	g_glApp.EndTextMode( );
 
 	//force a render finish, and then swap buffers
@@ -195,6 +224,7 @@ void DemoRender( void )
 //--------------------------------------------------------------
 bool DemoShutdown( void )
 {
+	g_bruteForce.FreeBuffers( );
 	g_bruteForce.UnloadAllTiles( );
 	g_bruteForce.UnloadTexture( );
 	g_bruteForce.UnloadHeightMap( );
@@ -287,6 +317,82 @@ bool DemoInput( void )
 		iToggleWait= 0;
 	}
 
+	//toggle the static vertex/index buffers
+	if( g_glApp.KeyDown( 'B' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bStaticBuffers )
+			g_bStaticBuffers= false;
+
+		else
+			g_bStaticBuffers= true;
+
+		iToggleWait= 0;
+	}
+
+	//toggle the chunk culling
+	if( g_glApp.KeyDown( 'C' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bChunking )
+			g_bChunking= false;
+
+		else
+			g_bChunking= true;
+
+		iToggleWait= 0;
+	}
+
+	//toggle the vertex cache ordered triangle lists
+	if( g_glApp.KeyDown( 'V' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bCacheOrder )
+			g_bCacheOrder= false;
+
+		else
+			g_bCacheOrder= true;
+
+		iToggleWait= 0;
+	}
+
+	//make the chunks bigger
+	if( g_glApp.KeyDown( VK_PRIOR ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		g_iChunkSize*= 2;
+		if( g_iChunkSize>128 )
+			g_iChunkSize= 128;
+
+		iToggleWait= 0;
+	}
+
+	//make the chunks smaller
+	else if( g_glApp.KeyDown( VK_NEXT ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		g_iChunkSize/= 2;
+		if( g_iChunkSize<4 )
+			g_iChunkSize= 4;
+
+		iToggleWait= 0;
+	}
+
 	//toggle texture mapping
 	if( g_glApp.KeyDown( 'T' ) )
 	{
@@ -41,6 +41,9 @@ bool CTERRAIN::LoadHeightMap( char* szFilename, int iSize )
 {
 	FILE* pFile;
 
+	//any meshes that were built from the old height map are out of date
+	m_bMeshDirty= true;
+
 	//check to see if the data has been set
 	if( m_heightData.m_ucpData )
 		UnloadHeightMap( );
@@ -126,6 +129,9 @@ bool CTERRAIN::SaveHeightMap( char* szFilename )
 //--------------------------------------------------------------
 void CTERRAIN::UnloadHeightMap( void )
 {
+	//any meshes that were built from the old height map are out of date
+	m_bMeshDirty= true;
+
 	//check to see if the data has been set
 	if( m_heightData.m_ucpData )
 	{
@@ -256,6 +262,9 @@ bool CTERRAIN::MakeTerrainFault( int iSize, int iIterations, int iMinDelta, int
 	int x, z;
 	int i;
 
+	//any meshes that were built from the old height map are out of date
+	m_bMeshDirty= true;
+
 	if( m_heightData.m_ucpData )
 		UnloadHeightMap( );
 
@@ -371,6 +380,9 @@ bool CTERRAIN::MakeTerrainPlasma( int iSize, float fRoughness )
 	int i, j;
 	int x, z;
 
+	//any meshes that were built from the old height map are out of date
+	m_bMeshDirty= true;
+
 	if( m_heightData.m_ucpData )
 		UnloadHeightMap( );
 
@@ -820,6 +832,9 @@ bool CTERRAIN::LoadLightMap( char* szFilename, int iSize )
 {
 	FILE* pFile;
 
+	//any meshes that were built from the old lightmap are out of date
+	m_bMeshDirty= true;
+
 	//check to see if the data has been set
 	if( m_lightmap.m_ucpData )
 		UnloadLightMap( );
@@ -905,6 +920,9 @@ bool CTERRAIN::SaveLightMap( char* szFilename )
 //--------------------------------------------------------------
 void CTERRAIN::UnloadLightMap( void )
 {
+	//any meshes that were built from the old lightmap are out of date
+	m_bMeshDirty= true;
+
 	//check to see if the data has been set
 	if( m_lightmap.m_ucpData )
 	{
@@ -942,6 +960,9 @@ void CTERRAIN::CalculateLighting( void )
 	if( m_lightingType==LIGHTMAP )
 		return;
 
+	//any meshes that were built from the old lightmap are out of date
+	m_bMeshDirty= true;
+
 	//allocate memory if it is needed
 	if( m_lightmap.m_iSize!=m_iSize || m_lightmap.m_ucpData==NULL )
 	{
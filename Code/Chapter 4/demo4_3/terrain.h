@@ -21,6 +21,7 @@
 #include <stdlib.h>
 
 #include "../Base Code/image.h"
+#include "../Base Code/render_backend.h"
 
 
 //--------------------------------------------------------------
@@ -107,6 +108,14 @@ class CTERRAIN
 		float m_fLightSoftness;//ƹͶ
 		int m_iDirectionX, m_iDirectionZ;//ƹⷽx\z
 
+		//what the terrain is drawn with (OpenGL, unless told otherwise)
+		CRENDER_BACKEND* m_pBackend;
+
+		//set whenever the height map, the lightmap or the light color
+		//changes, so that renderers with prebuilt meshes know to rebuild
+		//them (the renderer clears it)
+		bool m_bMeshDirty;
+
 		int m_iVertsPerFrame;		//stat variables
 		int m_iTrisPerFrame;
 
@@ -195,7 +204,10 @@ class CTERRAIN
 	// Return Value:	None
 	//--------------------------------------------------------------
 	inline void SetHeightScale( float fScale )
-	{	m_fHeightScale= fScale;	}
+	{
+		m_fHeightScale= fScale;
+		m_bMeshDirty  = true;
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::SetHeightAtPoint - public
@@ -205,7 +217,10 @@ class CTERRAIN
 	// Return Value:	None
 	//--------------------------------------------------------------
 	inline void SetHeightAtPoint( unsigned char ucHeight, int x, int z)
-	{	m_heightData.m_ucpData[( z*m_iSize )+x]= ucHeight;	}
+	{
+		m_heightData.m_ucpData[( z*m_iSize )+x]= ucHeight;
+		m_bMeshDirty= true;
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::GetTrueHeightAtPoint - public
@@ -312,6 +327,15 @@ class CTERRAIN
 	inline void DoMultitexturing( bool bDo )
 	{	m_bMultitexture= bDo;	}
 
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::SetRenderBackend - public
+	// Description:		Set what the terrain is drawn with
+	// Arguments:		-pBackend: the backend (NULL for OpenGL)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetRenderBackend( CRENDER_BACKEND* pBackend )
+	{	m_pBackend= pBackend ? pBackend : &g_glBackend;	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::LoadTile - public
 	// Description:		Load a single tile for the texture generation
@@ -365,7 +389,10 @@ class CTERRAIN
 	// Return Value:	None
 	//--------------------------------------------------------------
 	inline void SetBrightnessAtPoint( int x, int z, unsigned char ucBrightness )
-	{	m_lightmap.m_ucpData[( z*m_lightmap.m_iSize )+x]= ucBrightness;	}
+	{
+		m_lightmap.m_ucpData[( z*m_lightmap.m_iSize )+x]= ucBrightness;
+		m_bMeshDirty= true;
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::GetBrightnessAtPoint - public
@@ -384,7 +411,10 @@ class CTERRAIN
 	// Return Value:	None
 	//--------------------------------------------------------------
 	inline void SetLightColor( CVECTOR vecColor )
-	{	m_vecLightColor= vecColor;	}
+	{
+		m_vecLightColor= vecColor;
+		m_bMeshDirty   = true;
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::CustomizeSlopeLighting - public
@@ -411,7 +441,7 @@ class CTERRAIN
 		m_fLightSoftness= fSoftness;
 	}
 
-	CTERRAIN( void ) : m_vecLightColor( 1.0f, 1.0f, 1.0f )
+	CTERRAIN( void ) : m_vecLightColor( 1.0f, 1.0f, 1.0f ), m_pBackend( &g_glBackend ), m_bMeshDirty( true )
 	{	}
 	~CTERRAIN( void )
 	{	}
@@ -0,0 +1,839 @@
+//==============================================================
+//==============================================================
+//= render_backend.cpp =========================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= A thin layer between the engines and the rendering API.	   =
+//= The OpenGL backend draws for real; the recording backend   =
+//= only counts (and optionally keeps) what it is given, so	   =
+//= the engines can be run and timed without a video card.	   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "gl_app.h"
+#include "render_backend.h"
+#include "render_stats.h"
+#include "vertex_cache.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+CGL_BACKEND g_glBackend;
+
+//the OpenGL versions of the backend's enumerations (global (this file only))
+static const GLenum g_glPrimitives[3]= { GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN };
+static const GLenum g_glStates[BACKEND_NUM_STATES]= { GL_CULL_FACE, GL_BLEND, GL_DEPTH_TEST, 0, GL_TEXTURE_2D, GL_TEXTURE_2D, GL_FOG };
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CRENDER_BACKEND::GrowVertices - protected
+// Description:		Make room for more vertices between Begin and End
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_BACKEND::GrowVertices( void )
+{
+	SBACKEND_VERTEX* pNewVertices;
+	int iNewMax;
+
+	iNewMax= m_iMaxVertices ? m_iMaxVertices*2 : 256;
+
+	pNewVertices= new SBACKEND_VERTEX [iNewMax];
+	if( m_iNumVertices )
+		memcpy( pNewVertices, m_pVertices, m_iNumVertices*sizeof( SBACKEND_VERTEX ) );
+
+	delete[] m_pVertices;
+	m_pVertices	  = pNewVertices;
+	m_iMaxVertices= iNewMax;
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::SetState - public
+// Description:		Turn a piece of rendering state on or off
+// Arguments:		-state: the state to change
+//					-bEnable: turn it on or off
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::SetState( EBACKEND_STATES state, bool bEnable )
+{
+	STATS_TOGGLES( 1 );
+
+	if( state==BACKEND_DEPTH_WRITE )
+	{
+		glDepthMask( bEnable ? GL_TRUE : GL_FALSE );
+		return;
+	}
+
+	if( state==BACKEND_TEXTURE0 )
+		glActiveTextureARB( GL_TEXTURE0_ARB );
+	else if( state==BACKEND_TEXTURE1 )
+		glActiveTextureARB( GL_TEXTURE1_ARB );
+
+	if( bEnable )
+		glEnable( g_glStates[state] );
+	else
+		glDisable( g_glStates[state] );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::BindTexture - public
+// Description:		Bind a texture to a texture unit
+// Arguments:		-iUnit: the texture unit (0 or 1)
+//					-uiID: the OpenGL texture ID
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::BindTexture( int iUnit, unsigned int uiID )
+{
+	STATS_BINDS( 1 );
+
+	glActiveTextureARB( GL_TEXTURE0_ARB+iUnit );
+	glBindTexture( GL_TEXTURE_2D, uiID );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::SetBlendMode - public
+// Description:		Set how blended primitives are combined with what
+//					is already in the frame buffer
+// Arguments:		-mode: the blend mode
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::SetBlendMode( EBACKEND_BLEND_MODES mode )
+{
+	STATS_CHANGES( 1 );
+
+	if( mode==BACKEND_BLEND_MULTIPLY )
+		glBlendFunc( GL_ZERO, GL_SRC_COLOR );
+	else
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::SetCombineMode - public
+// Description:		Set how a texture unit combines its texture with
+//					the incoming color
+// Arguments:		-iUnit: the texture unit (0 or 1)
+//					-mode: the combine mode
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::SetCombineMode( int iUnit, EBACKEND_COMBINE_MODES mode )
+{
+	STATS_CHANGES( 1 );
+
+	glActiveTextureARB( GL_TEXTURE0_ARB+iUnit );
+
+	if( mode==BACKEND_COMBINE_DETAIL )
+	{
+		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB );
+		glTexEnvi( GL_TEXTURE_ENV, GL_RGB_SCALE_ARB, 2 );
+	}
+	else
+		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::SetTextureScale - public
+// Description:		Scale the texture coordinates that a texture unit
+//					gets (with the texture matrix), so that a texture can
+//					be repeated without new texture coordinates
+// Arguments:		-iUnit: the texture unit (0 or 1)
+//					-fScale: the scale (1 for none)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::SetTextureScale( int iUnit, float fScale )
+{
+	STATS_CHANGES( 1 );
+
+	glActiveTextureARB( GL_TEXTURE0_ARB+iUnit );
+
+	glMatrixMode( GL_TEXTURE );
+	glLoadIdentity( );
+	if( fScale!=1.0f )
+		glScalef( fScale, fScale, 1.0f );
+	glMatrixMode( GL_MODELVIEW );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::GetModelview - public
+// Description:		Get the current modelview matrix
+// Arguments:		-fpMatrix: storage for the matrix (16 floats)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::GetModelview( float* fpMatrix )
+{
+	glGetFloatv( GL_MODELVIEW_MATRIX, fpMatrix );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::Draw - public
+// Description:		Draw a vertex stream (with vertex arrays when the
+//					format allows it, and immediate mode otherwise)
+// Arguments:		-primitive: the type of primitive
+//					-iFormat: the vertex format flags (BACKEND_*)
+//					-pVertices: the vertex stream
+//					-iNumVertices: the number of vertices
+//					-uipIndices: the index stream (NULL to draw the vertices
+//								 in order)
+//					-iNumIndices: the number of indices
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::Draw( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+						const unsigned int* uipIndices, int iNumIndices )
+{
+	int iCount= uipIndices ? iNumIndices : iNumVertices;
+
+	//the fog coordinate can't be given as an array (without another
+	//extension), so those primitives are sent a vertex at a time
+	if( ( iFormat & BACKEND_FOGCOORD ) || ( ( iFormat & BACKEND_TEXCOORD1 ) && !glClientActiveTextureARB ) )
+	{
+		DrawImmediate( primitive, iFormat, pVertices, uipIndices, iCount );
+		return;
+	}
+
+	STATS_BATCH( primitive==BACKEND_TRIANGLES ? iCount/3 : iCount-2, iCount );
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, sizeof( SBACKEND_VERTEX ), pVertices->m_fPosition );
+
+	if( iFormat & BACKEND_COLOR )
+	{
+		glEnableClientState( GL_COLOR_ARRAY );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( SBACKEND_VERTEX ), pVertices->m_ucColor );
+	}
+
+	if( iFormat & BACKEND_NORMAL )
+	{
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glNormalPointer( GL_FLOAT, sizeof( SBACKEND_VERTEX ), pVertices->m_fNormal );
+	}
+
+	if( iFormat & BACKEND_TEXCOORD1 )
+	{
+		glClientActiveTextureARB( GL_TEXTURE1_ARB );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( SBACKEND_VERTEX ), pVertices->m_fTexCoord1 );
+	}
+
+	if( iFormat & BACKEND_TEXCOORD0 )
+	{
+		if( glClientActiveTextureARB )
+			glClientActiveTextureARB( GL_TEXTURE0_ARB );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( SBACKEND_VERTEX ), pVertices->m_fTexCoord0 );
+	}
+
+	if( uipIndices )
+		glDrawElements( g_glPrimitives[primitive], iNumIndices, GL_UNSIGNED_INT, uipIndices );
+	else
+		glDrawArrays( g_glPrimitives[primitive], 0, iNumVertices );
+
+	//leave the client state the way the rest of the code expects it
+	if( iFormat & BACKEND_TEXCOORD1 )
+	{
+		glClientActiveTextureARB( GL_TEXTURE1_ARB );
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		glClientActiveTextureARB( GL_TEXTURE0_ARB );
+	}
+	if( iFormat & BACKEND_TEXCOORD0 )
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	if( iFormat & BACKEND_NORMAL )
+		glDisableClientState( GL_NORMAL_ARRAY );
+	if( iFormat & BACKEND_COLOR )
+		glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+}
+
+//--------------------------------------------------------------
+// Name:			CGL_BACKEND::DrawImmediate - private
+// Description:		Draw a vertex stream a vertex at a time
+// Arguments:		-primitive: the type of primitive
+//					-iFormat: the vertex format flags (BACKEND_*)
+//					-pVertices: the vertex stream
+//					-uipIndices: the index stream (NULL to draw the vertices
+//								 in order)
+//					-iCount: the number of vertices (or indices) to send
+// Return Value:	None
+//--------------------------------------------------------------
+void CGL_BACKEND::DrawImmediate( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices,
+								 const unsigned int* uipIndices, int iCount )
+{
+	const SBACKEND_VERTEX* pVertex;
+	int i;
+
+	STATS_IMMEDIATE( primitive==BACKEND_TRIANGLES ? iCount/3 : iCount-2, iCount );
+
+	glBegin( g_glPrimitives[primitive] );
+	for( i=0; i<iCount; i++ )
+	{
+		pVertex= uipIndices ? &pVertices[uipIndices[i]] : &pVertices[i];
+
+		if( iFormat & BACKEND_COLOR )
+			glColor4ubv( pVertex->m_ucColor );
+
+		if( iFormat & BACKEND_TEXCOORD0 )
+			glMultiTexCoord2fARB( GL_TEXTURE0_ARB, pVertex->m_fTexCoord0[0], pVertex->m_fTexCoord0[1] );
+		if( iFormat & BACKEND_TEXCOORD1 )
+			glMultiTexCoord2fARB( GL_TEXTURE1_ARB, pVertex->m_fTexCoord1[0], pVertex->m_fTexCoord1[1] );
+
+		if( ( iFormat & BACKEND_FOGCOORD ) && glFogCoordfEXT )
+			glFogCoordfEXT( pVertex->m_fFogCoord );
+
+		if( iFormat & BACKEND_NORMAL )
+			glNormal3fv( pVertex->m_fNormal );
+
+		glVertex3fv( pVertex->m_fPosition );
+	}
+	glEnd( );
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::CRECORDING_BACKEND - public
+// Description:		Set the recording backend up (everything off, and an
+//					identity modelview matrix)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+CRECORDING_BACKEND::CRECORDING_BACKEND( void )
+{
+	int i;
+
+	for( i=0; i<BACKEND_NUM_STATES; i++ )
+		m_bStates[i]= false;
+	m_bStates[BACKEND_DEPTH_WRITE]= true;
+
+	for( i=0; i<BACKEND_MAX_TEXTURE_UNITS; i++ )
+	{
+		m_uiTextures[i]	   = 0;
+		m_iCombineModes[i] = BACKEND_COMBINE_MODULATE;
+		m_fTextureScales[i]= 1.0f;
+	}
+	m_iBlendMode= -1;
+
+	for( i=0; i<16; i++ )
+		m_fModelview[i]= ( i%5==0 ) ? 1.0f : 0.0f;
+
+	m_bRecording		 = false;
+	m_fpPositions		 = NULL;
+	m_iNumPositions		 = 0;
+	m_iMaxPositions		 = 0;
+	m_uipTriangles		 = NULL;
+	m_iNumTriangleIndices= 0;
+	m_iMaxTriangleIndices= 0;
+
+	m_bMeasureCache	  = false;
+	m_uipCacheList	  = NULL;
+	m_iMaxCacheIndices= 0;
+
+	ResetStats( );
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::~CRECORDING_BACKEND - public
+// Description:		Free any recorded geometry
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+CRECORDING_BACKEND::~CRECORDING_BACKEND( void )
+{
+	delete[] m_fpPositions;
+	delete[] m_uipTriangles;
+	delete[] m_uipCacheList;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::SetState - public
+// Description:		Count a change to a piece of rendering state
+// Arguments:		-state: the state to change
+//					-bEnable: turn it on or off
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::SetState( EBACKEND_STATES state, bool bEnable )
+{
+	CountStateChange( m_bStates[state]==bEnable );
+	m_bStates[state]= bEnable;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::BindTexture - public
+// Description:		Count a texture bind
+// Arguments:		-iUnit: the texture unit (0 or 1)
+//					-uiID: the texture ID
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::BindTexture( int iUnit, unsigned int uiID )
+{
+	CountStateChange( m_uiTextures[iUnit]==uiID );
+	m_uiTextures[iUnit]= uiID;
+
+	m_iNumTextureBinds++;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::SetBlendMode - public
+// Description:		Count a blend mode change
+// Arguments:		-mode: the blend mode
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::SetBlendMode( EBACKEND_BLEND_MODES mode )
+{
+	CountStateChange( m_iBlendMode==mode );
+	m_iBlendMode= mode;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::SetCombineMode - public
+// Description:		Count a texture combine mode change
+// Arguments:		-iUnit: the texture unit (0 or 1)
+//					-mode: the combine mode
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::SetCombineMode( int iUnit, EBACKEND_COMBINE_MODES mode )
+{
+	CountStateChange( m_iCombineModes[iUnit]==mode );
+	m_iCombineModes[iUnit]= mode;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::SetTextureScale - public
+// Description:		Count a texture coordinate scale change
+// Arguments:		-iUnit: the texture unit (0 or 1)
+//					-fScale: the scale (1 for none)
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::SetTextureScale( int iUnit, float fScale )
+{
+	CountStateChange( m_fTextureScales[iUnit]==fScale );
+	m_fTextureScales[iUnit]= fScale;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::GetModelview - public
+// Description:		Get the modelview matrix last given to SetModelview
+// Arguments:		-fpMatrix: storage for the matrix (16 floats)
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::GetModelview( float* fpMatrix )
+{
+	memcpy( fpMatrix, m_fModelview, 16*sizeof( float ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::SetModelview - public
+// Description:		Set the matrix that GetModelview hands back (there
+//					is no OpenGL matrix stack to ask)
+// Arguments:		-fpMatrix: the matrix (16 floats)
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::SetModelview( const float* fpMatrix )
+{
+	memcpy( m_fModelview, fpMatrix, 16*sizeof( float ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::Draw - public
+// Description:		Count (and maybe record) a vertex stream
+// Arguments:		-primitive: the type of primitive
+//					-iFormat: the vertex format flags
+//					-pVertices: the vertex stream
+//					-iNumVertices: the number of vertices
+//					-uipIndices: the index stream (NULL to use the vertices
+//								 in order)
+//					-iNumIndices: the number of indices
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::Draw( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+							   const unsigned int* uipIndices, int iNumIndices )
+{
+	int iCount= uipIndices ? iNumIndices : iNumVertices;
+
+	m_iNumDrawCalls++;
+	m_iNumVerticesDrawn+= iNumVertices;
+	m_iFormatsDrawn	   |= iFormat;
+	if( uipIndices )
+		m_iNumIndicesDrawn+= iNumIndices;
+
+	if( primitive==BACKEND_TRIANGLES )
+		m_iNumTrianglesDrawn+= iCount/3;
+	else if( iCount>2 )
+		m_iNumTrianglesDrawn+= iCount-2;
+
+	if( m_bRecording )
+		RecordGeometry( primitive, pVertices, iNumVertices, uipIndices, iNumIndices );
+
+	if( m_bMeasureCache )
+		MeasureCache( primitive, iNumVertices, uipIndices, iNumIndices );
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::ResetStats - public
+// Description:		Zero all of the statistics (usually once a frame)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::ResetStats( void )
+{
+	m_iNumDrawCalls		   = 0;
+	m_iNumVerticesDrawn	   = 0;
+	m_iNumIndicesDrawn	   = 0;
+	m_iNumTrianglesDrawn   = 0;
+	m_iNumStateChanges	   = 0;
+	m_iNumRedundantChanges = 0;
+	m_iNumTextureBinds	   = 0;
+	m_iFormatsDrawn		   = 0;
+
+	m_iNumCacheTriangles		  = 0;
+	m_iNumCacheUniques			  = 0;
+	m_iNumCacheMisses[VCACHE_FIFO]= 0;
+	m_iNumCacheMisses[VCACHE_LRU] = 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::LogStats - public
+// Description:		Write the statistics to the log
+// Arguments:		-szName: what was being drawn (for the log entry)
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::LogStats( char* szName )
+{
+	g_log.Write( LOG_PLAINTEXT, "%s: %d draw calls, %d vertices, %d indices, %d triangles, %d state changes (%d redundant, %d texture binds)",
+				 szName, m_iNumDrawCalls, m_iNumVerticesDrawn, m_iNumIndicesDrawn, m_iNumTrianglesDrawn,
+				 m_iNumStateChanges, m_iNumRedundantChanges, m_iNumTextureBinds );
+
+	g_log.Write( LOG_PLAINTEXT, "%s: vertices sent with positions%s%s%s%s%s", szName,
+				 ( m_iFormatsDrawn & BACKEND_COLOR )	 ? ", colors" : "",
+				 ( m_iFormatsDrawn & BACKEND_NORMAL )	 ? ", normals" : "",
+				 ( m_iFormatsDrawn & BACKEND_TEXCOORD0 ) ? ", texture coordinates" : "",
+				 ( m_iFormatsDrawn & BACKEND_TEXCOORD1 ) ? ", detail texture coordinates" : "",
+				 ( m_iFormatsDrawn & BACKEND_FOGCOORD )	 ? ", fog coordinates" : "" );
+
+	if( m_iNumCacheTriangles )
+	{
+		g_log.Write( LOG_PLAINTEXT, "%s: vertex cache ACMR %.3f/%.3f, ATVR %.3f/%.3f (%d-entry FIFO/%d-entry LRU)",
+					 szName, GetACMR( VCACHE_FIFO ), GetACMR( VCACHE_LRU ), GetATVR( VCACHE_FIFO ), GetATVR( VCACHE_LRU ),
+					 VCACHE_FIFO_SIZE, VCACHE_LRU_SIZE );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::GetACMR - public
+// Description:		Get the average cache miss ratio since the last reset:
+//					the vertices transformed for each triangle (0.5 is the
+//					best that a big grid can do, 3 the worst)
+// Arguments:		-iCacheType: the simulated cache (VCACHE_*)
+// Return Value:	A floating-point value: the ACMR (0 if nothing was
+//					measured)
+//--------------------------------------------------------------
+float CRECORDING_BACKEND::GetACMR( int iCacheType )
+{
+	if( m_iNumCacheTriangles==0 )
+		return 0.0f;
+
+	return ( float )m_iNumCacheMisses[iCacheType]/m_iNumCacheTriangles;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::GetATVR - public
+// Description:		Get the average transform to vertex ratio since the
+//					last reset: the vertices transformed for each vertex
+//					used (1 is perfect)
+// Arguments:		-iCacheType: the simulated cache (VCACHE_*)
+// Return Value:	A floating-point value: the ATVR (0 if nothing was
+//					measured)
+//--------------------------------------------------------------
+float CRECORDING_BACKEND::GetATVR( int iCacheType )
+{
+	if( m_iNumCacheUniques==0 )
+		return 0.0f;
+
+	return ( float )m_iNumCacheMisses[iCacheType]/m_iNumCacheUniques;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::StartRecording - public
+// Description:		Throw away any recorded geometry, and start keeping
+//					every triangle that is drawn
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::StartRecording( void )
+{
+	m_iNumPositions		 = 0;
+	m_iNumTriangleIndices= 0;
+	m_bRecording		 = true;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::StopRecording - public
+// Description:		Stop keeping triangles (what was kept stays around
+//					until the next StartRecording)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::StopRecording( void )
+{
+	m_bRecording= false;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::SaveOBJ - public
+// Description:		Write the recorded geometry to a Wavefront .obj file
+// Arguments:		-szFilename: the file to write
+// Return Value:	A boolean value: -true: the file was written
+//									 -false: the file could not be written
+//--------------------------------------------------------------
+bool CRECORDING_BACKEND::SaveOBJ( char* szFilename )
+{
+	FILE* pFile;
+	int i;
+
+	pFile= fopen( szFilename, "w" );
+	if( pFile==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not open %s to save the recorded geometry", szFilename );
+		return false;
+	}
+
+	fprintf( pFile, "# %d vertices, %d triangles\n", m_iNumPositions, m_iNumTriangleIndices/3 );
+
+	for( i=0; i<m_iNumPositions; i++ )
+		fprintf( pFile, "v %f %f %f\n", m_fpPositions[i*3], m_fpPositions[i*3+1], m_fpPositions[i*3+2] );
+
+	//.obj indices start at 1
+	for( i=0; i<m_iNumTriangleIndices; i+=3 )
+		fprintf( pFile, "f %u %u %u\n", m_uipTriangles[i]+1, m_uipTriangles[i+1]+1, m_uipTriangles[i+2]+1 );
+
+	fclose( pFile );
+
+	g_log.Write( LOG_SUCCESS, "Saved %d recorded triangles to %s", m_iNumTriangleIndices/3, szFilename );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::CountStateChange - private
+// Description:		Count a state change
+// Arguments:		-bRedundant: whether the change set what was already set
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::CountStateChange( bool bRedundant )
+{
+	m_iNumStateChanges++;
+	if( bRedundant )
+		m_iNumRedundantChanges++;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::RecordGeometry - private
+// Description:		Keep a vertex stream's positions, and its triangles
+//					(turned into a plain triangle list, without the
+//					degenerate triangles that join strips together)
+// Arguments:		-primitive: the type of primitive
+//					-pVertices: the vertex stream
+//					-iNumVertices: the number of vertices
+//					-uipIndices: the index stream (NULL to use the vertices
+//								 in order)
+//					-iNumIndices: the number of indices
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::RecordGeometry( EBACKEND_PRIMITIVES primitive, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+										 const unsigned int* uipIndices, int iNumIndices )
+{
+	int iCount= uipIndices ? iNumIndices : iNumVertices;
+	int iNumListIndices;
+	int iNewMax;
+	int i;
+
+	//make room for the positions
+	if( m_iNumPositions+iNumVertices>m_iMaxPositions )
+	{
+		float* fpNewPositions;
+
+		iNewMax= MAX( m_iMaxPositions*2, m_iNumPositions+iNumVertices );
+		fpNewPositions= new float [iNewMax*3];
+		if( m_iNumPositions )
+			memcpy( fpNewPositions, m_fpPositions, m_iNumPositions*3*sizeof( float ) );
+
+		delete[] m_fpPositions;
+		m_fpPositions  = fpNewPositions;
+		m_iMaxPositions= iNewMax;
+	}
+
+	//make room for the triangles (a primitive never has more than iCount)
+	if( m_iNumTriangleIndices+iCount*3>m_iMaxTriangleIndices )
+	{
+		unsigned int* uipNewTriangles;
+
+		iNewMax= MAX( m_iMaxTriangleIndices*2, m_iNumTriangleIndices+iCount*3 );
+		uipNewTriangles= new unsigned int [iNewMax];
+		if( m_iNumTriangleIndices )
+			memcpy( uipNewTriangles, m_uipTriangles, m_iNumTriangleIndices*sizeof( unsigned int ) );
+
+		delete[] m_uipTriangles;
+		m_uipTriangles		 = uipNewTriangles;
+		m_iMaxTriangleIndices= iNewMax;
+	}
+
+	for( i=0; i<iNumVertices; i++ )
+	{
+		m_fpPositions[( m_iNumPositions+i )*3  ]= pVertices[i].m_fPosition[0];
+		m_fpPositions[( m_iNumPositions+i )*3+1]= pVertices[i].m_fPosition[1];
+		m_fpPositions[( m_iNumPositions+i )*3+2]= pVertices[i].m_fPosition[2];
+	}
+
+	//the stream's indices start at 0, so move them past the vertices
+	//that were already recorded
+	iNumListIndices= MakeTriangleList( primitive, uipIndices, iCount, &m_uipTriangles[m_iNumTriangleIndices] );
+	for( i=0; i<iNumListIndices; i++ )
+		m_uipTriangles[m_iNumTriangleIndices+i]+= m_iNumPositions;
+
+	m_iNumTriangleIndices+= iNumListIndices;
+	m_iNumPositions		 += iNumVertices;
+}
+
+//--------------------------------------------------------------
+// Name:			CRECORDING_BACKEND::MeasureCache - private
+// Description:		Run a vertex stream's triangles through the simulated
+//					vertex caches (each draw starts with empty caches)
+// Arguments:		-primitive: the type of primitive
+//					-iNumVertices: the number of vertices
+//					-uipIndices: the index stream (NULL to use the vertices
+//								 in order)
+//					-iNumIndices: the number of indices
+// Return Value:	None
+//--------------------------------------------------------------
+void CRECORDING_BACKEND::MeasureCache( EBACKEND_PRIMITIVES primitive, int iNumVertices, const unsigned int* uipIndices, int iNumIndices )
+{
+	int iCount= uipIndices ? iNumIndices : iNumVertices;
+	int iNumListIndices;
+	int i;
+
+	//make room for the triangle list (a primitive never has more
+	//triangles than iCount)
+	if( iCount*3>m_iMaxCacheIndices )
+	{
+		delete[] m_uipCacheList;
+
+		m_iMaxCacheIndices= MAX( m_iMaxCacheIndices*2, iCount*3 );
+		m_uipCacheList	  = new unsigned int [m_iMaxCacheIndices];
+	}
+
+	iNumListIndices= MakeTriangleList( primitive, uipIndices, iCount, m_uipCacheList );
+	if( iNumListIndices==0 )
+		return;
+
+	//the largest index is needed to count the vertices that were used
+	if( uipIndices )
+	{
+		for( i=0; i<iNumListIndices; i++ )
+		{
+			if( ( int )m_uipCacheList[i]>=iNumVertices )
+				iNumVertices= m_uipCacheList[i]+1;
+		}
+	}
+
+	m_iNumCacheTriangles		  += iNumListIndices/3;
+	m_iNumCacheUniques			  += CountUniqueVertices( m_uipCacheList, iNumListIndices, iNumVertices );
+	m_iNumCacheMisses[VCACHE_FIFO]+= CountCacheMisses( m_uipCacheList, iNumListIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE );
+	m_iNumCacheMisses[VCACHE_LRU] += CountCacheMisses( m_uipCacheList, iNumListIndices, VCACHE_LRU, VCACHE_LRU_SIZE );
+}
+
+//--------------------------------------------------------------
+// Name:			CFRAME_MESH::Draw - public
+// Description:		Draw the whole mesh
+// Arguments:		-pBackend: the backend to draw with
+//					-iFormat: which of the vertices' attributes to use
+//							  (BACKEND_*)
+// Return Value:	None
+//--------------------------------------------------------------
+void CFRAME_MESH::Draw( CRENDER_BACKEND* pBackend, int iFormat )
+{
+	if( m_iNumIndices==0 )
+		return;
+
+	pBackend->Draw( BACKEND_TRIANGLES, iFormat, m_pVertices, m_iNumVertices, m_uipIndices, m_iNumIndices );
+}
+
+//--------------------------------------------------------------
+// Name:			CFRAME_MESH::Free - public
+// Description:		Free the mesh's memory
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CFRAME_MESH::Free( void )
+{
+	delete[] m_pVertices;
+	delete[] m_uipIndices;
+
+	m_pVertices	  = 0;
+	m_uipIndices  = 0;
+	m_iNumVertices= 0;
+	m_iMaxVertices= 0;
+	m_iNumIndices = 0;
+	m_iMaxIndices = 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CFRAME_MESH::GrowVertices - private
+// Description:		Make room for more vertices
+// Arguments:		-iNumNeeded: the number of vertices that are about to
+//								 be added
+// Return Value:	None
+//--------------------------------------------------------------
+void CFRAME_MESH::GrowVertices( int iNumNeeded )
+{
+	SBACKEND_VERTEX* pNewVertices;
+	int iNewMax;
+
+	iNewMax= m_iMaxVertices ? m_iMaxVertices*2 : 4096;
+	while( iNewMax<m_iNumVertices+iNumNeeded )
+		iNewMax*= 2;
+
+	pNewVertices= new SBACKEND_VERTEX [iNewMax];
+	if( m_iNumVertices )
+		memcpy( pNewVertices, m_pVertices, m_iNumVertices*sizeof( SBACKEND_VERTEX ) );
+
+	delete[] m_pVertices;
+	m_pVertices	  = pNewVertices;
+	m_iMaxVertices= iNewMax;
+}
+
+//--------------------------------------------------------------
+// Name:			CFRAME_MESH::GrowIndices - private
+// Description:		Make room for more indices
+// Arguments:		-iNumNeeded: the number of indices that are about to
+//								 be added
+// Return Value:	None
+//--------------------------------------------------------------
+void CFRAME_MESH::GrowIndices( int iNumNeeded )
+{
+	unsigned int* uipNewIndices;
+	int iNewMax;
+
+	iNewMax= m_iMaxIndices ? m_iMaxIndices*2 : 8192;
+	while( iNewMax<m_iNumIndices+iNumNeeded )
+		iNewMax*= 2;
+
+	uipNewIndices= new unsigned int [iNewMax];
+	if( m_iNumIndices )
+		memcpy( uipNewIndices, m_uipIndices, m_iNumIndices*sizeof( unsigned int ) );
+
+	delete[] m_uipIndices;
+	m_uipIndices = uipNewIndices;
+	m_iMaxIndices= iNewMax;
+}
@@ -63,6 +63,7 @@ int g_iCurrentHeightmap= 0;
 
 bool g_bTexture= true;
 bool g_bDetail = true;
+bool g_bCacheOrder= false;
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -163,6 +164,7 @@ void DemoRender( void )
 
 	g_quadtree.DoTextureMapping( g_bTexture );
 	g_quadtree.DoDetailMapping( g_bDetail, 16 );
+	g_quadtree.DoCacheOptimization( g_bCacheOrder );
 	g_quadtree.Update( &g_camera );
 
 	//render the simple terrain!
@@ -207,6 +209,11 @@ void DemoRender( void )
 			g_glApp.Print( 0, g_iScreenHeight-90, CVECTOR( 0.0f, 1.0f, 0.0f), "Detail Mapping: Enabled", g_glApp.GetFPS( ) );
 		else
 			g_glApp.Print( 0, g_iScreenHeight-90, CVECTOR( 0.0f, 1.0f, 0.0f), "Detail Mapping: Disabled", g_glApp.GetFPS( ) );
+
+		if( g_bCacheOrder )
+			g_glApp.Print( 0, g_iScreenHeight-110, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Enabled" );
+		else
+			g_glApp.Print( 0, g_iScreenHeight-110, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Disabled" );
 	g_glApp.EndTextMode( );
 
 	//force a render finish, and then swap buffers
@@ -332,6 +339,22 @@ bool DemoInput( void )
 		iToggleWait= 0;
 	}
 
+	//toggle the vertex cache ordering of the quadtree's mesh
+	if( g_glApp.KeyDown( 'V' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bCacheOrder )
+			g_bCacheOrder= false;
+
+		else
+			g_bCacheOrder= true;
+
+		iToggleWait= 0;
+	}
+
 	//increase mouse sensitivity
 	if( g_glApp.KeyDown( VK_ADD ) )
 	{
@@ -17,6 +17,7 @@
 #include <stdio.h>
 
 #include "../Base Code/gl_app.h"
+#include "../Base Code/vertex_cache.h"
 
 #include "quadtree.h"
 
@@ -65,6 +66,18 @@ bool CQUADTREE::Init( void )
 		}
 	}
 
+	//create memory for the height map point to mesh vertex table (no point
+	//has a vertex in frame 0, which is never built)
+	m_uipMeshVertex= new unsigned int [SQR( m_iSize )];
+	m_ipMeshFrame  = new int [SQR( m_iSize )];
+	if( m_uipMeshVertex==NULL || m_ipMeshFrame==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not initialize memory for the quadtree's vertex table" );
+		return false;
+	}
+	memset( m_ipMeshFrame, 0, SQR( m_iSize )*sizeof( int ) );
+	m_iMeshFrame= 0;
+
 	//propogate the roughness in the height map (so we can apply more triangles in rough spots of terrain)
 	PropagateRoughness( );
 
@@ -84,6 +97,13 @@ void CQUADTREE::Shutdown( void )
 	//free the memory stored in the quadtree matrix
 	if( m_ucpQuadMtrx )
 		delete[] m_ucpQuadMtrx;
+
+	delete[] m_uipMeshVertex;
+	delete[] m_ipMeshFrame;
+	m_uipMeshVertex= NULL;
+	m_ipMeshFrame  = NULL;
+
+	m_frameMesh.Free( );
 }
 
 //--------------------------------------------------------------
@@ -113,37 +133,40 @@ void CQUADTREE::Update( CCAMERA* pCamera )
 //--------------------------------------------------------------
 void CQUADTREE::Render( void )
 {
-	float fCenter;
+	bool bMultiTex;
 
 	//reset the counting variables
 	m_iVertsPerFrame= 0;
 	m_iTrisPerFrame = 0;
 
-	//calculate the center of the mesh
-	fCenter= ( m_iSize-1 )/2.0f;
+	//the light's color is the same for every vertex, so it only needs to
+	//be applied to each brightness value once
+	BuildShadeTable( );
+
+	//build the leaf nodes once, no matter how many passes it takes to
+	//draw them
+	bMultiTex= ( m_bMultitexture && m_bDetailMapping && m_bTextureMapping );
+	BuildMesh( bMultiTex );
 
 	//enable back-face culling
-	glDisable( GL_CULL_FACE );
+	m_pBackend->SetState( BACKEND_CULL_FACE, false );
 
 	//use hardware multitexturing for the texture map and the detail map
-	if( m_bMultitexture && m_bDetailMapping && m_bTextureMapping )
+	if( bMultiTex )
 	{
-		glDisable( GL_BLEND );
+		m_pBackend->SetState( BACKEND_BLEND, false );
 
 		//bind the primary color texture to the first texture unit
-		glActiveTextureARB( GL_TEXTURE0_ARB );
-		glEnable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
+		m_pBackend->SetState( BACKEND_TEXTURE0, true );
+		m_pBackend->BindTexture( 0, m_texture.GetID( ) );
 
 		//bind the detail color texture to the second texture unit
-		glActiveTextureARB( GL_TEXTURE1_ARB );
-		glEnable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, m_detailMap.GetID( ) );
-		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB );
-		glTexEnvi( GL_TEXTURE_ENV, GL_RGB_SCALE_ARB, 2 );
-
-		//render the main node (which will recurse down to the other nodes)
-		RenderNode( fCenter, fCenter, m_iSize, true, true );
+		m_pBackend->SetState( BACKEND_TEXTURE1, true );
+		m_pBackend->BindTexture( 1, m_detailMap.GetID( ) );
+		m_pBackend->SetCombineMode( 1, BACKEND_COMBINE_DETAIL );
+
+		//render the mesh
+		DrawMesh( GetVertexFormat( true ) );
 	}
 	
 	//no hardware multitexturing available, or the user only wants to render
@@ -153,12 +176,11 @@ void CQUADTREE::Render( void )
 		if( m_bTextureMapping )
 		{
 			//bind the primary color texture (FOR THE PRIMARY TEXTURE PASS)
-			glActiveTextureARB( GL_TEXTURE0_ARB );
-			glEnable( GL_TEXTURE_2D );
-			glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
+			m_pBackend->SetState( BACKEND_TEXTURE0, true );
+			m_pBackend->BindTexture( 0, m_texture.GetID( ) );
 
-			//render the main node (which will recurse down to the other nodes)
-			RenderNode( fCenter, fCenter, m_iSize, false, false );
+			//render the mesh
+			DrawMesh( GetVertexFormat( false ) );
 		}
 
 		if( !( m_bTextureMapping && !m_bDetailMapping ) )
@@ -167,33 +189,37 @@ void CQUADTREE::Render( void )
 			if( m_bDetailMapping )
 			{
 				//bind the detail texture
-				glActiveTextureARB( GL_TEXTURE0_ARB );
-				glEnable( GL_TEXTURE_2D );
-				glBindTexture( GL_TEXTURE_2D, m_detailMap.GetID( ) );
+				m_pBackend->SetState( BACKEND_TEXTURE0, true );
+				m_pBackend->BindTexture( 0, m_detailMap.GetID( ) );
 			
 				//only use blending if a texture pass was made
 				if( m_bTextureMapping )
 				{
-					glEnable( GL_BLEND );
-					glBlendFunc( GL_ZERO, GL_SRC_COLOR );
+					m_pBackend->SetState( BACKEND_BLEND, true );
+					m_pBackend->SetBlendMode( BACKEND_BLEND_MULTIPLY );
 				}
+
+				//the mesh only has the color map's texture coordinates, so
+				//the texture matrix stretches them for the detail map
+				m_pBackend->SetTextureScale( 0, ( float )m_iRepeatDetailMap );
 			}
-			//render the main node (which will recurse down to the other nodes)
-			RenderNode( fCenter, fCenter, m_iSize, false, m_bDetailMapping );
+			//render the mesh
+			DrawMesh( GetVertexFormat( false ) );
+
+			if( m_bDetailMapping )
+				m_pBackend->SetTextureScale( 0, 1.0f );
 		}
 	}
 
-	glDisable( GL_BLEND );
+	m_pBackend->SetState( BACKEND_BLEND, false );
 
 	//unbind the texture occupying the second texture unit
-	glActiveTextureARB( GL_TEXTURE1_ARB );
-	glDisable( GL_TEXTURE_2D );
-	glBindTexture( GL_TEXTURE_2D, 0 );
+	m_pBackend->SetState( BACKEND_TEXTURE1, false );
+	m_pBackend->BindTexture( 1, 0 );
 
 	//unbind the texture occupying the first texture unit
-	glActiveTextureARB( GL_TEXTURE0_ARB );
-	glDisable( GL_TEXTURE_2D );
-	glBindTexture( GL_TEXTURE_2D, 0 );
+	m_pBackend->SetState( BACKEND_TEXTURE0, false );
+	m_pBackend->BindTexture( 0, 0 );
 }
 
 //--------------------------------------------------------------
@@ -426,17 +452,126 @@ void CQUADTREE::RefineNode( float x, float z, int iEdgeLength )
 }
 
 //--------------------------------------------------------------
-// Name:			CQUADTREE::RenderNode - private
-// Description:		Render leaf (no children) quadtree nodes
+// Name:			CQUADTREE::BuildShadeTable - private
+// Description:		Multiply every possible lightmap brightness by the
+//					light's color
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CQUADTREE::BuildShadeTable( void )
+{
+	int i;
+
+	for( i=0; i<256; i++ )
+	{
+		m_ucShadeTable[i][0]= ( unsigned char )( i*m_vecLightColor[0] );
+		m_ucShadeTable[i][1]= ( unsigned char )( i*m_vecLightColor[1] );
+		m_ucShadeTable[i][2]= ( unsigned char )( i*m_vecLightColor[2] );
+		m_ucShadeTable[i][3]= 255;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CQUADTREE::BuildMesh - private
+// Description:		Build the frame's mesh out of the quadtree's leaf
+//					nodes, with the version of BuildNode that was compiled
+//					for the current options (so that they are only looked
+//					at once per frame)
+// Arguments:		-bMultiTex: fill in the detail map's texture coordinates
+// Return Value:	None
+//--------------------------------------------------------------
+void CQUADTREE::BuildMesh( bool bMultiTex )
+{
+	float fCenter;
+
+	//calculate the center of the mesh
+	fCenter= ( m_iSize-1 )/2.0f;
+
+	m_frameMesh.Reset( );
+
+	//none of the height map's points have a vertex in the new frame
+	m_iMeshFrame++;
+
+	if( bMultiTex )
+		BuildNode<true>( fCenter, fCenter, m_iSize );
+
+	else
+		BuildNode<false>( fCenter, fCenter, m_iSize );
+
+	if( m_bCacheOptimize )
+		OrderMesh( );
+}
+
+//--------------------------------------------------------------
+// Name:			CQUADTREE::OrderMesh - private
+// Description:		Reorder the frame's mesh for the vertex cache, and log
+//					how much it helped (for the first frame after the option
+//					is turned on, since the mesh changes every frame)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CQUADTREE::OrderMesh( void )
+{
+	unsigned int* uipIndices;
+	int iNumIndices, iNumVertices;
+	int iFanMisses, iOrderedMisses;
+
+	uipIndices	= m_frameMesh.GetIndices( );
+	iNumIndices = m_frameMesh.GetNumIndices( );
+	iNumVertices= m_frameMesh.GetNumVertices( );
+	if( iNumIndices==0 )
+		return;
+
+	iFanMisses= 0;
+	if( m_bLogCacheOrder )
+		iFanMisses= CountCacheMisses( uipIndices, iNumIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE );
+
+	OptimizeVertexCache( uipIndices, iNumIndices, iNumVertices );
+
+	if( m_bLogCacheOrder )
+	{
+		iOrderedMisses= CountCacheMisses( uipIndices, iNumIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE );
+
+		//the average number of vertices transformed for each triangle, and
+		//for each vertex (1.0 is the best it can be)
+		g_log.Write( LOG_PLAINTEXT, "Ordered %d quadtree triangles for the vertex cache: ACMR %.3f (fans), %.3f (ordered), ATVR %.3f (fans), %.3f (ordered)\n",
+					 iNumIndices/3,
+					 ( float )iFanMisses*3/iNumIndices,
+					 ( float )iOrderedMisses*3/iNumIndices,
+					 ( float )iFanMisses/iNumVertices, ( float )iOrderedMisses/iNumVertices );
+
+		m_bLogCacheOrder= false;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CQUADTREE::DrawMesh - private
+// Description:		Draw the frame's mesh (for one rendering pass)
+// Arguments:		-iFormat: the vertex attributes to draw with (BACKEND_*)
+// Return Value:	None
+//--------------------------------------------------------------
+void CQUADTREE::DrawMesh( int iFormat )
+{
+	m_frameMesh.Draw( m_pBackend, iFormat );
+
+	m_iVertsPerFrame+= m_frameMesh.GetNumVertices( );
+	m_iTrisPerFrame += m_frameMesh.GetNumTriangles( );
+}
+
+//--------------------------------------------------------------
+// Name:			CQUADTREE::BuildNode - private
+// Description:		Add leaf (no children) quadtree nodes to the frame's mesh
 // Arguments:		-x, z: center of current node
 //					-iEdgeLength: length of the current node's edge
-//					-bMultiTex: use multitexturing for rendering
-//					-bDetail: use a detail map when rendering
+//					-bMultiTex (template): fill in the detail map's texture
+//										   coordinates or not
 // Return Value:	None
 //--------------------------------------------------------------
-void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, bool bDetail )
+template< bool bMultiTex >
+void CQUADTREE::BuildNode( float x, float z, int iEdgeLength )
 {
 	float fTexLeft, fTexBottom, fMidX, fMidZ, fTexRight, fTexTop;
+	float fTexScale= 1.0f/m_iSize;
 	float fChildOffset;
 	float fEdgeOffset;
 	int iStart, iFanCode;
@@ -463,29 +598,14 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 	//compute the offset to the nodes near the current node
 	iAdjOffset= iEdgeLength-1;
 
-	if( bDetail && !bMultiTex )
-	{
-		//calculate the texture coordinates
-		fTexLeft  = ( ( float )fabs( x-fEdgeOffset )/m_iSize )*m_iRepeatDetailMap;
-		fTexBottom= ( ( float )fabs( z-fEdgeOffset )/m_iSize )*m_iRepeatDetailMap;
-		fTexRight = ( ( float )fabs( x+fEdgeOffset )/m_iSize )*m_iRepeatDetailMap;
-		fTexTop	  = ( ( float )fabs( z+fEdgeOffset )/m_iSize )*m_iRepeatDetailMap;
-
-		fMidX= ( ( fTexLeft+fTexRight )/2.0f );
-		fMidZ= ( ( fTexBottom+fTexTop )/2.0f );
-	}
+	//calculate the texture coordinates
+	fTexLeft  = ( float )fabs( x-fEdgeOffset )*fTexScale;
+	fTexBottom= ( float )fabs( z-fEdgeOffset )*fTexScale;
+	fTexRight = ( float )fabs( x+fEdgeOffset )*fTexScale;
+	fTexTop	  = ( float )fabs( z+fEdgeOffset )*fTexScale;
 
-	else
-	{
-		//calculate the texture coordinates
-		fTexLeft  = ( ( float )fabs( x-fEdgeOffset )/m_iSize );
-		fTexBottom= ( ( float )fabs( z-fEdgeOffset )/m_iSize );
-		fTexRight = ( ( float )fabs( x+fEdgeOffset )/m_iSize );
-		fTexTop	  = ( ( float )fabs( z+fEdgeOffset )/m_iSize );
-
-		fMidX= ( ( fTexLeft+fTexRight )/2.0f );
-		fMidZ= ( ( fTexBottom+fTexTop )/2.0f );
-	}
+	fMidX= ( ( fTexLeft+fTexRight )/2.0f );
+	fMidZ= ( ( fTexBottom+fTexTop )/2.0f );
 
 	//get the blend factor from the current quadtree value
 	iBlend= GetQuadMatrixData( iX, iZ );
@@ -496,58 +616,50 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 		if( iEdgeLength<=3 )
 		{
 			//render a triangle fan to represent the node
-			glBegin( GL_TRIANGLE_FAN );
+			BeginFan( );
 
 				//center vertex
-				RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+				BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 				//lower left vertex
-				RenderVertex( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom, bMultiTex );
+				BuildVertex<bMultiTex>( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom );
 
 				//lower mid, skip if the adjacent node is of a lower detail level
 				if( ( ( iZ-iAdjOffset )<0 ) || GetQuadMatrixData( iX, iZ-iAdjOffset )!=0 )
 				{
-					RenderVertex( x, z-fEdgeOffset, fMidX, fTexBottom, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x, z-fEdgeOffset, fMidX, fTexBottom );
 				}
 
 				//bottom right vertex
-				RenderVertex( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom, bMultiTex );
-				m_iTrisPerFrame++;
+				BuildVertex<bMultiTex>( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom );
 
 				//right mid, skip if the adjacent node is of a lower detail level
 				if( ( ( iX+iAdjOffset )>=m_iSize ) || GetQuadMatrixData( iX+iAdjOffset, iZ )!=0 )
 				{
-					RenderVertex( x+fEdgeOffset, z, fTexRight, fMidZ, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z, fTexRight, fMidZ );
 				}
 
 				//upper right vertex
-				RenderVertex( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop, bMultiTex );
-				m_iTrisPerFrame++;
+				BuildVertex<bMultiTex>( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop );
 
 				//upper mid, skip if the adjacent node is of a lower detail level
 				if( ( ( iZ+iAdjOffset )>=m_iSize ) || GetQuadMatrixData( iX, iZ+iAdjOffset )!=0 )
 				{
-					RenderVertex( x, z+fEdgeOffset, fMidX, fTexTop, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x, z+fEdgeOffset, fMidX, fTexTop );
 				}
 
 				//upper left vertex
-				RenderVertex( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop, bMultiTex );
-				m_iTrisPerFrame++;
+				BuildVertex<bMultiTex>( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop );
 
 				//left mid, skip if the adjacent node is of a lower detail level
 				if( ( ( iX-iAdjOffset )<0 ) || GetQuadMatrixData( iX-iAdjOffset, iZ )!=0 )
 				{
-					RenderVertex( x-fEdgeOffset, z, fTexLeft, fMidZ, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z, fTexLeft, fMidZ );
 				}
 
 				//bottom left vertex again
-				RenderVertex( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom, bMultiTex );
-				m_iTrisPerFrame++;
-			glEnd( );
+				BuildVertex<bMultiTex>( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom );
+			EndFan( );
 			return;
 
 		}
@@ -580,16 +692,16 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 			if( iFanCode==QT_NO_FAN )
 			{
 				//lower left
-				RenderNode( x-fChildOffset, z-fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x-fChildOffset, z-fChildOffset, iChildEdgeLength );
 
 				//lower right
-				RenderNode( x+fChildOffset, z-fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x+fChildOffset, z-fChildOffset, iChildEdgeLength );
 
 				//upper left
-				RenderNode( x-fChildOffset, z+fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x-fChildOffset, z+fChildOffset, iChildEdgeLength );
 
 				//upper right
-				RenderNode( x+fChildOffset, z+fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x+fChildOffset, z+fChildOffset, iChildEdgeLength );
 				return;
 			}
 
@@ -597,42 +709,38 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 			if( iFanCode==QT_LL_UR )
 			{
 				//the upper right fan
-				glBegin( GL_TRIANGLE_FAN );
+				BeginFan( );
 					//center vertex
-					RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 					//right mid vertex
-					RenderVertex( x+fEdgeOffset, z, fTexRight, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z, fTexRight, fMidZ );
 
 					//upper right vertex
-					RenderVertex( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop );
 
 					//upper mid vertex
-					RenderVertex( x, z+fEdgeOffset, fMidX, fTexTop, bMultiTex );
-					m_iTrisPerFrame++;
-				glEnd( );
+					BuildVertex<bMultiTex>( x, z+fEdgeOffset, fMidX, fTexTop );
+				EndFan( );
 
 				//lower left fan
-				glBegin( GL_TRIANGLE_FAN );
+				BeginFan( );
 					//center vertex
-					RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 					//left mid
-					RenderVertex( x-fEdgeOffset, z, fTexLeft, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z, fTexLeft, fMidZ );
 
 					//bottom left
-					RenderVertex( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom );
 
 					//bottom mid
-					RenderVertex( x, z-fEdgeOffset, fMidX, fTexBottom, bMultiTex );
-					m_iTrisPerFrame++;
-				glEnd( );
+					BuildVertex<bMultiTex>( x, z-fEdgeOffset, fMidX, fTexBottom );
+				EndFan( );
 
 				//recurse further down to the upper left and lower right nodes
-				RenderNode( x-fChildOffset, z+fChildOffset, iChildEdgeLength );
-				RenderNode( x+fChildOffset, z-fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x-fChildOffset, z+fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x+fChildOffset, z-fChildOffset, iChildEdgeLength );
 				return;
 
 			}
@@ -641,99 +749,87 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 			if( iFanCode==QT_LR_UL )
 			{
 				//upper left fan
-				glBegin( GL_TRIANGLE_FAN );
+				BeginFan( );
 					//center vertex
-					RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 					//upper mid vertex
-					RenderVertex( x, z+fEdgeOffset, fMidX, fTexTop, bMultiTex );
+					BuildVertex<bMultiTex>( x, z+fEdgeOffset, fMidX, fTexTop );
 
 					//upper left vertex
-					RenderVertex( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop );
 
 					//left mid vertex
-					RenderVertex( x-fEdgeOffset, z, fTexLeft, fMidZ, bMultiTex );
-					m_iTrisPerFrame++;
-				glEnd( );
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z, fTexLeft, fMidZ );
+				EndFan( );
 
 				//lower right fan
-				glBegin( GL_TRIANGLE_FAN );
+				BeginFan( );
 					//center vertex
-					RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 					//lower mid vertex
-					RenderVertex( x, z-fEdgeOffset, fMidX, fTexBottom, bMultiTex );
+					BuildVertex<bMultiTex>( x, z-fEdgeOffset, fMidX, fTexBottom );
 
 					//lower right vertex
-					RenderVertex( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom );
 
 					//right mid vertex
-					RenderVertex( x+fEdgeOffset, z, fTexRight, fMidZ, bMultiTex );
-					m_iTrisPerFrame++;
-				glEnd( );
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z, fTexRight, fMidZ );
+				EndFan( );
 
 				//recurse further down to the upper right and lower left nodes
-				RenderNode( x+fChildOffset, z+fChildOffset, iChildEdgeLength );
-				RenderNode( x-fChildOffset, z-fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x+fChildOffset, z+fChildOffset, iChildEdgeLength );
+				BuildNode<bMultiTex>( x-fChildOffset, z-fChildOffset, iChildEdgeLength );
 				return;
 			}
 
 			//this node is a leaf-node, render a complete fan
 			if( iFanCode==QT_COMPLETE_FAN )
 			{
-				glBegin( GL_TRIANGLE_FAN );
+				BeginFan( );
 					//center vertex
-					RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+					BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 					//render the lower left vertex
-					RenderVertex( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom, bMultiTex );
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom );
 
 					//lower mid, skip if the adjacent node is of a lower detail level
 					if( ( ( iZ-iAdjOffset )<0 ) || GetQuadMatrixData( iX, iZ-iAdjOffset )!=0 )
 					{
-						RenderVertex( x, z-fEdgeOffset, fMidX, fTexBottom, bMultiTex );
-						m_iTrisPerFrame++;
+						BuildVertex<bMultiTex>( x, z-fEdgeOffset, fMidX, fTexBottom );
 					}
 
 					//lower right vertex
-					RenderVertex( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom );
 
 					//right mid, skip if the adjacent node is of a lower detail level
 					if( ( ( iX+iAdjOffset )>=m_iSize ) || GetQuadMatrixData( iX+iAdjOffset, iZ )!=0 )
 					{
-						RenderVertex( x+fEdgeOffset, z, fTexRight, fMidZ, bMultiTex );
-						m_iTrisPerFrame++;
+						BuildVertex<bMultiTex>( x+fEdgeOffset, z, fTexRight, fMidZ );
 					}
 
 					//upper right vertex
-					RenderVertex( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop );
 
 					//upper mid, skip if the adjacent node is of a lower detail level
 					if( ( ( iZ+iAdjOffset )>=m_iSize ) || GetQuadMatrixData( iX, iZ+iAdjOffset )!=0 )
 					{
-						RenderVertex( x, z+fEdgeOffset, fMidX, fTexTop, bMultiTex );
-						m_iTrisPerFrame++;
+						BuildVertex<bMultiTex>( x, z+fEdgeOffset, fMidX, fTexTop );
 					}
 
 					//upper left
-					RenderVertex( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop, bMultiTex );
-					m_iTrisPerFrame++;
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop );
 
 					//left mid, skip if the adjacent node is of a lower detail level
 					if( ( ( iX-iAdjOffset )<0 ) || GetQuadMatrixData( iX-iAdjOffset, iZ )!=0 )
 					{
-						RenderVertex( x-fEdgeOffset, z, fTexLeft, fMidZ, bMultiTex );
-						m_iTrisPerFrame++;
+						BuildVertex<bMultiTex>( x-fEdgeOffset, z, fTexLeft, fMidZ );
 					}
 
 					//lower left vertex
-					RenderVertex( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom, bMultiTex );
-					m_iTrisPerFrame++;
-				glEnd( );
+					BuildVertex<bMultiTex>( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom );
+				EndFan( );
 				return;
 			}
 
@@ -748,9 +844,9 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 				iFanLength++;
 
 			//render a triangle fan
-			glBegin( GL_TRIANGLE_FAN );
+			BeginFan( );
 				//center vertex
-				RenderVertex( x, z, fMidX, fMidZ, bMultiTex );
+				BuildVertex<bMultiTex>( x, z, fMidX, fMidZ );
 
 				//render a triangle fan
 				for( iFanPosition=iFanLength; iFanPosition>0; iFanPosition-- )
@@ -762,19 +858,16 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 							//lower mid, skip if the adjacent node is of a lower detail level
 							if( ( ( iZ-iAdjOffset )<0 ) || GetQuadMatrixData( iX, iZ-iAdjOffset )!=0 || iFanPosition==iFanLength )
 							{
-								RenderVertex( x, z-fEdgeOffset, fMidX, fTexBottom, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x, z-fEdgeOffset, fMidX, fTexBottom );
 							}
 
 							//lower right vertex
-							RenderVertex( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom, bMultiTex );
-							m_iTrisPerFrame++;
+							BuildVertex<bMultiTex>( x+fEdgeOffset, z-fEdgeOffset, fTexRight, fTexBottom );
 
 							//finish off the fan with a right mid vertex
 							if( iFanPosition==1 )
 							{
-								RenderVertex( x+fEdgeOffset, z, fTexRight, fMidZ, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x+fEdgeOffset, z, fTexRight, fMidZ );
 							}
 							break;
 
@@ -783,19 +876,16 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 							//left mid, skip if the adjacent node is of a lower detail level
 							if( ( ( x-iAdjOffset )<0 ) || GetQuadMatrixData( iX-iAdjOffset, iZ )!=0 || iFanPosition==iFanLength )
 							{
-								RenderVertex( x-fEdgeOffset, z, fTexLeft, fMidZ, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x-fEdgeOffset, z, fTexLeft, fMidZ );
 							}
 
 							//lower left vertex
-							RenderVertex( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom, bMultiTex );
-							m_iTrisPerFrame++;
+							BuildVertex<bMultiTex>( x-fEdgeOffset, z-fEdgeOffset, fTexLeft, fTexBottom );
 
 							//finish off the fan with a lower mid vertex
 							if( iFanPosition==1 )
 							{
-								RenderVertex( x, z-fEdgeOffset, fMidX, fTexBottom, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x, z-fEdgeOffset, fMidX, fTexBottom );
 							}
 							break;
 
@@ -804,18 +894,16 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 							//upper mid, skip if the adjacent node is of a lower detail level
 							if( ( ( iZ+iAdjOffset )>=m_iSize ) || GetQuadMatrixData( iX, iZ+iAdjOffset )!=0 || iFanPosition==iFanLength )
 							{
-								RenderVertex( x, z+fEdgeOffset, fMidX, fTexTop, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x, z+fEdgeOffset, fMidX, fTexTop );
 							}
 
 							//upper left vertex
-							RenderVertex( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop, bMultiTex );
+							BuildVertex<bMultiTex>( x-fEdgeOffset, z+fEdgeOffset, fTexLeft, fTexTop );
 
 							//finish off the fan with a left mid vertex
 							if( iFanPosition==1 )
 							{
-								RenderVertex( x-fEdgeOffset, z, fTexLeft, fMidZ, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x-fEdgeOffset, z, fTexLeft, fMidZ );
 							}
 							break;
 
@@ -824,19 +912,16 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 							//right mid, skip if the adjacent node is of a lower detail level
 							if( ( ( iX+iAdjOffset )>=m_iSize ) || GetQuadMatrixData( iX+iAdjOffset, iZ )!=0 || iFanPosition==iFanLength )
 							{
-								RenderVertex( x+fEdgeOffset, z, fTexRight, fMidZ, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x+fEdgeOffset, z, fTexRight, fMidZ );
 							}
 
 							//upper right vertex
-							RenderVertex( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop, bMultiTex );
-							m_iTrisPerFrame++;
+							BuildVertex<bMultiTex>( x+fEdgeOffset, z+fEdgeOffset, fTexRight, fTexTop );
 
 							//finish off the fan with a top mid vertex
 							if( iFanPosition==1 )
 							{
-								RenderVertex( x, z+fEdgeOffset, fMidX, fTexTop, bMultiTex );
-								m_iTrisPerFrame++;
+								BuildVertex<bMultiTex>( x, z+fEdgeOffset, fMidX, fTexTop );
 							}
 							break;
 					}
@@ -844,7 +929,7 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 					iStart--;
 					iStart&= 3;
 				}
-			glEnd( );
+			EndFan( );
 
 			//now, recurse down to children (special cases that weren't handled earlier)
 			for( iFanPosition=( 4-iFanLength ); iFanPosition>0; iFanPosition-- )
@@ -853,22 +938,22 @@ void CQUADTREE::RenderNode( float x, float z, int iEdgeLength, bool bMultiTex, b
 				{
 					//lower right node
 					case QT_LR_NODE:
-						RenderNode( x+fChildOffset, z-fChildOffset, iChildEdgeLength );
+						BuildNode<bMultiTex>( x+fChildOffset, z-fChildOffset, iChildEdgeLength );
 						break;
 
 					//lower left node
 					case QT_LL_NODE:
-						RenderNode( x-fChildOffset, z-fChildOffset, iChildEdgeLength );
+						BuildNode<bMultiTex>( x-fChildOffset, z-fChildOffset, iChildEdgeLength );
 						break;
 
 					//upper left node
 					case QT_UL_NODE:
-						RenderNode( x-fChildOffset, z+fChildOffset, iChildEdgeLength );
+						BuildNode<bMultiTex>( x-fChildOffset, z+fChildOffset, iChildEdgeLength );
 						break;
 
 					//upper right node
 					case QT_UR_NODE:
-						RenderNode( x+fChildOffset, z+fChildOffset, iChildEdgeLength );
+						BuildNode<bMultiTex>( x+fChildOffset, z+fChildOffset, iChildEdgeLength );
 						break;
 				}
 
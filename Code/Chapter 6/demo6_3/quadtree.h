@@ -16,6 +16,8 @@
 //- HEADERS AND LIBRARIES --------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
+#include <string.h>
+
 #include "terrain.h"
 
 #include "../Base Code/camera.h"
@@ -37,6 +39,9 @@
 #define QT_LR_UL		10
 #define QT_NO_FAN       15
 
+//the most vertices that a node's fan can have (center, 8 rim, and the first rim vertex again)
+#define QT_MAX_FAN_VERTICES 10
+
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -66,37 +71,114 @@ class CQUADTREE : public CTERRAIN
 		float m_fDetailLevel;
 		float m_fMinResolution;
 
+		//the lightmap's brightness values, already multiplied by the light's
+		//color (rebuilt every time that the terrain is rendered)
+		unsigned char m_ucShadeTable[256][4];
+
+		//the leaf nodes, built once a frame and then drawn for each pass
+		CFRAME_MESH m_frameMesh;
+
+		//the mesh vertex that each height map point got, and the frame that
+		//it got it in (so that the fans share the vertices on their edges)
+		unsigned int* m_uipMeshVertex;
+		int* m_ipMeshFrame;
+		int m_iMeshFrame;
+
+		//the fan that is being built
+		unsigned int m_uiFan[QT_MAX_FAN_VERTICES];
+		int m_iFanLength;
+
+		//vertex cache ordering of the mesh
+		bool m_bCacheOptimize;
+		bool m_bLogCacheOrder;	//log the next frame's cache scores
+
 	void PropagateRoughness( void );
 	void RefineNode( float x, float z, int iEdgeLength );
-	void RenderNode( float x, float z, int iEdgeLength, bool bMultiTex= true, bool bDetail= true );
+
+	void BuildShadeTable( void );
+	void BuildMesh( bool bMultiTex );
+	void OrderMesh( void );
+	void DrawMesh( int iFormat );
+
+	template< bool bMultiTex >
+	void BuildNode( float x, float z, int iEdgeLength );
+
+	//--------------------------------------------------------------
+	// Name:			CQUADTREE::BeginFan - private
+	// Description:		Start a fan (BuildVertex adds its center, and then
+	//					its rim)
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void BeginFan( void )
+	{	m_iFanLength= 0;	}
+
+	//--------------------------------------------------------------
+	// Name:			CQUADTREE::EndFan - private
+	// Description:		Add the fan's triangles to the frame's mesh
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void EndFan( void )
+	{	m_frameMesh.AddFan( m_uiFan, m_iFanLength );	}
 
 	//--------------------------------------------------------------
-	// Name:			CQUADTREE::RenderVertex - private
-	// Description:		Render a single vertex
-	// Arguments:		-x, z: vertex to render
+	// Name:			CQUADTREE::BuildVertex - private
+	// Description:		Add a single vertex to the current fan, and to the
+	//					frame's mesh if no other fan has used it this frame.
+	//					Multitexturing is a template argument, so that there
+	//					is no test for it per vertex.
+	// Arguments:		-x, z: vertex to add
 	//					-u, v: texture coordinates for the vertex
-	//					-bMultiTex: use multitexturing or not
+	//					-bMultiTex (template): fill in the detail map's
+	//										   texture coordinates or not
 	// Return Value:	None
 	//--------------------------------------------------------------
-	inline void RenderVertex( float x, float z, float u, float v, bool bMultiTex )
+	template< bool bMultiTex >
+	inline void BuildVertex( float x, float z, float u, float v )
 	{
-		unsigned char ucColor= GetBrightnessAtPoint( ( int )x, ( int )z );
+		SBACKEND_VERTEX* pVertex;
+		int iPoint;
 
-		glColor3ub( ( unsigned char )( ucColor*m_vecLightColor[0] ),
-				    ( unsigned char )( ucColor*m_vecLightColor[1] ),
-				    ( unsigned char )( ucColor*m_vecLightColor[2] ) );
-		
-		glMultiTexCoord2fARB( GL_TEXTURE0_ARB, u, v );
-		if( bMultiTex )
-			glMultiTexCoord2fARB( GL_TEXTURE1_ARB, u*m_iRepeatDetailMap, v*m_iRepeatDetailMap );
+		iPoint= GetMatrixIndex( ( int )x, ( int )z );
+
+		//a neighbouring fan already built this point's vertex
+		if( m_ipMeshFrame[iPoint]==m_iMeshFrame )
+		{
+			m_uiFan[m_iFanLength++]= m_uipMeshVertex[iPoint];
+			return;
+		}
+
+		m_ipMeshFrame[iPoint]  = m_iMeshFrame;
+		m_uipMeshVertex[iPoint]= m_frameMesh.GetNumVertices( );
+		m_uiFan[m_iFanLength++]= m_uipMeshVertex[iPoint];
 
-		glVertex3f( x*m_vecScale[0],
-					GetScaledHeightAtPoint( ( int )x, ( int )z ),
-					z*m_vecScale[2] );
+		pVertex= m_frameMesh.AddVertex( );
 
-		m_iVertsPerFrame++;
+		memcpy( pVertex->m_ucColor, m_ucShadeTable[GetBrightnessAtPoint( ( int )x, ( int )z )], 4 );
+		
+		pVertex->m_fTexCoord0[0]= u;
+		pVertex->m_fTexCoord0[1]= v;
+		if( bMultiTex )
+		{
+			pVertex->m_fTexCoord1[0]= u*m_iRepeatDetailMap;
+			pVertex->m_fTexCoord1[1]= v*m_iRepeatDetailMap;
+		}
+
+		pVertex->m_fPosition[0]= x*m_vecScale[0];
+		pVertex->m_fPosition[1]= GetScaledHeightAtPoint( ( int )x, ( int )z );
+		pVertex->m_fPosition[2]= z*m_vecScale[2];
 	}
 
+	//--------------------------------------------------------------
+	// Name:			CQUADTREE::GetVertexFormat - private
+	// Description:		Get the format of the vertices that BuildVertex makes
+	// Arguments:		-bMultiTex: use multitexturing or not
+	// Return Value:	An integer value: the vertex format flags (BACKEND_*)
+	//--------------------------------------------------------------
+	inline int GetVertexFormat( bool bMultiTex )
+	{	return BACKEND_COLOR | BACKEND_TEXCOORD0 | ( bMultiTex ? BACKEND_TEXCOORD1 : 0 );	}
+
 	//--------------------------------------------------------------
 	// Name:			CQUADTREE::GetMatrixIndex - private
 	// Description:		Calculate the index value to access the quadtree matrix
@@ -133,6 +215,22 @@ class CQUADTREE : public CTERRAIN
 	inline void SetMinResolution( float fRes )
 	{	m_fMinResolution= fRes;	}
 
+	//--------------------------------------------------------------
+	// Name:			CQUADTREE::DoCacheOptimization - public
+	// Description:		Reorder each frame's mesh for the vertex cache or not
+	//					(the scores are logged for the first frame after it
+	//					is turned on)
+	// Arguments:		-bDo: reorder the mesh or not
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoCacheOptimization( bool bDo )
+	{
+		if( bDo && !m_bCacheOptimize )
+			m_bLogCacheOrder= true;
+
+		m_bCacheOptimize= bDo;
+	}
+
 	//--------------------------------------------------------------
 	// Name:			CQUADTREE::GetQuadMatrixData - public
 	// Description:		Retrieve a value from the quadtree matrix
@@ -143,7 +241,9 @@ class CQUADTREE : public CTERRAIN
 	inline unsigned char GetQuadMatrixData( int iX, int iZ )
 	{	return m_ucpQuadMtrx[ ( iZ*m_iSize )+iX];	}
 
-	CQUADTREE( void ) : m_fDetailLevel( 50.0f ), m_fMinResolution( 10.0f )
+	CQUADTREE( void ) : m_fDetailLevel( 50.0f ), m_fMinResolution( 10.0f ),
+						m_uipMeshVertex( NULL ), m_ipMeshFrame( NULL ), m_iMeshFrame( 0 ), m_iFanLength( 0 ),
+						m_bCacheOptimize( false ), m_bLogCacheOrder( false )
 	{	}
 	~CQUADTREE( void )
 	{	}
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 
 #include "../Base Code/image.h"
+#include "../Base Code/render_backend.h"
 
 
 //--------------------------------------------------------------
@@ -107,6 +108,9 @@ class CTERRAIN
 		float m_fLightSoftness;
 		int m_iDirectionX, m_iDirectionZ;
 
+		//what the terrain is drawn with (OpenGL, unless told otherwise)
+		CRENDER_BACKEND* m_pBackend;
+
 		int m_iVertsPerFrame;		//stat variables
 		int m_iTrisPerFrame;
 
@@ -312,6 +316,15 @@ class CTERRAIN
 	inline void DoMultitexturing( bool bDo )
 	{	m_bMultitexture= bDo;	}
 
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::SetRenderBackend - public
+	// Description:		Set what the terrain is drawn with
+	// Arguments:		-pBackend: the backend (NULL for OpenGL)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetRenderBackend( CRENDER_BACKEND* pBackend )
+	{	m_pBackend= pBackend ? pBackend : &g_glBackend;	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::LoadTile - public
 	// Description:		Load a single tile for the texture generation
@@ -411,7 +424,7 @@ class CTERRAIN
 		m_fLightSoftness= fSoftness;
 	}
 
-	CTERRAIN( void ) : m_vecLightColor( 1.0f, 1.0f, 1.0f ), m_vecScale( 1.0f, 1.0f, 1.0f )
+	CTERRAIN( void ) : m_vecLightColor( 1.0f, 1.0f, 1.0f ), m_vecScale( 1.0f, 1.0f, 1.0f ), m_pBackend( &g_glBackend )
 	{	}
 	~CTERRAIN( void )
 	{	}
@@ -114,7 +114,12 @@ class CROAM : public CTERRAIN
 
 		int m_iLog2Table[256];							//correction to float->int conversions
 		
-		float* m_fVertTexBuffer;						//data attachment specific to a library step
+		float* m_fVertTexBuffer;						//each diamond's vertex (texture coordinates, then position)
+		unsigned int* m_uipTriIndices;					//the three diamonds (vertices) of each triangle
+		unsigned int* m_uipDrawIndices;					//the triangles, reordered for the vertex cache
+
+		bool m_bCacheOptimize;							//reorder the triangles for the vertex cache
+		bool m_bLogCacheOrder;							//log the next frame's cache scores
 
 		float* m_fpLevelMDSize;							//max midpoint displacement per level
 		int m_iMaxLevel;
@@ -134,6 +139,26 @@ class CROAM : public CTERRAIN
 		*z*= m_iSize;			//translate into map-coords
 	}
 
+	//--------------------------------------------------------------
+	// Name:		 CROAM::SetVertex - private
+	// Description:  Fill in a diamond's vertex, which all of the triangles
+	//				 that have the diamond as a corner share
+	// Arguments:	 -pDmnd: the diamond (its position has to be set)
+	// Return Value: None
+	//--------------------------------------------------------------
+	inline void SetVertex( SROAM_DIAMOND* pDmnd )
+	{
+		float* fpVB;
+
+		fpVB= m_fVertTexBuffer+5*( pDmnd-m_pDmndPool );
+		fpVB[2]= pDmnd->m_fVert[0];
+		fpVB[3]= pDmnd->m_fVert[1];
+		fpVB[4]= pDmnd->m_fVert[2];
+
+		fpVB[0]= fpVB[2]/m_iSize;
+		fpVB[1]= fpVB[4]/m_iSize;
+	}
+
 	SROAM_DIAMOND* Create( void );
 	SROAM_DIAMOND* GetChild( SROAM_DIAMOND* pDmnd, int iIndex );
 
@@ -153,6 +178,8 @@ class CROAM : public CTERRAIN
 	void UpdatePriority( SROAM_DIAMOND* dm );
 	void Enqueue( SROAM_DIAMOND* dm,int qflags,int iq_new );
 
+	void OrderTris( unsigned int* uipIndices, int iNumIndices );
+
 	public:
 
 
@@ -162,7 +189,23 @@ class CROAM : public CTERRAIN
 	void Update( void );
 	void Render( void );
 
-	CROAM( void ) { }
+	//--------------------------------------------------------------
+	// Name:		 CROAM::DoCacheOptimization - public
+	// Description:	 Reorder each frame's triangles for the vertex cache or
+	//				 not (the scores are logged for the first frame after it
+	//				 is turned on)
+	// Arguments:	 -bDo: reorder the triangles or not
+	// Return Value: None
+	//--------------------------------------------------------------
+	void DoCacheOptimization( bool bDo )
+	{
+		if( bDo && !m_bCacheOptimize )
+			m_bLogCacheOrder= true;
+
+		m_bCacheOptimize= bDo;
+	}
+
+	CROAM( void ) : m_bCacheOptimize( false ), m_bLogCacheOrder( false ) { }
 	~CROAM( void ) { }
 };
 
@@ -51,6 +51,7 @@ CLEAN :
 	-@erase "$(INTDIR)\ROAM.obj"
 	-@erase "$(INTDIR)\terrain.obj"
 	-@erase "$(INTDIR)\vc60.idb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(OUTDIR)\demo7_4.exe"
 
 "$(OUTDIR)" :
@@ -74,6 +75,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
 	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\vertex_cache.obj" \
 	"$(INTDIR)\resource.res"
 
 "$(OUTDIR)\demo7_4.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
@@ -104,6 +106,7 @@ CLEAN :
 	-@erase "$(INTDIR)\terrain.obj"
 	-@erase "$(INTDIR)\vc60.idb"
 	-@erase "$(INTDIR)\vc60.pdb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(OUTDIR)\demo7_4.exe"
 	-@erase "$(OUTDIR)\demo7_4.ilk"
 	-@erase "$(OUTDIR)\demo7_4.pdb"
@@ -129,6 +132,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
 	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\vertex_cache.obj" \
 	"$(INTDIR)\resource.res"
 
 "$(OUTDIR)\demo7_4.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
@@ -224,6 +228,12 @@ SOURCE="..\Base Code\math_ops.cpp"
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE="..\Base Code\vertex_cache.cpp"
+
+"$(INTDIR)\vertex_cache.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\resource.rc
 
 "$(INTDIR)\resource.res" : $(SOURCE) "$(INTDIR)"
@@ -60,6 +60,7 @@ int g_iCurrentHeightmap;
 int g_iLevel= 45;
 bool g_bTexture= true;
 bool g_bDetail = true;
+bool g_bCacheOrder= false;
 
 
 //--------------------------------------------------------------
@@ -161,6 +162,7 @@ void DemoRender( void )
 	glEnable( GL_CULL_FACE );
 
 	g_ROAM.Scale( 1.0f, 1.0f, 1.0f );
+	g_ROAM.DoCacheOptimization( g_bCacheOrder );
 	g_ROAM.Update( );
 	g_ROAM.Render( );
 
@@ -193,6 +195,11 @@ void DemoRender( void )
 			g_glApp.Print( 0, g_iScreenHeight-90, CVECTOR( 0.0f, 1.0f, 0.0f), "Detail Mapping: Enabled" );
 		else
 			g_glApp.Print( 0, g_iScreenHeight-90, CVECTOR( 0.0f, 1.0f, 0.0f), "Detail Mapping: Disabled" );
+
+		if( g_bCacheOrder )
+			g_glApp.Print( 0, g_iScreenHeight-110, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Enabled" );
+		else
+			g_glApp.Print( 0, g_iScreenHeight-110, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Disabled" );
 	g_glApp.EndTextMode( );
 
 	//force a render finish, and then swap buffers
@@ -318,6 +325,22 @@ bool DemoInput( void )
 		iToggleWait= 0;
 	}
 
+	//toggle the vertex cache ordering of the ROAM mesh
+	if( g_glApp.KeyDown( 'V' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bCacheOrder )
+			g_bCacheOrder= false;
+
+		else
+			g_bCacheOrder= true;
+
+		iToggleWait= 0;
+	}
+
 	return true;
 }
 
@@ -0,0 +1,313 @@
+//==============================================================
+//==============================================================
+//= bake_cache.cpp =============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= An on-disk cache for data that takes a while to generate   =
+//= (height maps, lightmaps, texture maps).  Entries are keyed =
+//= by a hash of everything that went into making them.		   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "bake_cache.h"
+#include "log.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+CBAKE_CACHE g_bakeCache;
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::Init - public
+// Description:		Set the cache's directory up (it is created if it
+//					doesn't already exist), and turn the cache on
+// Arguments:		-szDirectory: the directory to keep the cache files in
+// Return Value:	A boolean value: -true: successful initiation
+//									 -false: unsuccessful initiation
+//--------------------------------------------------------------
+bool CBAKE_CACHE::Init( char* szDirectory )
+{
+	if( strlen( szDirectory )+32>=MAX_PATH )
+	{
+		g_log.Write( LOG_FAILURE, "Bake cache directory name is too long" );
+		return false;
+	}
+
+	strcpy( m_szDirectory, szDirectory );
+
+	//it's fine if the directory is already there
+	CreateDirectory( m_szDirectory, NULL );
+
+	m_bEnabled= true;
+	g_log.Write( LOG_SUCCESS, "Bake cache initialized in %s", m_szDirectory );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::HashBegin - public
+// Description:		Start a new key for an artefact (the artefact's name
+//					and the cache version both go into the key)
+// Arguments:		-szArtefact: the name of the type of data being baked
+// Return Value:	A BAKE_KEY value: the starting key
+//--------------------------------------------------------------
+BAKE_KEY CBAKE_CACHE::HashBegin( char* szArtefact )
+{
+	BAKE_KEY key;
+	unsigned int uiVersion= BAKE_CACHE_VERSION;
+
+	//the 64-bit FNV offset basis
+	key= ( ( BAKE_KEY )0xCBF29CE4<<32 ) | 0x84222325;
+
+	key= Hash( key, szArtefact, strlen( szArtefact ) );
+	return Hash( key, &uiVersion, sizeof( unsigned int ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::Hash - public
+// Description:		Add a block of data to a key (64-bit FNV-1a)
+// Arguments:		-key: the key so far
+//					-pData: the data to add
+//					-uiSize: the size of the data, in bytes
+// Return Value:	A BAKE_KEY value: the new key
+//--------------------------------------------------------------
+BAKE_KEY CBAKE_CACHE::Hash( BAKE_KEY key, const void* pData, unsigned int uiSize )
+{
+	const unsigned char* ucpData= ( const unsigned char* )pData;
+	const BAKE_KEY prime= ( ( BAKE_KEY )0x00000100<<32 ) | 0x000001B3;
+	unsigned int i;
+
+	for( i=0; i<uiSize; i++ )
+	{
+		key^= ucpData[i];
+		key*= prime;
+	}
+
+	return key;
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::Load - public
+// Description:		Look up a key, and map its data into memory if it
+//					is in the cache (call Release when done with it)
+// Arguments:		-key: the key to look for
+//					-pEntry: storage for the mapped entry
+// Return Value:	A boolean value: -true: cache hit
+//									 -false: cache miss
+//--------------------------------------------------------------
+bool CBAKE_CACHE::Load( BAKE_KEY key, SBAKE_ENTRY* pEntry )
+{
+	SBAKE_FILE_HEADER* pHeader;
+	char szFilename[MAX_PATH];
+	unsigned int uiFileSize;
+
+	memset( pEntry, 0, sizeof( SBAKE_ENTRY ) );
+
+	if( !m_bEnabled )
+		return false;
+
+	GetFilename( key, szFilename );
+
+	pEntry->m_hFile= CreateFile( szFilename, GENERIC_READ, FILE_SHARE_READ, NULL,
+								 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( pEntry->m_hFile==INVALID_HANDLE_VALUE )
+	{
+		pEntry->m_hFile= NULL;
+		m_iMisses++;
+		return false;
+	}
+
+	uiFileSize= GetFileSize( pEntry->m_hFile, NULL );
+	if( uiFileSize>=sizeof( SBAKE_FILE_HEADER ) )
+	{
+		pEntry->m_hMapping= CreateFileMapping( pEntry->m_hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+		if( pEntry->m_hMapping )
+			pEntry->m_ucpView= ( unsigned char* )MapViewOfFile( pEntry->m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+	}
+
+	//make sure that the file is actually what we asked for
+	pHeader= ( SBAKE_FILE_HEADER* )pEntry->m_ucpView;
+	if( pHeader==NULL ||
+		pHeader->m_uiMagic!=BAKE_CACHE_MAGIC || pHeader->m_uiVersion!=BAKE_CACHE_VERSION ||
+		pHeader->m_uiKeyLow!=( unsigned int )key || pHeader->m_uiKeyHigh!=( unsigned int )( key>>32 ) ||
+		pHeader->m_uiDataSize!=uiFileSize-sizeof( SBAKE_FILE_HEADER ) )
+	{
+		Release( pEntry );
+		DeleteFile( szFilename );
+
+		g_log.Write( LOG_FAILURE, "Bake cache: discarded stale file %s", szFilename );
+		m_iStale++;
+		m_iMisses++;
+		return false;
+	}
+
+	pEntry->m_ucpData= pEntry->m_ucpView+sizeof( SBAKE_FILE_HEADER );
+	pEntry->m_uiSize = pHeader->m_uiDataSize;
+
+	m_uiBytesRead+= pEntry->m_uiSize;
+	m_iHits++;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::Release - public
+// Description:		Unmap an entry that Load returned
+// Arguments:		-pEntry: the entry to release
+// Return Value:	None
+//--------------------------------------------------------------
+void CBAKE_CACHE::Release( SBAKE_ENTRY* pEntry )
+{
+	if( pEntry->m_ucpView )
+		UnmapViewOfFile( pEntry->m_ucpView );
+	if( pEntry->m_hMapping )
+		CloseHandle( pEntry->m_hMapping );
+	if( pEntry->m_hFile )
+		CloseHandle( pEntry->m_hFile );
+
+	memset( pEntry, 0, sizeof( SBAKE_ENTRY ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::Store - public
+// Description:		Write freshly baked data to the cache.  The data is
+//					given in two parts (a small description of the data,
+//					and then the data itself) so that callers don't need
+//					to glue them together first.
+// Arguments:		-key: the key to store the data under
+//					-pHeader, uiHeaderSize: the first part of the data
+//					-pData, uiDataSize: the second part of the data
+// Return Value:	A boolean value: -true: data was stored
+//									 -false: data was not stored
+//--------------------------------------------------------------
+bool CBAKE_CACHE::Store( BAKE_KEY key, const void* pHeader, unsigned int uiHeaderSize,
+						 const void* pData, unsigned int uiDataSize )
+{
+	SBAKE_FILE_HEADER header;
+	char szFilename[MAX_PATH];
+	char szTempFilename[MAX_PATH];
+	FILE* pFile;
+	bool bWritten;
+
+	if( !m_bEnabled )
+		return false;
+
+	GetFilename( key, szFilename );
+	sprintf( szTempFilename, "%s.tmp", szFilename );
+
+	pFile= fopen( szTempFilename, "wb" );
+	if( pFile==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Bake cache: could not create %s", szTempFilename );
+		return false;
+	}
+
+	header.m_uiMagic   = BAKE_CACHE_MAGIC;
+	header.m_uiVersion = BAKE_CACHE_VERSION;
+	header.m_uiKeyLow  = ( unsigned int )key;
+	header.m_uiKeyHigh = ( unsigned int )( key>>32 );
+	header.m_uiDataSize= uiHeaderSize+uiDataSize;
+
+	bWritten= ( fwrite( &header, sizeof( SBAKE_FILE_HEADER ), 1, pFile )==1 );
+	if( bWritten && uiHeaderSize )
+		bWritten= ( fwrite( pHeader, uiHeaderSize, 1, pFile )==1 );
+	if( bWritten && uiDataSize )
+		bWritten= ( fwrite( pData, uiDataSize, 1, pFile )==1 );
+
+	fclose( pFile );
+
+	//write to a temporary file first, so that a crash can't leave half of
+	//an entry behind
+	DeleteFile( szFilename );
+	if( !bWritten || !MoveFile( szTempFilename, szFilename ) )
+	{
+		DeleteFile( szTempFilename );
+		g_log.Write( LOG_FAILURE, "Bake cache: could not write %s", szFilename );
+		return false;
+	}
+
+	m_uiBytesWritten+= header.m_uiDataSize;
+	m_iStores++;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::Invalidate - public
+// Description:		Delete every file in the cache
+// Arguments:		None
+// Return Value:	An integer value: the number of files deleted
+//--------------------------------------------------------------
+int CBAKE_CACHE::Invalidate( void )
+{
+	WIN32_FIND_DATA findData;
+	HANDLE hFind;
+	char szSearch[MAX_PATH];
+	char szFilename[MAX_PATH];
+	int iNumDeleted= 0;
+
+	if( m_szDirectory[0]=='\0' )
+		return 0;
+
+	sprintf( szSearch, "%s\\*.bake", m_szDirectory );
+
+	hFind= FindFirstFile( szSearch, &findData );
+	if( hFind==INVALID_HANDLE_VALUE )
+		return 0;
+
+	do
+	{
+		sprintf( szFilename, "%s\\%s", m_szDirectory, findData.cFileName );
+		if( DeleteFile( szFilename ) )
+			iNumDeleted++;
+	} while( FindNextFile( hFind, &findData ) );
+
+	FindClose( hFind );
+
+	g_log.Write( LOG_SUCCESS, "Bake cache: invalidated %d files", iNumDeleted );
+	return iNumDeleted;
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::LogStats - public
+// Description:		Write the cache's statistics to the log
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CBAKE_CACHE::LogStats( void )
+{
+	int iLookups= m_iHits+m_iMisses;
+
+	g_log.Write( LOG_PLAINTEXT, "Bake cache: %d hits, %d misses (%d stale), %.1f%% hit rate, %d stores, %u KB read, %u KB written",
+				 m_iHits, m_iMisses, m_iStale, iLookups ? ( 100.0f*m_iHits )/iLookups : 0.0f,
+				 m_iStores, m_uiBytesRead/1024, m_uiBytesWritten/1024 );
+}
+
+//--------------------------------------------------------------
+// Name:			CBAKE_CACHE::GetFilename - private
+// Description:		Get the cache file's name for a key
+// Arguments:		-key: the key
+//					-szFilename: storage for the filename (MAX_PATH characters)
+// Return Value:	None
+//--------------------------------------------------------------
+void CBAKE_CACHE::GetFilename( BAKE_KEY key, char* szFilename )
+{
+	sprintf( szFilename, "%s\\%08x%08x.bake", m_szDirectory,
+			 ( unsigned int )( key>>32 ), ( unsigned int )key );
+}
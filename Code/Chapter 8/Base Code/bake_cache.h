@@ -0,0 +1,184 @@
+//==============================================================
+//==============================================================
+//= bake_cache.h ===============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= An on-disk cache for data that takes a while to generate   =
+//= (height maps, lightmaps, texture maps).  Entries are keyed =
+//= by a hash of everything that went into making them.		   =
+//==============================================================
+//==============================================================
+#ifndef __BAKE_CACHE_H__
+#define __BAKE_CACHE_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <windows.h>
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#define BAKE_CACHE_MAGIC   0x454B4142		//"BAKE"
+
+//bump this whenever the layout of any baked data changes, so that
+//old cache files get thrown out instead of being misread
+#define BAKE_CACHE_VERSION 1
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- STRUCTURES -------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+typedef unsigned __int64 BAKE_KEY;
+
+struct SBAKE_FILE_HEADER
+{
+	unsigned int m_uiMagic;
+	unsigned int m_uiVersion;
+	unsigned int m_uiKeyLow;
+	unsigned int m_uiKeyHigh;
+	unsigned int m_uiDataSize;		//not counting this header
+};
+
+//a cache hit, mapped into memory (read-only)
+struct SBAKE_ENTRY
+{
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+	unsigned char* m_ucpView;
+	unsigned char* m_ucpData;		//the baked data (just past the header)
+	unsigned int   m_uiSize;
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CBAKE_CACHE
+{
+	private:
+		char m_szDirectory[MAX_PATH];
+		bool m_bEnabled;
+
+		//statistics
+		int m_iHits;
+		int m_iMisses;
+		int m_iStale;				//files that were thrown out (old version, corrupt)
+		int m_iStores;
+		unsigned int m_uiBytesRead;
+		unsigned int m_uiBytesWritten;
+
+	void GetFilename( BAKE_KEY key, char* szFilename );
+
+	public:
+
+	bool Init( char* szDirectory );
+
+	static BAKE_KEY HashBegin( char* szArtefact );
+	static BAKE_KEY Hash( BAKE_KEY key, const void* pData, unsigned int uiSize );
+
+	bool Load( BAKE_KEY key, SBAKE_ENTRY* pEntry );
+	void Release( SBAKE_ENTRY* pEntry );
+	bool Store( BAKE_KEY key, const void* pHeader, unsigned int uiHeaderSize,
+				const void* pData, unsigned int uiDataSize );
+
+	int Invalidate( void );
+
+	void LogStats( void );
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::HashInt - public
+	// Description:		Add an integer parameter to a key
+	// Arguments:		-key: the key so far
+	//					-iValue: the value to add
+	// Return Value:	A BAKE_KEY value: the new key
+	//--------------------------------------------------------------
+	static inline BAKE_KEY HashInt( BAKE_KEY key, int iValue )
+	{	return Hash( key, &iValue, sizeof( int ) );	}
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::HashFloat - public
+	// Description:		Add a floating-point parameter to a key
+	// Arguments:		-key: the key so far
+	//					-fValue: the value to add
+	// Return Value:	A BAKE_KEY value: the new key
+	//--------------------------------------------------------------
+	static inline BAKE_KEY HashFloat( BAKE_KEY key, float fValue )
+	{	return Hash( key, &fValue, sizeof( float ) );	}
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::HashKey - public
+	// Description:		Add another key (for data that this data was made
+	//					from) to a key
+	// Arguments:		-key: the key so far
+	//					-otherKey: the key to add
+	// Return Value:	A BAKE_KEY value: the new key
+	//--------------------------------------------------------------
+	static inline BAKE_KEY HashKey( BAKE_KEY key, BAKE_KEY otherKey )
+	{	return Hash( key, &otherKey, sizeof( BAKE_KEY ) );	}
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::Enable - public
+	// Description:		Turn the cache on or off (when it is off, every
+	//					lookup misses and nothing is written)
+	// Arguments:		-bEnable: use the cache or not
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void Enable( bool bEnable )
+	{	m_bEnabled= bEnable;	}
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::IsEnabled - public
+	// Description:		Check to see if the cache is in use
+	// Arguments:		None
+	// Return Value:	A boolean variable: -true: cache is enabled
+	//										-false: cache is disabled
+	//--------------------------------------------------------------
+	inline bool IsEnabled( void )
+	{	return m_bEnabled;	}
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::GetNumHits - public
+	// Description:		Get the number of lookups that found their data
+	// Arguments:		None
+	// Return Value:	An integer value: the number of cache hits
+	//--------------------------------------------------------------
+	inline int GetNumHits( void )
+	{	return m_iHits;	}
+
+	//--------------------------------------------------------------
+	// Name:			CBAKE_CACHE::GetNumMisses - public
+	// Description:		Get the number of lookups that had to be baked
+	// Arguments:		None
+	// Return Value:	An integer value: the number of cache misses
+	//--------------------------------------------------------------
+	inline int GetNumMisses( void )
+	{	return m_iMisses;	}
+
+	CBAKE_CACHE( void ) : m_bEnabled( false ), m_iHits( 0 ), m_iMisses( 0 ), m_iStale( 0 ),
+						  m_iStores( 0 ), m_uiBytesRead( 0 ), m_uiBytesWritten( 0 )
+	{	m_szDirectory[0]= '\0';	}
+	~CBAKE_CACHE( void )
+	{	}
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+extern CBAKE_CACHE g_bakeCache;
+
+
+#endif	//__BAKE_CACHE_H__
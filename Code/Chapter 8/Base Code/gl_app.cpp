@@ -52,6 +52,8 @@ PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT;
 
 PFNGLFOGCOORDFEXTPROC glFogCoordfEXT;
 
+PFNGLCOMPRESSEDTEXIMAGE2DARBPROC glCompressedTexImage2DARB= NULL;
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- DEFINITIONS ------------------------------------------------
@@ -246,6 +248,15 @@ bool CGL_APP::Init( int iX, int iY, int iWidth, int iHeight, int iBPP,
 	glLockArraysEXT  = ( PFNGLLOCKARRAYSEXTPROC )  wglGetProcAddress( "glLockArraysEXT" );
 	glUnlockArraysEXT= ( PFNGLUNLOCKARRAYSEXTPROC )wglGetProcAddress( "glUnlockArraysEXT" );
 
+	//block compressed (S3TC) textures
+	if( CheckExtension( "GL_ARB_texture_compression" ) && CheckExtension( "GL_EXT_texture_compression_s3tc" ) )
+	{
+		glCompressedTexImage2DARB= ( PFNGLCOMPRESSEDTEXIMAGE2DARBPROC )wglGetProcAddress( "glCompressedTexImage2DARB" );
+		m_bCanCompressTextures	 = ( glCompressedTexImage2DARB!=NULL );
+	}
+	else
+		m_bCanCompressTextures= false;
+
 	m_bActive= APP_ACTIVE;
 	g_log.Write( LOG_SUCCESS, "WINDOW SUCCESS: A %dx%dx%d window has been created", m_iWidth, m_iHeight, m_iBPP);
 	return true;
@@ -68,6 +68,9 @@ class CGL_APP
 		//compiled vertex array (CVA) flag
 		bool m_bCanCVA;
 
+		//S3TC texture compression flag
+		bool m_bCanCompressTextures;
+
 	static LRESULT CALLBACK WindowProc( HWND hWnd, UINT uiMsg, WPARAM wParam, LPARAM lParam );
 
 	public:
@@ -240,6 +243,16 @@ class CGL_APP
 	inline bool CanMultitexture( void )
 	{	return m_bCanMultitexture;	}
 
+	//----------------------------------------------------------
+	// Name:			CGL_APP::CanCompressTextures - public
+	// Description:		Check to see if we can upload S3TC (DXT1/DXT5) textures
+	// Arguments:		None
+	// Return Value:	A boolean variable: -true: can use compressed textures
+	//										-false: cannot use compressed textures
+	//----------------------------------------------------------
+	inline bool CanCompressTextures( void )
+	{	return m_bCanCompressTextures;	}
+
 	//----------------------------------------------------------
 	// Name:			CGL_APP::CGL_APP - public
 	// Description:		Default constructor
@@ -290,4 +303,6 @@ extern PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT;
 
 extern PFNGLFOGCOORDFEXTPROC glFogCoordfEXT;
 
+extern PFNGLCOMPRESSEDTEXIMAGE2DARBPROC glCompressedTexImage2DARB;
+
 #endif	//__GL_APP_H__
\ No newline at end of file
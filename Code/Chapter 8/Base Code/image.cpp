@@ -16,9 +16,13 @@
 //--------------------------------------------------------------
 #include <stdio.h>
 #include <memory.h>
+#include <math.h>
 
 #include "image.h"
+#include "gl_app.h"
 #include "log.h"
+#include "simd.h"
+#include "thread_pool.h"
 
 
 //--------------------------------------------------------------
@@ -30,6 +34,26 @@ unsigned char g_ucUTGAcompare[12]= {	0, 0, 2,  0, 0, 0, 0, 0, 0, 0, 0, 0	};
 unsigned char g_ucCTGAcompare[12]= {	0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0	};
 
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- STRUCTURES -------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//one mipmap level's worth of block compression work, split into
+//rows of 4x4 blocks (one row per job)
+struct SCOMPRESS_JOB
+{
+	unsigned char* m_ucpSrc;		//RGB or RGBA pixels
+	unsigned char* m_ucpDest;		//compressed blocks
+	unsigned int   m_uiWidth;
+	unsigned int   m_uiHeight;
+	unsigned int   m_uiBytesPP;
+	unsigned int   m_uiBlocksX;
+	EIMAGE_COMPRESSION m_compression;
+	EIMAGE_QUALITY	   m_quality;
+};
+
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- DEFINITIONS ------------------------------------------------
@@ -46,6 +70,9 @@ unsigned char g_ucCTGAcompare[12]= {	0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0	};
 //--------------------------------------------------------------
 bool CIMAGE::Create( unsigned int uiWidth, unsigned int uiHeight, unsigned int uiBPP )
 {
+	//free whatever the image was holding before
+	Unload( );
+
 	//set the member variables
 	m_uiWidth = uiWidth;
 	m_uiHeight= uiHeight;
@@ -64,6 +91,54 @@ bool CIMAGE::Create( unsigned int uiWidth, unsigned int uiHeight, unsigned int u
 	return true;
 }
 
+//--------------------------------------------------------------
+// Name:			CIMAGE::CreateCompressed - public
+// Description:		Create space for a block compressed texture (fill it
+//					in through GetCompressedData)
+// Arguments:		-uiWidth, uiHeight: the dimensions of the new image
+//					-compression: IMAGE_BC1 or IMAGE_BC3
+//					-uiNumLevels: the number of mipmap levels
+// Return Value:	A boolean variable: -true: memory was successfully allocated
+//									    -false: memory was not successfully allocated
+//--------------------------------------------------------------
+bool CIMAGE::CreateCompressed( unsigned int uiWidth, unsigned int uiHeight, EIMAGE_COMPRESSION compression, unsigned int uiNumLevels )
+{
+	unsigned int uiSize;
+	unsigned int i;
+
+	//free whatever the image was holding before
+	Unload( );
+
+	//set the member variables
+	m_uiWidth	 = uiWidth;
+	m_uiHeight	 = uiHeight;
+	m_uiBPP		 = ( compression==IMAGE_BC3 ) ? 32 : 24;
+	m_compression= compression;
+	m_uiNumLevels= uiNumLevels;
+
+	//add up the size of all of the levels
+	uiSize= 0;
+	for( i=0; i<uiNumLevels; i++ )
+	{
+		uiSize	+= GetCompressedSize( uiWidth, uiHeight, compression );
+		uiWidth	 = ( uiWidth>1 )  ? uiWidth/2  : 1;
+		uiHeight = ( uiHeight>1 ) ? uiHeight/2 : 1;
+	}
+
+	//allocate memory
+	m_ucpBlocks= new unsigned char [uiSize];
+	if( !m_ucpBlocks )
+	{
+		g_log.Write( LOG_FAILURE, "Out of memory for image memory allocation" );
+		return false;
+	}
+	m_uiBlocksSize= uiSize;
+
+	//set the loaded flag
+	m_bIsLoaded= true;
+	return true;
+}
+
 //--------------------------------------------------------------
 // Name:			CIMAGE::LoadData - public
 // Description:		Load only the data for a new image (do not create an
@@ -79,6 +154,10 @@ bool CIMAGE::LoadData( char* szFilename )
 	int iEnd;
 	int iSize;
 
+	//free whatever the image was holding before (the loaders, LoadDDS
+	//included, fill in the buffers without looking at them)
+	Unload( );
+
 	//open the file for reading (in binary mode)
 	pFile= fopen( szFilename, "rb" );
 
@@ -112,8 +191,19 @@ bool CIMAGE::LoadData( char* szFilename )
 		return false;
 	}
 
+	//check to see if the file is a block compressed DDS
+	if( iSize>=( int )sizeof( DDSHeader ) && memcmp( m_ucpData, "DDS ", 4 )==0 )
+	{
+		//the DDS loader takes ownership of the file buffer
+		if( !LoadDDS( m_ucpData, iSize ) )
+		{
+			g_log.Write( LOG_FAILURE, "Could not load DDS %s\n", szFilename );
+			return false;
+		}
+	}
+
 	//check to see if the file is in the BMP format
-	if( memcmp( m_ucpData, "BM", 2 )==0 )
+	else if( memcmp( m_ucpData, "BM", 2 )==0 )
 	{
 		//load the BMP using the BMP-loading routine
 		if( !LoadBMP( ) )
@@ -194,24 +284,97 @@ bool CIMAGE::LoadData( char* szFilename )
 //--------------------------------------------------------------
 bool CIMAGE::Load( char* szFilename, float fMinFilter, float fMaxFilter, bool bMipmap )
 {
-	int	iType;
-
 	//load the file's data in
 	if( !LoadData( szFilename ) )
 		return false;
 
-	//set the image's OpenGL BPP type
-	if( m_uiBPP==24 )
-		iType= GL_RGB;
-	else
-		iType= GL_RGBA;
+	//build the texture for use with OpenGL
+	return Upload( fMinFilter, fMaxFilter, bMipmap );
+}
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::Upload - public
+// Description:		Create an OpenGL texture from the image's data.  If
+//					the image has been block compressed, and the video
+//					card can handle S3TC textures, the compressed blocks
+//					are sent as they are
+// Arguments:		-fMinFilter/fMaxFilter: OpenGL filter (GL_LINEAR is most common)
+//					-bMipmap: create mipmaps for the texture being created
+// Return Value:	A boolean variable: -true: texture was successfully created
+//									    -false: texture was not successfully created
+//--------------------------------------------------------------
+bool CIMAGE::Upload( float fMinFilter, float fMaxFilter, bool bMipmap )
+{
+	unsigned char* ucpLevel;
+	unsigned int uiWidth, uiHeight;
+	unsigned int uiLevelSize;
+	unsigned int i;
+	int	iType;
+	int iFormat;
+
+	//the video card can't handle the compressed data, so decode it
+	if( m_ucpBlocks && glCompressedTexImage2DARB==NULL && m_ucpData==NULL )
+	{
+		if( !Decompress( ) )
+			return false;
+	}
 
 	//build the texture for use with OpenGL
 	glGenTextures( 1, &m_ID );
 	glBindTexture( GL_TEXTURE_2D, m_ID );
+
+	//upload the compressed blocks directly
+	if( m_ucpBlocks && glCompressedTexImage2DARB!=NULL )
+	{
+		if( m_compression==IMAGE_BC1 )
+			iFormat= GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		else
+			iFormat= GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+		//without a full chain of levels, the texture can't be mipmapped
+		if( bMipmap && m_uiNumLevels<2 )
+		{
+			g_log.Write( LOG_FAILURE, "Compressed texture has no mipmaps, using linear filtering" );
+			fMinFilter= GL_LINEAR;
+			bMipmap	  = false;
+		}
+
+		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, fMinFilter );
+		glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, fMaxFilter );
+
+		ucpLevel= m_ucpBlocks;
+		uiWidth = m_uiWidth;
+		uiHeight= m_uiHeight;
+		for( i=0; i<( bMipmap ? m_uiNumLevels : 1 ); i++ )
+		{
+			uiLevelSize= GetCompressedSize( uiWidth, uiHeight, m_compression );
+			glCompressedTexImage2DARB( GL_TEXTURE_2D, i, iFormat, uiWidth, uiHeight,
+									   0, uiLevelSize, ucpLevel );
+
+			//move on to the next level
+			ucpLevel+= uiLevelSize;
+			uiWidth	 = ( uiWidth>1 )  ? uiWidth/2  : 1;
+			uiHeight = ( uiHeight>1 ) ? uiHeight/2 : 1;
+		}
+
+		//a chain that stops short of 1x1 is only complete if GL is told
+		//where it stops
+		if( bMipmap )
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_uiNumLevels-1 );
+
+		m_bIsLoaded= true;
+		return true;
+	}
+
 	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, fMinFilter );
 	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, fMaxFilter );						
 
+	//set the image's OpenGL BPP type
+	if( m_uiBPP==24 )
+		iType= GL_RGB;
+	else
+		iType= GL_RGBA;
+
 	//create the texture normally
 	if( !bMipmap )
 		glTexImage2D( GL_TEXTURE_2D, 0, iType, m_uiWidth, m_uiHeight, 
@@ -237,7 +400,16 @@ void CIMAGE::Unload( void )
 {
 	if( m_bIsLoaded )
 	{
-		delete[] m_ucpData;
+		if( m_ucpData )
+			delete[] m_ucpData;
+		m_ucpData= NULL;
+
+		if( m_ucpBlocks )
+			delete[] m_ucpBlocks;
+		m_ucpBlocks	  = NULL;
+		m_uiBlocksSize= 0;
+		m_uiNumLevels = 0;
+		m_compression = IMAGE_UNCOMPRESSED;
 
 		m_uiWidth = 0;
 		m_uiHeight= 0;
@@ -555,7 +727,7 @@ bool CIMAGE::LoadUncompressedTGA( void )
 	memcpy( m_ucpData, ucpFile, pTGAinfo.m_uiImageSize );
 
 	//byte swapping ( optimized by Steve Thomas )
-	for( uiCSwap=0; uiCSwap<( int )pTGAinfo.m_uiImageSize; uiCSwap+=pTGAinfo.m_uiBytesPerPixel )
+	for( uiCSwap=0; uiCSwap<pTGAinfo.m_uiImageSize; uiCSwap+=pTGAinfo.m_uiBytesPerPixel )
 	{
 		m_ucpData[uiCSwap]^= m_ucpData[uiCSwap+2]^=
 		m_ucpData[uiCSwap]^= m_ucpData[uiCSwap+2];
@@ -564,3 +736,933 @@ bool CIMAGE::LoadUncompressedTGA( void )
 	//the uncompressed TGA has been successfully loaded
 	return true;
 }
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::LoadDDS - private
+// Description:		Load a block compressed (DXT1/DXT5) DirectDraw surface
+// Arguments:		-ucpFile: the file's data (this function takes ownership)
+//					-uiFileSize: the size of the file's data
+// Return Value:	A boolean variable: -true: DDS was loaded
+//									    -false: DDS was not loaded
+//--------------------------------------------------------------
+bool CIMAGE::LoadDDS( unsigned char* ucpFile, unsigned int uiFileSize )
+{
+	DDSHeader* pHeader= ( DDSHeader* )ucpFile;
+	unsigned int uiWidth, uiHeight;
+	unsigned int uiLevels, uiMaxLevels;
+	unsigned int uiSize;
+	unsigned int i;
+
+	m_ucpData= NULL;
+
+	//we only handle the two formats that we can compress to ourselves
+	if( !( pHeader->pixelFormat.uiFlags & DDS_FOURCC ) )
+	{
+		delete[] ucpFile;
+		return false;
+	}
+
+	if( pHeader->pixelFormat.uiFourCC==FOURCC_DXT1 )
+	{
+		m_compression= IMAGE_BC1;
+		m_uiBPP		 = 24;
+	}
+	else if( pHeader->pixelFormat.uiFourCC==FOURCC_DXT5 )
+	{
+		m_compression= IMAGE_BC3;
+		m_uiBPP		 = 32;
+	}
+	else
+	{
+		delete[] ucpFile;
+		return false;
+	}
+
+	m_uiWidth = pHeader->uiWidth;
+	m_uiHeight= pHeader->uiHeight;
+
+	uiLevels= 1;
+	if( ( pHeader->uiFlags & DDS_MIPMAPCOUNT ) && pHeader->uiMipMapCount>1 )
+		uiLevels= pHeader->uiMipMapCount;
+
+	//a full chain goes down to 1x1 (a shorter one is fine, Upload tells
+	//GL where it stops, but a longer one is garbage)
+	uiMaxLevels= 1;
+	for( i=MAX( m_uiWidth, m_uiHeight ); i>1; i/= 2 )
+		uiMaxLevels++;
+
+	if( m_uiWidth==0 || m_uiHeight==0 || uiLevels>uiMaxLevels )
+	{
+		m_compression= IMAGE_UNCOMPRESSED;
+		delete[] ucpFile;
+		return false;
+	}
+
+	//add up the size of all of the levels
+	uiSize	= 0;
+	uiWidth = m_uiWidth;
+	uiHeight= m_uiHeight;
+	for( i=0; i<uiLevels; i++ )
+	{
+		uiSize	+= GetCompressedSize( uiWidth, uiHeight, m_compression );
+		uiWidth	 = ( uiWidth>1 )  ? uiWidth/2  : 1;
+		uiHeight = ( uiHeight>1 ) ? uiHeight/2 : 1;
+	}
+
+	//make sure that the file isn't truncated
+	if( sizeof( DDSHeader )+uiSize>uiFileSize )
+	{
+		m_compression= IMAGE_UNCOMPRESSED;
+		delete[] ucpFile;
+		return false;
+	}
+
+	//copy the blocks out of the file buffer
+	m_ucpBlocks= new unsigned char [uiSize];
+	memcpy( m_ucpBlocks, ucpFile+sizeof( DDSHeader ), uiSize );
+	m_uiBlocksSize= uiSize;
+	m_uiNumLevels = uiLevels;
+
+	delete[] ucpFile;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::SaveCompressed - public
+// Description:		Save the image's block compressed data to a DDS
+//					file, so that it can be loaded without having to
+//					compress it again
+// Arguments:		-szFilename: the filename of the file to be saved
+// Return Value:	A boolean variable: -true: image was saved
+//									    -false: image was not saved
+//--------------------------------------------------------------
+bool CIMAGE::SaveCompressed( char* szFilename )
+{
+	DDSHeader header;
+	FILE* pFile;
+
+	if( m_ucpBlocks==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not save %s, the image has not been compressed", szFilename );
+		return false;
+	}
+
+	pFile= fopen( szFilename, "wb" );
+	if( !pFile )
+	{
+		g_log.Write( LOG_FAILURE, "Could not open a file to save %s in", szFilename );
+		return false;
+	}
+
+	//fill in the header (DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE)
+	memset( &header, 0, sizeof( DDSHeader ) );
+	header.uiMagic			  = DDS_MAGIC;
+	header.uiSize			  = sizeof( DDSHeader )-sizeof( unsigned int );
+	header.uiFlags			  = 0x00081007;
+	header.uiWidth			  = m_uiWidth;
+	header.uiHeight			  = m_uiHeight;
+	header.uiPitchOrLinearSize= GetCompressedSize( m_uiWidth, m_uiHeight, m_compression );
+	header.uiMipMapCount	  = m_uiNumLevels;
+	header.uiCaps[0]		  = 0x00001000;		//DDSCAPS_TEXTURE
+
+	if( m_uiNumLevels>1 )
+	{
+		header.uiFlags	|= DDS_MIPMAPCOUNT;
+		header.uiCaps[0]|= 0x00400008;			//DDSCAPS_MIPMAP | DDSCAPS_COMPLEX
+	}
+
+	header.pixelFormat.uiSize  = sizeof( DDSPixelFormat );
+	header.pixelFormat.uiFlags = DDS_FOURCC;
+	header.pixelFormat.uiFourCC= ( m_compression==IMAGE_BC1 ) ? FOURCC_DXT1 : FOURCC_DXT5;
+
+	fwrite( &header, 1, sizeof( DDSHeader ), pFile );
+	fwrite( m_ucpBlocks, 1, m_uiBlocksSize, pFile );
+
+	fclose( pFile );
+	g_log.Write( LOG_SUCCESS, "%s has been successfully saved", szFilename );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::ReleaseData - public
+// Description:		Free the uncompressed pixels once the image has been
+//					compressed (the compressed blocks are kept around)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CIMAGE::ReleaseData( void )
+{
+	if( m_ucpBlocks && m_ucpData )
+	{
+		delete[] m_ucpData;
+		m_ucpData= NULL;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::GetCompressedSize - public
+// Description:		Get the size of one block compressed image level
+// Arguments:		-uiWidth, uiHeight: the dimensions of the level
+//					-compression: the compression format
+// Return Value:	An unsigned int value: the size of the level, in bytes
+//--------------------------------------------------------------
+unsigned int CIMAGE::GetCompressedSize( unsigned int uiWidth, unsigned int uiHeight, EIMAGE_COMPRESSION compression )
+{
+	unsigned int uiBlocksX= ( uiWidth+3 )/4;
+	unsigned int uiBlocksY= ( uiHeight+3 )/4;
+
+	if( uiBlocksX==0 )
+		uiBlocksX= 1;
+	if( uiBlocksY==0 )
+		uiBlocksY= 1;
+
+	return uiBlocksX*uiBlocksY*( ( compression==IMAGE_BC1 ) ? 8 : 16 );
+}
+
+//--------------------------------------------------------------
+// Name:			PackColor565 - global (this file only)
+// Description:		Pack an RGB color into 5:6:5 bits
+// Arguments:		-fpColor: the RGB color (0-255 per channel)
+// Return Value:	An unsigned short value: the packed color
+//--------------------------------------------------------------
+static unsigned short PackColor565( float* fpColor )
+{
+	int iRed, iGreen, iBlue;
+
+	iRed  = ( int )( fpColor[0]*31.0f/255.0f+0.5f );
+	iGreen= ( int )( fpColor[1]*63.0f/255.0f+0.5f );
+	iBlue = ( int )( fpColor[2]*31.0f/255.0f+0.5f );
+
+	CLAMP( iRed,   0, 31 );
+	CLAMP( iGreen, 0, 63 );
+	CLAMP( iBlue,  0, 31 );
+
+	return ( unsigned short )( ( iRed<<11 ) | ( iGreen<<5 ) | iBlue );
+}
+
+//--------------------------------------------------------------
+// Name:			UnpackColor565 - global (this file only)
+// Description:		Expand a 5:6:5 color back to 8 bits per channel
+// Arguments:		-usColor: the packed color
+//					-ucpColor: storage for the RGB color
+// Return Value:	None
+//--------------------------------------------------------------
+static void UnpackColor565( unsigned short usColor, unsigned char* ucpColor )
+{
+	int iRed  = ( usColor>>11 ) & 31;
+	int iGreen= ( usColor>>5 ) & 63;
+	int iBlue = usColor & 31;
+
+	//replicate the high bits into the low bits
+	ucpColor[0]= ( unsigned char )( ( iRed<<3 ) | ( iRed>>2 ) );
+	ucpColor[1]= ( unsigned char )( ( iGreen<<2 ) | ( iGreen>>4 ) );
+	ucpColor[2]= ( unsigned char )( ( iBlue<<3 ) | ( iBlue>>2 ) );
+}
+
+//--------------------------------------------------------------
+// Name:			MakePalette - global (this file only)
+// Description:		Build the four color palette for a BC1 block
+// Arguments:		-usColor0, usColor1: the two endpoints
+//					-fpPalette: storage for the palette (4 RGB triplets)
+// Return Value:	None
+//--------------------------------------------------------------
+static void MakePalette( unsigned short usColor0, unsigned short usColor1, float* fpPalette )
+{
+	unsigned char ucColor0[3], ucColor1[3];
+	int i;
+
+	UnpackColor565( usColor0, ucColor0 );
+	UnpackColor565( usColor1, ucColor1 );
+
+	for( i=0; i<3; i++ )
+	{
+		fpPalette[i]  = ucColor0[i];
+		fpPalette[3+i]= ucColor1[i];
+		fpPalette[6+i]= ( float )( ( 2*ucColor0[i]+ucColor1[i] )/3 );
+		fpPalette[9+i]= ( float )( ( ucColor0[i]+2*ucColor1[i] )/3 );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			FindColorIndices - global (this file only)
+// Description:		Find the closest palette entry for each of the
+//					block's 16 pixels
+// Arguments:		-fpRed, fpGreen, fpBlue: the block's pixels (16 each,
+//											 16-byte aligned)
+//					-fpPalette: the four palette colors
+//					-uipIndices: storage for the packed 2-bit indices
+// Return Value:	A floating point value: the block's squared error
+//--------------------------------------------------------------
+static float FindColorIndices( float* fpRed, float* fpGreen, float* fpBlue,
+							   float* fpPalette, unsigned int* uipIndices )
+{
+	unsigned int uiIndices= 0;
+	float fError= 0.0f;
+	int i;
+
+#ifdef USE_SSE2
+	SIMD_ALIGN( float fBest[4] );
+	SIMD_ALIGN( int iBest[4] );
+	__m128 vRed, vGreen, vBlue;
+	__m128 vDist, vBestDist, vDelta, vMask;
+	__m128i viBest;
+	int j, k;
+
+	//test four pixels at once against each of the palette entries
+	for( i=0; i<16; i+=4 )
+	{
+		vRed  = _mm_load_ps( fpRed+i );
+		vGreen= _mm_load_ps( fpGreen+i );
+		vBlue = _mm_load_ps( fpBlue+i );
+
+		vBestDist= _mm_set1_ps( BIG );
+		viBest	 = _mm_setzero_si128( );
+
+		for( j=0; j<4; j++ )
+		{
+			vDelta= _mm_sub_ps( vRed, _mm_set1_ps( fpPalette[j*3] ) );
+			vDist = _mm_mul_ps( vDelta, vDelta );
+			vDelta= _mm_sub_ps( vGreen, _mm_set1_ps( fpPalette[j*3+1] ) );
+			vDist = _mm_add_ps( vDist, _mm_mul_ps( vDelta, vDelta ) );
+			vDelta= _mm_sub_ps( vBlue, _mm_set1_ps( fpPalette[j*3+2] ) );
+			vDist = _mm_add_ps( vDist, _mm_mul_ps( vDelta, vDelta ) );
+
+			//keep the entry if it is closer than the best one so far
+			vMask	 = _mm_cmplt_ps( vDist, vBestDist );
+			vBestDist= _mm_min_ps( vDist, vBestDist );
+			viBest	 = _mm_or_si128( _mm_andnot_si128( _mm_castps_si128( vMask ), viBest ),
+									 _mm_and_si128( _mm_castps_si128( vMask ), _mm_set1_epi32( j ) ) );
+		}
+
+		_mm_store_ps( fBest, vBestDist );
+		_mm_store_si128( ( __m128i* )iBest, viBest );
+
+		for( k=0; k<4; k++ )
+		{
+			uiIndices|= ( unsigned int )iBest[k]<<( ( i+k )*2 );
+			fError	 += fBest[k];
+		}
+	}
+#else
+	float fDist, fBestDist;
+	float fDeltaR, fDeltaG, fDeltaB;
+	int iBest;
+	int j;
+
+	for( i=0; i<16; i++ )
+	{
+		fBestDist= BIG;
+		iBest	 = 0;
+
+		for( j=0; j<4; j++ )
+		{
+			fDeltaR= fpRed[i]  -fpPalette[j*3];
+			fDeltaG= fpGreen[i]-fpPalette[j*3+1];
+			fDeltaB= fpBlue[i] -fpPalette[j*3+2];
+			fDist  = fDeltaR*fDeltaR + fDeltaG*fDeltaG + fDeltaB*fDeltaB;
+
+			if( fDist<fBestDist )
+			{
+				fBestDist= fDist;
+				iBest	 = j;
+			}
+		}
+
+		uiIndices|= ( unsigned int )iBest<<( i*2 );
+		fError	 += fBestDist;
+	}
+#endif
+
+	*uipIndices= uiIndices;
+	return fError;
+}
+
+//--------------------------------------------------------------
+// Name:			EncodeColorEndpoints - global (this file only)
+// Description:		Quantize two endpoints and find the block's indices
+// Arguments:		-fpRed, fpGreen, fpBlue: the block's pixels
+//					-fpMax, fpMin: the two endpoints (unquantized)
+//					-ucpDest: storage for the 8 byte color block
+// Return Value:	A floating point value: the block's squared error
+//--------------------------------------------------------------
+static float EncodeColorEndpoints( float* fpRed, float* fpGreen, float* fpBlue,
+								   float* fpMax, float* fpMin, unsigned char* ucpDest )
+{
+	unsigned short usColor0, usColor1, usTemp;
+	unsigned int uiIndices;
+	float fPalette[12];
+	float fError;
+
+	usColor0= PackColor565( fpMax );
+	usColor1= PackColor565( fpMin );
+
+	//the four color mode needs the first endpoint to be the larger one
+	if( usColor0<usColor1 )
+	{
+		usTemp	= usColor0;
+		usColor0= usColor1;
+		usColor1= usTemp;
+	}
+
+	MakePalette( usColor0, usColor1, fPalette );
+	fError= FindColorIndices( fpRed, fpGreen, fpBlue, fPalette, &uiIndices );
+
+	//identical endpoints would switch the block into three color mode,
+	//where index 3 means black, so use the first entry everywhere
+	if( usColor0==usColor1 )
+		uiIndices= 0;
+
+	ucpDest[0]= ( unsigned char )( usColor0 & 0xFF );
+	ucpDest[1]= ( unsigned char )( usColor0>>8 );
+	ucpDest[2]= ( unsigned char )( usColor1 & 0xFF );
+	ucpDest[3]= ( unsigned char )( usColor1>>8 );
+	ucpDest[4]= ( unsigned char )( uiIndices & 0xFF );
+	ucpDest[5]= ( unsigned char )( ( uiIndices>>8 ) & 0xFF );
+	ucpDest[6]= ( unsigned char )( ( uiIndices>>16 ) & 0xFF );
+	ucpDest[7]= ( unsigned char )( uiIndices>>24 );
+
+	return fError;
+}
+
+//--------------------------------------------------------------
+// Name:			CompressColorBlock - global (this file only)
+// Description:		Compress a 4x4 block of pixels into a BC1 color block
+// Arguments:		-ucpPixels: the block's pixels (16 RGBA quadruplets)
+//					-quality: how hard to look for good endpoints
+//					-ucpDest: storage for the 8 byte color block
+// Return Value:	None
+//--------------------------------------------------------------
+static void CompressColorBlock( unsigned char* ucpPixels, EIMAGE_QUALITY quality, unsigned char* ucpDest )
+{
+	SIMD_ALIGN( float fRed[16] );
+	SIMD_ALIGN( float fGreen[16] );
+	SIMD_ALIGN( float fBlue[16] );
+	unsigned char ucTryBlock[8];
+	float fMin[3], fMax[3], fInset;
+	float fMean[3], fCov[6], fAxis[3], fTemp[3];
+	float fT, fMinT, fMaxT, fLength;
+	float fWeight, fAlpha2, fBeta2, fAlphaBeta, fDet;
+	float fAlphaX[3], fBetaX[3];
+	float fError, fTryError;
+	unsigned int uiIndices;
+	int iIteration;
+	int i, j;
+
+	//split the block up into channels (makes the SIMD index search easier)
+	for( i=0; i<16; i++ )
+	{
+		fRed[i]	 = ucpPixels[i*4];
+		fGreen[i]= ucpPixels[i*4+1];
+		fBlue[i] = ucpPixels[i*4+2];
+	}
+
+	//fast: use the corners of the block's color bounding box
+	if( quality==COMPRESS_FAST )
+	{
+		fMin[0]= fMax[0]= fRed[0];
+		fMin[1]= fMax[1]= fGreen[0];
+		fMin[2]= fMax[2]= fBlue[0];
+		for( i=1; i<16; i++ )
+		{
+			fMin[0]= MIN( fMin[0], fRed[i] );	fMax[0]= MAX( fMax[0], fRed[i] );
+			fMin[1]= MIN( fMin[1], fGreen[i] );	fMax[1]= MAX( fMax[1], fGreen[i] );
+			fMin[2]= MIN( fMin[2], fBlue[i] );	fMax[2]= MAX( fMax[2], fBlue[i] );
+		}
+
+		//pull the endpoints in a bit, since the extremes are rarely hit
+		for( j=0; j<3; j++ )
+		{
+			fInset = ( fMax[j]-fMin[j] )/16.0f;
+			fMax[j]-= fInset;
+			fMin[j]+= fInset;
+		}
+
+		EncodeColorEndpoints( fRed, fGreen, fBlue, fMax, fMin, ucpDest );
+		return;
+	}
+
+	//normal: fit a line through the colors along their principal axis
+	fMean[0]= fMean[1]= fMean[2]= 0.0f;
+	for( i=0; i<16; i++ )
+	{
+		fMean[0]+= fRed[i];
+		fMean[1]+= fGreen[i];
+		fMean[2]+= fBlue[i];
+	}
+	fMean[0]/= 16.0f;
+	fMean[1]/= 16.0f;
+	fMean[2]/= 16.0f;
+
+	//build the covariance matrix (rr, rg, rb, gg, gb, bb)
+	for( j=0; j<6; j++ )
+		fCov[j]= 0.0f;
+	for( i=0; i<16; i++ )
+	{
+		fTemp[0]= fRed[i]  -fMean[0];
+		fTemp[1]= fGreen[i]-fMean[1];
+		fTemp[2]= fBlue[i] -fMean[2];
+
+		fCov[0]+= fTemp[0]*fTemp[0];
+		fCov[1]+= fTemp[0]*fTemp[1];
+		fCov[2]+= fTemp[0]*fTemp[2];
+		fCov[3]+= fTemp[1]*fTemp[1];
+		fCov[4]+= fTemp[1]*fTemp[2];
+		fCov[5]+= fTemp[2]*fTemp[2];
+	}
+
+	//a few power iterations are enough to find the dominant eigenvector
+	fAxis[0]= fAxis[1]= fAxis[2]= 1.0f;
+	for( iIteration=0; iIteration<4; iIteration++ )
+	{
+		fTemp[0]= fCov[0]*fAxis[0] + fCov[1]*fAxis[1] + fCov[2]*fAxis[2];
+		fTemp[1]= fCov[1]*fAxis[0] + fCov[3]*fAxis[1] + fCov[4]*fAxis[2];
+		fTemp[2]= fCov[2]*fAxis[0] + fCov[4]*fAxis[1] + fCov[5]*fAxis[2];
+
+		fLength= MAX( MAX( fabsf( fTemp[0] ), fabsf( fTemp[1] ) ), fabsf( fTemp[2] ) );
+		if( fLength<SMALL )
+			break;
+
+		fAxis[0]= fTemp[0]/fLength;
+		fAxis[1]= fTemp[1]/fLength;
+		fAxis[2]= fTemp[2]/fLength;
+	}
+
+	fLength= fAxis[0]*fAxis[0] + fAxis[1]*fAxis[1] + fAxis[2]*fAxis[2];
+	if( fLength<SMALL )
+		fLength= 1.0f;
+
+	//project the colors onto the axis to find the extremes
+	fMinT=  BIG;
+	fMaxT= -BIG;
+	for( i=0; i<16; i++ )
+	{
+		fT= ( ( fRed[i]-fMean[0] )*fAxis[0] + ( fGreen[i]-fMean[1] )*fAxis[1] + ( fBlue[i]-fMean[2] )*fAxis[2] )/fLength;
+		fMinT= MIN( fMinT, fT );
+		fMaxT= MAX( fMaxT, fT );
+	}
+
+	for( j=0; j<3; j++ )
+	{
+		fMax[j]= fMean[j]+fAxis[j]*fMaxT;
+		fMin[j]= fMean[j]+fAxis[j]*fMinT;
+		CLAMP( fMax[j], 0.0f, 255.0f );
+		CLAMP( fMin[j], 0.0f, 255.0f );
+	}
+
+	fError= EncodeColorEndpoints( fRed, fGreen, fBlue, fMax, fMin, ucpDest );
+	if( quality!=COMPRESS_BEST )
+		return;
+
+	//best: refine the endpoints with a least squares fit to the chosen indices
+	for( iIteration=0; iIteration<2 && fError>0.0f; iIteration++ )
+	{
+		uiIndices= ucpDest[4] | ( ucpDest[5]<<8 ) | ( ucpDest[6]<<16 ) | ( ucpDest[7]<<24 );
+
+		fAlpha2= fBeta2= fAlphaBeta= 0.0f;
+		for( j=0; j<3; j++ )
+			fAlphaX[j]= fBetaX[j]= 0.0f;
+
+		for( i=0; i<16; i++ )
+		{
+			//palette index -> weight of the second endpoint
+			switch( ( uiIndices>>( i*2 ) ) & 3 )
+			{
+				case 0:  fWeight= 0.0f;		 break;
+				case 1:  fWeight= 1.0f;		 break;
+				case 2:  fWeight= 1.0f/3.0f; break;
+				default: fWeight= 2.0f/3.0f; break;
+			}
+
+			fAlpha2	  += ( 1.0f-fWeight )*( 1.0f-fWeight );
+			fBeta2	  += fWeight*fWeight;
+			fAlphaBeta+= ( 1.0f-fWeight )*fWeight;
+
+			fAlphaX[0]+= ( 1.0f-fWeight )*fRed[i];
+			fAlphaX[1]+= ( 1.0f-fWeight )*fGreen[i];
+			fAlphaX[2]+= ( 1.0f-fWeight )*fBlue[i];
+			fBetaX[0] += fWeight*fRed[i];
+			fBetaX[1] += fWeight*fGreen[i];
+			fBetaX[2] += fWeight*fBlue[i];
+		}
+
+		fDet= fAlpha2*fBeta2 - fAlphaBeta*fAlphaBeta;
+		if( fabsf( fDet )<SMALL )
+			break;
+
+		//solve the 2x2 normal equations for both endpoints
+		for( j=0; j<3; j++ )
+		{
+			fMax[j]= ( fAlphaX[j]*fBeta2 - fBetaX[j]*fAlphaBeta )/fDet;
+			fMin[j]= ( fBetaX[j]*fAlpha2 - fAlphaX[j]*fAlphaBeta )/fDet;
+			CLAMP( fMax[j], 0.0f, 255.0f );
+			CLAMP( fMin[j], 0.0f, 255.0f );
+		}
+
+		//only keep the refined block if it actually looks better
+		fTryError= EncodeColorEndpoints( fRed, fGreen, fBlue, fMax, fMin, ucTryBlock );
+		if( fTryError>=fError )
+			break;
+
+		memcpy( ucpDest, ucTryBlock, 8 );
+		fError= fTryError;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CompressAlphaBlock - global (this file only)
+// Description:		Compress the alpha channel of a 4x4 block of pixels
+//					into a BC3 alpha block (eight interpolated values)
+// Arguments:		-ucpPixels: the block's pixels (16 RGBA quadruplets)
+//					-ucpDest: storage for the 8 byte alpha block
+// Return Value:	None
+//--------------------------------------------------------------
+static void CompressAlphaBlock( unsigned char* ucpPixels, unsigned char* ucpDest )
+{
+	unsigned char ucMin= 255, ucMax= 0;
+	unsigned int uiLow= 0, uiHigh= 0;
+	unsigned int uiIndex;
+	int iStep;
+	int i;
+
+	for( i=0; i<16; i++ )
+	{
+		ucMin= MIN( ucMin, ucpPixels[i*4+3] );
+		ucMax= MAX( ucMax, ucpPixels[i*4+3] );
+	}
+
+	ucpDest[0]= ucMax;
+	ucpDest[1]= ucMin;
+
+	for( i=0; i<16; i++ )
+	{
+		if( ucMax==ucMin )
+			uiIndex= 0;
+		else
+		{
+			//step 0 is the minimum, step 7 is the maximum
+			iStep= ( ( ucpPixels[i*4+3]-ucMin )*14+( ucMax-ucMin ) )/( 2*( ucMax-ucMin ) );
+
+			if( iStep==7 )
+				uiIndex= 0;
+			else if( iStep==0 )
+				uiIndex= 1;
+			else
+				uiIndex= 8-iStep;
+		}
+
+		//48 bits of indices, split across two words
+		if( i<8 )
+			uiLow|= uiIndex<<( i*3 );
+		else
+			uiHigh|= uiIndex<<( ( i-8 )*3 );
+	}
+
+	ucpDest[2]= ( unsigned char )( uiLow & 0xFF );
+	ucpDest[3]= ( unsigned char )( ( uiLow>>8 ) & 0xFF );
+	ucpDest[4]= ( unsigned char )( ( uiLow>>16 ) & 0xFF );
+	ucpDest[5]= ( unsigned char )( uiHigh & 0xFF );
+	ucpDest[6]= ( unsigned char )( ( uiHigh>>8 ) & 0xFF );
+	ucpDest[7]= ( unsigned char )( ( uiHigh>>16 ) & 0xFF );
+}
+
+//--------------------------------------------------------------
+// Name:			CompressBlockRow - global (this file only)
+// Description:		Compress one row of 4x4 blocks (a thread pool job)
+// Arguments:		-iRow: the row of blocks to compress
+//					-pData: the SCOMPRESS_JOB structure for the level
+// Return Value:	None
+//--------------------------------------------------------------
+static void CompressBlockRow( int iRow, void* pData )
+{
+	SCOMPRESS_JOB* pJob= ( SCOMPRESS_JOB* )pData;
+	unsigned char ucBlock[64];
+	unsigned char* ucpSrc;
+	unsigned char* ucpDest;
+	unsigned int uiBlockSize= ( pJob->m_compression==IMAGE_BC1 ) ? 8 : 16;
+	unsigned int uiBlock;
+	unsigned int x, y;
+	unsigned int uiPixelX, uiPixelY;
+
+	ucpDest= pJob->m_ucpDest+iRow*pJob->m_uiBlocksX*uiBlockSize;
+
+	for( uiBlock=0; uiBlock<pJob->m_uiBlocksX; uiBlock++ )
+	{
+		//gather the block's pixels, repeating the edge for partial blocks
+		for( y=0; y<4; y++ )
+		{
+			uiPixelY= MIN( iRow*4+y, pJob->m_uiHeight-1 );
+
+			for( x=0; x<4; x++ )
+			{
+				uiPixelX= MIN( uiBlock*4+x, pJob->m_uiWidth-1 );
+				ucpSrc	= pJob->m_ucpSrc+( ( uiPixelY*pJob->m_uiWidth )+uiPixelX )*pJob->m_uiBytesPP;
+
+				ucBlock[( y*4+x )*4]  = ucpSrc[0];
+				ucBlock[( y*4+x )*4+1]= ucpSrc[1];
+				ucBlock[( y*4+x )*4+2]= ucpSrc[2];
+				ucBlock[( y*4+x )*4+3]= ( pJob->m_uiBytesPP==4 ) ? ucpSrc[3] : 255;
+			}
+		}
+
+		//BC3 blocks store the alpha block first
+		if( pJob->m_compression==IMAGE_BC3 )
+		{
+			CompressAlphaBlock( ucBlock, ucpDest );
+			CompressColorBlock( ucBlock, pJob->m_quality, ucpDest+8 );
+		}
+		else
+			CompressColorBlock( ucBlock, pJob->m_quality, ucpDest );
+
+		ucpDest+= uiBlockSize;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::Compress - public
+// Description:		Block compress the image's pixels (the work is
+//					spread across the thread pool, one row of blocks
+//					per job)
+// Arguments:		-compression: IMAGE_BC1 (RGB) or IMAGE_BC3 (RGBA)
+//					-quality: speed/quality trade-off for the encoder
+//					-bMipmaps: also build and compress a full mipmap chain
+// Return Value:	A boolean variable: -true: image was compressed
+//									    -false: image was not compressed
+//--------------------------------------------------------------
+bool CIMAGE::Compress( EIMAGE_COMPRESSION compression, EIMAGE_QUALITY quality, bool bMipmaps )
+{
+	SCOMPRESS_JOB job;
+	unsigned char* ucpLevel;
+	unsigned char* ucpNextLevel;
+	unsigned int uiBytesPP= m_uiBPP/8;
+	unsigned int uiWidth, uiHeight;
+	unsigned int uiNextWidth, uiNextHeight;
+	unsigned int uiLevels;
+	unsigned int uiSize;
+	unsigned int uiSum;
+	unsigned int x, y, c;
+	unsigned int x1, y1;
+
+	if( m_ucpData==NULL || compression==IMAGE_UNCOMPRESSED )
+		return false;
+
+	//count the number of levels, and the total size of the blocks
+	uiLevels= 1;
+	uiSize	= GetCompressedSize( m_uiWidth, m_uiHeight, compression );
+	uiWidth = m_uiWidth;
+	uiHeight= m_uiHeight;
+	while( bMipmaps && ( uiWidth>1 || uiHeight>1 ) )
+	{
+		uiWidth	 = ( uiWidth>1 )  ? uiWidth/2  : 1;
+		uiHeight = ( uiHeight>1 ) ? uiHeight/2 : 1;
+		uiSize	+= GetCompressedSize( uiWidth, uiHeight, compression );
+		uiLevels++;
+	}
+
+	if( m_ucpBlocks )
+		delete[] m_ucpBlocks;
+
+	m_ucpBlocks= new unsigned char [uiSize];
+	if( m_ucpBlocks==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Out of memory for block compression" );
+		return false;
+	}
+
+	m_uiBlocksSize= uiSize;
+	m_uiNumLevels = uiLevels;
+	m_compression = compression;
+
+	job.m_ucpDest	 = m_ucpBlocks;
+	job.m_uiBytesPP	 = uiBytesPP;
+	job.m_compression= compression;
+	job.m_quality	 = quality;
+
+	ucpLevel= m_ucpData;
+	uiWidth = m_uiWidth;
+	uiHeight= m_uiHeight;
+	while( true )
+	{
+		//compress this level, a row of blocks at a time
+		job.m_ucpSrc   = ucpLevel;
+		job.m_uiWidth  = uiWidth;
+		job.m_uiHeight = uiHeight;
+		job.m_uiBlocksX= ( uiWidth+3 )/4;
+		g_threadPool.Run( CompressBlockRow, &job, ( uiHeight+3 )/4 );
+
+		job.m_ucpDest+= GetCompressedSize( uiWidth, uiHeight, compression );
+
+		if( --uiLevels==0 )
+			break;
+
+		//box filter the level down to make the next one
+		uiNextWidth = ( uiWidth>1 )  ? uiWidth/2  : 1;
+		uiNextHeight= ( uiHeight>1 ) ? uiHeight/2 : 1;
+		ucpNextLevel= new unsigned char [uiNextWidth*uiNextHeight*uiBytesPP];
+
+		for( y=0; y<uiNextHeight; y++ )
+		{
+			y1= MIN( y*2+1, uiHeight-1 );
+
+			for( x=0; x<uiNextWidth; x++ )
+			{
+				x1= MIN( x*2+1, uiWidth-1 );
+
+				for( c=0; c<uiBytesPP; c++ )
+				{
+					uiSum= ucpLevel[( ( y*2*uiWidth )+x*2 )*uiBytesPP+c]+
+						   ucpLevel[( ( y*2*uiWidth )+x1 )*uiBytesPP+c]+
+						   ucpLevel[( ( y1*uiWidth )+x*2 )*uiBytesPP+c]+
+						   ucpLevel[( ( y1*uiWidth )+x1 )*uiBytesPP+c];
+
+					ucpNextLevel[( ( y*uiNextWidth )+x )*uiBytesPP+c]= ( unsigned char )( ( uiSum+2 )/4 );
+				}
+			}
+		}
+
+		if( ucpLevel!=m_ucpData )
+			delete[] ucpLevel;
+
+		ucpLevel= ucpNextLevel;
+		uiWidth = uiNextWidth;
+		uiHeight= uiNextHeight;
+	}
+
+	if( ucpLevel!=m_ucpData )
+		delete[] ucpLevel;
+
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CIMAGE::Decompress - public
+// Description:		Decode the largest level of the compressed blocks
+//					back into pixels (used when the video card can't
+//					handle S3TC, and to measure the encoder's quality)
+// Arguments:		-ucpDest: storage for the pixels (m_uiBPP bits each),
+//							  or NULL to decode into the image's own buffer
+// Return Value:	A boolean variable: -true: image was decompressed
+//									    -false: image was not decompressed
+//--------------------------------------------------------------
+bool CIMAGE::Decompress( unsigned char* ucpDest )
+{
+	unsigned char ucPalette[4][4];
+	unsigned char ucAlpha[8];
+	unsigned char* ucpBlock;
+	unsigned char* ucpPixel;
+	unsigned short usColor0, usColor1;
+	unsigned int uiBytesPP= m_uiBPP/8;
+	unsigned int uiBlocksX, uiBlocksY;
+	unsigned int uiIndices;
+	unsigned int uiAlphaLow, uiAlphaHigh;
+	unsigned int bx, by;
+	unsigned int x, y;
+	int i;
+
+	if( m_ucpBlocks==NULL )
+		return false;
+
+	//decode into our own buffer
+	if( ucpDest==NULL )
+	{
+		if( m_ucpData==NULL )
+			m_ucpData= new unsigned char [m_uiWidth*m_uiHeight*uiBytesPP];
+
+		ucpDest= m_ucpData;
+	}
+
+	uiBlocksX= ( m_uiWidth+3 )/4;
+	uiBlocksY= ( m_uiHeight+3 )/4;
+	ucpBlock = m_ucpBlocks;
+
+	for( by=0; by<uiBlocksY; by++ )
+	{
+		for( bx=0; bx<uiBlocksX; bx++ )
+		{
+			//decode the alpha block's eight values
+			if( m_compression==IMAGE_BC3 )
+			{
+				ucAlpha[0]= ucpBlock[0];
+				ucAlpha[1]= ucpBlock[1];
+
+				if( ucAlpha[0]>ucAlpha[1] )
+				{
+					for( i=1; i<7; i++ )
+						ucAlpha[i+1]= ( unsigned char )( ( ( 7-i )*ucAlpha[0]+i*ucAlpha[1] )/7 );
+				}
+				else
+				{
+					for( i=1; i<5; i++ )
+						ucAlpha[i+1]= ( unsigned char )( ( ( 5-i )*ucAlpha[0]+i*ucAlpha[1] )/5 );
+
+					ucAlpha[6]= 0;
+					ucAlpha[7]= 255;
+				}
+
+				uiAlphaLow = ucpBlock[2] | ( ucpBlock[3]<<8 ) | ( ucpBlock[4]<<16 );
+				uiAlphaHigh= ucpBlock[5] | ( ucpBlock[6]<<8 ) | ( ucpBlock[7]<<16 );
+				ucpBlock+= 8;
+			}
+
+			//decode the color block's palette
+			usColor0= ( unsigned short )( ucpBlock[0] | ( ucpBlock[1]<<8 ) );
+			usColor1= ( unsigned short )( ucpBlock[2] | ( ucpBlock[3]<<8 ) );
+			uiIndices= ucpBlock[4] | ( ucpBlock[5]<<8 ) | ( ucpBlock[6]<<16 ) | ( ucpBlock[7]<<24 );
+			ucpBlock+= 8;
+
+			UnpackColor565( usColor0, ucPalette[0] );
+			UnpackColor565( usColor1, ucPalette[1] );
+			ucPalette[0][3]= ucPalette[1][3]= ucPalette[2][3]= 255;
+
+			for( i=0; i<3; i++ )
+			{
+				if( usColor0>usColor1 || m_compression==IMAGE_BC3 )
+				{
+					ucPalette[2][i]= ( unsigned char )( ( 2*ucPalette[0][i]+ucPalette[1][i] )/3 );
+					ucPalette[3][i]= ( unsigned char )( ( ucPalette[0][i]+2*ucPalette[1][i] )/3 );
+					ucPalette[3][3]= 255;
+				}
+				else
+				{
+					ucPalette[2][i]= ( unsigned char )( ( ucPalette[0][i]+ucPalette[1][i] )/2 );
+					ucPalette[3][i]= 0;
+					ucPalette[3][3]= 0;
+				}
+			}
+
+			//write the pixels that fall inside of the image
+			for( y=0; y<4; y++ )
+			{
+				if( by*4+y>=m_uiHeight )
+					break;
+
+				for( x=0; x<4; x++ )
+				{
+					if( bx*4+x>=m_uiWidth )
+						break;
+
+					i		= ( y*4 )+x;
+					ucpPixel= ucpDest+( ( ( by*4+y )*m_uiWidth )+bx*4+x )*uiBytesPP;
+
+					ucpPixel[0]= ucPalette[( uiIndices>>( i*2 ) ) & 3][0];
+					ucpPixel[1]= ucPalette[( uiIndices>>( i*2 ) ) & 3][1];
+					ucpPixel[2]= ucPalette[( uiIndices>>( i*2 ) ) & 3][2];
+
+					if( uiBytesPP==4 )
+					{
+						if( m_compression==IMAGE_BC3 )
+						{
+							if( i<8 )
+								ucpPixel[3]= ucAlpha[( uiAlphaLow>>( i*3 ) ) & 7];
+							else
+								ucpPixel[3]= ucAlpha[( uiAlphaHigh>>( ( i-8 )*3 ) ) & 7];
+						}
+						else
+							ucpPixel[3]= ucPalette[( uiIndices>>( i*2 ) ) & 3][3];
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
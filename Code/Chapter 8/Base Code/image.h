@@ -29,12 +29,32 @@
 //--------------------------------------------------------------
 #define BITMAP_ID 0x4D42
 
+#define DDS_MAGIC	  0x20534444	//"DDS "
+#define DDS_FOURCC	  0x00000004
+#define DDS_MIPMAPCOUNT 0x00020000
+#define FOURCC_DXT1	  0x31545844	//"DXT1"
+#define FOURCC_DXT5	  0x35545844	//"DXT5"
+
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- STRUCTURES -------------------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
+enum EIMAGE_COMPRESSION
+{
+	IMAGE_UNCOMPRESSED= 0,
+	IMAGE_BC1,				//DXT1: 4 bits per pixel, RGB (the alpha channel is dropped)
+	IMAGE_BC3				//DXT5: 8 bits per pixel, RGBA
+};
+
+enum EIMAGE_QUALITY
+{
+	COMPRESS_FAST= 0,		//bounding box endpoints
+	COMPRESS_NORMAL,		//principal axis endpoints
+	COMPRESS_BEST			//principal axis plus least squares endpoint refinement
+};
+
 struct TGAInformationHeader
 {
 	unsigned char m_ucHeader[6];
@@ -75,6 +95,34 @@ struct BMPInfoHeader
     unsigned int uiClrImportant; 
 };
 
+struct DDSPixelFormat
+{
+	unsigned int uiSize;
+	unsigned int uiFlags;
+	unsigned int uiFourCC;
+	unsigned int uiRGBBitCount;
+	unsigned int uiRBitMask;
+	unsigned int uiGBitMask;
+	unsigned int uiBBitMask;
+	unsigned int uiABitMask;
+};
+
+struct DDSHeader
+{
+	unsigned int   uiMagic;
+	unsigned int   uiSize;
+	unsigned int   uiFlags;
+	unsigned int   uiHeight;
+	unsigned int   uiWidth;
+	unsigned int   uiPitchOrLinearSize;
+	unsigned int   uiDepth;
+	unsigned int   uiMipMapCount;
+	unsigned int   uiReserved1[11];
+	DDSPixelFormat pixelFormat;
+	unsigned int   uiCaps[4];
+	unsigned int   uiReserved2;
+};
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- GLOBALS ----------------------------------------------------
@@ -98,6 +146,12 @@ class CIMAGE
 		unsigned int   m_uiBPP;
 		unsigned int   m_ID;
 
+		//block compressed data (every mipmap level, largest first)
+		unsigned char*	   m_ucpBlocks;
+		unsigned int	   m_uiBlocksSize;
+		unsigned int	   m_uiNumLevels;
+		EIMAGE_COMPRESSION m_compression;
+
 		bool m_bIsLoaded;
 
 	bool LoadBMP( void );
@@ -106,17 +160,29 @@ class CIMAGE
 	bool LoadCompressedTGA( void );
 	bool LoadUncompressedTGA( void );
 
+	bool LoadDDS( unsigned char* ucpFile, unsigned int uiFileSize );
+
 	public:
 
 
 	bool Create( unsigned int uiWidth, unsigned int uiHeight, unsigned int uiBPP );
+	bool CreateCompressed( unsigned int uiWidth, unsigned int uiHeight, EIMAGE_COMPRESSION compression, unsigned int uiNumLevels );
 
 	bool LoadData( char* a_szFilename );
 
 	bool Load( char* a_szFilename, float a_fMinFilter, float a_fMaxFilter, bool a_bMipmap= false );
+	bool Upload( float fMinFilter, float fMaxFilter, bool bMipmap= false );
 	void Unload( void );
 	bool Save( char* szFilename );
 
+	//block compression (BC1/BC3)
+	bool Compress( EIMAGE_COMPRESSION compression, EIMAGE_QUALITY quality= COMPRESS_NORMAL, bool bMipmaps= false );
+	bool Decompress( unsigned char* ucpDest= NULL );
+	bool SaveCompressed( char* szFilename );
+	void ReleaseData( void );
+
+	static unsigned int GetCompressedSize( unsigned int uiWidth, unsigned int uiHeight, EIMAGE_COMPRESSION compression );
+
 	//--------------------------------------------------------------
 	// Name:			CIMAGE::GetColor - public
 	// Description:		Get the color (RGB triplet) from a texture pixel
@@ -219,6 +285,48 @@ class CIMAGE
 	//--------------------------------------------------------------
 	inline bool IsLoaded( void )
 	{	return m_bIsLoaded;	}
+
+	//--------------------------------------------------------------
+	// Name:			CIMAGE::IsCompressed - public
+	// Description:		Find out if the image has block compressed data
+	// Arguments:		None
+	// Return Value:	A boolean value: -true: block compressed data is present
+	//									 -false: the image is uncompressed
+	//--------------------------------------------------------------
+	inline bool IsCompressed( void )
+	{	return ( m_ucpBlocks!=NULL );	}
+
+	//--------------------------------------------------------------
+	// Name:			CIMAGE::GetCompression - public
+	// Description:		Get the block compression format of the image
+	// Arguments:		None
+	// Return Value:	An EIMAGE_COMPRESSION value: the compression format
+	//--------------------------------------------------------------
+	inline EIMAGE_COMPRESSION GetCompression( void )
+	{	return m_compression;	}
+
+	//--------------------------------------------------------------
+	// Name:			CIMAGE::GetCompressedData - public
+	// Description:		Get a pointer to the image's block compressed data
+	// Arguments:		None
+	// Return Value:	An unsigned char buffer (the compressed blocks)
+	//--------------------------------------------------------------
+	inline unsigned char* GetCompressedData( void )
+	{	return m_ucpBlocks;	}
+
+	//--------------------------------------------------------------
+	// Name:			CIMAGE::GetCompressedDataSize - public
+	// Description:		Get the size of the block compressed data (all levels)
+	// Arguments:		None
+	// Return Value:	An unsigned int value: the size, in bytes
+	//--------------------------------------------------------------
+	inline unsigned int GetCompressedDataSize( void )
+	{	return m_uiBlocksSize;	}
+
+	CIMAGE( void ) : m_ucpData( NULL ), m_uiWidth( 0 ), m_uiHeight( 0 ), m_uiBPP( 0 ), m_ID( 0 ),
+					 m_ucpBlocks( NULL ), m_uiBlocksSize( 0 ), m_uiNumLevels( 0 ),
+					 m_compression( IMAGE_UNCOMPRESSED ), m_bIsLoaded( false )
+	{	}
 };
 
 
@@ -0,0 +1,532 @@
+//==============================================================
+//==============================================================
+//= render_backend.h ===========================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= A thin layer between the engines and the rendering API.	   =
+//= The OpenGL backend draws for real; the recording backend   =
+//= only counts (and optionally keeps) what it is given, so	   =
+//= the engines can be run and timed without a video card.	   =
+//==============================================================
+//==============================================================
+#ifndef __RENDER_BACKEND_H__
+#define __RENDER_BACKEND_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//vertex format flags (the position is always there)
+#define BACKEND_COLOR	  1
+#define BACKEND_NORMAL	  2
+#define BACKEND_TEXCOORD0 4
+#define BACKEND_TEXCOORD1 8
+#define BACKEND_FOGCOORD  16
+
+#define BACKEND_MAX_TEXTURE_UNITS 2
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+enum EBACKEND_PRIMITIVES
+{
+	BACKEND_TRIANGLES= 0,
+	BACKEND_TRIANGLE_STRIP,
+	BACKEND_TRIANGLE_FAN
+};
+
+enum EBACKEND_STATES
+{
+	BACKEND_CULL_FACE= 0,
+	BACKEND_BLEND,
+	BACKEND_DEPTH_TEST,
+	BACKEND_DEPTH_WRITE,
+	BACKEND_TEXTURE0,			//texturing on the first texture unit
+	BACKEND_TEXTURE1,			//texturing on the second texture unit
+	BACKEND_FOG,
+	BACKEND_NUM_STATES
+};
+
+enum EBACKEND_BLEND_MODES
+{
+	BACKEND_BLEND_MULTIPLY= 0,	//destination*source color
+	BACKEND_BLEND_ADDITIVE		//destination+source color*source alpha
+};
+
+enum EBACKEND_COMBINE_MODES
+{
+	BACKEND_COMBINE_MODULATE= 0,
+	BACKEND_COMBINE_DETAIL		//modulate, and then double it (for detail maps)
+};
+
+struct SBACKEND_VERTEX
+{
+	float m_fPosition[3];
+	float m_fNormal[3];
+	float m_fTexCoord0[2];
+	float m_fTexCoord1[2];
+	float m_fFogCoord;
+	unsigned char m_ucColor[4];
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASSES ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CRENDER_BACKEND
+{
+	protected:
+		//the primitive that is being built between Begin and End
+		SBACKEND_VERTEX* m_pVertices;
+		int m_iNumVertices;
+		int m_iMaxVertices;
+		EBACKEND_PRIMITIVES m_primitive;
+		int m_iFormat;
+
+	void GrowVertices( void );
+
+	public:
+
+	//state changes
+	virtual void SetState( EBACKEND_STATES state, bool bEnable )= 0;
+	virtual void BindTexture( int iUnit, unsigned int uiID )= 0;
+	virtual void SetBlendMode( EBACKEND_BLEND_MODES mode )= 0;
+	virtual void SetCombineMode( int iUnit, EBACKEND_COMBINE_MODES mode )= 0;
+	virtual void SetTextureScale( int iUnit, float fScale )= 0;
+
+	//the current modelview matrix (for billboarding)
+	virtual void GetModelview( float* fpMatrix )= 0;
+
+	//draw a vertex stream, with an optional index stream
+	virtual void Draw( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+					   const unsigned int* uipIndices= 0, int iNumIndices= 0 )= 0;
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_BACKEND::Begin - public
+	// Description:		Start building a primitive a vertex at a time (it is
+	//					drawn in one go when End is called)
+	// Arguments:		-primitive: the type of primitive
+	//					-iFormat: the vertex format flags (BACKEND_*)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void Begin( EBACKEND_PRIMITIVES primitive, int iFormat )
+	{
+		m_primitive	  = primitive;
+		m_iFormat	  = iFormat;
+		m_iNumVertices= 0;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_BACKEND::Vertex - public
+	// Description:		Add a vertex to the primitive being built
+	// Arguments:		-vertex: the vertex
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void Vertex( const SBACKEND_VERTEX& vertex )
+	{
+		if( m_iNumVertices==m_iMaxVertices )
+			GrowVertices( );
+
+		m_pVertices[m_iNumVertices++]= vertex;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_BACKEND::End - public
+	// Description:		Draw the primitive that was built since Begin
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void End( void )
+	{
+		if( m_iNumVertices>0 )
+			Draw( m_primitive, m_iFormat, m_pVertices, m_iNumVertices );
+
+		m_iNumVertices= 0;
+	}
+
+	CRENDER_BACKEND( void ) : m_pVertices( 0 ), m_iNumVertices( 0 ), m_iMaxVertices( 0 ),
+							  m_primitive( BACKEND_TRIANGLES ), m_iFormat( 0 )
+	{	}
+	virtual ~CRENDER_BACKEND( void )
+	{	delete[] m_pVertices;	}
+};
+
+//draws everything with OpenGL
+class CGL_BACKEND : public CRENDER_BACKEND
+{
+	private:
+
+	void DrawImmediate( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices,
+						const unsigned int* uipIndices, int iCount );
+
+	public:
+
+	void SetState( EBACKEND_STATES state, bool bEnable );
+	void BindTexture( int iUnit, unsigned int uiID );
+	void SetBlendMode( EBACKEND_BLEND_MODES mode );
+	void SetCombineMode( int iUnit, EBACKEND_COMBINE_MODES mode );
+	void SetTextureScale( int iUnit, float fScale );
+
+	void GetModelview( float* fpMatrix );
+
+	void Draw( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+			   const unsigned int* uipIndices= 0, int iNumIndices= 0 );
+
+	CGL_BACKEND( void )
+	{	}
+	~CGL_BACKEND( void )
+	{	}
+};
+
+//draws nothing, but counts everything (and can keep the triangles, so
+//that they can be written out and looked at)
+class CRECORDING_BACKEND : public CRENDER_BACKEND
+{
+	private:
+		//the current state (so that redundant changes can be counted)
+		bool m_bStates[BACKEND_NUM_STATES];
+		unsigned int m_uiTextures[BACKEND_MAX_TEXTURE_UNITS];
+		int m_iBlendMode;
+		int m_iCombineModes[BACKEND_MAX_TEXTURE_UNITS];
+		float m_fTextureScales[BACKEND_MAX_TEXTURE_UNITS];
+		float m_fModelview[16];
+
+		//statistics
+		int m_iNumDrawCalls;
+		int m_iNumVerticesDrawn;
+		int m_iNumIndicesDrawn;
+		int m_iNumTrianglesDrawn;
+		int m_iNumStateChanges;
+		int m_iNumRedundantChanges;	//changes to what was already set
+		int m_iNumTextureBinds;
+		int m_iFormatsDrawn;		//every vertex attribute that a draw sent (BACKEND_*)
+
+		//the recorded geometry (positions, and triangle lists into them)
+		bool   m_bRecording;
+		float* m_fpPositions;
+		int	   m_iNumPositions;
+		int	   m_iMaxPositions;
+		unsigned int* m_uipTriangles;
+		int	   m_iNumTriangleIndices;
+		int	   m_iMaxTriangleIndices;
+
+		//simulated vertex caches (a FIFO and an LRU cache)
+		bool m_bMeasureCache;
+		unsigned int* m_uipCacheList;	//each draw's triangle list
+		int m_iMaxCacheIndices;
+		int m_iNumCacheTriangles;
+		int m_iNumCacheUniques;			//the different vertices that each draw used
+		int m_iNumCacheMisses[2];
+
+	void CountStateChange( bool bRedundant );
+	void RecordGeometry( EBACKEND_PRIMITIVES primitive, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+						 const unsigned int* uipIndices, int iNumIndices );
+	void MeasureCache( EBACKEND_PRIMITIVES primitive, int iNumVertices, const unsigned int* uipIndices, int iNumIndices );
+
+	public:
+
+	void SetState( EBACKEND_STATES state, bool bEnable );
+	void BindTexture( int iUnit, unsigned int uiID );
+	void SetBlendMode( EBACKEND_BLEND_MODES mode );
+	void SetCombineMode( int iUnit, EBACKEND_COMBINE_MODES mode );
+	void SetTextureScale( int iUnit, float fScale );
+
+	void GetModelview( float* fpMatrix );
+	void SetModelview( const float* fpMatrix );
+
+	void Draw( EBACKEND_PRIMITIVES primitive, int iFormat, const SBACKEND_VERTEX* pVertices, int iNumVertices,
+			   const unsigned int* uipIndices= 0, int iNumIndices= 0 );
+
+	void ResetStats( void );
+	void LogStats( char* szName );
+
+	float GetACMR( int iCacheType );
+	float GetATVR( int iCacheType );
+
+	void StartRecording( void );
+	void StopRecording( void );
+	bool SaveOBJ( char* szFilename );
+
+	//--------------------------------------------------------------
+	// Name:			CRECORDING_BACKEND::GetNumDrawCalls - public
+	// Description:		Get the number of draw calls since the last reset
+	// Arguments:		None
+	// Return Value:	An integer value: the number of draw calls
+	//--------------------------------------------------------------
+	inline int GetNumDrawCalls( void )
+	{	return m_iNumDrawCalls;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRECORDING_BACKEND::GetNumVertices - public
+	// Description:		Get the number of vertices sent since the last reset
+	// Arguments:		None
+	// Return Value:	An integer value: the number of vertices
+	//--------------------------------------------------------------
+	inline int GetNumVertices( void )
+	{	return m_iNumVerticesDrawn;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRECORDING_BACKEND::GetNumTriangles - public
+	// Description:		Get the number of triangles drawn since the last reset
+	// Arguments:		None
+	// Return Value:	An integer value: the number of triangles
+	//--------------------------------------------------------------
+	inline int GetNumTriangles( void )
+	{	return m_iNumTrianglesDrawn;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRECORDING_BACKEND::GetNumStateChanges - public
+	// Description:		Get the number of state changes (including texture
+	//					binds) since the last reset
+	// Arguments:		None
+	// Return Value:	An integer value: the number of state changes
+	//--------------------------------------------------------------
+	inline int GetNumStateChanges( void )
+	{	return m_iNumStateChanges;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRECORDING_BACKEND::GetFormatsDrawn - public
+	// Description:		Get every vertex attribute that was sent since the
+	//					last reset
+	// Arguments:		None
+	// Return Value:	An integer value: the vertex format flags (BACKEND_*)
+	//--------------------------------------------------------------
+	inline int GetFormatsDrawn( void )
+	{	return m_iFormatsDrawn;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRECORDING_BACKEND::MeasureVertexCache - public
+	// Description:		Turn the vertex cache simulation (GetACMR/GetATVR)
+	//					on or off (it is slow, so it is off by default)
+	// Arguments:		-bMeasure: turn it on or off
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void MeasureVertexCache( bool bMeasure )
+	{	m_bMeasureCache= bMeasure;	}
+
+	CRECORDING_BACKEND( void );
+	~CRECORDING_BACKEND( void );
+};
+
+//a triangle list that an engine builds once a frame, and then draws once
+//for every rendering pass (instead of building it again for each pass)
+class CFRAME_MESH
+{
+	private:
+		SBACKEND_VERTEX* m_pVertices;
+		unsigned int*	 m_uipIndices;
+		int m_iNumVertices;
+		int m_iMaxVertices;
+		int m_iNumIndices;
+		int m_iMaxIndices;
+
+		int m_iFanStart;	//the first vertex of the fan being built
+
+	void GrowVertices( int iNumNeeded );
+	void GrowIndices( int iNumNeeded );
+
+	public:
+
+	void Draw( CRENDER_BACKEND* pBackend, int iFormat );
+	void Free( void );
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::Reset - public
+	// Description:		Empty the mesh, so that the next frame's mesh can be
+	//					built (the memory is kept)
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void Reset( void )
+	{
+		m_iNumVertices= 0;
+		m_iNumIndices = 0;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::AddVertex - public
+	// Description:		Add a vertex to the end of the mesh
+	// Arguments:		None
+	// Return Value:	A pointer to the new vertex (for the caller to fill in)
+	//--------------------------------------------------------------
+	inline SBACKEND_VERTEX* AddVertex( void )
+	{
+		if( m_iNumVertices==m_iMaxVertices )
+			GrowVertices( 1 );
+
+		return &m_pVertices[m_iNumVertices++];
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::AddVertices - public
+	// Description:		Add a block of vertices to the end of the mesh
+	// Arguments:		-iNumVertices: the number of vertices
+	// Return Value:	A pointer to the first new vertex (for the caller to
+	//					fill in)
+	//--------------------------------------------------------------
+	inline SBACKEND_VERTEX* AddVertices( int iNumVertices )
+	{
+		SBACKEND_VERTEX* pVertices;
+
+		if( m_iNumVertices+iNumVertices>m_iMaxVertices )
+			GrowVertices( iNumVertices );
+
+		pVertices	   = &m_pVertices[m_iNumVertices];
+		m_iNumVertices+= iNumVertices;
+
+		return pVertices;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::BeginFan - public
+	// Description:		Start a triangle fan (the vertices that are added until
+	//					EndFan is called are the fan's center and then its rim)
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void BeginFan( void )
+	{	m_iFanStart= m_iNumVertices;	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::EndFan - public
+	// Description:		Turn the fan's vertices into triangles
+	// Arguments:		None
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void EndFan( void )
+	{
+		unsigned int* uipIndex;
+		int i;
+
+		if( m_iNumVertices-m_iFanStart<3 )
+			return;
+
+		if( m_iNumIndices+( m_iNumVertices-m_iFanStart-2 )*3>m_iMaxIndices )
+			GrowIndices( ( m_iNumVertices-m_iFanStart-2 )*3 );
+
+		uipIndex= &m_uipIndices[m_iNumIndices];
+		for( i=m_iFanStart+1; i<m_iNumVertices-1; i++ )
+		{
+			*uipIndex++= m_iFanStart;
+			*uipIndex++= i;
+			*uipIndex++= i+1;
+		}
+
+		m_iNumIndices= ( int )( uipIndex-m_uipIndices );
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::AddIndices - public
+	// Description:		Add a triangle list whose (16-bit) indices start at 0,
+	//					for vertices that were added from uiBase on
+	// Arguments:		-uspIndices: the triangle list
+	//					-iNumIndices: the number of indices
+	//					-uiBase: the mesh vertex that index 0 refers to
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void AddIndices( const unsigned short* uspIndices, int iNumIndices, unsigned int uiBase )
+	{
+		unsigned int* uipIndex;
+		int i;
+
+		if( m_iNumIndices+iNumIndices>m_iMaxIndices )
+			GrowIndices( iNumIndices );
+
+		uipIndex= &m_uipIndices[m_iNumIndices];
+		for( i=0; i<iNumIndices; i++ )
+			uipIndex[i]= uiBase+uspIndices[i];
+
+		m_iNumIndices+= iNumIndices;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::AddFan - public
+	// Description:		Add a triangle fan out of vertices that are already in
+	//					the mesh (so that neighbouring fans can share them)
+	// Arguments:		-uipFan: the fan's center vertex, and then its rim
+	//					-iNumVertices: the number of vertices in the fan
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void AddFan( const unsigned int* uipFan, int iNumVertices )
+	{
+		unsigned int* uipIndex;
+		int i;
+
+		if( iNumVertices<3 )
+			return;
+
+		if( m_iNumIndices+( iNumVertices-2 )*3>m_iMaxIndices )
+			GrowIndices( ( iNumVertices-2 )*3 );
+
+		uipIndex= &m_uipIndices[m_iNumIndices];
+		for( i=1; i<iNumVertices-1; i++ )
+		{
+			*uipIndex++= uipFan[0];
+			*uipIndex++= uipFan[i];
+			*uipIndex++= uipFan[i+1];
+		}
+
+		m_iNumIndices= ( int )( uipIndex-m_uipIndices );
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::GetIndices - public
+	// Description:		Get the mesh's triangle list (so that it can be
+	//					reordered in place)
+	// Arguments:		None
+	// Return Value:	A pointer to the indices
+	//--------------------------------------------------------------
+	inline unsigned int* GetIndices( void )
+	{	return m_uipIndices;	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::GetNumIndices - public
+	// Description:		Get the number of indices in the mesh
+	// Arguments:		None
+	// Return Value:	An integer value: the number of indices
+	//--------------------------------------------------------------
+	inline int GetNumIndices( void )
+	{	return m_iNumIndices;	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::GetNumVertices - public
+	// Description:		Get the number of vertices in the mesh
+	// Arguments:		None
+	// Return Value:	An integer value: the number of vertices
+	//--------------------------------------------------------------
+	inline int GetNumVertices( void )
+	{	return m_iNumVertices;	}
+
+	//--------------------------------------------------------------
+	// Name:			CFRAME_MESH::GetNumTriangles - public
+	// Description:		Get the number of triangles in the mesh
+	// Arguments:		None
+	// Return Value:	An integer value: the number of triangles
+	//--------------------------------------------------------------
+	inline int GetNumTriangles( void )
+	{	return m_iNumIndices/3;	}
+
+	CFRAME_MESH( void ) : m_pVertices( 0 ), m_uipIndices( 0 ), m_iNumVertices( 0 ), m_iMaxVertices( 0 ),
+						  m_iNumIndices( 0 ), m_iMaxIndices( 0 ), m_iFanStart( 0 )
+	{	}
+	~CFRAME_MESH( void )
+	{	Free( );	}
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+extern CGL_BACKEND g_glBackend;
+
+
+#endif	//__RENDER_BACKEND_H__
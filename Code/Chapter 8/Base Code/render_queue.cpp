@@ -0,0 +1,355 @@
+//==============================================================
+//==============================================================
+//= render_queue.cpp ===========================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= Collects a frame's draws (packets) from every part of the  =
+//= scene, sorts them once by pass, state and texture, and	   =
+//= draws them in that order, only changing the state that	   =
+//= differs from one packet to the next.					   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+
+#include "render_queue.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//the on/off state for each texture unit's texturing (global (this file only))
+static const EBACKEND_STATES g_textureStates[BACKEND_MAX_TEXTURE_UNITS]= { BACKEND_TEXTURE0, BACKEND_TEXTURE1 };
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::AddPacket - public
+// Description:		Add a packet to the queue, with the default state
+// Arguments:		-pass: the pass that the packet is drawn in
+//					-subsystem: the part of the frame that the packet's
+//								draw is counted for (STATS_*)
+// Return Value:	A pointer to the new packet (for the caller to fill in
+//					its state, depth and draw function)
+//--------------------------------------------------------------
+SRENDER_PACKET* CRENDER_QUEUE::AddPacket( ERENDER_PASSES pass, ESTATS_SUBSYSTEMS subsystem )
+{
+	SRENDER_PACKET* pPacket;
+
+	if( m_iNumPackets==m_iMaxPackets )
+		GrowPackets( );
+
+	pPacket= &m_pPackets[m_iNumPackets];
+
+	pPacket->m_uiKey	 = 0;
+	pPacket->m_iSequence = m_iNumPackets;
+	pPacket->m_pass		 = pass;
+	pPacket->m_fDepth	 = 0.0f;
+	pPacket->m_subsystem = subsystem;
+	DefaultState( &pPacket->m_state );
+	pPacket->m_pfnDraw	 = 0;
+	pPacket->m_pData	 = 0;
+	pPacket->m_iParam	 = 0;
+
+	m_iNumPackets++;
+	return pPacket;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::Flush - public
+// Description:		Sort the packets, draw them, and empty the queue.  The
+//					backend is left in the default state afterwards, for
+//					whatever is drawn without the queue (and so that the
+//					depth buffer can be cleared)
+// Arguments:		-pBackend: what the state is set with
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::Flush( CRENDER_BACKEND* pBackend )
+{
+	SRENDER_STATE defaultState;
+	SRENDER_PACKET* pPacket;
+	int i;
+
+	m_iStatesApplied= 0;
+	m_iStatesSkipped= 0;
+
+	//the keys are only worked out now, since the caller can change a
+	//packet's state after adding it
+	for( i=0; i<m_iNumPackets; i++ )
+		m_pPackets[i].m_uiKey= MakeKey( m_pPackets[i] );
+
+	qsort( m_pPackets, m_iNumPackets, sizeof( SRENDER_PACKET ), ComparePackets );
+
+	for( i=0; i<m_iNumPackets; i++ )
+	{
+		pPacket= &m_pPackets[i];
+
+		STATS_SUBSYSTEM( pPacket->m_subsystem );
+		ApplyState( pBackend, pPacket->m_state );
+
+		if( pPacket->m_pfnDraw )
+			pPacket->m_pfnDraw( pPacket->m_pData, pPacket->m_iParam );
+	}
+
+	STATS_SUBSYSTEM( STATS_OTHER );
+	DefaultState( &defaultState );
+	ApplyState( pBackend, defaultState );
+
+	m_iNumPackets= 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::Invalidate - public
+// Description:		Forget what state the backend is in (because
+//					something else changed it), so that the next flush
+//					sets every piece of state
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::Invalidate( void )
+{
+	int i;
+
+	for( i=0; i<BACKEND_NUM_STATES; i++ )
+		m_iStates[i]= -1;
+	m_iBlendMode= -1;
+
+	for( i=0; i<BACKEND_MAX_TEXTURE_UNITS; i++ )
+	{
+		m_uiTextures[i]	   = 0;
+		m_iCombineModes[i] = -1;
+		m_fTextureScales[i]= -1.0f;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::Free - public
+// Description:		Free the queue's memory
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::Free( void )
+{
+	delete[] m_pPackets;
+
+	m_pPackets	 = 0;
+	m_iNumPackets= 0;
+	m_iMaxPackets= 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::DefaultState - public
+// Description:		Fill in the state that everything starts with: depth
+//					testing and depth writes on, and everything else off
+// Arguments:		-pState: the state to fill in
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::DefaultState( SRENDER_STATE* pState )
+{
+	int i;
+
+	pState->m_bCullFace	 = false;
+	pState->m_bDepthTest = true;
+	pState->m_bDepthWrite= true;
+	pState->m_bFog		 = false;
+	pState->m_bBlend	 = false;
+	pState->m_blendMode	 = BACKEND_BLEND_MULTIPLY;
+
+	for( i=0; i<BACKEND_MAX_TEXTURE_UNITS; i++ )
+	{
+		pState->m_uiTextures[i]	   = 0;
+		pState->m_combineModes[i]  = BACKEND_COMBINE_MODULATE;
+		pState->m_fTextureScales[i]= 1.0f;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::GrowPackets - private
+// Description:		Make room for more packets
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::GrowPackets( void )
+{
+	SRENDER_PACKET* pNewPackets;
+	int iNewMax;
+
+	iNewMax= m_iMaxPackets ? m_iMaxPackets*2 : 64;
+	pNewPackets= new SRENDER_PACKET [iNewMax];
+
+	if( m_pPackets )
+		memcpy( pNewPackets, m_pPackets, m_iNumPackets*sizeof( SRENDER_PACKET ) );
+
+	delete[] m_pPackets;
+	m_pPackets	 = pNewPackets;
+	m_iMaxPackets= iNewMax;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::MakeKey - private
+// Description:		Work out the key that a packet is sorted by: the pass
+//					in the top 4 bits, and then the state, the first
+//					texture and the depth.  Packets in the translucent and
+//					overlay passes have to be drawn back to front, so their
+//					(reversed) depth comes before their state instead
+// Arguments:		-packet: the packet
+// Return Value:	An unsigned integer value: the packet's key
+//--------------------------------------------------------------
+unsigned int CRENDER_QUEUE::MakeKey( const SRENDER_PACKET& packet )
+{
+	const SRENDER_STATE& state= packet.m_state;
+	unsigned int uiState;
+	unsigned int uiTexture;
+	unsigned int uiDepth;
+	float fDepth;
+
+	//the state (12 bits), with the most expensive changes in the highest
+	//bits, so that packets which share them end up next to each other
+	uiState= ( state.m_uiTextures[1]!=0 ? 0x800 : 0 ) |
+			 ( state.m_combineModes[1]!=BACKEND_COMBINE_MODULATE ? 0x400 : 0 ) |
+			 ( state.m_bBlend ? 0x200 : 0 ) |
+			 ( state.m_blendMode==BACKEND_BLEND_ADDITIVE ? 0x100 : 0 ) |
+			 ( state.m_uiTextures[0]!=0 ? 0x080 : 0 ) |
+			 ( state.m_fTextureScales[0]!=1.0f ? 0x040 : 0 ) |
+			 ( state.m_bFog ? 0x020 : 0 ) |
+			 ( state.m_bCullFace ? 0x010 : 0 ) |
+			 ( state.m_bDepthTest ? 0x008 : 0 ) |
+			 ( state.m_bDepthWrite ? 0x004 : 0 );
+
+	uiTexture= state.m_uiTextures[0] & 0xFF;
+
+	fDepth= packet.m_fDepth;
+	if( fDepth<0.0f )
+		fDepth= 0.0f;
+	else if( fDepth>1.0f )
+		fDepth= 1.0f;
+	uiDepth= ( unsigned int )( fDepth*255.0f );
+
+	if( packet.m_pass>=RENDER_PASS_TRANSLUCENT )
+		return ( packet.m_pass<<28 ) | ( ( 255-uiDepth )<<20 ) | ( uiState<<8 ) | uiTexture;
+
+	return ( packet.m_pass<<28 ) | ( uiState<<16 ) | ( uiTexture<<8 ) | uiDepth;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::ApplyState - private
+// Description:		Give the backend the parts of a state that differ
+//					from the state it is already in
+// Arguments:		-pBackend: what the state is set with
+//					-state: the state to set
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::ApplyState( CRENDER_BACKEND* pBackend, const SRENDER_STATE& state )
+{
+	int i;
+
+	ApplyToggle( pBackend, BACKEND_CULL_FACE,	state.m_bCullFace );
+	ApplyToggle( pBackend, BACKEND_DEPTH_TEST,	state.m_bDepthTest );
+	ApplyToggle( pBackend, BACKEND_DEPTH_WRITE, state.m_bDepthWrite );
+	ApplyToggle( pBackend, BACKEND_FOG,			state.m_bFog );
+	ApplyToggle( pBackend, BACKEND_BLEND,		state.m_bBlend );
+
+	//the blend mode doesn't matter while blending is off
+	if( state.m_bBlend )
+	{
+		if( m_iBlendMode!=state.m_blendMode )
+		{
+			pBackend->SetBlendMode( state.m_blendMode );
+			m_iBlendMode= state.m_blendMode;
+			m_iStatesApplied++;
+		}
+		else
+			m_iStatesSkipped++;
+	}
+
+	for( i=0; i<BACKEND_MAX_TEXTURE_UNITS; i++ )
+	{
+		ApplyToggle( pBackend, g_textureStates[i], state.m_uiTextures[i]!=0 );
+
+		//a unit's texture, combine mode and scale don't matter while it is off
+		if( state.m_uiTextures[i]==0 )
+			continue;
+
+		if( m_uiTextures[i]!=state.m_uiTextures[i] )
+		{
+			pBackend->BindTexture( i, state.m_uiTextures[i] );
+			m_uiTextures[i]= state.m_uiTextures[i];
+			m_iStatesApplied++;
+		}
+		else
+			m_iStatesSkipped++;
+
+		if( m_iCombineModes[i]!=state.m_combineModes[i] )
+		{
+			pBackend->SetCombineMode( i, state.m_combineModes[i] );
+			m_iCombineModes[i]= state.m_combineModes[i];
+			m_iStatesApplied++;
+		}
+		else
+			m_iStatesSkipped++;
+
+		if( m_fTextureScales[i]!=state.m_fTextureScales[i] )
+		{
+			pBackend->SetTextureScale( i, state.m_fTextureScales[i] );
+			m_fTextureScales[i]= state.m_fTextureScales[i];
+			m_iStatesApplied++;
+		}
+		else
+			m_iStatesSkipped++;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::ApplyToggle - private
+// Description:		Turn a piece of state on or off, if it isn't already
+// Arguments:		-pBackend: what the state is set with
+//					-state: the state to change
+//					-bEnable: turn it on or off
+// Return Value:	None
+//--------------------------------------------------------------
+void CRENDER_QUEUE::ApplyToggle( CRENDER_BACKEND* pBackend, EBACKEND_STATES state, bool bEnable )
+{
+	if( m_iStates[state]==( bEnable ? 1 : 0 ) )
+	{
+		m_iStatesSkipped++;
+		return;
+	}
+
+	pBackend->SetState( state, bEnable );
+	m_iStates[state]= bEnable ? 1 : 0;
+	m_iStatesApplied++;
+}
+
+//--------------------------------------------------------------
+// Name:			CRENDER_QUEUE::ComparePackets - private
+// Description:		Compare two packets for qsort: by key, and then by the
+//					order that they were added in (qsort isn't stable)
+// Arguments:		-pPacket1, pPacket2: the packets
+// Return Value:	An integer value: less than, equal to, or greater than
+//					zero if the first packet goes before, with, or after
+//					the second
+//--------------------------------------------------------------
+int CRENDER_QUEUE::ComparePackets( const void* pPacket1, const void* pPacket2 )
+{
+	const SRENDER_PACKET* p1= ( const SRENDER_PACKET* )pPacket1;
+	const SRENDER_PACKET* p2= ( const SRENDER_PACKET* )pPacket2;
+
+	if( p1->m_uiKey!=p2->m_uiKey )
+		return ( p1->m_uiKey<p2->m_uiKey ) ? -1 : 1;
+
+	return p1->m_iSequence-p2->m_iSequence;
+}
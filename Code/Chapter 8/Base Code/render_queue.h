@@ -0,0 +1,154 @@
+//==============================================================
+//==============================================================
+//= render_queue.h =============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= Collects a frame's draws (packets) from every part of the  =
+//= scene, sorts them once by pass, state and texture, and	   =
+//= draws them in that order, only changing the state that	   =
+//= differs from one packet to the next.					   =
+//==============================================================
+//==============================================================
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include "render_backend.h"
+#include "render_stats.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//the passes are drawn in this order (the translucent and overlay
+//passes are drawn back to front, the others front to back)
+enum ERENDER_PASSES
+{
+	RENDER_PASS_BACKGROUND= 0,	//the sky, drawn without depth
+	RENDER_PASS_OPAQUE,
+	RENDER_PASS_DECAL,			//blended on top of opaque geometry (detail maps)
+	RENDER_PASS_TRANSLUCENT,
+	RENDER_PASS_OVERLAY			//drawn over everything (particles)
+};
+
+//the state a packet is drawn with
+struct SRENDER_STATE
+{
+	bool m_bCullFace;
+	bool m_bDepthTest;
+	bool m_bDepthWrite;
+	bool m_bFog;
+	bool m_bBlend;
+	EBACKEND_BLEND_MODES m_blendMode;
+
+	//a texture ID of 0 turns texturing off on that unit
+	unsigned int m_uiTextures[BACKEND_MAX_TEXTURE_UNITS];
+	EBACKEND_COMBINE_MODES m_combineModes[BACKEND_MAX_TEXTURE_UNITS];
+	float m_fTextureScales[BACKEND_MAX_TEXTURE_UNITS];
+};
+
+//draws a packet's geometry (the state has already been set)
+typedef void ( *PFN_DRAW_PACKET )( void* pData, int iParam );
+
+struct SRENDER_PACKET
+{
+	unsigned int m_uiKey;		//what the packets are sorted by (worked out when they are flushed)
+	int m_iSequence;			//the order the packets were added in (for packets with the same key)
+
+	ERENDER_PASSES m_pass;
+	float m_fDepth;				//0 (near) to 1 (far)
+	ESTATS_SUBSYSTEMS m_subsystem;
+	SRENDER_STATE m_state;
+
+	PFN_DRAW_PACKET m_pfnDraw;
+	void* m_pData;
+	int m_iParam;
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CRENDER_QUEUE
+{
+	private:
+		SRENDER_PACKET* m_pPackets;
+		int m_iNumPackets;
+		int m_iMaxPackets;
+
+		//the state that the backend was last left in, so that only the
+		//differences need to be set (-1, or a texture ID of 0, when it
+		//isn't known)
+		int m_iStates[BACKEND_NUM_STATES];
+		int m_iBlendMode;
+		unsigned int m_uiTextures[BACKEND_MAX_TEXTURE_UNITS];
+		int m_iCombineModes[BACKEND_MAX_TEXTURE_UNITS];
+		float m_fTextureScales[BACKEND_MAX_TEXTURE_UNITS];
+
+		//statistics for the last flush
+		int m_iStatesApplied;
+		int m_iStatesSkipped;
+
+	void GrowPackets( void );
+	unsigned int MakeKey( const SRENDER_PACKET& packet );
+	void ApplyState( CRENDER_BACKEND* pBackend, const SRENDER_STATE& state );
+	void ApplyToggle( CRENDER_BACKEND* pBackend, EBACKEND_STATES state, bool bEnable );
+
+	static int ComparePackets( const void* pPacket1, const void* pPacket2 );
+
+	public:
+
+	SRENDER_PACKET* AddPacket( ERENDER_PASSES pass, ESTATS_SUBSYSTEMS subsystem );
+	void Flush( CRENDER_BACKEND* pBackend );
+	void Invalidate( void );
+	void Free( void );
+
+	static void DefaultState( SRENDER_STATE* pState );
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_QUEUE::GetNumPackets - public
+	// Description:		Get the number of packets waiting to be flushed
+	// Arguments:		None
+	// Return Value:	An integer value: the number of packets
+	//--------------------------------------------------------------
+	inline int GetNumPackets( void )
+	{	return m_iNumPackets;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_QUEUE::GetStatesApplied - public
+	// Description:		Get the number of state changes that the last flush
+	//					gave to the backend
+	// Arguments:		None
+	// Return Value:	An integer value: the number of state changes
+	//--------------------------------------------------------------
+	inline int GetStatesApplied( void )
+	{	return m_iStatesApplied;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_QUEUE::GetStatesSkipped - public
+	// Description:		Get the number of state changes that the last flush
+	//					didn't need to make, because the state was already set
+	// Arguments:		None
+	// Return Value:	An integer value: the number of state changes
+	//--------------------------------------------------------------
+	inline int GetStatesSkipped( void )
+	{	return m_iStatesSkipped;	}
+
+	CRENDER_QUEUE( void ) : m_pPackets( 0 ), m_iNumPackets( 0 ), m_iMaxPackets( 0 ),
+							m_iStatesApplied( 0 ), m_iStatesSkipped( 0 )
+	{	Invalidate( );	}
+	~CRENDER_QUEUE( void )
+	{	Free( );	}
+};
+
+
+#endif	//__RENDER_QUEUE_H__
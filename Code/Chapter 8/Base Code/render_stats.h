@@ -0,0 +1,168 @@
+//==============================================================
+//==============================================================
+//= render_stats.h =============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= Counts what each part of a frame asks the driver to do	   =
+//= (batches, texture binds, state changes).  Define		   =
+//= RENDER_STATS in the project settings to turn the counting  =
+//= on; without it, the STATS_* macros compile to nothing.	   =
+//==============================================================
+//==============================================================
+#ifndef __RENDER_STATS_H__
+#define __RENDER_STATS_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//the parts of a frame that are counted separately
+enum ESTATS_SUBSYSTEMS
+{
+	STATS_OTHER= 0,				//anything that isn't one of the others (text, etc.)
+	STATS_SKY,
+	STATS_TERRAIN,
+	STATS_WATER,
+	STATS_PARTICLES,
+	STATS_NUM_SUBSYSTEMS
+};
+
+struct SRENDER_STATS
+{
+	int m_iBatches;				//draw calls (a glBegin/glEnd pair is one batch)
+	int m_iImmediateBatches;	//the batches that were sent a vertex at a time
+	int m_iTriangles;
+	int m_iVertices;
+	int m_iTextureBinds;
+	int m_iStateToggles;		//glEnable/glDisable/glDepthMask
+	int m_iStateChanges;		//other state (blend functions, texture environments, etc.)
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CRENDER_STATS
+{
+	private:
+		//the frame being counted, and the last one that finished
+		SRENDER_STATS m_current[STATS_NUM_SUBSYSTEMS];
+		SRENDER_STATS m_lastFrame[STATS_NUM_SUBSYSTEMS];
+		int m_iSubsystem;
+		int m_iNumFrames;
+
+	public:
+
+	void EndFrame( void );
+	void GetFrameTotals( SRENDER_STATS* pTotals );
+	void LogFrame( void );
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_STATS::SetSubsystem - public
+	// Description:		Set the part of the frame that everything counted
+	//					from now on belongs to
+	// Arguments:		-subsystem: the part of the frame (STATS_*)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetSubsystem( ESTATS_SUBSYSTEMS subsystem )
+	{	m_iSubsystem= subsystem;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_STATS::CountBatch - public
+	// Description:		Count a draw call
+	// Arguments:		-iTriangles: the number of triangles drawn
+	//					-iVertices: the number of vertices sent
+	//					-bImmediate: whether the vertices were sent one at
+	//								 a time
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void CountBatch( int iTriangles, int iVertices, bool bImmediate )
+	{
+		SRENDER_STATS* pStats= &m_current[m_iSubsystem];
+
+		pStats->m_iBatches++;
+		pStats->m_iTriangles+= iTriangles;
+		pStats->m_iVertices += iVertices;
+		if( bImmediate )
+			pStats->m_iImmediateBatches++;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_STATS::CountTextureBinds - public
+	// Description:		Count texture binds
+	// Arguments:		-iNum: the number of binds
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void CountTextureBinds( int iNum )
+	{	m_current[m_iSubsystem].m_iTextureBinds+= iNum;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_STATS::CountStateToggles - public
+	// Description:		Count states being turned on or off
+	// Arguments:		-iNum: the number of toggles
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void CountStateToggles( int iNum )
+	{	m_current[m_iSubsystem].m_iStateToggles+= iNum;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_STATS::CountStateChanges - public
+	// Description:		Count changes to state that isn't just on or off
+	// Arguments:		-iNum: the number of changes
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void CountStateChanges( int iNum )
+	{	m_current[m_iSubsystem].m_iStateChanges+= iNum;	}
+
+	//--------------------------------------------------------------
+	// Name:			CRENDER_STATS::GetFrameStats - public
+	// Description:		Get the counts for one part of the last frame
+	// Arguments:		-subsystem: the part of the frame (STATS_*)
+	// Return Value:	A SRENDER_STATS reference: the last frame's counts
+	//--------------------------------------------------------------
+	inline const SRENDER_STATS& GetFrameStats( ESTATS_SUBSYSTEMS subsystem )
+	{	return m_lastFrame[subsystem];	}
+
+	CRENDER_STATS( void );
+	~CRENDER_STATS( void )
+	{	}
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+extern CRENDER_STATS g_renderStats;
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- MACROS -----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#ifdef RENDER_STATS
+	#define STATS_SUBSYSTEM( subsystem )				g_renderStats.SetSubsystem( subsystem )
+	#define STATS_BATCH( iTriangles, iVertices )		g_renderStats.CountBatch( iTriangles, iVertices, false )
+	#define STATS_IMMEDIATE( iTriangles, iVertices )	g_renderStats.CountBatch( iTriangles, iVertices, true )
+	#define STATS_BINDS( iNum )							g_renderStats.CountTextureBinds( iNum )
+	#define STATS_TOGGLES( iNum )						g_renderStats.CountStateToggles( iNum )
+	#define STATS_CHANGES( iNum )						g_renderStats.CountStateChanges( iNum )
+	#define STATS_END_FRAME( )							g_renderStats.EndFrame( )
+#else
+	#define STATS_SUBSYSTEM( subsystem )
+	#define STATS_BATCH( iTriangles, iVertices )
+	#define STATS_IMMEDIATE( iTriangles, iVertices )
+	#define STATS_BINDS( iNum )
+	#define STATS_TOGGLES( iNum )
+	#define STATS_CHANGES( iNum )
+	#define STATS_END_FRAME( )
+#endif
+
+
+#endif	//__RENDER_STATS_H__
@@ -0,0 +1,37 @@
+//==============================================================
+//==============================================================
+//= simd.h =====================================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= Switches for the SSE2 code paths.  Define NO_SSE2 in the   =
+//= project settings to build the plain C versions instead.	   =
+//==============================================================
+//==============================================================
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#ifndef NO_SSE2
+	#define USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- MACROS -----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#ifdef _MSC_VER
+	#define SIMD_ALIGN( declaration ) __declspec( align( 16 ) ) declaration
+#else
+	#define SIMD_ALIGN( declaration ) declaration __attribute__( ( aligned( 16 ) ) )
+#endif
+
+
+#endif	//__SIMD_H__
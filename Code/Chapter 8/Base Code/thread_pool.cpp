@@ -0,0 +1,237 @@
+//==============================================================
+//==============================================================
+//= thread_pool.cpp ============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= A small pool of worker threads that splits a batch of	   =
+//= independent jobs (rows, tiles, blocks) across the CPUs.	   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <process.h>
+
+#include "thread_pool.h"
+#include "log.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+CTHREAD_POOL g_threadPool;
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CTHREAD_POOL::Init - public
+// Description:		Create the worker threads
+// Arguments:		-iNumThreads: total number of threads to use (the
+//								  calling thread counts as one), 0 means
+//								  one thread per processor
+// Return Value:	A boolean value: -true: successful initiation
+//									 -false: unsuccessful initiation
+//--------------------------------------------------------------
+bool CTHREAD_POOL::Init( int iNumThreads )
+{
+	unsigned int uiThreadID;
+	int i;
+
+	if( m_bInitialized )
+		Shutdown( );
+
+	if( iNumThreads<=0 )
+		iNumThreads= GetNumProcessors( );
+
+	//the calling thread always does its share of the work
+	m_iNumWorkers= iNumThreads-1;
+	if( m_iNumWorkers>MAX_WORKER_THREADS )
+		m_iNumWorkers= MAX_WORKER_THREADS;
+
+	m_bShutdown= false;
+	m_lBusy	   = 0;
+
+	for( i=0; i<m_iNumWorkers; i++ )
+	{
+		m_workers[i].m_pPool	 = this;
+		m_workers[i].m_hWakeEvent= CreateEvent( NULL, FALSE, FALSE, NULL );
+		m_workers[i].m_hDoneEvent= CreateEvent( NULL, FALSE, FALSE, NULL );
+		m_workers[i].m_hThread	 = ( HANDLE )_beginthreadex( NULL, 0, WorkerProc, &m_workers[i], 0, &uiThreadID );
+
+		if( m_workers[i].m_hThread==NULL )
+		{
+			g_log.Write( LOG_FAILURE, "Could not create worker thread %d", i );
+
+			CloseHandle( m_workers[i].m_hWakeEvent );
+			CloseHandle( m_workers[i].m_hDoneEvent );
+			m_iNumWorkers= i;
+			break;
+		}
+	}
+
+	m_bInitialized= true;
+	g_log.Write( LOG_SUCCESS, "Thread pool initialized with %d threads", m_iNumWorkers+1 );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CTHREAD_POOL::Shutdown - public
+// Description:		Stop and release all of the worker threads
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTHREAD_POOL::Shutdown( void )
+{
+	int i;
+
+	if( !m_bInitialized )
+		return;
+
+	//wake everybody up so that they see the shutdown flag
+	m_bShutdown= true;
+	for( i=0; i<m_iNumWorkers; i++ )
+		SetEvent( m_workers[i].m_hWakeEvent );
+
+	for( i=0; i<m_iNumWorkers; i++ )
+	{
+		WaitForSingleObject( m_workers[i].m_hThread, INFINITE );
+
+		CloseHandle( m_workers[i].m_hThread );
+		CloseHandle( m_workers[i].m_hWakeEvent );
+		CloseHandle( m_workers[i].m_hDoneEvent );
+	}
+
+	m_iNumWorkers = 0;
+	m_bInitialized= false;
+}
+
+//--------------------------------------------------------------
+// Name:			CTHREAD_POOL::Run - public
+// Description:		Run a batch of jobs and wait for all of them to
+//					finish.  If the pool is already busy (a job started
+//					another batch, or two threads use the pool at once)
+//					the batch is run on the calling thread instead.
+// Arguments:		-pfnJob: the function to call for each job
+//					-pData: user data handed to every job
+//					-iNumJobs: number of jobs in the batch
+//					-iMaxThreads: limit on the number of threads used
+//								  for this batch (0 means no limit)
+// Return Value:	None
+//--------------------------------------------------------------
+void CTHREAD_POOL::Run( PFN_JOB pfnJob, void* pData, int iNumJobs, int iMaxThreads )
+{
+	HANDLE hDoneEvents[MAX_WORKER_THREADS];
+	int iNumWorkers;
+	int i;
+
+	if( iNumJobs<=0 )
+		return;
+
+	//start the workers up the first time they are needed
+	if( !m_bInitialized )
+		Init( );
+
+	//only one batch can be in flight at a time
+	if( m_iNumWorkers==0 || iNumJobs==1 || iMaxThreads==1 || InterlockedExchange( &m_lBusy, 1 )!=0 )
+	{
+		for( i=0; i<iNumJobs; i++ )
+			pfnJob( i, pData );
+
+		return;
+	}
+
+	//figure out how many of the workers need to be woken up
+	iNumWorkers= m_iNumWorkers;
+	if( iMaxThreads>0 && iNumWorkers>iMaxThreads-1 )
+		iNumWorkers= iMaxThreads-1;
+	if( iNumWorkers>iNumJobs-1 )
+		iNumWorkers= iNumJobs-1;
+
+	//setup the batch
+	m_pfnJob  = pfnJob;
+	m_pJobData= pData;
+	m_iNumJobs= iNumJobs;
+	m_lNextJob= 0;
+	m_iNumActiveWorkers= iNumWorkers;
+
+	for( i=0; i<iNumWorkers; i++ )
+	{
+		hDoneEvents[i]= m_workers[i].m_hDoneEvent;
+		SetEvent( m_workers[i].m_hWakeEvent );
+	}
+
+	//do our share of the work, and then wait for the stragglers
+	DoJobs( );
+	WaitForMultipleObjects( iNumWorkers, hDoneEvents, TRUE, INFINITE );
+
+	InterlockedExchange( &m_lBusy, 0 );
+}
+
+//--------------------------------------------------------------
+// Name:			CTHREAD_POOL::GetNumProcessors - public
+// Description:		Get the number of processors in the machine
+// Arguments:		None
+// Return Value:	An integer value: the number of processors
+//--------------------------------------------------------------
+int CTHREAD_POOL::GetNumProcessors( void )
+{
+	SYSTEM_INFO sysInfo;
+
+	GetSystemInfo( &sysInfo );
+	if( sysInfo.dwNumberOfProcessors<1 )
+		return 1;
+
+	return ( int )sysInfo.dwNumberOfProcessors;
+}
+
+//--------------------------------------------------------------
+// Name:			CTHREAD_POOL::DoJobs - private
+// Description:		Grab jobs from the current batch until there are
+//					none left
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTHREAD_POOL::DoJobs( void )
+{
+	int iJob;
+
+	//InterlockedIncrement returns the new value, so subtract one to get ours
+	while( ( iJob= InterlockedIncrement( &m_lNextJob )-1 )<m_iNumJobs )
+		m_pfnJob( iJob, m_pJobData );
+}
+
+//--------------------------------------------------------------
+// Name:			CTHREAD_POOL::WorkerProc - private
+// Description:		The main loop for every worker thread
+// Arguments:		-pParam: the worker's SWORKER_THREAD structure
+// Return Value:	An unsigned integer value: the thread's exit code
+//--------------------------------------------------------------
+unsigned int __stdcall CTHREAD_POOL::WorkerProc( void* pParam )
+{
+	SWORKER_THREAD* pWorker= ( SWORKER_THREAD* )pParam;
+	CTHREAD_POOL*	pPool  = pWorker->m_pPool;
+
+	while( true )
+	{
+		//sleep until there is something to do
+		WaitForSingleObject( pWorker->m_hWakeEvent, INFINITE );
+		if( pPool->m_bShutdown )
+			break;
+
+		pPool->DoJobs( );
+		SetEvent( pWorker->m_hDoneEvent );
+	}
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+//==============================================================
+//==============================================================
+//= thread_pool.h ==============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= A small pool of worker threads that splits a batch of	   =
+//= independent jobs (rows, tiles, blocks) across the CPUs.	   =
+//==============================================================
+//==============================================================
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <windows.h>
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#define MAX_WORKER_THREADS 32
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- STRUCTURES -------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//a job function gets called once for every job index in [0, iNumJobs),
+//it must not touch anything that another job index writes to
+typedef void ( *PFN_JOB )( int iJob, void* pData );
+
+class CTHREAD_POOL;
+
+struct SWORKER_THREAD
+{
+	CTHREAD_POOL* m_pPool;
+	HANDLE m_hThread;
+	HANDLE m_hWakeEvent;		//signaled when a new batch is ready
+	HANDLE m_hDoneEvent;		//signaled when the worker ran out of jobs
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CTHREAD_POOL
+{
+	private:
+		SWORKER_THREAD m_workers[MAX_WORKER_THREADS];
+		int m_iNumWorkers;			//not counting the calling thread
+		int m_iNumActiveWorkers;	//workers taking part in the current batch
+
+		//the current batch of jobs
+		PFN_JOB m_pfnJob;
+		void* m_pJobData;
+		int m_iNumJobs;
+		volatile LONG m_lNextJob;
+
+		volatile LONG m_lBusy;		//a batch is in flight (nested batches run serially)
+		volatile bool m_bShutdown;
+		bool m_bInitialized;
+
+	static unsigned int __stdcall WorkerProc( void* pParam );
+	void DoJobs( void );
+
+	public:
+
+	bool Init( int iNumThreads= 0 );
+	void Shutdown( void );
+
+	void Run( PFN_JOB pfnJob, void* pData, int iNumJobs, int iMaxThreads= 0 );
+
+	static int GetNumProcessors( void );
+
+	//--------------------------------------------------------------
+	// Name:			CTHREAD_POOL::GetNumThreads - public
+	// Description:		Get the number of threads that work on a batch
+	// Arguments:		None
+	// Return Value:	An integer value: worker threads plus the caller
+	//--------------------------------------------------------------
+	inline int GetNumThreads( void )
+	{	return m_iNumWorkers+1;	}
+
+	CTHREAD_POOL( void ) : m_iNumWorkers( 0 ), m_iNumActiveWorkers( 0 ), m_lBusy( 0 ),
+						   m_bShutdown( false ), m_bInitialized( false )
+	{	}
+	~CTHREAD_POOL( void )
+	{	Shutdown( );	}
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+extern CTHREAD_POOL g_threadPool;
+
+
+#endif	//__THREAD_POOL_H__
@@ -0,0 +1,428 @@
+//==============================================================
+//==============================================================
+//= vertex_cache.cpp ===========================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= The video card keeps the last few vertices it transformed, =
+//= so a triangle order that reuses them transforms fewer	   =
+//= vertices.  This simulates that cache (to score an index	   =
+//= stream), and reorders triangle lists to make better use of =
+//= it (Tom Forsyth's "Linear-Speed Vertex Cache			   =
+//= Optimisation").											   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <math.h>
+#include <string.h>
+
+#include "vertex_cache.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//the optimizer's scoring (the values from Forsyth's article)
+#define VCOPT_CACHE_SIZE	   VCACHE_LRU_SIZE
+#define VCOPT_MAX_VALENCE	   32		//vertices used by more triangles score the same as this
+#define VCOPT_LAST_TRI_SCORE   0.75f	//the last triangle's vertices (a little lower, so strips don't win)
+#define VCOPT_CACHE_DECAY	   1.5f
+#define VCOPT_VALENCE_SCALE	   2.0f		//vertices with few triangles left are finished off first
+#define VCOPT_VALENCE_POWER	   0.5f
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CVERTEX_CACHE::Access - public
+// Description:		Ask the cache for a vertex (it is added if it isn't
+//					there)
+// Arguments:		-uiIndex: the vertex's index
+// Return Value:	A boolean value: -true: the vertex was in the cache
+//									 -false: it had to be transformed
+//--------------------------------------------------------------
+bool CVERTEX_CACHE::Access( unsigned int uiIndex )
+{
+	int i;
+
+	for( i=0; i<m_iNumEntries; i++ )
+	{
+		if( m_uiEntries[i]!=uiIndex )
+			continue;
+
+		//move the vertex to the front
+		if( m_type==VCACHE_LRU )
+		{
+			memmove( &m_uiEntries[1], &m_uiEntries[0], i*sizeof( unsigned int ) );
+			m_uiEntries[0]= uiIndex;
+		}
+
+		return true;
+	}
+
+	if( m_type==VCACHE_FIFO )
+	{
+		//replace the oldest entry
+		m_uiEntries[m_iNext]= uiIndex;
+		m_iNext= ( m_iNext+1 )%m_iSize;
+
+		if( m_iNumEntries<m_iSize )
+			m_iNumEntries++;
+	}
+	else
+	{
+		//everything moves back one, and the last entry falls out
+		if( m_iNumEntries<m_iSize )
+			m_iNumEntries++;
+
+		memmove( &m_uiEntries[1], &m_uiEntries[0], ( m_iNumEntries-1 )*sizeof( unsigned int ) );
+		m_uiEntries[0]= uiIndex;
+	}
+
+	return false;
+}
+
+//--------------------------------------------------------------
+// Name:			MakeTriangleList - global
+// Description:		Turn a primitive's indices into a plain triangle list
+//					(without the degenerate triangles that join strips
+//					together)
+// Arguments:		-primitive: the type of primitive
+//					-uipIndices: the index stream (NULL to use the vertices
+//								 in order)
+//					-iCount: the number of indices (or vertices)
+//					-uipList: storage for the list (a primitive never has
+//							  more than iCount triangles)
+// Return Value:	An integer value: the number of indices in the list
+//--------------------------------------------------------------
+int MakeTriangleList( EBACKEND_PRIMITIVES primitive, const unsigned int* uipIndices, int iCount, unsigned int* uipList )
+{
+	unsigned int ui0, ui1, ui2;
+	int iNumIndices= 0;
+	int i;
+
+	for( i=0; i+2<iCount; )
+	{
+		if( primitive==BACKEND_TRIANGLES )
+		{
+			ui0= uipIndices ? uipIndices[i  ] : i;
+			ui1= uipIndices ? uipIndices[i+1] : i+1;
+			ui2= uipIndices ? uipIndices[i+2] : i+2;
+			i+= 3;
+		}
+		else if( primitive==BACKEND_TRIANGLE_STRIP )
+		{
+			//every other triangle in a strip is wound the other way
+			ui0= uipIndices ? uipIndices[i+( i&1 )  ] : i+( i&1 );
+			ui1= uipIndices ? uipIndices[i+1-( i&1 )] : i+1-( i&1 );
+			ui2= uipIndices ? uipIndices[i+2] : i+2;
+			i++;
+		}
+		else
+		{
+			ui0= uipIndices ? uipIndices[0  ] : 0;
+			ui1= uipIndices ? uipIndices[i+1] : i+1;
+			ui2= uipIndices ? uipIndices[i+2] : i+2;
+			i++;
+		}
+
+		if( ui0==ui1 || ui1==ui2 || ui0==ui2 )
+			continue;
+
+		uipList[iNumIndices++]= ui0;
+		uipList[iNumIndices++]= ui1;
+		uipList[iNumIndices++]= ui2;
+	}
+
+	return iNumIndices;
+}
+
+//--------------------------------------------------------------
+// Name:			CountCacheMisses - global
+// Description:		Run a triangle list through an empty simulated cache
+// Arguments:		-uipList: the triangle list
+//					-iNumIndices: the number of indices in the list
+//					-type: the kind of cache (VCACHE_*)
+//					-iCacheSize: the number of vertices the cache holds
+// Return Value:	An integer value: the number of vertices that had to
+//					be transformed (the misses)
+//--------------------------------------------------------------
+int CountCacheMisses( const unsigned int* uipList, int iNumIndices, EVCACHE_TYPES type, int iCacheSize )
+{
+	CVERTEX_CACHE cache( type, iCacheSize );
+	int iNumMisses= 0;
+	int i;
+
+	for( i=0; i<iNumIndices; i++ )
+	{
+		if( !cache.Access( uipList[i] ) )
+			iNumMisses++;
+	}
+
+	return iNumMisses;
+}
+
+//--------------------------------------------------------------
+// Name:			CountUniqueVertices - global
+// Description:		Count the different vertices that a triangle list uses
+//					(the fewest transforms that any order could get away
+//					with)
+// Arguments:		-uipList: the triangle list
+//					-iNumIndices: the number of indices in the list
+//					-iNumVertices: one more than the largest index
+// Return Value:	An integer value: the number of different vertices
+//--------------------------------------------------------------
+int CountUniqueVertices( const unsigned int* uipList, int iNumIndices, int iNumVertices )
+{
+	unsigned char* ucpUsed;
+	int iNumUnique= 0;
+	int i;
+
+	ucpUsed= new unsigned char [iNumVertices];
+	memset( ucpUsed, 0, iNumVertices );
+
+	for( i=0; i<iNumIndices; i++ )
+	{
+		if( !ucpUsed[uipList[i]] )
+		{
+			ucpUsed[uipList[i]]= 1;
+			iNumUnique++;
+		}
+	}
+
+	delete[] ucpUsed;
+	return iNumUnique;
+}
+
+//--------------------------------------------------------------
+// Name:			GetVertexScore - global (this file only)
+// Description:		Score a vertex for the optimizer: high if it is near
+//					the front of the cache, or has few triangles left
+// Arguments:		-iCachePosition: the vertex's position in the cache
+//									 (-1 if it isn't in it)
+//					-iNumActiveTris: the triangles that still use it
+// Return Value:	A floating-point value: the vertex's score
+//--------------------------------------------------------------
+static float GetVertexScore( int iCachePosition, int iNumActiveTris )
+{
+	float fScore= 0.0f;
+
+	//nothing left to draw with it
+	if( iNumActiveTris==0 )
+		return -1.0f;
+
+	if( iCachePosition>=0 )
+	{
+		if( iCachePosition<3 )
+			fScore= VCOPT_LAST_TRI_SCORE;
+		else
+			fScore= ( float )pow( 1.0f-( float )( iCachePosition-3 )/( VCOPT_CACHE_SIZE-3 ), VCOPT_CACHE_DECAY );
+	}
+
+	if( iNumActiveTris>VCOPT_MAX_VALENCE )
+		iNumActiveTris= VCOPT_MAX_VALENCE;
+
+	return fScore+VCOPT_VALENCE_SCALE*( float )pow( ( float )iNumActiveTris, -VCOPT_VALENCE_POWER );
+}
+
+//--------------------------------------------------------------
+// Name:			OptimizeVertexCache - global
+// Description:		Reorder a triangle list's triangles (in place) so that
+//					they reuse the vertices in the cache as much as they
+//					can.  Each step draws the triangle whose vertices score
+//					best, and only the vertices that were in the cache
+//					have to be scored again, so it runs in linear time.
+// Arguments:		-uipList: the triangle list
+//					-iNumIndices: the number of indices in the list
+//					-iNumVertices: one more than the largest index
+// Return Value:	None
+//--------------------------------------------------------------
+void OptimizeVertexCache( unsigned int* uipList, int iNumIndices, int iNumVertices )
+{
+	float fCacheScores[VCOPT_CACHE_SIZE];
+	float fValenceScores[VCOPT_MAX_VALENCE+1];
+	int iCache[VCOPT_CACHE_SIZE+3];
+	int iNewCache[VCOPT_CACHE_SIZE+3];
+	unsigned int* uipOutput;
+	int* ipNumActiveTris;
+	int* ipFirstTri;
+	int* ipAdjacency;
+	int* ipCachePosition;
+	float* fpVertexScores;
+	float* fpTriScores;
+	bool* bpTriAdded;
+	int iNumTris= iNumIndices/3;
+	int iCacheCount, iNewCount;
+	int iBestTri, iCursor;
+	float fBestScore, fScore;
+	int iTri, iVertex;
+	int i, j, k;
+
+	if( iNumTris<2 )
+		return;
+
+	//the scores only depend on small integers, so they can be looked up
+	for( i=0; i<VCOPT_CACHE_SIZE; i++ )
+		fCacheScores[i]= GetVertexScore( i, 1 )-GetVertexScore( -1, 1 );
+	for( i=0; i<=VCOPT_MAX_VALENCE; i++ )
+		fValenceScores[i]= GetVertexScore( -1, i );
+
+	ipNumActiveTris= new int [iNumVertices];
+	ipFirstTri	   = new int [iNumVertices+1];
+	ipCachePosition= new int [iNumVertices];
+	fpVertexScores = new float [iNumVertices];
+	ipAdjacency	   = new int [iNumIndices];
+	fpTriScores	   = new float [iNumTris];
+	bpTriAdded	   = new bool [iNumTris];
+	uipOutput	   = new unsigned int [iNumIndices];
+
+	//the triangles that use each vertex, packed into one array
+	memset( ipNumActiveTris, 0, iNumVertices*sizeof( int ) );
+	for( i=0; i<iNumIndices; i++ )
+		ipNumActiveTris[uipList[i]]++;
+
+	ipFirstTri[0]= 0;
+	for( i=0; i<iNumVertices; i++ )
+	{
+		ipFirstTri[i+1]	  = ipFirstTri[i]+ipNumActiveTris[i];
+		ipNumActiveTris[i]= 0;
+	}
+
+	for( i=0; i<iNumIndices; i++ )
+	{
+		iVertex= uipList[i];
+		ipAdjacency[ipFirstTri[iVertex]+ipNumActiveTris[iVertex]++]= i/3;
+	}
+
+	for( i=0; i<iNumVertices; i++ )
+	{
+		ipCachePosition[i]= -1;
+		fpVertexScores[i] = fValenceScores[( ipNumActiveTris[i]<VCOPT_MAX_VALENCE ) ? ipNumActiveTris[i] : VCOPT_MAX_VALENCE];
+	}
+
+	iBestTri  = -1;
+	fBestScore= -1.0f;
+	for( i=0; i<iNumTris; i++ )
+	{
+		bpTriAdded[i] = false;
+		fpTriScores[i]= fpVertexScores[uipList[i*3]]+fpVertexScores[uipList[i*3+1]]+fpVertexScores[uipList[i*3+2]];
+
+		if( fpTriScores[i]>fBestScore )
+		{
+			fBestScore= fpTriScores[i];
+			iBestTri  = i;
+		}
+	}
+
+	iCacheCount= 0;
+	iCursor	   = 0;
+	for( i=0; i<iNumTris; i++ )
+	{
+		//nothing in the cache has any triangles left, so start again
+		//with the next triangle that hasn't been drawn
+		if( iBestTri<0 )
+		{
+			while( bpTriAdded[iCursor] )
+				iCursor++;
+
+			iBestTri= iCursor;
+		}
+
+		iTri= iBestTri;
+		bpTriAdded[iTri]= true;
+		uipOutput[i*3  ]= uipList[iTri*3  ];
+		uipOutput[i*3+1]= uipList[iTri*3+1];
+		uipOutput[i*3+2]= uipList[iTri*3+2];
+
+		//the triangle's vertices go to the front of the cache, and the
+		//triangle is taken off of their lists
+		iNewCount= 0;
+		for( j=0; j<3; j++ )
+		{
+			iVertex= uipList[iTri*3+j];
+			iNewCache[iNewCount++]= iVertex;
+
+			for( k=ipFirstTri[iVertex]; k<ipFirstTri[iVertex]+ipNumActiveTris[iVertex]; k++ )
+			{
+				if( ipAdjacency[k]==iTri )
+				{
+					ipAdjacency[k]= ipAdjacency[ipFirstTri[iVertex]+ipNumActiveTris[iVertex]-1];
+					break;
+				}
+			}
+			ipNumActiveTris[iVertex]--;
+		}
+
+		for( j=0; j<iCacheCount; j++ )
+		{
+			iVertex= iCache[j];
+			if( iVertex!=( int )uipList[iTri*3] && iVertex!=( int )uipList[iTri*3+1] && iVertex!=( int )uipList[iTri*3+2] )
+				iNewCache[iNewCount++]= iVertex;
+		}
+
+		//score the vertices that were in the cache again (including the
+		//ones that just fell out of it), and find the best triangle
+		//among their triangles
+		iBestTri  = -1;
+		fBestScore= -1.0f;
+		for( j=0; j<iNewCount; j++ )
+		{
+			iVertex= iNewCache[j];
+
+			if( j<VCOPT_CACHE_SIZE )
+			{
+				ipCachePosition[iVertex]= j;
+				iCache[j]= iVertex;
+			}
+			else
+				ipCachePosition[iVertex]= -1;
+
+			if( ipNumActiveTris[iVertex]==0 )
+				fScore= -1.0f;
+			else
+			{
+				fScore= fValenceScores[( ipNumActiveTris[iVertex]<VCOPT_MAX_VALENCE ) ? ipNumActiveTris[iVertex] : VCOPT_MAX_VALENCE];
+				if( ipCachePosition[iVertex]>=0 )
+					fScore+= fCacheScores[ipCachePosition[iVertex]];
+			}
+
+			for( k=ipFirstTri[iVertex]; k<ipFirstTri[iVertex]+ipNumActiveTris[iVertex]; k++ )
+			{
+				iTri= ipAdjacency[k];
+				fpTriScores[iTri]+= fScore-fpVertexScores[iVertex];
+
+				if( fpTriScores[iTri]>fBestScore )
+				{
+					fBestScore= fpTriScores[iTri];
+					iBestTri  = iTri;
+				}
+			}
+
+			fpVertexScores[iVertex]= fScore;
+		}
+
+		iCacheCount= ( iNewCount<VCOPT_CACHE_SIZE ) ? iNewCount : VCOPT_CACHE_SIZE;
+	}
+
+	memcpy( uipList, uipOutput, iNumIndices*sizeof( unsigned int ) );
+
+	delete[] ipNumActiveTris;
+	delete[] ipFirstTri;
+	delete[] ipCachePosition;
+	delete[] fpVertexScores;
+	delete[] ipAdjacency;
+	delete[] fpTriScores;
+	delete[] bpTriAdded;
+	delete[] uipOutput;
+}
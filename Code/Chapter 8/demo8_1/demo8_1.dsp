@@ -42,7 +42,7 @@ RSC=rc.exe
 # PROP Intermediate_Dir "Release"
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
-# ADD CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
+# ADD CPP /nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
 # ADD BASE MTL /nologo /D "NDEBUG" /mktyplib203 /win32
 # ADD MTL /nologo /D "NDEBUG" /mktyplib203 /win32
 # ADD BASE RSC /l 0x409 /d "NDEBUG"
@@ -67,7 +67,7 @@ LINK32=link.exe
 # PROP Intermediate_Dir "Debug"
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
-# ADD CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
+# ADD CPP /nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
 # ADD BASE MTL /nologo /D "_DEBUG" /mktyplib203 /win32
 # ADD MTL /nologo /D "_DEBUG" /mktyplib203 /win32
 # ADD BASE RSC /l 0x409 /d "_DEBUG"
@@ -170,8 +170,32 @@ SOURCE="..\Base Code\math_ops.h"
 # End Source File
 # Begin Source File
 
+SOURCE="..\Base Code\render_backend.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\simd.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\thread_pool.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\thread_pool.h"
+# End Source File
+# Begin Source File
+
 SOURCE="..\Base Code\timer.h"
 # End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\vertex_cache.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\vertex_cache.h"
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
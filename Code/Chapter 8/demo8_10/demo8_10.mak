@@ -49,13 +49,14 @@ CLEAN :
 	-@erase "$(INTDIR)\math_ops.obj"
 	-@erase "$(INTDIR)\particle.obj"
 	-@erase "$(INTDIR)\resource.res"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
 	-@erase "$(OUTDIR)\demo8_10.exe"
 
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /ML /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_10.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
+CPP_PROJ=/nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_10.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
 MTL_PROJ=/nologo /D "NDEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "NDEBUG" 
 BSC32=bscmake.exe
@@ -72,7 +73,8 @@ LINK32_OBJS= \
 	"$(INTDIR)\gl_app.obj" \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
-	"$(INTDIR)\math_ops.obj"
+	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\thread_pool.obj"
 
 "$(OUTDIR)\demo8_10.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -99,6 +101,7 @@ CLEAN :
 	-@erase "$(INTDIR)\math_ops.obj"
 	-@erase "$(INTDIR)\particle.obj"
 	-@erase "$(INTDIR)\resource.res"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
 	-@erase "$(INTDIR)\vc60.pdb"
 	-@erase "$(OUTDIR)\demo8_10.exe"
@@ -108,7 +111,7 @@ CLEAN :
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /MLd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_10.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
+CPP_PROJ=/nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_10.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
 MTL_PROJ=/nologo /D "_DEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "_DEBUG" 
 BSC32=bscmake.exe
@@ -125,7 +128,8 @@ LINK32_OBJS= \
 	"$(INTDIR)\gl_app.obj" \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
-	"$(INTDIR)\math_ops.obj"
+	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\thread_pool.obj"
 
 "$(OUTDIR)\demo8_10.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -215,6 +219,12 @@ SOURCE="..\Base Code\math_ops.cpp"
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE="..\Base Code\thread_pool.cpp"
+
+"$(INTDIR)\thread_pool.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\resource.rc
 
 "$(INTDIR)\resource.res" : $(SOURCE) "$(INTDIR)"
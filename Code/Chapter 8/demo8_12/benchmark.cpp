@@ -0,0 +1,1088 @@
+//==============================================================
+//==============================================================
+//= benchmark.cpp ==============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= demo8_12: timing runs for the engine's heavy lifting.  Run =
+//= the demo with "-benchmark" on the command line, and the	   =
+//= results end up in the program log.						   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- INCLUDES ---------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <math.h>
+
+#include "../Base Code/gl_app.h"
+#include "../Base Code/bake_cache.h"
+#include "../Base Code/image.h"
+#include "../Base Code/log.h"
+#include "../Base Code/render_backend.h"
+#include "../Base Code/thread_pool.h"
+#include "../Base Code/timer.h"
+#include "../Base Code/vertex_cache.h"
+
+#include "benchmark.h"
+#include "chunklod.h"
+#include "geoclipmap.h"
+#include "geomipmapping.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+static char* g_szBenchmarkImages[]= {	"../Data/lowestTile.tga", "../Data/lowTile.tga",
+										"../Data/highTile.tga",	  "../Data/highestTile.tga",
+										"../Data/detailMap.tga"	};
+
+static char* g_szQualityNames[]= {	"fast", "normal", "best"	};
+
+static float g_fBenchmarkSunAngles[]= {	0.0f, 30.0f, 45.0f, 100.0f, 225.0f, 290.0f	};
+
+//file-scope terrains, so that they start out zeroed like the demo's
+static CGEOMIPMAPPING g_benchmarkTerrain;
+static CGEOCLIPMAP g_benchmarkClipmap;
+static CCHUNKLOD g_benchmarkChunkLOD;
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			GetPSNR - global (this file only)
+// Description:		Find the peak signal to noise ratio between two images
+// Arguments:		-ucpOriginal, ucpTest: the two images' pixels
+//					-uiSize: the number of bytes in each image
+// Return Value:	A floating-point value: the PSNR, in decibels
+//--------------------------------------------------------------
+static float GetPSNR( unsigned char* ucpOriginal, unsigned char* ucpTest, unsigned int uiSize )
+{
+	double dError= 0.0;
+	double dDelta;
+	unsigned int i;
+
+	for( i=0; i<uiSize; i++ )
+	{
+		dDelta = ( double )ucpOriginal[i]-( double )ucpTest[i];
+		dError+= dDelta*dDelta;
+	}
+
+	//a perfect match
+	if( dError==0.0 )
+		return 99.0f;
+
+	return ( float )( 10.0*log10( ( 255.0*255.0 )/( dError/uiSize ) ) );
+}
+
+//--------------------------------------------------------------
+// Name:			SetBenchmarkFrustum - global (this file only)
+// Description:		Give a camera the view frustum that it would have
+//					looking straight down the X axis (without needing
+//					OpenGL's matrices)
+// Arguments:		-pCamera: the camera (already positioned)
+//					-fFOV: the vertical field of view (in degrees)
+//					-fAspect: the viewport's width/height
+//					-fFar: the distance to the far plane
+// Return Value:	None
+//--------------------------------------------------------------
+static void SetBenchmarkFrustum( CCAMERA* pCamera, float fFOV, float fAspect, float fFar )
+{
+	float fHalfV, fHalfH;
+	int i;
+
+	fHalfV= DEG_TO_RAD( fFOV )/2.0f;
+	fHalfH= ( float )atan( tan( fHalfV )*fAspect );
+
+	//the side planes' normals point in towards the view direction
+	pCamera->m_viewFrustum[FRUSTUM_RIGHT][0] = ( float )sin( fHalfH );
+	pCamera->m_viewFrustum[FRUSTUM_RIGHT][1] = 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_RIGHT][2] =-( float )cos( fHalfH );
+	pCamera->m_viewFrustum[FRUSTUM_LEFT][0]	 = ( float )sin( fHalfH );
+	pCamera->m_viewFrustum[FRUSTUM_LEFT][1]	 = 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_LEFT][2]	 = ( float )cos( fHalfH );
+	pCamera->m_viewFrustum[FRUSTUM_BOTTOM][0]= ( float )sin( fHalfV );
+	pCamera->m_viewFrustum[FRUSTUM_BOTTOM][1]= ( float )cos( fHalfV );
+	pCamera->m_viewFrustum[FRUSTUM_BOTTOM][2]= 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_TOP][0]	 = ( float )sin( fHalfV );
+	pCamera->m_viewFrustum[FRUSTUM_TOP][1]	 =-( float )cos( fHalfV );
+	pCamera->m_viewFrustum[FRUSTUM_TOP][2]	 = 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_FAR][0]	 =-1.0f;
+	pCamera->m_viewFrustum[FRUSTUM_FAR][1]	 = 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_FAR][2]	 = 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_NEAR][0]	 = 1.0f;
+	pCamera->m_viewFrustum[FRUSTUM_NEAR][1]	 = 0.0f;
+	pCamera->m_viewFrustum[FRUSTUM_NEAR][2]	 = 0.0f;
+
+	//every plane goes through the eye, except for the far plane
+	for( i=0; i<6; i++ )
+	{
+		pCamera->m_viewFrustum[i][3]= -( pCamera->m_viewFrustum[i][0]*pCamera->m_vecEyePos[0]+
+										 pCamera->m_viewFrustum[i][1]*pCamera->m_vecEyePos[1]+
+										 pCamera->m_viewFrustum[i][2]*pCamera->m_vecEyePos[2] );
+	}
+	pCamera->m_viewFrustum[FRUSTUM_FAR][3]+= fFar;
+}
+
+//--------------------------------------------------------------
+// Name:			SetFlightCamera - global (this file only)
+// Description:		Put a camera where it is on a frame of the benchmark
+//					flight: east across the middle of a 513x513 terrain,
+//					rising and falling over the hills
+// Arguments:		-pCamera: the camera
+//					-iFrame: the frame of the flight
+// Return Value:	None
+//--------------------------------------------------------------
+static void SetFlightCamera( CCAMERA* pCamera, int iFrame )
+{
+	pCamera->SetPosition( iFrame*3.0f, 220.0f+60.0f*( float )sin( iFrame*0.03f ), 512.0f );
+	SetBenchmarkFrustum( pCamera, 45.0f, 4.0f/3.0f, 2048.0f );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkTextureCompression - global
+// Description:		Time the block compressor at each quality setting,
+//					with one thread and with the whole thread pool
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkTextureCompression( void )
+{
+	CIMAGE image;
+	CTIMER timer;
+	EIMAGE_COMPRESSION compression;
+	unsigned char* ucpDecoded;
+	unsigned int uiSize;
+	float fTime, fSingleTime;
+	float fMegaPixels;
+	int iNumThreads;
+	int iImage, iQuality;
+
+	timer.Init( );
+	iNumThreads= CTHREAD_POOL::GetNumProcessors( );
+
+	g_log.Write( LOG_PLAINTEXT, "TEXTURE COMPRESSION BENCHMARK (%d processors)", iNumThreads );
+
+	for( iImage=0; iImage<( int )( sizeof( g_szBenchmarkImages )/sizeof( char* ) ); iImage++ )
+	{
+		if( !image.LoadData( g_szBenchmarkImages[iImage] ) )
+			continue;
+
+		uiSize		= image.GetWidth( )*image.GetHeight( )*( image.GetBPP( )/8 );
+		fMegaPixels = ( image.GetWidth( )*image.GetHeight( ) )/1000000.0f;
+		compression = ( image.GetBPP( )==32 ) ? IMAGE_BC3 : IMAGE_BC1;
+		ucpDecoded	= new unsigned char [uiSize];
+
+		for( iQuality=COMPRESS_FAST; iQuality<=COMPRESS_BEST; iQuality++ )
+		{
+			//one thread
+			g_threadPool.Init( 1 );
+			fTime= timer.GetTime( );
+			image.Compress( compression, ( EIMAGE_QUALITY )iQuality );
+			fSingleTime= timer.GetTime( )-fTime;
+
+			//all of the threads
+			g_threadPool.Init( iNumThreads );
+			fTime= timer.GetTime( );
+			image.Compress( compression, ( EIMAGE_QUALITY )iQuality );
+			fTime= timer.GetTime( )-fTime;
+
+			image.Decompress( ucpDecoded );
+
+			g_log.Write( LOG_PLAINTEXT, "%s %dx%d %s %s: %.2f MPix/s (1 thread), %.2f MPix/s (%d threads), PSNR %.2f dB",
+						 g_szBenchmarkImages[iImage], image.GetWidth( ), image.GetHeight( ),
+						 ( compression==IMAGE_BC1 ) ? "BC1" : "BC3", g_szQualityNames[iQuality],
+						 fMegaPixels/( MAX( fSingleTime, 0.001f )/1000.0f ),
+						 fMegaPixels/( MAX( fTime, 0.001f )/1000.0f ), iNumThreads,
+						 GetPSNR( image.GetData( ), ucpDecoded, uiSize ) );
+		}
+
+		delete[] ucpDecoded;
+		image.Unload( );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkShadowedLighting - global
+// Description:		Time the shadowed lightmap sweep on a big terrain,
+//					for a handful of sun directions, with one thread and
+//					with the whole thread pool
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkShadowedLighting( void )
+{
+	CTIMER timer;
+	float fTime, fSingleTime;
+	bool bCacheEnabled;
+	int iNumThreads;
+	int iAngle;
+
+	timer.Init( );
+	iNumThreads= CTHREAD_POOL::GetNumProcessors( );
+
+	g_log.Write( LOG_PLAINTEXT, "SHADOWED LIGHTING BENCHMARK (%d processors)", iNumThreads );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 2049, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.SetLightingType( SHADOWED_LIGHT );
+
+	//the lightmaps need to actually be computed every time
+	bCacheEnabled= g_bakeCache.IsEnabled( );
+	g_bakeCache.Enable( false );
+
+	for( iAngle=0; iAngle<( int )( sizeof( g_fBenchmarkSunAngles )/sizeof( float ) ); iAngle++ )
+	{
+		g_benchmarkTerrain.CustomizeShadowedLighting( g_fBenchmarkSunAngles[iAngle], 20.0f, 0.5f, 0.2f, 1.0f );
+
+		//one thread
+		g_threadPool.Init( 1 );
+		fTime= timer.GetTime( );
+		g_benchmarkTerrain.CalculateLighting( );
+		fSingleTime= timer.GetTime( )-fTime;
+
+		//all of the threads
+		g_threadPool.Init( iNumThreads );
+		fTime= timer.GetTime( );
+		g_benchmarkTerrain.CalculateLighting( );
+		fTime= timer.GetTime( )-fTime;
+
+		g_log.Write( LOG_PLAINTEXT, "2049x2049, sun at %.0f degrees: %.1f ms (1 thread), %.1f ms (%d threads)",
+					 g_fBenchmarkSunAngles[iAngle], fSingleTime, fTime, iNumThreads );
+	}
+
+	g_bakeCache.Enable( bCacheEnabled );
+
+	g_benchmarkTerrain.UnloadLightMap( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkHorizonMaps - global
+// Description:		Time building the horizon maps for a big terrain, and
+//					relighting it from them, with one thread and with the
+//					whole thread pool
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkHorizonMaps( void )
+{
+	CTIMER timer;
+	float fTime, fSingleTime;
+	bool bCacheEnabled;
+	int iNumThreads;
+	int iAngle;
+
+	timer.Init( );
+	iNumThreads= CTHREAD_POOL::GetNumProcessors( );
+
+	g_log.Write( LOG_PLAINTEXT, "HORIZON MAP BENCHMARK (%d processors)", iNumThreads );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 2049, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.CustomizeShadowedLighting( 0.0f, 0.0f, 0.5f, 0.2f, 1.0f );
+
+	//the maps need to actually be built every time
+	bCacheEnabled= g_bakeCache.IsEnabled( );
+	g_bakeCache.Enable( false );
+
+	g_threadPool.Init( 1 );
+	fTime= timer.GetTime( );
+	g_benchmarkTerrain.BuildHorizonMaps( );
+	fSingleTime= timer.GetTime( )-fTime;
+
+	g_threadPool.Init( iNumThreads );
+	fTime= timer.GetTime( );
+	g_benchmarkTerrain.BuildHorizonMaps( );
+	fTime= timer.GetTime( )-fTime;
+
+	g_log.Write( LOG_PLAINTEXT, "2049x2049, %d directions: built in %.1f ms (1 thread), %.1f ms (%d threads)",
+				 g_benchmarkTerrain.GetNumAzimuths( ), fSingleTime, fTime, iNumThreads );
+
+	for( iAngle=0; iAngle<( int )( sizeof( g_fBenchmarkSunAngles )/sizeof( float ) ); iAngle++ )
+	{
+		g_threadPool.Init( 1 );
+		fTime= timer.GetTime( );
+		g_benchmarkTerrain.Relight( g_fBenchmarkSunAngles[iAngle], 20.0f );
+		fSingleTime= timer.GetTime( )-fTime;
+
+		g_threadPool.Init( iNumThreads );
+		fTime= timer.GetTime( );
+		g_benchmarkTerrain.Relight( g_fBenchmarkSunAngles[iAngle], 20.0f );
+		fTime= timer.GetTime( )-fTime;
+
+		g_log.Write( LOG_PLAINTEXT, "2049x2049, relit for the sun at %.0f degrees: %.1f ms (1 thread), %.1f ms (%d threads)",
+					 g_fBenchmarkSunAngles[iAngle], fSingleTime, fTime, iNumThreads );
+	}
+
+	g_bakeCache.Enable( bCacheEnabled );
+
+	g_benchmarkTerrain.UnloadHorizonMaps( );
+	g_benchmarkTerrain.UnloadLightMap( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkAmbientOcclusion - global
+// Description:		Time the ambient occlusion bake on a 4097x4097
+//					terrain with more and more threads, and time a single
+//					progressive refinement step
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkAmbientOcclusion( void )
+{
+	CTIMER timer;
+	float fTime, fSingleTime;
+	bool bCacheEnabled;
+	int iNumProcessors;
+	int iNumThreads;
+
+	timer.Init( );
+	iNumProcessors= CTHREAD_POOL::GetNumProcessors( );
+
+	g_log.Write( LOG_PLAINTEXT, "AMBIENT OCCLUSION BENCHMARK (%d processors)", iNumProcessors );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 4097, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.CustomizeAmbientOcclusion( 32.0f, 1.0f );
+
+	//the occlusion needs to actually be traced every time
+	bCacheEnabled= g_bakeCache.IsEnabled( );
+	g_bakeCache.Enable( false );
+
+	//1, 2, 4, ... threads, and then every processor
+	fSingleTime= 0.0f;
+	for( iNumThreads=1; iNumThreads>0; )
+	{
+		g_threadPool.Init( iNumThreads );
+		fTime= timer.GetTime( );
+		g_benchmarkTerrain.BakeAmbientOcclusion( );
+		fTime= timer.GetTime( )-fTime;
+
+		if( iNumThreads==1 )
+			fSingleTime= fTime;
+
+		g_log.Write( LOG_PLAINTEXT, "4097x4097, %d directions: %.1f ms (%d threads, %.2fx)",
+					 g_benchmarkTerrain.GetNumOcclusionDirections( ), fTime, iNumThreads, fSingleTime/fTime );
+
+		if( iNumThreads==iNumProcessors )
+			iNumThreads= 0;
+		else
+			iNumThreads= MIN( iNumThreads*2, iNumProcessors );
+	}
+
+	//one more direction on top of the full bake
+	fTime= timer.GetTime( );
+	g_benchmarkTerrain.RefineAmbientOcclusion( 1 );
+	fTime= timer.GetTime( )-fTime;
+
+	g_log.Write( LOG_PLAINTEXT, "4097x4097, refined by 1 direction: %.1f ms (%d threads)", fTime, iNumProcessors );
+
+	g_bakeCache.Enable( bCacheEnabled );
+
+	g_benchmarkTerrain.UnloadAmbientOcclusion( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkTerrainUpdate - global
+// Description:		Time the geomipmapping update (culling and choosing
+//					levels of detail) for the 65536 patches of a 4097x4097
+//					terrain, with one thread and with the whole thread pool
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkTerrainUpdate( void )
+{
+	CCAMERA camera;
+	CTIMER timer;
+	float fTime, fSingleTime;
+	int iNumUpdates= 50;
+	int iNumThreads;
+	int i, j;
+
+	timer.Init( );
+	iNumThreads= CTHREAD_POOL::GetNumProcessors( );
+
+	g_log.Write( LOG_PLAINTEXT, "TERRAIN UPDATE BENCHMARK (%d processors)", iNumThreads );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 4097, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.Init( 17 );
+
+	//from the middle of the western edge, looking east across the terrain
+	camera.SetPosition( 0.0f, 300.0f, 4096.0f );
+	SetBenchmarkFrustum( &camera, 45.0f, 4.0f/3.0f, 8192.0f );
+
+	//everything, and then only what the camera can see
+	for( j=0; j<2; j++ )
+	{
+		g_threadPool.Init( 1 );
+		fSingleTime= timer.GetTime( );
+		for( i=0; i<iNumUpdates; i++ )
+			g_benchmarkTerrain.Update( camera, j==1 );
+		fSingleTime= ( timer.GetTime( )-fSingleTime )/iNumUpdates;
+
+		g_threadPool.Init( iNumThreads );
+		fTime= timer.GetTime( );
+		for( i=0; i<iNumUpdates; i++ )
+			g_benchmarkTerrain.Update( camera, j==1 );
+		fTime= ( timer.GetTime( )-fTime )/iNumUpdates;
+
+		g_log.Write( LOG_PLAINTEXT, "4097x4097, 17x17 patches, %s: %.2f ms (1 thread), %.2f ms (%d threads), %d patches visible, %d tested one at a time",
+					 j ? "culled" : "not culled", fSingleTime, fTime, iNumThreads,
+					 g_benchmarkTerrain.GetNumVisiblePatches( ), g_benchmarkTerrain.GetNumPatchesTested( ) );
+	}
+
+	g_benchmarkTerrain.Shutdown( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkTerrainRendering - global
+// Description:		Draw the geomipmapped terrain through the recording
+//					backend, so that the cost of building its vertices can
+//					be timed without the video card getting in the way (the
+//					last frame is written out to an .obj file)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkTerrainRendering( void )
+{
+	static CRECORDING_BACKEND recorder;
+	CCAMERA camera;
+	CTIMER timer;
+	char* szModes[2]= { "multitextured", "two passes" };
+	float fTime;
+	int iNumFrames= 50;
+	int iNumVertices;
+	int i, j;
+
+	timer.Init( );
+
+	g_log.Write( LOG_PLAINTEXT, "TERRAIN RENDERING BENCHMARK (recording backend)" );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 513, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.SetLightingType( HEIGHT_BASED );
+	g_benchmarkTerrain.CalculateLighting( );
+	g_benchmarkTerrain.DoTextureMapping( true );
+	g_benchmarkTerrain.DoDetailMapping( true, 16 );
+	g_benchmarkTerrain.DoMultitexturing( true );
+	g_benchmarkTerrain.Init( 17 );
+
+	//look at everything from the middle of the terrain
+	camera.SetPosition( 512.0f, 300.0f, 512.0f );
+	g_benchmarkTerrain.Update( camera, false );
+
+	g_benchmarkTerrain.SetRenderBackend( &recorder );
+
+	//with hardware multitexturing, and then with a pass for each texture
+	for( j=0; j<2; j++ )
+	{
+		g_benchmarkTerrain.DoMultitexturing( j==0 );
+
+		fTime= timer.GetTime( );
+		for( i=0; i<iNumFrames; i++ )
+		{
+			recorder.ResetStats( );
+			if( i==iNumFrames-1 && j==0 )
+				recorder.StartRecording( );
+
+			g_benchmarkTerrain.Render( );
+		}
+		fTime= ( timer.GetTime( )-fTime )/iNumFrames;
+		recorder.StopRecording( );
+
+		iNumVertices= recorder.GetNumVertices( );
+		g_log.Write( LOG_PLAINTEXT, "513x513, 17x17 patches, %s: %.2f ms per frame, %.1f ns per vertex",
+					 szModes[j], fTime, iNumVertices ? ( fTime*1000000.0f )/iNumVertices : 0.0f );
+		recorder.LogStats( szModes[j] );
+	}
+
+	//one more (untimed) frame, run through the simulated vertex caches
+	g_benchmarkTerrain.DoMultitexturing( true );
+	recorder.ResetStats( );
+	recorder.MeasureVertexCache( true );
+	g_benchmarkTerrain.Render( );
+	recorder.MeasureVertexCache( false );
+
+	g_log.Write( LOG_PLAINTEXT, "513x513, 17x17 patches, vertex cache: ACMR %.3f (FIFO), %.3f (LRU), ATVR %.3f (FIFO), %.3f (LRU)",
+				 recorder.GetACMR( VCACHE_FIFO ), recorder.GetACMR( VCACHE_LRU ),
+				 recorder.GetATVR( VCACHE_FIFO ), recorder.GetATVR( VCACHE_LRU ) );
+
+	recorder.SaveOBJ( "benchmark_terrain.obj" );
+
+	g_benchmarkTerrain.SetRenderBackend( NULL );
+	g_benchmarkTerrain.Shutdown( );
+	g_benchmarkTerrain.UnloadLightMap( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkGeomorphing - global
+// Description:		Fly a camera across the terrain at a few pixel
+//					tolerances, with and without geomorphing, and count
+//					the triangles drawn (through the recording backend)
+//					and how far the level of detail switches popped
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkGeomorphing( void )
+{
+	static CRECORDING_BACKEND recorder;
+	CCAMERA camera;
+	float fTolerances[4]= { 2.0f, 4.0f, 8.0f, 12.0f };
+	float fMaxPop, fTotalPop;
+	int iNumFrames= 300;
+	int iTriangles;
+	int iSwitches;
+	int i, j, k;
+
+	g_log.Write( LOG_PLAINTEXT, "GEOMORPHING BENCHMARK (%d frame flight, recording backend)", iNumFrames );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 513, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.SetLightingType( HEIGHT_BASED );
+	g_benchmarkTerrain.CalculateLighting( );
+	g_benchmarkTerrain.DoTextureMapping( true );
+	g_benchmarkTerrain.DoDetailMapping( true, 16 );
+	g_benchmarkTerrain.DoMultitexturing( true );
+	g_benchmarkTerrain.Init( 17 );
+	g_benchmarkTerrain.SetLODHysteresis( 0.0f );
+	g_benchmarkTerrain.SetRenderBackend( &recorder );
+
+	for( j=0; j<4; j++ )
+	{
+		//without geomorphing, and then with it
+		for( k=0; k<2; k++ )
+		{
+			g_benchmarkTerrain.SetPixelTolerance( fTolerances[j] );
+			g_benchmarkTerrain.DoGeomorphing( k==1 );
+
+			iTriangles= 0;
+			iSwitches = 0;
+			fMaxPop	  = 0.0f;
+			fTotalPop = 0.0f;
+
+			//the same flight every time (frame 0 is only there so that the
+			//first frame's pops are measured against this setting)
+			for( i=0; i<=iNumFrames; i++ )
+			{
+				SetFlightCamera( &camera, i );
+				g_benchmarkTerrain.Update( camera );
+				if( i==0 )
+					continue;
+
+				recorder.ResetStats( );
+				g_benchmarkTerrain.Render( );
+
+				iTriangles+= recorder.GetNumTriangles( );
+				iSwitches += g_benchmarkTerrain.GetNumLODSwitches( );
+				fTotalPop += g_benchmarkTerrain.GetTotalPopPixels( );
+				fMaxPop	   = MAX( fMaxPop, g_benchmarkTerrain.GetMaxPopPixels( ) );
+			}
+
+			g_log.Write( LOG_PLAINTEXT, "513x513, %.0f pixel tolerance, %s: %d triangles per frame, %.1f LOD switches per frame, pops of %.2f pixels (average), %.2f pixels (worst)",
+						 fTolerances[j], k ? "geomorphed" : "popping", iTriangles/iNumFrames, ( float )iSwitches/iNumFrames,
+						 iSwitches ? fTotalPop/iSwitches : 0.0f, fMaxPop );
+		}
+	}
+
+	g_benchmarkTerrain.SetRenderBackend( NULL );
+	g_benchmarkTerrain.Shutdown( );
+	g_benchmarkTerrain.UnloadLightMap( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkPatchCache - global
+// Description:		Fly a camera across the terrain with the patch vertex
+//					cache off and on, and with and without the level of
+//					detail hysteresis, and time how long it takes to build
+//					each frame (through the recording backend)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkPatchCache( void )
+{
+	static CRECORDING_BACKEND recorder;
+	CCAMERA camera;
+	CTIMER timer;
+	char* szSettings[3]= { "no cache, no hysteresis", "cache, no hysteresis", "cache, hysteresis" };
+	float fTime;
+	int iNumFrames= 300;
+	int iTriangles;
+	int iHits, iRebuilt;
+	int iSwitches;
+	int i, j;
+
+	timer.Init( );
+
+	g_log.Write( LOG_PLAINTEXT, "PATCH CACHE BENCHMARK (%d frame flight, recording backend)", iNumFrames );
+
+	g_benchmarkTerrain.SetRandomSeed( 20030101 );
+	if( !g_benchmarkTerrain.MakeTerrainFault( 513, 64, 0, 255, 0.15f ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.SetLightingType( HEIGHT_BASED );
+	g_benchmarkTerrain.CalculateLighting( );
+	g_benchmarkTerrain.CalculateNormals( );
+	g_benchmarkTerrain.DoTextureMapping( true );
+	g_benchmarkTerrain.DoDetailMapping( true, 16 );
+	g_benchmarkTerrain.DoMultitexturing( true );
+	g_benchmarkTerrain.SetFogDepth( 150.0f );
+	g_benchmarkTerrain.Init( 17 );
+	g_benchmarkTerrain.DoGeomorphing( true );
+	g_benchmarkTerrain.SetPixelTolerance( 2.0f*GEOMM_DEFAULT_TOLERANCE );
+	g_benchmarkTerrain.SetRenderBackend( &recorder );
+
+	for( j=0; j<3; j++ )
+	{
+		g_benchmarkTerrain.SetCacheSize( j==0 ? 0 : GEOMM_DEFAULT_CACHE_SIZE );
+		g_benchmarkTerrain.SetLODHysteresis( j==2 ? GEOMM_DEFAULT_HYSTERESIS : 0.0f );
+		g_benchmarkTerrain.FlushPatchCache( );
+
+		iTriangles= 0;
+		iHits	  = 0;
+		iRebuilt  = 0;
+		iSwitches = 0;
+
+		fTime= timer.GetTime( );
+		for( i=1; i<=iNumFrames; i++ )
+		{
+			SetFlightCamera( &camera, i );
+			g_benchmarkTerrain.Update( camera );
+
+			recorder.ResetStats( );
+			g_benchmarkTerrain.Render( );
+
+			iTriangles+= recorder.GetNumTriangles( );
+			iHits	  += g_benchmarkTerrain.GetNumCacheHits( );
+			iRebuilt  += g_benchmarkTerrain.GetNumPatchesRebuilt( );
+			iSwitches += g_benchmarkTerrain.GetNumLODSwitches( );
+		}
+		fTime= ( timer.GetTime( )-fTime )/iNumFrames;
+
+		g_log.Write( LOG_PLAINTEXT, "513x513, %s: %.3f ms per frame, %d triangles per frame, %.1f%% hit rate, %.1f patches rebuilt per frame, %.1f LOD switches per frame",
+					 szSettings[j], fTime, iTriangles/iNumFrames, ( iHits+iRebuilt ) ? ( 100.0f*iHits )/( iHits+iRebuilt ) : 0.0f,
+					 ( float )iRebuilt/iNumFrames, ( float )iSwitches/iNumFrames );
+	}
+
+	g_benchmarkTerrain.SetRenderBackend( NULL );
+	g_benchmarkTerrain.Shutdown( );
+	g_benchmarkTerrain.UnloadNormals( );
+	g_benchmarkTerrain.UnloadLightMap( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkClipmaps - global
+// Description:		Fly a camera low over bigger and bigger terrains with
+//					the geometry clipmap and with geomipmapping, and time
+//					how long it takes to update and build each frame
+//					(through the recording backend)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkClipmaps( void )
+{
+	static CRECORDING_BACKEND recorder;
+	CTERRAIN* pTerrains[2]= { &g_benchmarkClipmap, &g_benchmarkTerrain };
+	char* szEngines[2]= { "geometry clipmap", "geomipmapping" };
+	int iSizes[4]= { 513, 1025, 2049, 4097 };
+	CCAMERA camera;
+	CTIMER timer;
+	float fTime;
+	float fX, fZ;
+	int iNumFrames= 300;
+	int iTriangles;
+	int iRefreshed, iBlocks;
+	int i, j, k;
+
+	timer.Init( );
+
+	g_log.Write( LOG_PLAINTEXT, "GEOMETRY CLIPMAP BENCHMARK (%d frame flight, recording backend)", iNumFrames );
+
+	for( i=0; i<4; i++ )
+	{
+		for( j=0; j<2; j++ )
+		{
+			pTerrains[j]->SetRandomSeed( 20030101 );
+			if( !pTerrains[j]->MakeTerrainFault( iSizes[i], 64, 0, 255, 0.15f ) )
+				return;
+			pTerrains[j]->Scale( 2.0f, 1.0f, 2.0f );
+			pTerrains[j]->SetLightingType( HEIGHT_BASED );
+			pTerrains[j]->CalculateLighting( );
+			pTerrains[j]->DoTextureMapping( true );
+			pTerrains[j]->DoDetailMapping( true, 16 );
+			pTerrains[j]->DoMultitexturing( true );
+			pTerrains[j]->SetRenderBackend( &recorder );
+
+			if( j==0 )
+				g_benchmarkClipmap.Init( GEOCM_DEFAULT_GRID_SIZE, GEOCM_DEFAULT_LEVELS );
+			else
+				g_benchmarkTerrain.Init( 17 );
+
+			iTriangles= 0;
+			iRefreshed= 0;
+			iBlocks	  = 0;
+
+			fTime= timer.GetTime( );
+			for( k=1; k<=iNumFrames; k++ )
+			{
+				//east from the middle of the terrain, a little way above the ground
+				fX= ( iSizes[i]-1 )+k*3.0f;
+				fZ= ( float )( iSizes[i]-1 );
+				camera.SetPosition( fX, pTerrains[j]->SampleHeight( fX, fZ )+30.0f, fZ );
+				SetBenchmarkFrustum( &camera, 45.0f, 4.0f/3.0f, 2048.0f );
+
+				recorder.ResetStats( );
+				if( j==0 )
+				{
+					g_benchmarkClipmap.Update( camera );
+					g_benchmarkClipmap.Render( );
+
+					iRefreshed+= g_benchmarkClipmap.GetNumVerticesRefreshed( );
+					iBlocks	  += g_benchmarkClipmap.GetNumVisibleBlocks( );
+				}
+				else
+				{
+					g_benchmarkTerrain.Update( camera );
+					g_benchmarkTerrain.Render( );
+				}
+
+				iTriangles+= recorder.GetNumTriangles( );
+			}
+			fTime= ( timer.GetTime( )-fTime )/iNumFrames;
+
+			if( j==0 )
+				g_log.Write( LOG_PLAINTEXT, "%dx%d, %s: %.3f ms per frame, %d triangles per frame, %d vertices refreshed per frame, %d blocks drawn per frame",
+							 iSizes[i], iSizes[i], szEngines[j], fTime, iTriangles/iNumFrames, iRefreshed/iNumFrames, iBlocks/iNumFrames );
+			else
+				g_log.Write( LOG_PLAINTEXT, "%dx%d, %s: %.3f ms per frame, %d triangles per frame",
+							 iSizes[i], iSizes[i], szEngines[j], fTime, iTriangles/iNumFrames );
+
+			if( j==0 )
+				g_benchmarkClipmap.Shutdown( );
+			else
+				g_benchmarkTerrain.Shutdown( );
+
+			pTerrains[j]->SetRenderBackend( NULL );
+			pTerrains[j]->UnloadLightMap( );
+			pTerrains[j]->UnloadHeightMap( );
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkChunkLOD - global
+// Description:		Build chunk files for bigger and bigger terrains, and
+//					fly the same low camera path as the clipmap benchmark
+//					over them (through the recording backend), to time
+//					the build and what is left to do every frame
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkChunkLOD( void )
+{
+	static CRECORDING_BACKEND recorder;
+	int iSizes[3]= { 513, 1025, 2049 };
+	CCAMERA camera;
+	CTIMER timer;
+	float fBuildTime;
+	float fUpdateTime, fTime;
+	float fX, fZ;
+	int iNumFrames= 300;
+	int iTriangles, iChunks, iVisited;
+	int i, k;
+
+	timer.Init( );
+
+	g_log.Write( LOG_PLAINTEXT, "CHUNKED LOD BENCHMARK (%d frame flight, recording backend)", iNumFrames );
+
+	for( i=0; i<3; i++ )
+	{
+		g_benchmarkChunkLOD.SetRandomSeed( 20030101 );
+		if( !g_benchmarkChunkLOD.MakeTerrainFault( iSizes[i], 64, 0, 255, 0.15f ) )
+			return;
+		g_benchmarkChunkLOD.Scale( 2.0f, 1.0f, 2.0f );
+		g_benchmarkChunkLOD.SetLightingType( HEIGHT_BASED );
+		g_benchmarkChunkLOD.CalculateLighting( );
+		g_benchmarkChunkLOD.DoTextureMapping( true );
+		g_benchmarkChunkLOD.DoDetailMapping( true, 16 );
+		g_benchmarkChunkLOD.DoMultitexturing( true );
+		g_benchmarkChunkLOD.SetRenderBackend( &recorder );
+
+		fBuildTime= timer.GetTime( );
+		if( !g_benchmarkChunkLOD.Build( "benchmark.chunks" ) || !g_benchmarkChunkLOD.Init( "benchmark.chunks" ) )
+			return;
+		fBuildTime= timer.GetTime( )-fBuildTime;
+
+		iTriangles = 0;
+		iChunks	   = 0;
+		iVisited   = 0;
+		fUpdateTime= 0.0f;
+
+		fTime= timer.GetTime( );
+		for( k=1; k<=iNumFrames; k++ )
+		{
+			//east from the middle of the terrain, a little way above the ground
+			fX= ( iSizes[i]-1 )+k*3.0f;
+			fZ= ( float )( iSizes[i]-1 );
+			camera.SetPosition( fX, g_benchmarkChunkLOD.SampleHeight( fX, fZ )+30.0f, fZ );
+			SetBenchmarkFrustum( &camera, 45.0f, 4.0f/3.0f, 2048.0f );
+
+			recorder.ResetStats( );
+			fUpdateTime-= timer.GetTime( );
+			g_benchmarkChunkLOD.Update( camera );
+			fUpdateTime+= timer.GetTime( );
+			g_benchmarkChunkLOD.Render( );
+
+			iTriangles+= recorder.GetNumTriangles( );
+			iChunks	  += g_benchmarkChunkLOD.GetNumChunksDrawn( );
+			iVisited  += g_benchmarkChunkLOD.GetNumNodesVisited( );
+		}
+		fTime= ( timer.GetTime( )-fTime )/iNumFrames;
+
+		g_log.Write( LOG_PLAINTEXT, "%dx%d: built %d chunks in %.0f ms (%u KB file)",
+					 iSizes[i], iSizes[i], g_benchmarkChunkLOD.GetNumChunks( ), fBuildTime, g_benchmarkChunkLOD.GetFileSize( )/1024 );
+		g_log.Write( LOG_PLAINTEXT, "%dx%d: %.3f ms per frame (%.4f ms choosing chunks), %d triangles per frame, %d chunks drawn per frame, %d nodes visited per frame",
+					 iSizes[i], iSizes[i], fTime, fUpdateTime/iNumFrames, iTriangles/iNumFrames, iChunks/iNumFrames, iVisited/iNumFrames );
+
+		g_benchmarkChunkLOD.Shutdown( );
+		DeleteFile( "benchmark.chunks" );
+
+		g_benchmarkChunkLOD.SetRenderBackend( NULL );
+		g_benchmarkChunkLOD.UnloadLightMap( );
+		g_benchmarkChunkLOD.UnloadHeightMap( );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkPatchMerging - global
+// Description:		Fly a camera across the demo's height map (and a fault
+//					terrain) with patch merging off and on, and count the
+//					patches, triangles and vertices that go to the backend
+//					each frame (through the recording backend)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkPatchMerging( void )
+{
+	static CRECORDING_BACKEND recorder;
+	char* szMaps[2]= { "height1.RAW", "fault" };
+	float fTolerances[2]= { GEOMM_DEFAULT_TOLERANCE, 4.0f*GEOMM_DEFAULT_TOLERANCE };
+	CCAMERA camera;
+	CTIMER timer;
+	float fTime;
+	int iNumFrames= 300;
+	int iPatches, iSuperPatches;
+	int iTriangles, iVertices;
+	int iDrawCalls;
+	int i, j, k, m;
+	bool bMerge;
+
+	timer.Init( );
+
+	//the terrain is shared with the other benchmarks, so put merging back
+	//the way it was when we're done
+	bMerge= g_benchmarkTerrain.IsMergingPatches( );
+
+	g_log.Write( LOG_PLAINTEXT, "PATCH MERGING BENCHMARK (%d frame flight, recording backend)", iNumFrames );
+
+	for( m=0; m<2; m++ )
+	{
+		if( m==0 )
+		{
+			if( !g_benchmarkTerrain.LoadHeightMap( "../Data/height1.RAW", 513 ) )
+				continue;
+		}
+
+		else
+		{
+			g_benchmarkTerrain.SetRandomSeed( 20030101 );
+			if( !g_benchmarkTerrain.MakeTerrainFault( 513, 64, 0, 255, 0.15f ) )
+				continue;
+		}
+
+		g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+		g_benchmarkTerrain.SetLightingType( HEIGHT_BASED );
+		g_benchmarkTerrain.CalculateLighting( );
+		g_benchmarkTerrain.DoTextureMapping( true );
+		g_benchmarkTerrain.DoDetailMapping( true, 16 );
+		g_benchmarkTerrain.DoMultitexturing( true );
+		g_benchmarkTerrain.Init( 17 );
+		g_benchmarkTerrain.DoGeomorphing( true );
+		g_benchmarkTerrain.SetLODHysteresis( 0.0f );
+		g_benchmarkTerrain.SetRenderBackend( &recorder );
+
+		for( j=0; j<2; j++ )
+		{
+			//without merging, and then with it
+			for( k=0; k<2; k++ )
+			{
+				g_benchmarkTerrain.SetPixelTolerance( fTolerances[j] );
+				g_benchmarkTerrain.DoPatchMerging( k==1 );
+
+				iPatches	 = 0;
+				iSuperPatches= 0;
+				iTriangles	 = 0;
+				iVertices	 = 0;
+				iDrawCalls	 = 0;
+
+				fTime= timer.GetTime( );
+				for( i=1; i<=iNumFrames; i++ )
+				{
+					SetFlightCamera( &camera, i );
+					g_benchmarkTerrain.Update( camera );
+
+					recorder.ResetStats( );
+					g_benchmarkTerrain.Render( );
+
+					iPatches	 += g_benchmarkTerrain.GetNumPatchesPerFrame( );
+					iSuperPatches+= g_benchmarkTerrain.GetNumSuperPatches( );
+					iTriangles	 += recorder.GetNumTriangles( );
+					iVertices	 += recorder.GetNumVertices( );
+					iDrawCalls	 += recorder.GetNumDrawCalls( );
+				}
+				fTime= ( timer.GetTime( )-fTime )/iNumFrames;
+
+				g_log.Write( LOG_PLAINTEXT, "%s, %.0f pixel tolerance, %s: %.1f patches per frame (%.1f merged), %d triangles per frame, %d vertices per frame, %.1f draw calls per frame, %.3f ms per frame",
+							 szMaps[m], fTolerances[j], k ? "merged" : "not merged", ( float )iPatches/iNumFrames, ( float )iSuperPatches/iNumFrames,
+							 iTriangles/iNumFrames, iVertices/iNumFrames, ( float )iDrawCalls/iNumFrames, fTime );
+			}
+		}
+
+		g_benchmarkTerrain.SetRenderBackend( NULL );
+		g_benchmarkTerrain.Shutdown( );
+		g_benchmarkTerrain.UnloadLightMap( );
+		g_benchmarkTerrain.UnloadHeightMap( );
+	}
+
+	g_benchmarkTerrain.DoPatchMerging( bMerge );
+}
+
+//--------------------------------------------------------------
+// Name:			BenchmarkPatchSizes - global
+// Description:		Fly a camera across the demo's height map with each
+//					patch size, building the patches with the general
+//					kernel and then with the ones specialized for their
+//					vertex blocks, and then let the terrain calibrate its
+//					patch size over the same flight
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void BenchmarkPatchSizes( void )
+{
+	static CRECORDING_BACKEND recorder;
+	static CCAMERA path[300];
+	int iSizes[4]= { 17, 33, 65, 129 };
+	CTIMER timer;
+	float fTime;
+	int iNumFrames= 300;
+	int iTriangles;
+	int i, j, k;
+
+	timer.Init( );
+
+	g_log.Write( LOG_PLAINTEXT, "PATCH SIZE BENCHMARK (%d frame flight, recording backend)", iNumFrames );
+
+	if( !g_benchmarkTerrain.LoadHeightMap( "../Data/height1.RAW", 513 ) )
+		return;
+	g_benchmarkTerrain.Scale( 2.0f, 1.0f, 2.0f );
+	g_benchmarkTerrain.SetLightingType( HEIGHT_BASED );
+	g_benchmarkTerrain.CalculateLighting( );
+	g_benchmarkTerrain.DoTextureMapping( true );
+	g_benchmarkTerrain.DoDetailMapping( true, 16 );
+	g_benchmarkTerrain.DoMultitexturing( true );
+	g_benchmarkTerrain.SetFogDepth( 150.0f );
+	g_benchmarkTerrain.DoGeomorphing( true );
+	g_benchmarkTerrain.SetLODHysteresis( 0.0f );
+
+	for( i=0; i<iNumFrames; i++ )
+		SetFlightCamera( &path[i], i+1 );
+
+	for( j=0; j<4; j++ )
+	{
+		if( !g_benchmarkTerrain.Init( iSizes[j] ) )
+			continue;
+		g_benchmarkTerrain.SetRenderBackend( &recorder );
+
+		//the general kernel, and then the specialized ones
+		for( k=0; k<2; k++ )
+		{
+			g_benchmarkTerrain.DoSpecializedKernels( k==1 );
+			g_benchmarkTerrain.FlushPatchCache( );
+
+			iTriangles= 0;
+
+			fTime= timer.GetTime( );
+			for( i=0; i<iNumFrames; i++ )
+			{
+				g_benchmarkTerrain.Update( path[i] );
+
+				recorder.ResetStats( );
+				g_benchmarkTerrain.Render( );
+
+				iTriangles+= recorder.GetNumTriangles( );
+			}
+			fTime= ( timer.GetTime( )-fTime )/iNumFrames;
+
+			g_log.Write( LOG_PLAINTEXT, "513x513, %dx%d patches, %s kernel: %.3f ms per frame, %d triangles per frame",
+						 iSizes[j], iSizes[j], k ? "specialized" : "general", fTime, iTriangles/iNumFrames );
+		}
+
+		g_benchmarkTerrain.SetRenderBackend( NULL );
+	}
+
+	g_benchmarkTerrain.DoSpecializedKernels( true );
+	g_log.Write( LOG_PLAINTEXT, "513x513, calibrated patch size: %d", g_benchmarkTerrain.CalibratePatchSize( path, iNumFrames ) );
+
+	g_benchmarkTerrain.Shutdown( );
+	g_benchmarkTerrain.UnloadLightMap( );
+	g_benchmarkTerrain.UnloadHeightMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			RunBenchmarks - global
+// Description:		Run all of the benchmarks
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void RunBenchmarks( void )
+{
+	BenchmarkTextureCompression( );
+	BenchmarkShadowedLighting( );
+	BenchmarkHorizonMaps( );
+	BenchmarkAmbientOcclusion( );
+	BenchmarkTerrainUpdate( );
+	BenchmarkTerrainRendering( );
+	BenchmarkGeomorphing( );
+	BenchmarkPatchCache( );
+	BenchmarkClipmaps( );
+	BenchmarkChunkLOD( );
+	BenchmarkPatchMerging( );
+	BenchmarkPatchSizes( );
+}
@@ -0,0 +1,36 @@
+//==============================================================
+//==============================================================
+//= benchmark.h ================================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= demo8_12: timing runs for the engine's heavy lifting.  Run =
+//= the demo with "-benchmark" on the command line, and the	   =
+//= results end up in the program log.						   =
+//==============================================================
+//==============================================================
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DECLARATIONS -----------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+void BenchmarkTextureCompression( void );
+void BenchmarkShadowedLighting( void );
+void BenchmarkHorizonMaps( void );
+void BenchmarkAmbientOcclusion( void );
+void BenchmarkTerrainUpdate( void );
+void BenchmarkTerrainRendering( void );
+void BenchmarkGeomorphing( void );
+void BenchmarkPatchCache( void );
+void BenchmarkClipmaps( void );
+void BenchmarkChunkLOD( void );
+void BenchmarkPatchMerging( void );
+void BenchmarkPatchSizes( void );
+
+void RunBenchmarks( void );
+
+
+#endif	//__BENCHMARK_H__
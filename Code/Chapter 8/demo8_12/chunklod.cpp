@@ -0,0 +1,1055 @@
+//==============================================================
+//==============================================================
+//= chunklod.cpp ===============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= This file (along with chunklod.h) contains all of the	   =
+//= information for the chunked level of detail terrain		   =
+//= component.												   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <stdio.h>
+
+#include "../Base Code/gl_app.h"
+
+#include "chunklod.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::Build - public
+// Description:		Build the chunk quadtree for the terrain, and save
+//					it.  Each chunk covers a square of the terrain with
+//					the same number of cells on a side (so the root's
+//					cells are the biggest), simplified down to the
+//					vertices that are needed for its error threshold
+//					(which doubles with every level up from the leaves).
+//					The vertices are saved ready to draw, lighting and fog
+//					included, so the terrain's scale, lighting and fog
+//					need to be set up first.
+// Arguments:		-szFilename: the file to save the chunks to
+//					-iChunkCells: the cells on a side of each chunk (a power
+//								  of two)
+//					-fLeafError: the leaves' error threshold (height map
+//								 units)
+// Return Value:	A boolean value: -true: the chunks were built
+//									 -false: the chunks were not built
+//--------------------------------------------------------------
+bool CCHUNKLOD::Build( char* szFilename, int iChunkCells, float fLeafError )
+{
+	SCHUNK_FILE_HEADER header;
+	SCHUNK_NODE* pNodes;
+	SCHUNK_NODE* pNode;
+	SCHUNK_MESH mesh;
+	SBACKEND_VERTEX* pVertices;
+	FILE* pFile;
+	BAKE_KEY key;
+	float* fpErrors;
+	float fError, fSkirtDepth;
+	float fThreshold;
+	unsigned int uiOffset;
+	bool bWritten;
+	int iNumCells= m_iSize-1;
+	int iNode, iChild;
+	int iDepth, iMaxDepth;
+	int iNumNodes;
+	int x, z;
+	int i, j;
+
+	if( m_iSize==0 )
+		return false;
+
+	if( ( iNumCells & ( iNumCells-1 ) )!=0 || iChunkCells<2 || ( iChunkCells & ( iChunkCells-1 ) )!=0 )
+	{
+		g_log.Write( LOG_FAILURE, "Chunked LOD needs a height map and chunks that are a power of two cells on a side" );
+		return false;
+	}
+
+	if( iChunkCells>iNumCells )
+		iChunkCells= iNumCells;
+
+	//the depth of the quadtree (the leaves are at the height map's resolution)
+	iMaxDepth= 0;
+	while( ( iChunkCells<<iMaxDepth )<iNumCells )
+		iMaxDepth++;
+
+	if( iMaxDepth>CHUNK_MAX_DEPTH )
+	{
+		g_log.Write( LOG_FAILURE, "Chunked LOD: %d cell chunks are too small for a %dx%d height map", iChunkCells, m_iSize, m_iSize );
+		return false;
+	}
+
+	iNumNodes= ( ( 1<<( ( iMaxDepth+1 )*2 ) )-1 )/3;
+
+	m_fpVertexErrors= new float [SQR( m_iSize )];
+	pNodes			= new SCHUNK_NODE [iNumNodes];
+	fpErrors		= new float [iNumNodes];
+	pVertices		= new SBACKEND_VERTEX [( iChunkCells+1 )*( iChunkCells+1 )+4*iChunkCells];
+	if( m_fpVertexErrors==NULL || pNodes==NULL || fpErrors==NULL || pVertices==NULL || !AllocMesh( &mesh, iChunkCells ) )
+	{
+		delete[] m_fpVertexErrors;
+		delete[] pNodes;
+		delete[] fpErrors;
+		delete[] pVertices;
+		m_fpVertexErrors= NULL;
+
+		g_log.Write( LOG_FAILURE, "Could not allocate memory to build the chunks" );
+		return false;
+	}
+
+	//work out how far off every vertex of the height map is from the
+	//triangle that it splits, from the finest triangles up (the finest
+	//ones split a cell's diagonal, which has no vertex in the middle)
+	memset( m_fpVertexErrors, 0, SQR( m_iSize )*sizeof( float ) );
+
+	i= 0;
+	while( ( 1<<i )<iNumCells )
+		i++;
+
+	for( iDepth=i*2-1; iDepth>=0; iDepth-- )
+	{
+		SaturateErrors( iNumCells, 0, 0, 0, iNumCells, iNumCells, 0, iDepth );
+		SaturateErrors( 0, iNumCells, iNumCells, iNumCells, 0, 0, 0, iDepth );
+	}
+
+	//simplify every chunk, and measure how far off it is from the height map
+	for( iDepth=0; iDepth<=iMaxDepth; iDepth++ )
+	{
+		fThreshold= fLeafError*( 1<<( iMaxDepth-iDepth ) );
+
+		for( z=0; z<( 1<<iDepth ); z++ )
+		{
+			for( x=0; x<( 1<<iDepth ); x++ )
+			{
+				TessellateChunk( &mesh, iDepth, x, z, iChunkCells, fThreshold );
+				fpErrors[GetNodeIndex( iDepth, x, z )]= MeasureError( &mesh );
+			}
+		}
+	}
+
+	//a chunk is never more accurate than its children (so that a chunk
+	//that is good enough always has children that are good enough)
+	for( iDepth=iMaxDepth-1; iDepth>=0; iDepth-- )
+	{
+		for( z=0; z<( 1<<iDepth ); z++ )
+		{
+			for( x=0; x<( 1<<iDepth ); x++ )
+			{
+				iNode= GetNodeIndex( iDepth, x, z );
+
+				for( i=0; i<4; i++ )
+				{
+					iChild= GetNodeIndex( iDepth+1, x*2+( i & 1 ), z*2+( i>>1 ) );
+					if( fpErrors[iChild]>fpErrors[iNode] )
+						fpErrors[iNode]= fpErrors[iChild];
+				}
+			}
+		}
+	}
+
+	pFile= fopen( szFilename, "wb" );
+	if( pFile==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not create the chunk file %s", szFilename );
+		bWritten= false;
+	}
+
+	else
+	{
+		memset( &header, 0, sizeof( SCHUNK_FILE_HEADER ) );
+		memset( pNodes, 0, iNumNodes*sizeof( SCHUNK_NODE ) );
+
+		//leave room for the header and the nodes, which are written once
+		//the meshes' offsets are known
+		bWritten= ( fwrite( &header, sizeof( SCHUNK_FILE_HEADER ), 1, pFile )==1 &&
+					fwrite( pNodes, sizeof( SCHUNK_NODE ), iNumNodes, pFile )==( size_t )iNumNodes );
+		uiOffset= sizeof( SCHUNK_FILE_HEADER )+iNumNodes*sizeof( SCHUNK_NODE );
+
+		//the gap between two chunks' edges is never bigger than the coarser
+		//chunk's error, and the root's error is the biggest of them all
+		//(the neighbors can be any number of levels apart), so every skirt
+		//reaches down that far
+		fSkirtDepth= fpErrors[0]+1.0f;
+
+		for( iDepth=0; iDepth<=iMaxDepth && bWritten; iDepth++ )
+		{
+			fThreshold= fLeafError*( 1<<( iMaxDepth-iDepth ) );
+
+			for( z=0; z<( 1<<iDepth ) && bWritten; z++ )
+			{
+				for( x=0; x<( 1<<iDepth ) && bWritten; x++ )
+				{
+					iNode = GetNodeIndex( iDepth, x, z );
+					pNode = &pNodes[iNode];
+					fError= fpErrors[iNode];
+
+					TessellateChunk( &mesh, iDepth, x, z, iChunkCells, fThreshold );
+					AddSkirts( &mesh );
+
+					for( i=0; i<mesh.m_iNumVertices; i++ )
+					{
+						FillVertex( &pVertices[i], mesh.m_ipVertices[i*2], mesh.m_ipVertices[( i*2 )+1],
+									( i<mesh.m_iNumSurfaceVertices ) ? 0.0f : fSkirtDepth );
+
+						for( j=0; j<3; j++ )
+						{
+							if( i==0 || pVertices[i].m_fPosition[j]<pNode->m_fMin[j] )
+								pNode->m_fMin[j]= pVertices[i].m_fPosition[j];
+							if( i==0 || pVertices[i].m_fPosition[j]>pNode->m_fMax[j] )
+								pNode->m_fMax[j]= pVertices[i].m_fPosition[j];
+						}
+					}
+
+					pNode->m_fError		   = fError*( float )fabs( m_vecScale[1] );
+					pNode->m_uiVertexOffset= uiOffset;
+					pNode->m_iNumVertices  = mesh.m_iNumVertices;
+					uiOffset			  += mesh.m_iNumVertices*sizeof( SBACKEND_VERTEX );
+					pNode->m_uiIndexOffset = uiOffset;
+					pNode->m_iNumIndices   = mesh.m_iNumIndices;
+					uiOffset			  += mesh.m_iNumIndices*sizeof( unsigned int );
+
+					bWritten= ( fwrite( pVertices, sizeof( SBACKEND_VERTEX ), mesh.m_iNumVertices, pFile )==( size_t )mesh.m_iNumVertices &&
+								fwrite( mesh.m_uipIndices, sizeof( unsigned int ), mesh.m_iNumIndices, pFile )==( size_t )mesh.m_iNumIndices );
+				}
+			}
+		}
+
+		key= GetBuildKey( );
+
+		header.m_uiMagic	= CHUNK_FILE_MAGIC;
+		header.m_uiVersion	= CHUNK_FILE_VERSION;
+		header.m_uiKeyLow	= ( unsigned int )key;
+		header.m_uiKeyHigh	= ( unsigned int )( key>>32 );
+		header.m_iMapSize	= m_iSize;
+		header.m_iChunkCells= iChunkCells;
+		header.m_iDepth		= iMaxDepth;
+		header.m_iNumNodes	= iNumNodes;
+		header.m_iFormat	= ( HasNormals( ) ? BACKEND_NORMAL : 0 ) | ( m_fFogDepth>0.0f ? BACKEND_FOGCOORD : 0 );
+		header.m_uiFileSize = uiOffset;
+
+		if( bWritten )
+		{
+			bWritten= ( fseek( pFile, 0, SEEK_SET )==0 &&
+						fwrite( &header, sizeof( SCHUNK_FILE_HEADER ), 1, pFile )==1 &&
+						fwrite( pNodes, sizeof( SCHUNK_NODE ), iNumNodes, pFile )==( size_t )iNumNodes );
+		}
+
+		fclose( pFile );
+
+		if( !bWritten )
+		{
+			DeleteFile( szFilename );
+			g_log.Write( LOG_FAILURE, "Could not write the chunk file %s", szFilename );
+		}
+
+		else
+		{
+			g_log.Write( LOG_SUCCESS, "Built %d chunks (%d levels of %dx%d cells) into %s: %u KB, root error %.2f, leaf error %.2f",
+						 iNumNodes, iMaxDepth+1, iChunkCells, iChunkCells, szFilename, uiOffset/1024,
+						 pNodes[0].m_fError, pNodes[iNumNodes-1].m_fError );
+		}
+	}
+
+	FreeMesh( &mesh );
+	delete[] pVertices;
+	delete[] fpErrors;
+	delete[] pNodes;
+	delete[] m_fpVertexErrors;
+	m_fpVertexErrors= NULL;
+
+	return bWritten;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::GetBuildKey - private
+// Description:		Hash everything that gets baked into the chunks, so
+//					that an out of date chunk file can be spotted
+// Arguments:		None
+// Return Value:	A BAKE_KEY value: the hash
+//--------------------------------------------------------------
+BAKE_KEY CCHUNKLOD::GetBuildKey( void )
+{
+	BAKE_KEY key;
+
+	key= CBAKE_CACHE::HashBegin( "chunk lod" );
+	key= CBAKE_CACHE::HashInt( key, m_iSize );
+	key= CBAKE_CACHE::Hash( key, m_heightData.m_ucpData, SQR( m_iSize ) );
+	if( m_lightmap.m_ucpData )
+		key= CBAKE_CACHE::Hash( key, m_lightmap.m_ucpData, SQR( m_lightmap.m_iSize ) );
+
+	key= CBAKE_CACHE::HashFloat( key, m_vecScale[0] );
+	key= CBAKE_CACHE::HashFloat( key, m_vecScale[1] );
+	key= CBAKE_CACHE::HashFloat( key, m_vecScale[2] );
+	key= CBAKE_CACHE::HashFloat( key, m_vecLightColor[0] );
+	key= CBAKE_CACHE::HashFloat( key, m_vecLightColor[1] );
+	key= CBAKE_CACHE::HashFloat( key, m_vecLightColor[2] );
+	key= CBAKE_CACHE::HashFloat( key, m_fFogDepth );
+	key= CBAKE_CACHE::HashInt( key, m_iRepeatDetailMap );
+	key= CBAKE_CACHE::HashInt( key, HasNormals( ) );
+
+	return key;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::SaturateErrors - private
+// Description:		Walk the triangle bintree down to a depth, and work
+//					out the error of the vertex that splits each triangle
+//					there (how far it is from the middle of the
+//					triangle's long edge).  Each vertex also takes on the
+//					errors of the two vertices that split its children,
+//					so that a vertex that is needed always has all of the
+//					vertices that it depends on (the meshes never crack).
+//					The deeper levels need to be done first.
+// Arguments:		-ax, az: the triangle's right-angled corner
+//					-lx, lz, rx, rz: the ends of its long edge
+//					-iDepth: the triangle's depth in the bintree
+//					-iTargetDepth: the depth to work on
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::SaturateErrors( int ax, int az, int lx, int lz, int rx, int rz, int iDepth, int iTargetDepth )
+{
+	float fError;
+	int mx, mz;
+
+	//the finest triangles have nothing in the middle of their long edge
+	if( ( ( lx+rx ) & 1 ) || ( ( lz+rz ) & 1 ) )
+		return;
+
+	mx= ( lx+rx )/2;
+	mz= ( lz+rz )/2;
+
+	if( iDepth<iTargetDepth )
+	{
+		SaturateErrors( mx, mz, ax, az, lx, lz, iDepth+1, iTargetDepth );
+		SaturateErrors( mx, mz, rx, rz, ax, az, iDepth+1, iTargetDepth );
+		return;
+	}
+
+	fError= ( float )fabs( GetTrueHeightAtPoint( mx, mz )-( GetTrueHeightAtPoint( lx, lz )+GetTrueHeightAtPoint( rx, rz ) )*0.5f );
+
+	if( !( ( ax+lx ) & 1 ) && !( ( az+lz ) & 1 ) )
+	{
+		fError= MAX( fError, GetVertexError( ( ax+lx )/2, ( az+lz )/2 ) );
+		fError= MAX( fError, GetVertexError( ( ax+rx )/2, ( az+rz )/2 ) );
+	}
+
+	if( fError>GetVertexError( mx, mz ) )
+		m_fpVertexErrors[( mz*m_iSize )+mx]= fError;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::AllocMesh - private
+// Description:		Allocate the memory to build a chunk's mesh in
+// Arguments:		-pMesh: the mesh
+//					-iChunkCells: the cells on a side of each chunk
+// Return Value:	A boolean value: -true: the memory was allocated
+//									 -false: out of memory
+//--------------------------------------------------------------
+bool CCHUNKLOD::AllocMesh( SCHUNK_MESH* pMesh, int iChunkCells )
+{
+	memset( pMesh, 0, sizeof( SCHUNK_MESH ) );
+
+	//every grid point and a skirt vertex for each one along the edges, and
+	//two triangles for every cell and every edge of the chunk's border
+	pMesh->m_ipVertexMap= new int [( iChunkCells+1 )*( iChunkCells+1 )];
+	pMesh->m_ipSkirtMap = new int [( iChunkCells+1 )*( iChunkCells+1 )];
+	pMesh->m_ipVertices = new int [( ( iChunkCells+1 )*( iChunkCells+1 )+4*iChunkCells )*2];
+	pMesh->m_uipIndices = new unsigned int [iChunkCells*iChunkCells*6+4*iChunkCells*6];
+
+	if( pMesh->m_ipVertexMap==NULL || pMesh->m_ipSkirtMap==NULL || pMesh->m_ipVertices==NULL || pMesh->m_uipIndices==NULL )
+	{
+		FreeMesh( pMesh );
+		return false;
+	}
+
+	pMesh->m_iChunkCells= iChunkCells;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::FreeMesh - private
+// Description:		Free a mesh's memory
+// Arguments:		-pMesh: the mesh
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::FreeMesh( SCHUNK_MESH* pMesh )
+{
+	delete[] pMesh->m_ipVertexMap;
+	delete[] pMesh->m_ipSkirtMap;
+	delete[] pMesh->m_ipVertices;
+	delete[] pMesh->m_uipIndices;
+
+	memset( pMesh, 0, sizeof( SCHUNK_MESH ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::TessellateChunk - private
+// Description:		Build a chunk's simplified mesh: the bintree's
+//					triangles over the chunk, split wherever the vertex
+//					in the middle of the long edge has a bigger error than
+//					the chunk's threshold (down to the chunk's grid spacing)
+// Arguments:		-pMesh: the mesh to build
+//					-iDepth: the chunk's level in the quadtree
+//					-x, z: the chunk's position in its level
+//					-iChunkCells: the cells on a side of each chunk
+//					-fThreshold: the chunk's error threshold (height map units)
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::TessellateChunk( SCHUNK_MESH* pMesh, int iDepth, int x, int z, int iChunkCells, float fThreshold )
+{
+	int iNumCells= m_iSize-1;
+
+	pMesh->m_iWidth		= iNumCells>>iDepth;
+	pMesh->m_iMinX		= x*pMesh->m_iWidth;
+	pMesh->m_iMinZ		= z*pMesh->m_iWidth;
+	pMesh->m_iStride	= pMesh->m_iWidth/iChunkCells;
+	pMesh->m_fThreshold	= fThreshold;
+	pMesh->m_iNumVertices= 0;
+	pMesh->m_iNumIndices = 0;
+
+	memset( pMesh->m_ipVertexMap, 0xFF, ( iChunkCells+1 )*( iChunkCells+1 )*sizeof( int ) );
+
+	//the chunk is made of two of the bintree's triangles (two levels of
+	//the bintree for every level of the quadtree)
+	AddTriangle( pMesh, iNumCells, 0, 0, 0, iNumCells, iNumCells, 0, iDepth*2 );
+	AddTriangle( pMesh, 0, iNumCells, iNumCells, iNumCells, 0, 0, 0, iDepth*2 );
+
+	pMesh->m_iNumSurfaceVertices= pMesh->m_iNumVertices;
+	pMesh->m_iNumSurfaceIndices = pMesh->m_iNumIndices;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::AddTriangle - private
+// Description:		Add one of the bintree's triangles to a chunk's mesh
+//					(split down until it is inside of the chunk, and then
+//					until it is accurate enough)
+// Arguments:		-pMesh: the mesh
+//					-ax, az: the triangle's right-angled corner
+//					-lx, lz, rx, rz: the ends of its long edge
+//					-iDepth: the triangle's depth in the bintree
+//					-iChunkDepth: the depth of the chunk's two triangles
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::AddTriangle( SCHUNK_MESH* pMesh, int ax, int az, int lx, int lz, int rx, int rz, int iDepth, int iChunkDepth )
+{
+	unsigned int* uipIndex;
+	bool bSplit;
+	int mx, mz;
+
+	//the triangles above the chunk's level are bigger than it, so only the
+	//ones that overlap it are split
+	if( MAX( MAX( ax, lx ), rx )<=pMesh->m_iMinX || MIN( MIN( ax, lx ), rx )>=pMesh->m_iMinX+pMesh->m_iWidth ||
+		MAX( MAX( az, lz ), rz )<=pMesh->m_iMinZ || MIN( MIN( az, lz ), rz )>=pMesh->m_iMinZ+pMesh->m_iWidth )
+		return;
+
+	mx= ( lx+rx )/2;
+	mz= ( lz+rz )/2;
+
+	if( iDepth<iChunkDepth )
+		bSplit= true;
+
+	//split if the middle of the long edge is on the chunk's grid, and it
+	//needs to be there
+	else
+	{
+		bSplit= !( ( lx+rx ) & 1 ) && !( ( lz+rz ) & 1 ) &&
+				( mx-pMesh->m_iMinX )%pMesh->m_iStride==0 && ( mz-pMesh->m_iMinZ )%pMesh->m_iStride==0 &&
+				GetVertexError( mx, mz )>pMesh->m_fThreshold;
+	}
+
+	if( bSplit )
+	{
+		AddTriangle( pMesh, mx, mz, ax, az, lx, lz, iDepth+1, iChunkDepth );
+		AddTriangle( pMesh, mx, mz, rx, rz, ax, az, iDepth+1, iChunkDepth );
+		return;
+	}
+
+	//counter-clockwise, seen from above (like all of the other meshes)
+	uipIndex= &pMesh->m_uipIndices[pMesh->m_iNumIndices];
+	uipIndex[0]= AddVertex( pMesh, ax, az );
+	if( ( lz-az )*( rx-ax )-( lx-ax )*( rz-az )>0 )
+	{
+		uipIndex[1]= AddVertex( pMesh, lx, lz );
+		uipIndex[2]= AddVertex( pMesh, rx, rz );
+	}
+	else
+	{
+		uipIndex[1]= AddVertex( pMesh, rx, rz );
+		uipIndex[2]= AddVertex( pMesh, lx, lz );
+	}
+
+	pMesh->m_iNumIndices+= 3;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::AddVertex - private
+// Description:		Find one of the chunk's grid points in its mesh (it
+//					is added to the mesh if it isn't there yet)
+// Arguments:		-pMesh: the mesh
+//					-x, z: the point (height map coordinates)
+// Return Value:	An integer value: the vertex's number in the mesh
+//--------------------------------------------------------------
+int CCHUNKLOD::AddVertex( SCHUNK_MESH* pMesh, int x, int z )
+{
+	int iPoint;
+
+	iPoint= ( ( ( z-pMesh->m_iMinZ )/pMesh->m_iStride )*( pMesh->m_iChunkCells+1 ) )+( x-pMesh->m_iMinX )/pMesh->m_iStride;
+
+	if( pMesh->m_ipVertexMap[iPoint]<0 )
+	{
+		pMesh->m_ipVertices[pMesh->m_iNumVertices*2]	= x;
+		pMesh->m_ipVertices[( pMesh->m_iNumVertices*2 )+1]= z;
+		pMesh->m_ipVertexMap[iPoint]= pMesh->m_iNumVertices++;
+	}
+
+	return pMesh->m_ipVertexMap[iPoint];
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::AddSkirts - private
+// Description:		Hang a skirt (a strip of triangles going straight
+//					down) from every edge of a chunk's mesh that is on
+//					the chunk's border, to hide the cracks to neighbors
+//					that are at another level of detail (the skirt's
+//					bottom vertices are lowered when they are filled in)
+// Arguments:		-pMesh: the mesh
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::AddSkirts( SCHUNK_MESH* pMesh )
+{
+	unsigned int* uipIndex;
+	int iMaxX= pMesh->m_iMinX+pMesh->m_iWidth;
+	int iMaxZ= pMesh->m_iMinZ+pMesh->m_iWidth;
+	int iPoint[2];
+	int iSkirt[2];
+	int p, q;
+	int px, pz;
+	int qx, qz;
+	int i, j;
+
+	memset( pMesh->m_ipSkirtMap, 0xFF, ( pMesh->m_iChunkCells+1 )*( pMesh->m_iChunkCells+1 )*sizeof( int ) );
+
+	for( i=0; i<pMesh->m_iNumSurfaceIndices; i++ )
+	{
+		//the triangle's edge from p to q
+		p = pMesh->m_uipIndices[i];
+		q = pMesh->m_uipIndices[( i%3==2 ) ? i-2 : i+1];
+		px= pMesh->m_ipVertices[p*2];
+		pz= pMesh->m_ipVertices[( p*2 )+1];
+		qx= pMesh->m_ipVertices[q*2];
+		qz= pMesh->m_ipVertices[( q*2 )+1];
+
+		if( !( px==qx && ( px==pMesh->m_iMinX || px==iMaxX ) ) &&
+			!( pz==qz && ( pz==pMesh->m_iMinZ || pz==iMaxZ ) ) )
+			continue;
+
+		//a copy of each end, for the bottom of the skirt
+		iPoint[0]= ( ( ( pz-pMesh->m_iMinZ )/pMesh->m_iStride )*( pMesh->m_iChunkCells+1 ) )+( px-pMesh->m_iMinX )/pMesh->m_iStride;
+		iPoint[1]= ( ( ( qz-pMesh->m_iMinZ )/pMesh->m_iStride )*( pMesh->m_iChunkCells+1 ) )+( qx-pMesh->m_iMinX )/pMesh->m_iStride;
+
+		for( j=0; j<2; j++ )
+		{
+			if( pMesh->m_ipSkirtMap[iPoint[j]]<0 )
+			{
+				pMesh->m_ipVertices[pMesh->m_iNumVertices*2]	  = j ? qx : px;
+				pMesh->m_ipVertices[( pMesh->m_iNumVertices*2 )+1]= j ? qz : pz;
+				pMesh->m_ipSkirtMap[iPoint[j]]= pMesh->m_iNumVertices++;
+			}
+
+			iSkirt[j]= pMesh->m_ipSkirtMap[iPoint[j]];
+		}
+
+		//the edge runs with the chunk on its left (seen from above), so the
+		//skirt faces out of the chunk when it runs the other way
+		uipIndex= &pMesh->m_uipIndices[pMesh->m_iNumIndices];
+		uipIndex[0]= q;
+		uipIndex[1]= p;
+		uipIndex[2]= iSkirt[0];
+
+		uipIndex[3]= q;
+		uipIndex[4]= iSkirt[0];
+		uipIndex[5]= iSkirt[1];
+
+		pMesh->m_iNumIndices+= 6;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::MeasureError - private
+// Description:		Find the most that a chunk's mesh is off by, at any
+//					of the height map's points under it
+// Arguments:		-pMesh: the mesh (without its skirts)
+// Return Value:	A float value: the error (height map units)
+//--------------------------------------------------------------
+float CCHUNKLOD::MeasureError( SCHUNK_MESH* pMesh )
+{
+	float fMaxError= 0.0f;
+	float fHeight;
+	float fError;
+	float h[3];
+	int v[3][2];
+	int iMinX, iMaxX;
+	int iMinZ, iMaxZ;
+	int iArea;
+	int w0, w1, w2;
+	int i, j;
+	int x, z;
+
+	for( i=0; i<pMesh->m_iNumSurfaceIndices; i+= 3 )
+	{
+		for( j=0; j<3; j++ )
+		{
+			v[j][0]= pMesh->m_ipVertices[pMesh->m_uipIndices[i+j]*2];
+			v[j][1]= pMesh->m_ipVertices[( pMesh->m_uipIndices[i+j]*2 )+1];
+			h[j]   = GetTrueHeightAtPoint( v[j][0], v[j][1] );
+		}
+
+		iMinX= MIN( MIN( v[0][0], v[1][0] ), v[2][0] );
+		iMaxX= MAX( MAX( v[0][0], v[1][0] ), v[2][0] );
+		iMinZ= MIN( MIN( v[0][1], v[1][1] ), v[2][1] );
+		iMaxZ= MAX( MAX( v[0][1], v[1][1] ), v[2][1] );
+
+		//twice the triangle's area (the triangles are counter-clockwise)
+		iArea= ( v[1][1]-v[0][1] )*( v[2][0]-v[0][0] )-( v[1][0]-v[0][0] )*( v[2][1]-v[0][1] );
+
+		//the height map's points inside of the triangle (or on its edges)
+		for( z=iMinZ; z<=iMaxZ; z++ )
+		{
+			for( x=iMinX; x<=iMaxX; x++ )
+			{
+				w0= ( v[2][1]-v[1][1] )*( x-v[1][0] )-( v[2][0]-v[1][0] )*( z-v[1][1] );
+				w1= ( v[0][1]-v[2][1] )*( x-v[2][0] )-( v[0][0]-v[2][0] )*( z-v[2][1] );
+				w2= iArea-w0-w1;
+				if( w0<0 || w1<0 || w2<0 )
+					continue;
+
+				fHeight= ( w0*h[0]+w1*h[1]+w2*h[2] )/iArea;
+				fError = ( float )fabs( GetTrueHeightAtPoint( x, z )-fHeight );
+				if( fError>fMaxError )
+					fMaxError= fError;
+			}
+		}
+	}
+
+	return fMaxError;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::FillVertex - private
+// Description:		Fill a vertex in, ready to be drawn (with the
+//					terrain's scale, lighting and fog baked in)
+// Arguments:		-pVertex: the vertex
+//					-x, z: the height map point under the vertex
+//					-fDrop: how far below the point the vertex is (for
+//							the bottom of a skirt, in height map units)
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::FillVertex( SBACKEND_VERTEX* pVertex, int x, int z, float fDrop )
+{
+	float fTexScale= 1.0f/m_iSize;
+	unsigned char ucBrightness;
+
+	memset( pVertex, 0, sizeof( SBACKEND_VERTEX ) );
+
+	pVertex->m_fPosition[0]= x*m_vecScale[0];
+	pVertex->m_fPosition[1]= ( GetTrueHeightAtPoint( x, z )-fDrop )*m_vecScale[1];
+	pVertex->m_fPosition[2]= z*m_vecScale[2];
+
+	if( HasNormals( ) )
+		GetNormalAtPoint( x, z, pVertex->m_fNormal );
+
+	pVertex->m_fTexCoord0[0]= x*fTexScale;
+	pVertex->m_fTexCoord0[1]= z*fTexScale;
+	pVertex->m_fTexCoord1[0]= pVertex->m_fTexCoord0[0]*m_iRepeatDetailMap;
+	pVertex->m_fTexCoord1[1]= pVertex->m_fTexCoord0[1]*m_iRepeatDetailMap;
+
+	ucBrightness= m_lightmap.m_ucpData ? GetBrightnessAtPoint( x, z ) : 255;
+	pVertex->m_ucColor[0]= ( unsigned char )( ucBrightness*m_vecLightColor[0] );
+	pVertex->m_ucColor[1]= ( unsigned char )( ucBrightness*m_vecLightColor[1] );
+	pVertex->m_ucColor[2]= ( unsigned char )( ucBrightness*m_vecLightColor[2] );
+	pVertex->m_ucColor[3]= 255;
+
+	if( m_fFogDepth>0.0f )
+		pVertex->m_fFogCoord= GetFogCoord( pVertex->m_fPosition[1] );
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::Init - public
+// Description:		Map a chunk file into memory, so that its chunks
+//					can be drawn straight out of it (the pages of the
+//					file are only read in when a chunk is drawn)
+// Arguments:		-szFilename: the chunk file
+// Return Value:	A boolean value: -true: the file was mapped
+//									 -false: no file, or a stale one
+//--------------------------------------------------------------
+bool CCHUNKLOD::Init( char* szFilename )
+{
+	SCHUNK_FILE_HEADER* pHeader;
+	SCHUNK_NODE* pNodes;
+	unsigned int uiFileSize= 0;
+	BAKE_KEY key;
+	int i;
+
+	if( m_pHeader )
+		Shutdown( );
+
+	m_hFile= CreateFile( szFilename, GENERIC_READ, FILE_SHARE_READ, NULL,
+						 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( m_hFile==INVALID_HANDLE_VALUE )
+	{
+		m_hFile= NULL;
+
+		g_log.Write( LOG_FAILURE, "Could not open the chunk file %s", szFilename );
+		return false;
+	}
+
+	uiFileSize= ::GetFileSize( m_hFile, NULL );
+	if( uiFileSize>=sizeof( SCHUNK_FILE_HEADER ) )
+	{
+		m_hMapping= CreateFileMapping( m_hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+		if( m_hMapping )
+			m_ucpView= ( unsigned char* )MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+	}
+
+	//make sure that the file is a whole chunk file
+	pHeader= ( SCHUNK_FILE_HEADER* )m_ucpView;
+	if( pHeader==NULL ||
+		pHeader->m_uiMagic!=CHUNK_FILE_MAGIC || pHeader->m_uiVersion!=CHUNK_FILE_VERSION ||
+		pHeader->m_uiFileSize!=uiFileSize || pHeader->m_iDepth<0 || pHeader->m_iDepth>CHUNK_MAX_DEPTH ||
+		pHeader->m_iNumNodes!=( ( 1<<( ( pHeader->m_iDepth+1 )*2 ) )-1 )/3 )
+	{
+		Shutdown( );
+
+		g_log.Write( LOG_FAILURE, "%s is not a chunk file (or it is from an old version)", szFilename );
+		return false;
+	}
+
+	//the chunks are drawn straight out of the mapping, so every one of
+	//their meshes has to be inside the file (or a truncated file would
+	//have us reading past the end of it)
+	pNodes= ( SCHUNK_NODE* )( m_ucpView+sizeof( SCHUNK_FILE_HEADER ) );
+	if( ( uiFileSize-sizeof( SCHUNK_FILE_HEADER ) )/sizeof( SCHUNK_NODE )<( unsigned int )pHeader->m_iNumNodes )
+	{
+		Shutdown( );
+
+		g_log.Write( LOG_FAILURE, "The chunk file %s is truncated", szFilename );
+		return false;
+	}
+
+	for( i=0; i<pHeader->m_iNumNodes; i++ )
+	{
+		if( pNodes[i].m_iNumVertices<0 || pNodes[i].m_iNumIndices<0 ||
+			pNodes[i].m_uiVertexOffset>uiFileSize || pNodes[i].m_uiIndexOffset>uiFileSize ||
+			( uiFileSize-pNodes[i].m_uiVertexOffset )/sizeof( SBACKEND_VERTEX )<( unsigned int )pNodes[i].m_iNumVertices ||
+			( uiFileSize-pNodes[i].m_uiIndexOffset )/sizeof( unsigned int )<( unsigned int )pNodes[i].m_iNumIndices )
+		{
+			Shutdown( );
+
+			g_log.Write( LOG_FAILURE, "The chunk file %s is truncated or corrupt (chunk %d is out of bounds)", szFilename, i );
+			return false;
+		}
+	}
+
+	//if the terrain that it was built from is loaded, make sure that
+	//nothing has changed since it was built
+	if( m_heightData.m_ucpData )
+	{
+		key= GetBuildKey( );
+
+		if( pHeader->m_iMapSize!=m_iSize ||
+			pHeader->m_uiKeyLow!=( unsigned int )key || pHeader->m_uiKeyHigh!=( unsigned int )( key>>32 ) )
+		{
+			Shutdown( );
+
+			g_log.Write( LOG_FAILURE, "The chunk file %s is out of date", szFilename );
+			return false;
+		}
+	}
+
+	m_ipSelected= new int [pHeader->m_iNumNodes];
+	if( m_ipSelected==NULL )
+	{
+		Shutdown( );
+
+		g_log.Write( LOG_FAILURE, "Could not allocate memory for the chunked LOD system" );
+		return false;
+	}
+
+	m_pHeader	 = pHeader;
+	m_pNodes	 = pNodes;
+	m_iNumSelected= 0;
+
+	g_log.Write( LOG_SUCCESS, "Chunked LOD system successfully initialized: %d chunks from %s (%u KB)",
+				 m_pHeader->m_iNumNodes, szFilename, uiFileSize/1024 );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::Shutdown - public
+// Description:		Unmap the chunk file
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::Shutdown( void )
+{
+	if( m_ucpView )
+		UnmapViewOfFile( m_ucpView );
+	if( m_hMapping )
+		CloseHandle( m_hMapping );
+	if( m_hFile )
+		CloseHandle( m_hFile );
+
+	delete[] m_ipSelected;
+
+	m_hFile		  = NULL;
+	m_hMapping	  = NULL;
+	m_ucpView	  = NULL;
+	m_pHeader	  = NULL;
+	m_pNodes	  = NULL;
+	m_ipSelected  = NULL;
+	m_iNumSelected= 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::Update - public
+// Description:		Pick the chunks to draw: walk the quadtree from the
+//					root, and stop at the first chunk on each branch
+//					that is accurate enough from where the camera is
+// Arguments:		-camera: the camera object your demo is using
+//					-bCullChunks: cull unseen chunks (true by default)
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::Update( CCAMERA camera, bool bCullChunks )
+{
+	m_iNumSelected = 0;
+	m_iNodesVisited= 0;
+
+	if( m_pHeader==NULL )
+		return;
+
+	SelectNode( &camera, 0, 0, 0, bCullChunks );
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::SelectNode - private
+// Description:		Pick a chunk if it is accurate enough on the screen
+//					(or it is a leaf), or else look at its children
+// Arguments:		-pCamera: the camera (with its frustum calculated)
+//					-iDepth: the chunk's level in the quadtree
+//					-x, z: the chunk's position in its level
+//					-bCull: test the chunk against the frustum (a chunk
+//							that is all of the way inside of the frustum
+//							doesn't need its children tested)
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::SelectNode( CCAMERA* pCamera, int iDepth, int x, int z, bool bCull )
+{
+	SCHUNK_NODE* pNode;
+	float fCenter[3], fHalf[3];
+	float fDistance, fRadius;
+	float fDelta[3];
+	bool bInside;
+	int i, j;
+
+	pNode= &m_pNodes[GetNodeIndex( iDepth, x, z )];
+	m_iNodesVisited++;
+
+	if( bCull )
+	{
+		for( j=0; j<3; j++ )
+		{
+			fCenter[j]= ( pNode->m_fMin[j]+pNode->m_fMax[j] )*0.5f;
+			fHalf[j]  = ( pNode->m_fMax[j]-pNode->m_fMin[j] )*0.5f;
+		}
+
+		bInside= true;
+		for( i=0; i<6; i++ )
+		{
+			fDistance= pCamera->m_viewFrustum[i][0]*fCenter[0] + pCamera->m_viewFrustum[i][1]*fCenter[1] +
+					   pCamera->m_viewFrustum[i][2]*fCenter[2] + pCamera->m_viewFrustum[i][3];
+			fRadius	 = ( float )fabs( pCamera->m_viewFrustum[i][0] )*fHalf[0]+
+					   ( float )fabs( pCamera->m_viewFrustum[i][1] )*fHalf[1]+
+					   ( float )fabs( pCamera->m_viewFrustum[i][2] )*fHalf[2];
+
+			//even the corner furthest along the normal is outside
+			if( fDistance+fRadius<=0 )
+				return;
+
+			if( fDistance-fRadius<=0 )
+				bInside= false;
+		}
+
+		if( bInside )
+			bCull= false;
+	}
+
+	//the distance from the camera to the closest point of the chunk's box
+	for( j=0; j<3; j++ )
+	{
+		fDelta[j]= 0.0f;
+		if( pCamera->m_vecEyePos[j]<pNode->m_fMin[j] )
+			fDelta[j]= pNode->m_fMin[j]-pCamera->m_vecEyePos[j];
+		else if( pCamera->m_vecEyePos[j]>pNode->m_fMax[j] )
+			fDelta[j]= pCamera->m_vecEyePos[j]-pNode->m_fMax[j];
+	}
+	fDistance= ( float )sqrt( SQR( fDelta[0] )+SQR( fDelta[1] )+SQR( fDelta[2] ) );
+
+	//the chunk's error, projected onto the screen
+	if( iDepth==m_pHeader->m_iDepth || pNode->m_fError*m_fErrorScale<=m_fPixelTolerance*fDistance )
+	{
+		m_ipSelected[m_iNumSelected++]= GetNodeIndex( iDepth, x, z );
+		return;
+	}
+
+	SelectNode( pCamera, iDepth+1, x*2,	  z*2,	 bCull );
+	SelectNode( pCamera, iDepth+1, x*2+1, z*2,	 bCull );
+	SelectNode( pCamera, iDepth+1, x*2,	  z*2+1, bCull );
+	SelectNode( pCamera, iDepth+1, x*2+1, z*2+1, bCull );
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::Render - public
+// Description:		Render the chunks that the last update picked
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::Render( void )
+{
+	bool bMultiTex;
+	int iFormat;
+
+	iFormat= PrepareMesh( &bMultiTex );
+
+	//enable back-face culling
+	m_pBackend->SetState( BACKEND_CULL_FACE, true );
+
+	//render the multitexturing terrain
+	if( bMultiTex )
+	{
+		m_pBackend->SetState( BACKEND_BLEND, false );
+
+		//bind the primary color texture to the first texture unit
+		m_pBackend->SetState( BACKEND_TEXTURE0, true );
+		m_pBackend->BindTexture( 0, m_texture.GetID( ) );
+
+		//bind the detail color texture to the second texture unit
+		m_pBackend->SetState( BACKEND_TEXTURE1, true );
+		m_pBackend->BindTexture( 1, m_detailMap.GetID( ) );
+		m_pBackend->SetCombineMode( 1, BACKEND_COMBINE_DETAIL );
+
+		//render the chunks
+		DrawMesh( iFormat );
+	}
+
+	//no hardware multitexturing available, or the user only wants to render
+	//the detail texture or the color texture
+	else
+	{
+		if( m_bTextureMapping )
+		{
+			//bind the primary color texture (FOR THE PRIMARY TEXTURE PASS)
+			m_pBackend->SetState( BACKEND_TEXTURE0, true );
+			m_pBackend->BindTexture( 0, m_texture.GetID( ) );
+
+			//render the color texture
+			DrawMesh( iFormat );
+		}
+
+		if( !( m_bTextureMapping && !m_bDetailMapping ) )
+		{
+			//if the user wants detail mapping, we need to set some things up
+			if( m_bDetailMapping )
+			{
+				//bind the detail texture
+				m_pBackend->SetState( BACKEND_TEXTURE0, true );
+				m_pBackend->BindTexture( 0, m_detailMap.GetID( ) );
+
+				//only use blending if a texture pass was made
+				if( m_bTextureMapping )
+				{
+					m_pBackend->SetState( BACKEND_BLEND, true );
+					m_pBackend->SetBlendMode( BACKEND_BLEND_MULTIPLY );
+				}
+
+				//the vertices only have the color map's texture coordinates,
+				//so the texture matrix stretches them for the detail map
+				m_pBackend->SetTextureScale( 0, ( float )m_iRepeatDetailMap );
+			}
+
+			//render either the detail map on top of the texture,
+			//only the detail map, or neither
+			DrawMesh( iFormat );
+
+			if( m_bDetailMapping )
+				m_pBackend->SetTextureScale( 0, 1.0f );
+		}
+	}
+
+	m_pBackend->SetState( BACKEND_BLEND, false );
+
+	//unbind the texture occupying the second texture unit
+	m_pBackend->SetState( BACKEND_TEXTURE1, false );
+	m_pBackend->BindTexture( 1, 0 );
+
+	//unbind the texture occupying the first texture unit
+	m_pBackend->SetState( BACKEND_TEXTURE0, false );
+	m_pBackend->BindTexture( 0, 0 );
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::PrepareMesh - private
+// Description:		Reset the frame's counters, and work out how the
+//					chunks are drawn (the vertices are drawn just as they
+//					were baked, so there is nothing else to do)
+// Arguments:		-pbMultiTex: storage for whether the chunks are drawn
+//								 in one multitextured pass
+// Return Value:	An integer value: the vertex format that the passes
+//					draw the chunks with (BACKEND_*)
+//--------------------------------------------------------------
+int CCHUNKLOD::PrepareMesh( bool* pbMultiTex )
+{
+	//reset the counting variables
+	m_iVertsPerFrame= 0;
+	m_iTrisPerFrame = 0;
+
+	*pbMultiTex= ( m_bMultitexture && m_bDetailMapping && m_bTextureMapping );
+
+	return BACKEND_COLOR | BACKEND_TEXCOORD0 | ( *pbMultiTex ? BACKEND_TEXCOORD1 : 0 ) |
+		   ( m_pHeader ? m_pHeader->m_iFormat : 0 );
+}
+
+//--------------------------------------------------------------
+// Name:			CCHUNKLOD::DrawMesh - private
+// Description:		Draw the chunks that the last update picked (for one
+//					rendering pass), straight out of the chunk file
+// Arguments:		-iFormat: the vertex attributes to draw with (BACKEND_*)
+// Return Value:	None
+//--------------------------------------------------------------
+void CCHUNKLOD::DrawMesh( int iFormat )
+{
+	SCHUNK_NODE* pNode;
+	int i;
+
+	for( i=0; i<m_iNumSelected; i++ )
+	{
+		pNode= &m_pNodes[m_ipSelected[i]];
+
+		m_pBackend->Draw( BACKEND_TRIANGLES, iFormat, ( SBACKEND_VERTEX* )( m_ucpView+pNode->m_uiVertexOffset ), pNode->m_iNumVertices,
+						  ( unsigned int* )( m_ucpView+pNode->m_uiIndexOffset ), pNode->m_iNumIndices );
+
+		m_iVertsPerFrame+= pNode->m_iNumVertices;
+		m_iTrisPerFrame += pNode->m_iNumIndices/3;
+	}
+}
@@ -0,0 +1,259 @@
+//==============================================================
+//==============================================================
+//= chunklod.h =================================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= This file (along with chunklod.cpp) contains all of the	   =
+//= information for the chunked level of detail terrain		   =
+//= component: a quadtree of meshes that are simplified ahead  =
+//= of time, saved into one file, and drawn straight out of it =
+//==============================================================
+//==============================================================
+#ifndef __CHUNKLOD_H__
+#define __CHUNKLOD_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <windows.h>
+
+#include "terrain.h"
+
+#include "../Base Code/bake_cache.h"
+#include "../Base Code/camera.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#define CHUNK_FILE_MAGIC   0x4B4E4843		//"CHNK"
+
+//bump this whenever the layout of the chunk file changes
+#define CHUNK_FILE_VERSION 1
+
+#define CHUNK_DEFAULT_CELLS		32		//cells on a side of each chunk
+#define CHUNK_DEFAULT_ERROR		1.0f	//the leaves' simplification error (height map units)
+#define CHUNK_DEFAULT_TOLERANCE 2.0f	//pixels
+
+#define CHUNK_MAX_DEPTH 10
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+struct SCHUNK_FILE_HEADER
+{
+	unsigned int m_uiMagic;
+	unsigned int m_uiVersion;
+
+	//a hash of everything that was baked into the chunks (the heights,
+	//the lighting, the scale and the fog)
+	unsigned int m_uiKeyLow;
+	unsigned int m_uiKeyHigh;
+
+	int m_iMapSize;
+	int m_iChunkCells;
+	int m_iDepth;				//the levels below the root
+	int m_iNumNodes;
+	int m_iFormat;				//the attributes that were baked (BACKEND_NORMAL, BACKEND_FOGCOORD)
+	unsigned int m_uiFileSize;
+};
+
+//one chunk of the quadtree, in the file.  The nodes are stored a level
+//at a time, each level in rows (so a node's children are found from its
+//level and position, and don't need to be stored).
+struct SCHUNK_NODE
+{
+	float m_fError;				//the most that the mesh is off by (world units, never less than the children's)
+	float m_fMin[3], m_fMax[3];	//the bounding box (world units, skirts included)
+
+	//the mesh (from the start of the file): the chunk's vertices, and a
+	//triangle list into them
+	unsigned int m_uiVertexOffset;
+	int m_iNumVertices;
+	unsigned int m_uiIndexOffset;
+	int m_iNumIndices;
+};
+
+//a chunk's mesh while it is being built (height map coordinates)
+struct SCHUNK_MESH
+{
+	int* m_ipVertexMap;			//the chunk's grid point -> vertex number (-1 if unused)
+	int* m_ipSkirtMap;			//the chunk's grid point -> skirt vertex number (-1 if unused)
+
+	//x, z pairs (the surface's vertices, and then the skirts' vertices)
+	int* m_ipVertices;
+	int m_iNumVertices;
+	int m_iNumSurfaceVertices;
+
+	//a triangle list (the surface, and then the skirts)
+	unsigned int* m_uipIndices;
+	int m_iNumIndices;
+	int m_iNumSurfaceIndices;
+
+	//the chunk's square, and the spacing of its grid
+	int m_iMinX, m_iMinZ;
+	int m_iWidth;
+	int m_iStride;
+	int m_iChunkCells;
+	float m_fThreshold;			//vertices with a bigger (saturated) error are added
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CCHUNKLOD : public CTERRAIN
+{
+	private:
+		//the chunk file, mapped into memory (read-only)
+		HANDLE m_hFile;
+		HANDLE m_hMapping;
+		unsigned char* m_ucpView;
+		SCHUNK_FILE_HEADER* m_pHeader;
+		SCHUNK_NODE* m_pNodes;
+
+		//the chunks that the last update picked
+		int* m_ipSelected;
+		int m_iNumSelected;
+		int m_iNodesVisited;
+
+		//the screen-space error that a chunk is allowed
+		float m_fPixelTolerance;
+		float m_fErrorScale;		//viewport height/( 2*tan( fov/2 ) )
+
+		//the build's saturated vertex errors (every vertex's error is at
+		//least as big as those of the vertices that depend on it)
+		float* m_fpVertexErrors;
+
+	BAKE_KEY GetBuildKey( void );
+
+	void SaturateErrors( int ax, int az, int lx, int lz, int rx, int rz, int iDepth, int iTargetDepth );
+	bool AllocMesh( SCHUNK_MESH* pMesh, int iChunkCells );
+	void FreeMesh( SCHUNK_MESH* pMesh );
+	void TessellateChunk( SCHUNK_MESH* pMesh, int iDepth, int x, int z, int iChunkCells, float fThreshold );
+	void AddTriangle( SCHUNK_MESH* pMesh, int ax, int az, int lx, int lz, int rx, int rz, int iDepth, int iChunkDepth );
+	int  AddVertex( SCHUNK_MESH* pMesh, int x, int z );
+	void AddSkirts( SCHUNK_MESH* pMesh );
+	float MeasureError( SCHUNK_MESH* pMesh );
+	void FillVertex( SBACKEND_VERTEX* pVertex, int x, int z, float fDrop );
+
+	void SelectNode( CCAMERA* pCamera, int iDepth, int x, int z, bool bCull );
+	int  PrepareMesh( bool* pbMultiTex );
+	void DrawMesh( int iFormat );
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::GetNodeIndex - private
+	// Description:		Find a node in the file's node list
+	// Arguments:		-iDepth: the node's level (0 is the root)
+	//					-x, z: the node's position in its level
+	// Return Value:	An integer value: the node's number
+	//--------------------------------------------------------------
+	inline int GetNodeIndex( int iDepth, int x, int z )
+	{	return ( ( ( 1<<( iDepth*2 ) )-1 )/3 )+( z<<iDepth )+x;	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::GetVertexError - private
+	// Description:		Get a vertex's saturated error (while building)
+	// Arguments:		-x, z: the vertex
+	// Return Value:	A float value: the error (height map units)
+	//--------------------------------------------------------------
+	inline float GetVertexError( int x, int z )
+	{	return m_fpVertexErrors[( z*m_iSize )+x];	}
+
+	public:
+
+	bool Build( char* szFilename, int iChunkCells= CHUNK_DEFAULT_CELLS, float fLeafError= CHUNK_DEFAULT_ERROR );
+
+	bool Init( char* szFilename );
+	void Shutdown( void );
+
+	void Update( CCAMERA camera, bool bCullChunks= true );
+	void Render( void );
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::SetProjection - public
+	// Description:		Tell the chunk selection how big the screen is, so
+	//					that it can work out how many pixels an error covers
+	// Arguments:		-fFOV: the vertical field of view (in degrees)
+	//					-iViewportHeight: the viewport's height (in pixels)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetProjection( float fFOV, int iViewportHeight )
+	{	m_fErrorScale= iViewportHeight/( 2.0f*( float )tan( DEG_TO_RAD( fFOV )/2.0f ) );	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::SetPixelTolerance - public
+	// Description:		Set the biggest error (on the screen) that a chunk
+	//					is allowed to have
+	// Arguments:		-fPixels: the tolerance, in pixels
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetPixelTolerance( float fPixels )
+	{	m_fPixelTolerance= ( fPixels>0.0f ) ? fPixels : 0.0f;	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::IsLoaded - public
+	// Description:		Check to see if a chunk file is mapped in
+	// Arguments:		None
+	// Return Value:	A boolean value: -true: the chunks can be drawn
+	//									 -false: no chunk file
+	//--------------------------------------------------------------
+	inline bool IsLoaded( void )
+	{	return ( m_pHeader!=NULL );	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::GetNumChunks - public
+	// Description:		Get the number of chunks in the file
+	// Arguments:		None
+	// Return Value:	An integer value: the number of chunks
+	//--------------------------------------------------------------
+	inline int GetNumChunks( void )
+	{	return m_pHeader ? m_pHeader->m_iNumNodes : 0;	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::GetFileSize - public
+	// Description:		Get the size of the mapped chunk file
+	// Arguments:		None
+	// Return Value:	An unsigned integer value: the size, in bytes
+	//--------------------------------------------------------------
+	inline unsigned int GetFileSize( void )
+	{	return m_pHeader ? m_pHeader->m_uiFileSize : 0;	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::GetNumChunksDrawn - public
+	// Description:		Get the number of chunks that the last update picked
+	// Arguments:		None
+	// Return Value:	An integer value: the number of chunks
+	//--------------------------------------------------------------
+	inline int GetNumChunksDrawn( void )
+	{	return m_iNumSelected;	}
+
+	//--------------------------------------------------------------
+	// Name:			CCHUNKLOD::GetNumNodesVisited - public
+	// Description:		Get the number of quadtree nodes that the last update
+	//					looked at
+	// Arguments:		None
+	// Return Value:	An integer value: the number of nodes
+	//--------------------------------------------------------------
+	inline int GetNumNodesVisited( void )
+	{	return m_iNodesVisited;	}
+
+	CCHUNKLOD( void ) : m_hFile( NULL ), m_hMapping( NULL ), m_ucpView( NULL ), m_pHeader( NULL ), m_pNodes( NULL ),
+						m_ipSelected( NULL ), m_iNumSelected( 0 ), m_iNodesVisited( 0 ),
+						m_fPixelTolerance( CHUNK_DEFAULT_TOLERANCE ), m_fpVertexErrors( NULL )
+	{	SetProjection( 45.0f, 480 );	}
+	~CCHUNKLOD( void )
+	{	}
+};
+
+#endif	//__CHUNKLOD_H__
@@ -42,7 +42,7 @@ RSC=rc.exe
 # PROP Intermediate_Dir "Release"
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
-# ADD CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
+# ADD CPP /nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /c
 # ADD BASE MTL /nologo /D "NDEBUG" /mktyplib203 /win32
 # ADD MTL /nologo /D "NDEBUG" /mktyplib203 /win32
 # ADD BASE RSC /l 0x409 /d "NDEBUG"
@@ -67,7 +67,7 @@ LINK32=link.exe
 # PROP Intermediate_Dir "Debug"
 # PROP Target_Dir ""
 # ADD BASE CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
-# ADD CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /YX /FD /GZ /c
+# ADD CPP /nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /D "RENDER_STATS" /YX /FD /GZ /c
 # ADD BASE MTL /nologo /D "_DEBUG" /mktyplib203 /win32
 # ADD MTL /nologo /D "_DEBUG" /mktyplib203 /win32
 # ADD BASE RSC /l 0x409 /d "_DEBUG"
@@ -90,6 +90,18 @@ LINK32=link.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\benchmark.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\chunklod.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\geoclipmap.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\geomipmapping.cpp
 # End Source File
 # Begin Source File
@@ -118,6 +130,18 @@ SOURCE=.\water.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\benchmark.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\chunklod.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\geoclipmap.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\geomipmapping.h
 # End Source File
 # Begin Source File
@@ -142,6 +166,14 @@ SOURCE=.\water.h
 # PROP Default_Filter ""
 # Begin Source File
 
+SOURCE="..\Base Code\bake_cache.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\bake_cache.h"
+# End Source File
+# Begin Source File
+
 SOURCE="..\Base Code\camera.cpp"
 # End Source File
 # Begin Source File
@@ -186,8 +218,52 @@ SOURCE="..\Base Code\math_ops.h"
 # End Source File
 # Begin Source File
 
+SOURCE="..\Base Code\render_backend.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_backend.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_queue.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_queue.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_stats.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\render_stats.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\simd.h"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\thread_pool.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\thread_pool.h"
+# End Source File
+# Begin Source File
+
 SOURCE="..\Base Code\timer.h"
 # End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\vertex_cache.cpp"
+# End Source File
+# Begin Source File
+
+SOURCE="..\Base Code\vertex_cache.h"
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
@@ -41,7 +41,11 @@ ALL : "$(OUTDIR)\demo8_12.exe"
 
 
 CLEAN :
+	-@erase "$(INTDIR)\bake_cache.obj"
+	-@erase "$(INTDIR)\benchmark.obj"
 	-@erase "$(INTDIR)\camera.obj"
+	-@erase "$(INTDIR)\chunklod.obj"
+	-@erase "$(INTDIR)\geoclipmap.obj"
 	-@erase "$(INTDIR)\geomipmapping.obj"
 	-@erase "$(INTDIR)\gl_app.obj"
 	-@erase "$(INTDIR)\image.obj"
@@ -49,17 +53,22 @@ CLEAN :
 	-@erase "$(INTDIR)\main.obj"
 	-@erase "$(INTDIR)\math_ops.obj"
 	-@erase "$(INTDIR)\particle.obj"
+	-@erase "$(INTDIR)\render_backend.obj"
+	-@erase "$(INTDIR)\render_queue.obj"
+	-@erase "$(INTDIR)\render_stats.obj"
 	-@erase "$(INTDIR)\resource.res"
 	-@erase "$(INTDIR)\skydome.obj"
 	-@erase "$(INTDIR)\terrain.obj"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(INTDIR)\water.obj"
 	-@erase "$(OUTDIR)\demo8_12.exe"
 
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /ML /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_12.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
+CPP_PROJ=/nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_12.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
 MTL_PROJ=/nologo /D "NDEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "NDEBUG" 
 BSC32=bscmake.exe
@@ -69,6 +78,9 @@ BSC32_SBRS= \
 LINK32=link.exe
 LINK32_FLAGS=kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /subsystem:windows /incremental:no /pdb:"$(OUTDIR)\demo8_12.pdb" /machine:I386 /out:"$(OUTDIR)\demo8_12.exe" 
 LINK32_OBJS= \
+	"$(INTDIR)\benchmark.obj" \
+	"$(INTDIR)\chunklod.obj" \
+	"$(INTDIR)\geoclipmap.obj" \
 	"$(INTDIR)\geomipmapping.obj" \
 	"$(INTDIR)\main.obj" \
 	"$(INTDIR)\particle.obj" \
@@ -80,7 +92,13 @@ LINK32_OBJS= \
 	"$(INTDIR)\gl_app.obj" \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
-	"$(INTDIR)\math_ops.obj"
+	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\thread_pool.obj" \
+	"$(INTDIR)\bake_cache.obj" \
+	"$(INTDIR)\render_backend.obj" \
+	"$(INTDIR)\render_stats.obj" \
+	"$(INTDIR)\render_queue.obj" \
+	"$(INTDIR)\vertex_cache.obj"
 
 "$(OUTDIR)\demo8_12.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -99,7 +117,11 @@ ALL : "$(OUTDIR)\demo8_12.exe"
 
 
 CLEAN :
+	-@erase "$(INTDIR)\bake_cache.obj"
+	-@erase "$(INTDIR)\benchmark.obj"
 	-@erase "$(INTDIR)\camera.obj"
+	-@erase "$(INTDIR)\chunklod.obj"
+	-@erase "$(INTDIR)\geoclipmap.obj"
 	-@erase "$(INTDIR)\geomipmapping.obj"
 	-@erase "$(INTDIR)\gl_app.obj"
 	-@erase "$(INTDIR)\image.obj"
@@ -107,11 +129,16 @@ CLEAN :
 	-@erase "$(INTDIR)\main.obj"
 	-@erase "$(INTDIR)\math_ops.obj"
 	-@erase "$(INTDIR)\particle.obj"
+	-@erase "$(INTDIR)\render_backend.obj"
+	-@erase "$(INTDIR)\render_queue.obj"
+	-@erase "$(INTDIR)\render_stats.obj"
 	-@erase "$(INTDIR)\resource.res"
 	-@erase "$(INTDIR)\skydome.obj"
 	-@erase "$(INTDIR)\terrain.obj"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
 	-@erase "$(INTDIR)\vc60.pdb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(INTDIR)\water.obj"
 	-@erase "$(OUTDIR)\demo8_12.exe"
 	-@erase "$(OUTDIR)\demo8_12.ilk"
@@ -120,7 +147,7 @@ CLEAN :
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /MLd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_12.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
+CPP_PROJ=/nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /D "RENDER_STATS" /Fp"$(INTDIR)\demo8_12.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
 MTL_PROJ=/nologo /D "_DEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "_DEBUG" 
 BSC32=bscmake.exe
@@ -130,6 +157,9 @@ BSC32_SBRS= \
 LINK32=link.exe
 LINK32_FLAGS=kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /subsystem:windows /incremental:yes /pdb:"$(OUTDIR)\demo8_12.pdb" /debug /machine:I386 /out:"$(OUTDIR)\demo8_12.exe" /pdbtype:sept 
 LINK32_OBJS= \
+	"$(INTDIR)\benchmark.obj" \
+	"$(INTDIR)\chunklod.obj" \
+	"$(INTDIR)\geoclipmap.obj" \
 	"$(INTDIR)\geomipmapping.obj" \
 	"$(INTDIR)\main.obj" \
 	"$(INTDIR)\particle.obj" \
@@ -141,7 +171,13 @@ LINK32_OBJS= \
 	"$(INTDIR)\gl_app.obj" \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
-	"$(INTDIR)\math_ops.obj"
+	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\thread_pool.obj" \
+	"$(INTDIR)\bake_cache.obj" \
+	"$(INTDIR)\render_backend.obj" \
+	"$(INTDIR)\render_stats.obj" \
+	"$(INTDIR)\render_queue.obj" \
+	"$(INTDIR)\vertex_cache.obj"
 
 "$(OUTDIR)\demo8_12.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -191,6 +227,21 @@ LINK32_OBJS= \
 
 
 !IF "$(CFG)" == "demo8_12 - Win32 Release" || "$(CFG)" == "demo8_12 - Win32 Debug"
+SOURCE=.\benchmark.cpp
+
+"$(INTDIR)\benchmark.obj" : $(SOURCE) "$(INTDIR)"
+
+
+SOURCE=.\chunklod.cpp
+
+"$(INTDIR)\chunklod.obj" : $(SOURCE) "$(INTDIR)"
+
+
+SOURCE=.\geoclipmap.cpp
+
+"$(INTDIR)\geoclipmap.obj" : $(SOURCE) "$(INTDIR)"
+
+
 SOURCE=.\geomipmapping.cpp
 
 "$(INTDIR)\geomipmapping.obj" : $(SOURCE) "$(INTDIR)"
@@ -251,6 +302,42 @@ SOURCE="..\Base Code\math_ops.cpp"
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE="..\Base Code\thread_pool.cpp"
+
+"$(INTDIR)\thread_pool.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\bake_cache.cpp"
+
+"$(INTDIR)\bake_cache.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\render_backend.cpp"
+
+"$(INTDIR)\render_backend.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\render_stats.cpp"
+
+"$(INTDIR)\render_stats.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\render_queue.cpp"
+
+"$(INTDIR)\render_queue.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\vertex_cache.cpp"
+
+"$(INTDIR)\vertex_cache.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\resource.rc
 
 "$(INTDIR)\resource.res" : $(SOURCE) "$(INTDIR)"
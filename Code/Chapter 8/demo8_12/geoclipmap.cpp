@@ -0,0 +1,958 @@
+//==============================================================
+//==============================================================
+//= geoclipmap.cpp =============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= This file (along with geoclipmap.h) contains all of the	   =
+//= information for the geometry clipmap terrain component.	   =
+//==============================================================
+//==============================================================
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <stdio.h>
+
+#include "../Base Code/gl_app.h"
+#include "../Base Code/thread_pool.h"
+
+#include "geoclipmap.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DEFINITIONS ------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::Init - public
+// Description:		Initiate the geometry clipmap: build the height
+//					pyramid, and allocate the levels' grids
+// Arguments:		-iGridSize: vertices on a side of each level (a
+//								power of two plus one, from 17 to 257)
+//					-iNumLevels: the number of levels (each one covers
+//								 twice as much ground as the one before it)
+// Return Value:	A boolean value: -true: successful initiation
+//									 -false: unsuccessful initiation
+//--------------------------------------------------------------
+bool CGEOCLIPMAP::Init( int iGridSize, int iNumLevels )
+{
+	SGEOCM_LEVEL* pLevel;
+	int iMaxIndices;
+	int iHeight;
+	int i;
+
+	if( m_iSize==0 )
+		return false;
+
+	if( m_pVertices )
+		Shutdown( );
+
+	if( iGridSize<17 || iGridSize>257 || ( ( iGridSize-1 ) & ( iGridSize-2 ) )!=0 )
+	{
+		g_log.Write( LOG_FAILURE, "Clipmap levels must be a power of two plus one vertices on a side, from 17 to 257 (not %d)", iGridSize );
+		return false;
+	}
+
+	//the pyramid halves the height map until it is down to one cell
+	if( ( ( m_iSize-1 ) & ( m_iSize-2 ) )!=0 )
+	{
+		g_log.Write( LOG_FAILURE, "The geometry clipmap needs a height map that is a power of two plus one on a side" );
+		return false;
+	}
+
+	if( !BuildPyramid( ) )
+	{
+		Shutdown( );
+
+		g_log.Write( LOG_FAILURE, "Could not allocate memory for the clipmap's height pyramid" );
+		return false;
+	}
+
+	//a level needs its own level of the pyramid
+	m_iGridSize	= iGridSize;
+	m_iNumLevels= MIN( iNumLevels, m_iNumPyramidLevels );
+	if( m_iNumLevels<1 )
+		m_iNumLevels= 1;
+
+	//the last tenth of a level blends into the next coarser level (which
+	//is as wide as the blend can be, and still be done before the level's
+	//edge, wherever the camera is in the level)
+	m_iTransitionWidth= ( m_iGridSize-1 )/10;
+
+	//every cell of a level, and a (zero-area) triangle for each vertex
+	//along its edge that the next coarser level doesn't have
+	iMaxIndices= SQR( ( m_iGridSize-1 ) )*6+( m_iGridSize-1 )*6;
+
+	m_pVertices		  = new SBACKEND_VERTEX [m_iNumLevels*SQR( m_iGridSize )];
+	m_uipFrameIndices = new unsigned int [m_iNumLevels*iMaxIndices];
+	m_iNumFrameIndices= 0;
+	if( m_pVertices==NULL || m_uipFrameIndices==NULL )
+	{
+		Shutdown( );
+
+		g_log.Write( LOG_FAILURE, "Could not allocate memory for the geometry clipmap" );
+		return false;
+	}
+
+	for( i=0; i<m_iNumLevels; i++ )
+	{
+		pLevel= &m_levels[i];
+
+		pLevel->m_pVertices		 = &m_pVertices[i*SQR( m_iGridSize )];
+		pLevel->m_fpHeights		 = new float [SQR( m_iGridSize )];
+		pLevel->m_fpCoarseHeights= new float [SQR( m_iGridSize )];
+		pLevel->m_uipIndices	 = new unsigned int [iMaxIndices];
+		pLevel->m_bValid		 = false;
+		pLevel->m_bIndicesValid	 = false;
+		pLevel->m_bHole			 = false;
+
+		if( pLevel->m_fpHeights==NULL || pLevel->m_fpCoarseHeights==NULL || pLevel->m_uipIndices==NULL )
+		{
+			Shutdown( );
+
+			g_log.Write( LOG_FAILURE, "Could not allocate memory for the geometry clipmap" );
+			return false;
+		}
+	}
+
+	//the terrain's height range, for culling the levels' blocks
+	m_fMinHeight= 255.0f;
+	m_fMaxHeight= 0.0f;
+	for( i=0; i<SQR( m_iSize ); i++ )
+	{
+		iHeight= m_heightData.m_ucpData[i];
+
+		if( iHeight<m_fMinHeight )
+			m_fMinHeight= ( float )iHeight;
+		if( iHeight>m_fMaxHeight )
+			m_fMaxHeight= ( float )iHeight;
+	}
+
+	m_vecGridScale= m_vecScale;
+	m_bGridNormals= HasNormals( );
+	m_iFinestLevel= 0;
+
+	g_log.Write( LOG_SUCCESS, "Geometry clipmap successfully initialized: %d levels of %dx%d vertices", m_iNumLevels, m_iGridSize, m_iGridSize );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::Shutdown - public
+// Description:		Shutdown the geometry clipmap
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::Shutdown( void )
+{
+	int i;
+
+	for( i=0; i<GEOCM_MAX_LEVELS; i++ )
+	{
+		delete[] m_levels[i].m_fpHeights;
+		delete[] m_levels[i].m_fpCoarseHeights;
+		delete[] m_levels[i].m_uipIndices;
+	}
+	memset( m_levels, 0, sizeof( m_levels ) );
+
+	delete[] m_pVertices;
+	delete[] m_uipFrameIndices;
+	m_pVertices		  = NULL;
+	m_uipFrameIndices = NULL;
+	m_iNumFrameIndices= 0;
+
+	FreePyramid( );
+
+	m_iNumLevels= 0;
+	m_iGridSize = 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::BuildPyramid - private
+// Description:		Filter the height map down to half of its size, and
+//					then that down to half of its size, and so on, until
+//					it is down to a single cell (each point is a weighted
+//					average of the 3x3 points around it, one level up)
+// Arguments:		None
+// Return Value:	A boolean value: -true: the pyramid was built
+//									 -false: out of memory
+//--------------------------------------------------------------
+bool CGEOCLIPMAP::BuildPyramid( void )
+{
+	static const int iWeights[3]= { 1, 2, 1 };
+	unsigned char* ucpSource;
+	unsigned char* ucpDest;
+	int iSourceSize, iSize;
+	int iTotal;
+	int sx, sz;
+	int x, z;
+	int i, j;
+
+	//the first level is the height map itself
+	m_ucpPyramid[0]	  = m_heightData.m_ucpData;
+	m_iPyramidSize[0] = m_iSize;
+	m_iNumPyramidLevels= 1;
+
+	while( m_iPyramidSize[m_iNumPyramidLevels-1]>2 && m_iNumPyramidLevels<GEOCM_MAX_LEVELS )
+	{
+		ucpSource  = m_ucpPyramid[m_iNumPyramidLevels-1];
+		iSourceSize= m_iPyramidSize[m_iNumPyramidLevels-1];
+		iSize	   = ( iSourceSize-1 )/2+1;
+
+		ucpDest= new unsigned char [SQR( iSize )];
+		if( ucpDest==NULL )
+			return false;
+
+		for( z=0; z<iSize; z++ )
+		{
+			for( x=0; x<iSize; x++ )
+			{
+				iTotal= 0;
+
+				for( j=-1; j<=1; j++ )
+				{
+					sz= z*2+j;
+					CLAMP( sz, 0, iSourceSize-1 );
+
+					for( i=-1; i<=1; i++ )
+					{
+						sx= x*2+i;
+						CLAMP( sx, 0, iSourceSize-1 );
+
+						iTotal+= iWeights[i+1]*iWeights[j+1]*ucpSource[( sz*iSourceSize )+sx];
+					}
+				}
+
+				ucpDest[( z*iSize )+x]= ( unsigned char )( ( iTotal+8 )>>4 );
+			}
+		}
+
+		m_ucpPyramid[m_iNumPyramidLevels]  = ucpDest;
+		m_iPyramidSize[m_iNumPyramidLevels]= iSize;
+		m_iNumPyramidLevels++;
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::FreePyramid - private
+// Description:		Free the height pyramid (the first level is the
+//					height map, which belongs to CTERRAIN)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::FreePyramid( void )
+{
+	int i;
+
+	for( i=1; i<m_iNumPyramidLevels; i++ )
+		delete[] m_ucpPyramid[i];
+
+	memset( m_ucpPyramid, 0, sizeof( m_ucpPyramid ) );
+	memset( m_iPyramidSize, 0, sizeof( m_iPyramidSize ) );
+	m_iNumPyramidLevels= 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::Update - public
+// Description:		Move the levels with the camera (each one only fills
+//					in the rows and columns that it moved onto), blend
+//					each level into the next coarser one towards its
+//					edge, and find the blocks of the levels that are in
+//					the frustum.  The levels are split across the thread
+//					pool.  None of this depends on the size of the height
+//					map, only on the size and number of the levels.
+// Arguments:		-camera: the camera object your demo is using
+//					-bCullBlocks: cull unseen blocks (true by default)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::Update( CCAMERA camera, bool bCullBlocks )
+{
+	SGEOCM_LEVEL* pLevel;
+	float fHeight;
+	int iHoleX, iHoleZ;
+	bool bHole;
+	int i;
+
+	if( m_pVertices==NULL )
+		return;
+
+	//everything is built again if the scale changes, or once the normal
+	//map has been made
+	if( m_vecGridScale!=m_vecScale || m_bGridNormals!=HasNormals( ) )
+	{
+		for( i=0; i<m_iNumLevels; i++ )
+			m_levels[i].m_bValid= false;
+
+		m_vecGridScale= m_vecScale;
+		m_bGridNormals= HasNormals( );
+	}
+
+	m_fEyeX= camera.m_vecEyePos[0]/m_vecScale[0];
+	m_fEyeZ= camera.m_vecEyePos[2]/m_vecScale[2];
+
+	//the higher the camera is above the ground, the fewer of the fine
+	//levels are worth drawing
+	fHeight= camera.m_vecEyePos[1]-SampleHeight( camera.m_vecEyePos[0], camera.m_vecEyePos[2] );
+
+	m_iFinestLevel= 0;
+	while( m_iFinestLevel<m_iNumLevels-1 &&
+		   fHeight>GEOCM_ACTIVE_HEIGHT*( m_iGridSize-1 )*( 1<<m_iFinestLevel )*( float )fabs( m_vecScale[0] ) )
+		m_iFinestLevel++;
+
+	//the levels that are turned off are filled in from scratch when they
+	//are turned back on
+	for( i=0; i<m_iFinestLevel; i++ )
+		m_levels[i].m_bValid= false;
+
+	m_iLevelsMoved= 0;
+	for( i=m_iFinestLevel; i<m_iNumLevels; i++ )
+	{
+		pLevel= &m_levels[i];
+
+		pLevel->m_iLastOriginX= pLevel->m_iOriginX;
+		pLevel->m_iLastOriginZ= pLevel->m_iOriginZ;
+		PlaceLevel( i, &pLevel->m_iOriginX, &pLevel->m_iOriginZ );
+
+		if( !pLevel->m_bValid || pLevel->m_iOriginX!=pLevel->m_iLastOriginX || pLevel->m_iOriginZ!=pLevel->m_iLastOriginZ )
+		{
+			pLevel->m_bIndicesValid= false;
+			m_iLevelsMoved++;
+		}
+
+		//the next finer level's cells are cut out of this level (its first
+		//point is always even, so it starts on one of this level's points)
+		bHole = ( i>m_iFinestLevel );
+		iHoleX= bHole ? m_levels[i-1].m_iOriginX/2 : 0;
+		iHoleZ= bHole ? m_levels[i-1].m_iOriginZ/2 : 0;
+
+		if( bHole!=pLevel->m_bHole || iHoleX!=pLevel->m_iHoleX || iHoleZ!=pLevel->m_iHoleZ )
+		{
+			pLevel->m_bHole		   = bHole;
+			pLevel->m_iHoleX	   = iHoleX;
+			pLevel->m_iHoleZ	   = iHoleZ;
+			pLevel->m_bIndicesValid= false;
+		}
+	}
+
+	g_threadPool.Run( UpdateLevelJob, this, m_iNumLevels-m_iFinestLevel );
+
+	m_iVerticesRefreshed= 0;
+	for( i=m_iFinestLevel; i<m_iNumLevels; i++ )
+		m_iVerticesRefreshed+= m_levels[i].m_iVerticesRefreshed;
+
+	CullBlocks( &camera, bCullBlocks );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::PlaceLevel - private
+// Description:		Find where a level should be for the camera: as close
+//					to centered on it as the level can get, with its first
+//					point on one of the next coarser level's points
+// Arguments:		-iLevel: the level
+//					-ipOriginX, ipOriginZ: storage for the level's first
+//										   point (in level units)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::PlaceLevel( int iLevel, int* ipOriginX, int* ipOriginZ )
+{
+	float fSpacing= ( float )( 1<<iLevel );
+	float fHalfWidth= ( m_iGridSize-1 )*0.5f;
+
+	//the nearest even point to where the level would start if it were
+	//centered on the camera (so the camera is never more than one of the
+	//level's units away from its center)
+	*ipOriginX= 2*( int )floor( ( m_fEyeX/fSpacing-fHalfWidth )*0.5f+0.5f );
+	*ipOriginZ= 2*( int )floor( ( m_fEyeZ/fSpacing-fHalfWidth )*0.5f+0.5f );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::UpdateLevelJob - private
+// Description:		A thread pool job: update one of the levels that are
+//					turned on
+// Arguments:		-iJob: the level (counting from the finest one that is on)
+//					-pData: the clipmap
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::UpdateLevelJob( int iJob, void* pData )
+{
+	CGEOCLIPMAP* pClipmap= ( CGEOCLIPMAP* )pData;
+
+	pClipmap->UpdateLevel( pClipmap->m_iFinestLevel+iJob );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::UpdateLevel - private
+// Description:		Fill in the vertices that a level moved onto, build
+//					its triangles again if it (or the level inside of it)
+//					moved, and blend its heights for where the camera is
+// Arguments:		-iLevel: the level
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::UpdateLevel( int iLevel )
+{
+	RefreshLevel( iLevel );
+
+	if( !m_levels[iLevel].m_bIndicesValid )
+		BuildLevelIndices( iLevel );
+
+	BlendLevel( iLevel );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::RefreshVertex - private
+// Description:		Fill in one of a level's vertices from the height
+//					pyramid: everything but its height (which BlendLevel
+//					works out), color and fog coordinate (which depend on
+//					the lighting and the fog)
+// Arguments:		-iLevel: the level
+//					-gx, gz: the point (in level units)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::RefreshVertex( int iLevel, int gx, int gz )
+{
+	SGEOCM_LEVEL* pLevel= &m_levels[iLevel];
+	SBACKEND_VERTEX* pVertex;
+	float fTexScale= 1.0f/m_iSize;
+	float fHeight, fCoarseHeight;
+	int iSlot= GetSlot( gx, gz );
+	int x, z;
+	int cx, cz;
+
+	pVertex= &pLevel->m_pVertices[iSlot];
+
+	//the height map point under the vertex (the ones past the edges of
+	//the terrain are never drawn, but they still get filled in)
+	x= gx<<iLevel;
+	z= gz<<iLevel;
+
+	pVertex->m_fTexCoord0[0]= x*fTexScale;
+	pVertex->m_fTexCoord0[1]= z*fTexScale;
+	pVertex->m_fTexCoord1[0]= pVertex->m_fTexCoord0[0]*m_iRepeatDetailMap;
+	pVertex->m_fTexCoord1[1]= pVertex->m_fTexCoord0[1]*m_iRepeatDetailMap;
+
+	pVertex->m_fPosition[0]= x*m_vecScale[0];
+	pVertex->m_fPosition[2]= z*m_vecScale[2];
+
+	CLAMP( x, 0, m_iSize-1 );
+	CLAMP( z, 0, m_iSize-1 );
+
+	if( m_bGridNormals )
+		GetNormalAtPoint( x, z, pVertex->m_fNormal );
+
+	//the vertex's height in this level, and on the next coarser level's
+	//surface (the points between that level's points are on its edges,
+	//or on the diagonal that its cells are split along)
+	gx= x>>iLevel;
+	gz= z>>iLevel;
+	fHeight= GetPyramidHeight( iLevel, gx, gz );
+
+	if( iLevel<m_iNumLevels-1 )
+	{
+		cx= gx>>1;
+		cz= gz>>1;
+
+		if( !( gx & 1 ) && !( gz & 1 ) )
+			fCoarseHeight= GetPyramidHeight( iLevel+1, cx, cz );
+		else if( !( gz & 1 ) )
+			fCoarseHeight= ( GetPyramidHeight( iLevel+1, cx, cz )+GetPyramidHeight( iLevel+1, cx+1, cz ) )*0.5f;
+		else if( !( gx & 1 ) )
+			fCoarseHeight= ( GetPyramidHeight( iLevel+1, cx, cz )+GetPyramidHeight( iLevel+1, cx, cz+1 ) )*0.5f;
+		else
+			fCoarseHeight= ( GetPyramidHeight( iLevel+1, cx, cz )+GetPyramidHeight( iLevel+1, cx+1, cz+1 ) )*0.5f;
+	}
+
+	//the coarsest level has nothing to blend into
+	else
+		fCoarseHeight= fHeight;
+
+	pLevel->m_fpHeights[iSlot]		= fHeight;
+	pLevel->m_fpCoarseHeights[iSlot]= fCoarseHeight;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::RefreshLevel - private
+// Description:		Fill in the vertices that a level has moved onto since
+//					the last update: an L-shaped strip of columns and rows
+//					along two of its edges (or the whole level, if it
+//					moved all the way off of what it had)
+// Arguments:		-iLevel: the level
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::RefreshLevel( int iLevel )
+{
+	SGEOCM_LEVEL* pLevel= &m_levels[iLevel];
+	int iOriginX= pLevel->m_iOriginX;
+	int iOriginZ= pLevel->m_iOriginZ;
+	int iLastX= pLevel->m_iLastOriginX;
+	int iLastZ= pLevel->m_iLastOriginZ;
+	int iMinX, iMaxX;
+	int iMinZ, iMaxZ;
+	int gx, gz;
+
+	pLevel->m_iVerticesRefreshed= 0;
+
+	if( !pLevel->m_bValid || abs( iOriginX-iLastX )>=m_iGridSize || abs( iOriginZ-iLastZ )>=m_iGridSize )
+	{
+		for( gz=iOriginZ; gz<iOriginZ+m_iGridSize; gz++ )
+		{
+			for( gx=iOriginX; gx<iOriginX+m_iGridSize; gx++ )
+				RefreshVertex( iLevel, gx, gz );
+		}
+
+		pLevel->m_iVerticesRefreshed= SQR( m_iGridSize );
+		pLevel->m_bValid= true;
+		return;
+	}
+
+	//the columns that the level moved onto (they take the slots of the
+	//columns that it moved off of)
+	iMinX= ( iOriginX>iLastX ) ? iLastX+m_iGridSize : iOriginX;
+	iMaxX= ( iOriginX>iLastX ) ? iOriginX+m_iGridSize : iLastX;
+
+	for( gz=iOriginZ; gz<iOriginZ+m_iGridSize; gz++ )
+	{
+		for( gx=iMinX; gx<iMaxX; gx++ )
+			RefreshVertex( iLevel, gx, gz );
+	}
+	pLevel->m_iVerticesRefreshed+= ( iMaxX-iMinX )*m_iGridSize;
+
+	//and the rows (without the columns that were just done)
+	iMinZ= ( iOriginZ>iLastZ ) ? iLastZ+m_iGridSize : iOriginZ;
+	iMaxZ= ( iOriginZ>iLastZ ) ? iOriginZ+m_iGridSize : iLastZ;
+
+	for( gz=iMinZ; gz<iMaxZ; gz++ )
+	{
+		for( gx=iOriginX; gx<iOriginX+m_iGridSize; gx++ )
+		{
+			if( gx<iMinX || gx>=iMaxX )
+				RefreshVertex( iLevel, gx, gz );
+		}
+	}
+	pLevel->m_iVerticesRefreshed+= ( iMaxZ-iMinZ )*( m_iGridSize-( iMaxX-iMinX ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::BuildLevelIndices - private
+// Description:		Build a level's triangles, a block at a time: every
+//					cell that is on the terrain and isn't covered by the
+//					next finer level, and a zero-area triangle over each
+//					T-junction along the level's edge (where its vertices
+//					sit halfway along the next coarser level's edges)
+// Arguments:		-iLevel: the level
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::BuildLevelIndices( int iLevel )
+{
+	SGEOCM_LEVEL* pLevel= &m_levels[iLevel];
+	unsigned int* uipIndex= pLevel->m_uipIndices;
+	unsigned int uiBase= iLevel*SQR( m_iGridSize );
+	unsigned int a, b, c, d;
+	int iBlockSize= ( m_iGridSize-1 )/GEOCM_BLOCKS_PER_SIDE;
+	int iHoleSize= ( m_iGridSize-1 )/2;
+	int iNumCells= ( m_iSize-1 )>>iLevel;	//the level's cells on a side of the terrain
+	int iFirst;
+	int iStartX, iStartZ;
+	int bx, bz;
+	int cx, cz;
+	int gx, gz;
+	bool bStitch;
+
+	//the coarsest level has nothing outside of it to line up with
+	bStitch= ( iLevel<m_iNumLevels-1 );
+
+	for( bz=0; bz<GEOCM_BLOCKS_PER_SIDE; bz++ )
+	{
+		for( bx=0; bx<GEOCM_BLOCKS_PER_SIDE; bx++ )
+		{
+			iFirst = uipIndex-pLevel->m_uipIndices;
+			iStartX= bx*iBlockSize;
+			iStartZ= bz*iBlockSize;
+
+			for( cz=iStartZ; cz<iStartZ+iBlockSize; cz++ )
+			{
+				gz= pLevel->m_iOriginZ+cz;
+				if( gz<0 || gz>=iNumCells )
+					continue;
+
+				for( cx=iStartX; cx<iStartX+iBlockSize; cx++ )
+				{
+					gx= pLevel->m_iOriginX+cx;
+					if( gx<0 || gx>=iNumCells )
+						continue;
+
+					if( pLevel->m_bHole && gx>=pLevel->m_iHoleX && gx<pLevel->m_iHoleX+iHoleSize &&
+						gz>=pLevel->m_iHoleZ && gz<pLevel->m_iHoleZ+iHoleSize )
+						continue;
+
+					//split along the same diagonal as every other level's cells
+					a= uiBase+GetSlot( gx, gz );
+					b= uiBase+GetSlot( gx+1, gz );
+					c= uiBase+GetSlot( gx, gz+1 );
+					d= uiBase+GetSlot( gx+1, gz+1 );
+
+					*uipIndex++= a;
+					*uipIndex++= c;
+					*uipIndex++= d;
+
+					*uipIndex++= a;
+					*uipIndex++= d;
+					*uipIndex++= b;
+				}
+			}
+
+			//the T-junctions along the level's edges (every odd vertex)
+			if( bStitch )
+			{
+				for( cx=iStartX+1; cx<iStartX+iBlockSize; cx+= 2 )
+				{
+					gx= pLevel->m_iOriginX+cx;
+					if( gx-1<0 || gx+1>iNumCells )
+						continue;
+
+					gz= pLevel->m_iOriginZ;
+					if( bz==0 && gz>=0 && gz<iNumCells )
+					{
+						*uipIndex++= uiBase+GetSlot( gx-1, gz );
+						*uipIndex++= uiBase+GetSlot( gx, gz );
+						*uipIndex++= uiBase+GetSlot( gx+1, gz );
+					}
+
+					gz= pLevel->m_iOriginZ+m_iGridSize-1;
+					if( bz==GEOCM_BLOCKS_PER_SIDE-1 && gz>0 && gz<=iNumCells )
+					{
+						*uipIndex++= uiBase+GetSlot( gx+1, gz );
+						*uipIndex++= uiBase+GetSlot( gx, gz );
+						*uipIndex++= uiBase+GetSlot( gx-1, gz );
+					}
+				}
+
+				for( cz=iStartZ+1; cz<iStartZ+iBlockSize; cz+= 2 )
+				{
+					gz= pLevel->m_iOriginZ+cz;
+					if( gz-1<0 || gz+1>iNumCells )
+						continue;
+
+					gx= pLevel->m_iOriginX;
+					if( bx==0 && gx>=0 && gx<iNumCells )
+					{
+						*uipIndex++= uiBase+GetSlot( gx, gz+1 );
+						*uipIndex++= uiBase+GetSlot( gx, gz );
+						*uipIndex++= uiBase+GetSlot( gx, gz-1 );
+					}
+
+					gx= pLevel->m_iOriginX+m_iGridSize-1;
+					if( bx==GEOCM_BLOCKS_PER_SIDE-1 && gx>0 && gx<=iNumCells )
+					{
+						*uipIndex++= uiBase+GetSlot( gx, gz-1 );
+						*uipIndex++= uiBase+GetSlot( gx, gz );
+						*uipIndex++= uiBase+GetSlot( gx, gz+1 );
+					}
+				}
+			}
+
+			pLevel->m_iBlockFirst[( bz*GEOCM_BLOCKS_PER_SIDE )+bx]= iFirst;
+			pLevel->m_iBlockCount[( bz*GEOCM_BLOCKS_PER_SIDE )+bx]= ( uipIndex-pLevel->m_uipIndices )-iFirst;
+		}
+	}
+
+	pLevel->m_bIndicesValid= true;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::BlendLevel - private
+// Description:		Work out the height of each of a level's vertices:
+//					its own height near the camera, sliding over to the
+//					next coarser level's surface across the outer part of
+//					the level (so that the edge of the level, which the
+//					camera is never closer than half of the level's width
+//					less one unit to, is exactly on the coarser level)
+// Arguments:		-iLevel: the level
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::BlendLevel( int iLevel )
+{
+	SGEOCM_LEVEL* pLevel= &m_levels[iLevel];
+	float fSpacing= ( float )( 1<<iLevel );
+	float fEyeX= m_fEyeX/fSpacing;
+	float fEyeZ= m_fEyeZ/fSpacing;
+	float fStart, fWidth;
+	float fDistX, fDistZ;
+	float fBlend;
+	float fHeight;
+	bool bBlend;
+	int iSlot;
+	int gx, gz;
+
+	//the blend reaches the coarser level's surface one unit in from the
+	//closest that the level's edge can be to the camera
+	fWidth= ( float )MAX( m_iTransitionWidth, 1 );
+	fStart= ( m_iGridSize-1 )*0.5f-1.0f-fWidth;
+	bBlend= ( iLevel<m_iNumLevels-1 );
+
+	for( gz=pLevel->m_iOriginZ; gz<pLevel->m_iOriginZ+m_iGridSize; gz++ )
+	{
+		fDistZ= ( float )fabs( gz-fEyeZ );
+
+		for( gx=pLevel->m_iOriginX; gx<pLevel->m_iOriginX+m_iGridSize; gx++ )
+		{
+			iSlot = GetSlot( gx, gz );
+			fDistX= ( float )fabs( gx-fEyeX );
+
+			fBlend= bBlend ? ( MAX( fDistX, fDistZ )-fStart )/fWidth : 0.0f;
+
+			if( fBlend<=0.0f )
+				fHeight= pLevel->m_fpHeights[iSlot];
+			else if( fBlend>=1.0f )
+				fHeight= pLevel->m_fpCoarseHeights[iSlot];
+			else
+				fHeight= pLevel->m_fpHeights[iSlot]+fBlend*( pLevel->m_fpCoarseHeights[iSlot]-pLevel->m_fpHeights[iSlot] );
+
+			pLevel->m_pVertices[iSlot].m_fPosition[1]= fHeight*m_vecScale[1];
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::CullBlocks - private
+// Description:		Test the levels' blocks against the frustum, and put
+//					the triangles of the ones that are (partly) inside of
+//					it together into the frame's index list
+// Arguments:		-pCamera: the camera (with its frustum calculated)
+//					-bCullBlocks: test the blocks, or keep them all
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::CullBlocks( CCAMERA* pCamera, bool bCullBlocks )
+{
+	SGEOCM_LEVEL* pLevel;
+	float fX, fY, fZ;
+	float fHalfX, fHalfY, fHalfZ;
+	float fDistance, fRadius;
+	float fBlockWidth;
+	int iBlock;
+	int iBlockSize= ( m_iGridSize-1 )/GEOCM_BLOCKS_PER_SIDE;
+	int bx, bz;
+	int iLevel;
+	int i;
+
+	m_iNumFrameIndices= 0;
+	m_iVisibleBlocks  = 0;
+
+	fY	  = ( m_fMaxHeight+m_fMinHeight )*0.5f*m_vecScale[1];
+	fHalfY= ( float )fabs( ( m_fMaxHeight-m_fMinHeight )*0.5f*m_vecScale[1] );
+
+	for( iLevel=m_iFinestLevel; iLevel<m_iNumLevels; iLevel++ )
+	{
+		pLevel= &m_levels[iLevel];
+		fBlockWidth= ( float )( iBlockSize<<iLevel );
+
+		for( bz=0; bz<GEOCM_BLOCKS_PER_SIDE; bz++ )
+		{
+			for( bx=0; bx<GEOCM_BLOCKS_PER_SIDE; bx++ )
+			{
+				iBlock= ( bz*GEOCM_BLOCKS_PER_SIDE )+bx;
+				if( pLevel->m_iBlockCount[iBlock]==0 )
+					continue;
+
+				if( bCullBlocks )
+				{
+					fX	  = ( ( pLevel->m_iOriginX<<iLevel )+( bx+0.5f )*fBlockWidth )*m_vecScale[0];
+					fZ	  = ( ( pLevel->m_iOriginZ<<iLevel )+( bz+0.5f )*fBlockWidth )*m_vecScale[2];
+					fHalfX= ( float )fabs( fBlockWidth*0.5f*m_vecScale[0] );
+					fHalfZ= ( float )fabs( fBlockWidth*0.5f*m_vecScale[2] );
+
+					for( i=0; i<6; i++ )
+					{
+						fDistance= pCamera->m_viewFrustum[i][0]*fX + pCamera->m_viewFrustum[i][1]*fY +
+								   pCamera->m_viewFrustum[i][2]*fZ + pCamera->m_viewFrustum[i][3];
+						fRadius	 = ( float )fabs( pCamera->m_viewFrustum[i][0] )*fHalfX+
+								   ( float )fabs( pCamera->m_viewFrustum[i][1] )*fHalfY+
+								   ( float )fabs( pCamera->m_viewFrustum[i][2] )*fHalfZ;
+
+						//even the corner furthest along the normal is outside
+						if( fDistance+fRadius<=0 )
+							break;
+					}
+
+					if( i<6 )
+						continue;
+				}
+
+				memcpy( &m_uipFrameIndices[m_iNumFrameIndices], &pLevel->m_uipIndices[pLevel->m_iBlockFirst[iBlock]],
+						pLevel->m_iBlockCount[iBlock]*sizeof( unsigned int ) );
+				m_iNumFrameIndices+= pLevel->m_iBlockCount[iBlock];
+				m_iVisibleBlocks++;
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::Render - public
+// Description:		Render the geometry clipmap
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::Render( void )
+{
+	bool bMultiTex;
+	int iFormat;
+
+	iFormat= PrepareMesh( &bMultiTex );
+
+	//enable back-face culling
+	m_pBackend->SetState( BACKEND_CULL_FACE, true );
+
+	//render the multitexturing terrain
+	if( bMultiTex )
+	{
+		m_pBackend->SetState( BACKEND_BLEND, false );
+
+		//bind the primary color texture to the first texture unit
+		m_pBackend->SetState( BACKEND_TEXTURE0, true );
+		m_pBackend->BindTexture( 0, m_texture.GetID( ) );
+
+		//bind the detail color texture to the second texture unit
+		m_pBackend->SetState( BACKEND_TEXTURE1, true );
+		m_pBackend->BindTexture( 1, m_detailMap.GetID( ) );
+		m_pBackend->SetCombineMode( 1, BACKEND_COMBINE_DETAIL );
+
+		//render the levels
+		DrawMesh( iFormat );
+	}
+
+	//no hardware multitexturing available, or the user only wants to render
+	//the detail texture or the color texture
+	else
+	{
+		if( m_bTextureMapping )
+		{
+			//bind the primary color texture (FOR THE PRIMARY TEXTURE PASS)
+			m_pBackend->SetState( BACKEND_TEXTURE0, true );
+			m_pBackend->BindTexture( 0, m_texture.GetID( ) );
+
+			//render the color texture
+			DrawMesh( iFormat );
+		}
+
+		if( !( m_bTextureMapping && !m_bDetailMapping ) )
+		{
+			//if the user wants detail mapping, we need to set some things up
+			if( m_bDetailMapping )
+			{
+				//bind the detail texture
+				m_pBackend->SetState( BACKEND_TEXTURE0, true );
+				m_pBackend->BindTexture( 0, m_detailMap.GetID( ) );
+
+				//only use blending if a texture pass was made
+				if( m_bTextureMapping )
+				{
+					m_pBackend->SetState( BACKEND_BLEND, true );
+					m_pBackend->SetBlendMode( BACKEND_BLEND_MULTIPLY );
+				}
+
+				//the vertices only have the color map's texture coordinates,
+				//so the texture matrix stretches them for the detail map
+				m_pBackend->SetTextureScale( 0, ( float )m_iRepeatDetailMap );
+			}
+
+			//render either the detail map on top of the texture,
+			//only the detail map, or neither
+			DrawMesh( iFormat );
+
+			if( m_bDetailMapping )
+				m_pBackend->SetTextureScale( 0, 1.0f );
+		}
+	}
+
+	m_pBackend->SetState( BACKEND_BLEND, false );
+
+	//unbind the texture occupying the second texture unit
+	m_pBackend->SetState( BACKEND_TEXTURE1, false );
+	m_pBackend->BindTexture( 1, 0 );
+
+	//unbind the texture occupying the first texture unit
+	m_pBackend->SetState( BACKEND_TEXTURE0, false );
+	m_pBackend->BindTexture( 0, 0 );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::PrepareMesh - private
+// Description:		Reset the frame's counters, and give the vertices of
+//					the levels that are turned on this frame's colors and
+//					fog coordinates (once, no matter how many passes it
+//					takes to draw them)
+// Arguments:		-pbMultiTex: storage for whether the levels are drawn
+//								 in one multitextured pass
+// Return Value:	An integer value: the vertex format that the passes
+//					draw the levels with (BACKEND_*)
+//--------------------------------------------------------------
+int CGEOCLIPMAP::PrepareMesh( bool* pbMultiTex )
+{
+	SGEOCM_LEVEL* pLevel;
+	SBACKEND_VERTEX* pVertex;
+	bool bFog;
+	int iLevel;
+	int x, z;
+	int gx, gz;
+
+	//reset the counting variables
+	m_iVertsPerFrame= 0;
+	m_iTrisPerFrame = 0;
+
+	//the light's color is the same for every vertex, so it only needs to
+	//be applied to each brightness value once
+	BuildShadeTable( );
+
+	*pbMultiTex= ( m_bMultitexture && m_bDetailMapping && m_bTextureMapping );
+	bFog	   = ( m_fFogDepth>0.0f );
+
+	for( iLevel=m_iFinestLevel; iLevel<m_iNumLevels && m_pVertices; iLevel++ )
+	{
+		pLevel= &m_levels[iLevel];
+
+		for( gz=pLevel->m_iOriginZ; gz<pLevel->m_iOriginZ+m_iGridSize; gz++ )
+		{
+			z= gz<<iLevel;
+			CLAMP( z, 0, m_iSize-1 );
+
+			for( gx=pLevel->m_iOriginX; gx<pLevel->m_iOriginX+m_iGridSize; gx++ )
+			{
+				x= gx<<iLevel;
+				CLAMP( x, 0, m_iSize-1 );
+
+				pVertex= &pLevel->m_pVertices[GetSlot( gx, gz )];
+				memcpy( pVertex->m_ucColor, m_ucShadeTable[GetBrightnessAtPoint( x, z )], 4 );
+
+				if( bFog )
+					pVertex->m_fFogCoord= GetFogCoord( pVertex->m_fPosition[1] );
+			}
+		}
+	}
+
+	return GetVertexFormat( *pbMultiTex, bFog, m_bGridNormals );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOCLIPMAP::DrawMesh - private
+// Description:		Draw the visible blocks of every level (for one
+//					rendering pass), all in one go
+// Arguments:		-iFormat: the vertex attributes to draw with (BACKEND_*)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOCLIPMAP::DrawMesh( int iFormat )
+{
+	if( m_iNumFrameIndices==0 )
+		return;
+
+	m_pBackend->Draw( BACKEND_TRIANGLES, iFormat, m_pVertices, m_iNumLevels*SQR( m_iGridSize ),
+					  m_uipFrameIndices, m_iNumFrameIndices );
+
+	m_iVertsPerFrame+= ( m_iNumLevels-m_iFinestLevel )*SQR( m_iGridSize );
+	m_iTrisPerFrame += m_iNumFrameIndices/3;
+}
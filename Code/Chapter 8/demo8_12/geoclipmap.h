@@ -0,0 +1,262 @@
+//==============================================================
+//==============================================================
+//= geoclipmap.h ===============================================
+//= Original coders: Trent Polack (trent@voxelsoft.com)		   =
+//==============================================================
+//= This file (along with geoclipmap.cpp) contains all of the  =
+//= information for the geometry clipmap terrain component:	   =
+//= nested square grids of the same size around the camera,	   =
+//= each one twice as coarse as the one inside of it.		   =
+//==============================================================
+//==============================================================
+#ifndef __GEOCLIPMAP_H__
+#define __GEOCLIPMAP_H__
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- HEADERS AND LIBRARIES --------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#include <string.h>
+
+#include "terrain.h"
+
+#include "../Base Code/camera.h"
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+#define GEOCM_MAX_LEVELS TRN_MAX_PYRAMID_LEVELS
+
+#define GEOCM_DEFAULT_GRID_SIZE 65	//vertices on a side of each level
+#define GEOCM_DEFAULT_LEVELS	6
+
+//each level is split into this many blocks on a side for frustum culling
+#define GEOCM_BLOCKS_PER_SIDE 4
+#define GEOCM_NUM_BLOCKS	  ( GEOCM_BLOCKS_PER_SIDE*GEOCM_BLOCKS_PER_SIDE )
+
+//a level is turned off once the camera is higher above the ground than
+//this much of the level's width (its triangles would be too small to see)
+#define GEOCM_ACTIVE_HEIGHT 0.4f
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- DATA STRUCTURES --------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//one ring of the clipmap: a grid of vertices with a spacing of 2^level
+//height map units.  The grid is stored toroidally (the point gx, gz of
+//the level is always kept in slot gx%size, gz%size), so that when the
+//grid moves only the rows and columns that it moves onto are filled in.
+struct SGEOCM_LEVEL
+{
+	//the grid's first point, in level units (always even, so that the
+	//grid lines up with the next coarser level), and what was in the
+	//grid before this update moved it
+	int m_iOriginX, m_iOriginZ;
+	int m_iLastOriginX, m_iLastOriginZ;
+	bool m_bValid;				//the grid has been filled in
+	int m_iVerticesRefreshed;	//the vertices that the last update filled in
+
+	//the cells covered by the next finer level (which aren't drawn)
+	bool m_bHole;
+	int m_iHoleX, m_iHoleZ;
+
+	//the vertices (in the clipmap's vertex array), and each one's height
+	//in this level and in the next coarser level (height map units)
+	SBACKEND_VERTEX* m_pVertices;
+	float* m_fpHeights;
+	float* m_fpCoarseHeights;
+
+	//the level's triangles, a block at a time (indices into the
+	//clipmap's vertex array)
+	unsigned int* m_uipIndices;
+	int m_iBlockFirst[GEOCM_NUM_BLOCKS];
+	int m_iBlockCount[GEOCM_NUM_BLOCKS];
+	bool m_bIndicesValid;
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CLASS ------------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+class CGEOCLIPMAP : public CTERRAIN
+{
+	private:
+		SGEOCM_LEVEL m_levels[GEOCM_MAX_LEVELS];
+		int m_iNumLevels;
+		int m_iFinestLevel;		//the finest level that is turned on
+		int m_iGridSize;		//vertices on a side of each level
+		int m_iTransitionWidth;	//the vertices that blend into the next coarser level
+
+		//the height map, filtered down to half of its size again and
+		//again (level 0 is the height map itself)
+		unsigned char* m_ucpPyramid[GEOCM_MAX_LEVELS];
+		int m_iPyramidSize[GEOCM_MAX_LEVELS];
+		int m_iNumPyramidLevels;
+
+		//the lowest and highest points of the height map (for culling)
+		float m_fMinHeight, m_fMaxHeight;
+
+		//what the vertices were built with (they are all built again if
+		//either one changes)
+		CVECTOR m_vecGridScale;
+		bool m_bGridNormals;
+
+		//the camera, in height map units (for the levels' update jobs)
+		float m_fEyeX, m_fEyeZ;
+
+		//every level's vertices, and the frame's triangles
+		SBACKEND_VERTEX* m_pVertices;
+		unsigned int* m_uipFrameIndices;
+		int m_iNumFrameIndices;
+
+		//the last update's statistics
+		int m_iVerticesRefreshed;
+		int m_iLevelsMoved;
+		int m_iVisibleBlocks;
+
+	bool BuildPyramid( void );
+	void FreePyramid( void );
+	void PlaceLevel( int iLevel, int* ipOriginX, int* ipOriginZ );
+	void UpdateLevel( int iLevel );
+	void RefreshVertex( int iLevel, int gx, int gz );
+	void RefreshLevel( int iLevel );
+	void BuildLevelIndices( int iLevel );
+	void BlendLevel( int iLevel );
+	void CullBlocks( CCAMERA* pCamera, bool bCullBlocks );
+	int  PrepareMesh( bool* pbMultiTex );
+	void DrawMesh( int iFormat );
+
+	static void UpdateLevelJob( int iJob, void* pData );
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetSlot - private
+	// Description:		Find the slot that a level's point is kept in
+	// Arguments:		-gx, gz: the point (in level units)
+	// Return Value:	An integer value: the vertex's number in the level
+	//--------------------------------------------------------------
+	inline int GetSlot( int gx, int gz )
+	{
+		gx%= m_iGridSize;
+		gz%= m_iGridSize;
+		if( gx<0 )
+			gx+= m_iGridSize;
+		if( gz<0 )
+			gz+= m_iGridSize;
+
+		return ( gz*m_iGridSize )+gx;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetPyramidHeight - private
+	// Description:		Get a height out of the pyramid (points past the
+	//					edges of the terrain get the edge's height)
+	// Arguments:		-iLevel: the pyramid level
+	//					-x, z: the point (in that level's units)
+	// Return Value:	A float value: the height (height map units)
+	//--------------------------------------------------------------
+	inline float GetPyramidHeight( int iLevel, int x, int z )
+	{
+		int iSize= m_iPyramidSize[iLevel];
+
+		CLAMP( x, 0, iSize-1 );
+		CLAMP( z, 0, iSize-1 );
+
+		return m_ucpPyramid[iLevel][( z*iSize )+x];
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetVertexFormat - private
+	// Description:		Get the format of the clipmap's vertices
+	// Arguments:		- bMultiTex: send the detail map's texture coordinates
+	//					- bFog: send fog coordinates
+	//					- bLighting: send normals
+	// Return Value:	An integer value: the vertex format flags (BACKEND_*)
+	//--------------------------------------------------------------
+	inline int GetVertexFormat( bool bMultiTex, bool bFog, bool bLighting )
+	{
+		return BACKEND_COLOR | BACKEND_TEXCOORD0 | ( bMultiTex ? BACKEND_TEXCOORD1 : 0 ) |
+			   ( bFog ? BACKEND_FOGCOORD : 0 ) | ( bLighting ? BACKEND_NORMAL : 0 );
+	}
+
+	public:
+
+	bool Init( int iGridSize, int iNumLevels );
+	void Shutdown( void );
+
+	void Update( CCAMERA camera, bool bCullBlocks= true );
+	void Render( void );
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetNumLevels - public
+	// Description:		Get the number of levels in the clipmap
+	// Arguments:		None
+	// Return Value:	An integer value: the number of levels
+	//--------------------------------------------------------------
+	inline int GetNumLevels( void )
+	{	return m_iNumLevels;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetFinestLevel - public
+	// Description:		Get the finest level that the last update drew
+	//					(the ones under it are turned off while the camera
+	//					is high up)
+	// Arguments:		None
+	// Return Value:	An integer value: the level
+	//--------------------------------------------------------------
+	inline int GetFinestLevel( void )
+	{	return m_iFinestLevel;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetNumVerticesRefreshed - public
+	// Description:		Get the number of vertices that the last update had
+	//					to sample from the height pyramid (the rows and
+	//					columns that the levels moved onto)
+	// Arguments:		None
+	// Return Value:	An integer value: the number of vertices
+	//--------------------------------------------------------------
+	inline int GetNumVerticesRefreshed( void )
+	{	return m_iVerticesRefreshed;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetNumLevelsMoved - public
+	// Description:		Get the number of levels that the last update moved
+	// Arguments:		None
+	// Return Value:	An integer value: the number of levels
+	//--------------------------------------------------------------
+	inline int GetNumLevelsMoved( void )
+	{	return m_iLevelsMoved;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOCLIPMAP::GetNumVisibleBlocks - public
+	// Description:		Get the number of blocks that the last update found
+	//					inside of the frustum
+	// Arguments:		None
+	// Return Value:	An integer value: the number of blocks
+	//--------------------------------------------------------------
+	inline int GetNumVisibleBlocks( void )
+	{	return m_iVisibleBlocks;	}
+
+	CGEOCLIPMAP( void ) : m_iNumLevels( 0 ), m_iFinestLevel( 0 ), m_iGridSize( 0 ), m_iTransitionWidth( 0 ),
+						  m_iNumPyramidLevels( 0 ), m_fMinHeight( 0.0f ), m_fMaxHeight( 0.0f ),
+						  m_bGridNormals( false ), m_fEyeX( 0.0f ), m_fEyeZ( 0.0f ),
+						  m_pVertices( NULL ), m_uipFrameIndices( NULL ), m_iNumFrameIndices( 0 ),
+						  m_iVerticesRefreshed( 0 ), m_iLevelsMoved( 0 ), m_iVisibleBlocks( 0 )
+	{
+		memset( m_levels, 0, sizeof( m_levels ) );
+		memset( m_ucpPyramid, 0, sizeof( m_ucpPyramid ) );
+		memset( m_iPyramidSize, 0, sizeof( m_iPyramidSize ) );
+	}
+	~CGEOCLIPMAP( void )
+	{	}
+};
+
+#endif	//__GEOCLIPMAP_H__
@@ -17,27 +17,664 @@
 #include <stdio.h>
 
 #include "../Base Code/gl_app.h"
+#include "../Base Code/simd.h"
+#include "../Base Code/thread_pool.h"
+#include "../Base Code/timer.h"
+#include "../Base Code/vertex_cache.h"
 
 #include "geomipmapping.h"
 
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- STRUCTURES -------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//the patches' errors and bounds, a row of patches at a time
+struct SGEOMM_ERROR_JOB
+{
+	SGEOMM_PATCHES* m_pPatches;
+	unsigned char* m_ucpHeights;
+	int m_iSize;
+	int m_iPatchSize;
+	int m_iNumPatchesPerSide;
+	int m_iMaxLOD;
+	int m_iMergeLevel;			//the super-patches that SuperPatchErrorRow works on
+};
+
+//the patches' visibility, distances and levels of detail, a quadtree
+//leaf at a time
+struct SGEOMM_UPDATE_JOB
+{
+	SGEOMM_PATCHES* m_pPatches;
+	SGEOMM_NODE* m_pNodes;
+	int m_iNumPatchesPerSide;
+	int m_iPatchSpan;			//the width of a patch (in height map units)
+	int m_iMaxLOD;
+
+	//the leaves that made it through the quadtree, and the planes that
+	//their patches still need to be tested against
+	int* m_ipLeaves;
+	int* m_ipLeafPlanes;
+	int  m_iNumLeaves;
+	int  m_iPatchesTested;
+
+	int* m_ipVisible;			//each leaf writes its visible patches to its own part of the list
+	int* m_ipLeafVisible;
+
+	float m_fPlanes[6][4];
+	float m_fEyePos[3];
+	float m_fScale[3];
+	float m_fHalfSpanX;			//half of a patch's width (scaled)
+	float m_fHalfSpanZ;
+	float m_fErrorPerUnit;		//the biggest error allowed, one unit away (tolerance/( error scale*height scale ))
+	float m_fHysteresis;		//1/( 1+hysteresis band ): how much less error a patch has to get by with to lose detail
+};
+
+
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- GLOBALS ----------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+static int g_iCalibrationSizes[GEOMM_NUM_CALIBRATION_SIZES]= { 17, 33, 65, 129 };
+
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- DEFINITIONS ------------------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 
+//--------------------------------------------------------------
+// Name:			GetFanHeight - global (this file only)
+// Description:		Get the height of a triangle fan's surface (eight
+//					triangles around the center vertex, the way that
+//					BuildTemplate makes them) at a point inside of the fan
+// Arguments:		-pJob: the height map
+//					-cX, cZ: the fan's center
+//					-iHalfSize: the distance from the center to the edges
+//					-dX, dZ: the point, relative to the center
+// Return Value:	A float value: the surface's height (in height map units)
+//--------------------------------------------------------------
+static float GetFanHeight( SGEOMM_ERROR_JOB* pJob, int cX, int cZ, int iHalfSize, int dX, int dZ )
+{
+	unsigned char* ucpHeights= pJob->m_ucpHeights;
+	float fCenter, fSide, fCorner;
+	float fA, fB;
+	int iSideX, iSideZ;
+
+	//the corner of the fan that the point is heading towards
+	iSideX= ( dX<0 ) ? -iHalfSize : iHalfSize;
+	iSideZ= ( dZ<0 ) ? -iHalfSize : iHalfSize;
+
+	fCenter= ucpHeights[cZ*pJob->m_iSize+cX];
+	fCorner= ucpHeights[( cZ+iSideZ )*pJob->m_iSize+cX+iSideX];
+
+	//the point is in the triangle between the center, the corner and the
+	//middle of whichever edge it is closer to
+	if( abs( dX )>=abs( dZ ) )
+	{
+		fSide= ucpHeights[cZ*pJob->m_iSize+cX+iSideX];
+		fB	 = ( float )abs( dZ )/iHalfSize;
+		fA	 = ( float )abs( dX )/iHalfSize-fB;
+	}
+	else
+	{
+		fSide= ucpHeights[( cZ+iSideZ )*pJob->m_iSize+cX];
+		fB	 = ( float )abs( dX )/iHalfSize;
+		fA	 = ( float )abs( dZ )/iHalfSize-fB;
+	}
+
+	return fCenter+fA*( fSide-fCenter )+fB*( fCorner-fCenter );
+}
+
+//--------------------------------------------------------------
+// Name:			CalculatePatch - global (this file only)
+// Description:		Work out a patch's bounds, and its error at every level
+//					of detail (the "d" values)
+// Arguments:		-pJob: the height map and patches
+//					-PX, PZ: the patch
+// Return Value:	None
+//--------------------------------------------------------------
+static void CalculatePatch( SGEOMM_ERROR_JOB* pJob, int PX, int PZ )
+{
+	SGEOMM_PATCHES* pPatches= pJob->m_pPatches;
+	unsigned char ucHeight, ucMin, ucMax;
+	float fError, fMaxError;
+	int iSpan= pJob->m_iPatchSize-1;
+	int iFansPerSide, iFanSize;
+	int iStartX, iStartZ;
+	int cX, cZ;
+	int iLOD;
+	int iPatch;
+	int x, z;
+
+	iPatch = PZ*pJob->m_iNumPatchesPerSide+PX;
+	iStartX= PX*iSpan;
+	iStartZ= PZ*iSpan;
+
+	//the patch's bounds, and the point that its distance is measured to
+	ucMin= 255;
+	ucMax= 0;
+	for( z=0; z<=iSpan; z++ )
+	{
+		for( x=0; x<=iSpan; x++ )
+		{
+			ucHeight= pJob->m_ucpHeights[( iStartZ+z )*pJob->m_iSize+iStartX+x];
+			if( ucHeight<ucMin )
+				ucMin= ucHeight;
+			if( ucHeight>ucMax )
+				ucMax= ucHeight;
+		}
+	}
+
+	pPatches->m_fpCenterX[iPatch]	  = iStartX+( iSpan/2.0f );
+	pPatches->m_fpCenterZ[iPatch]	  = iStartZ+( iSpan/2.0f );
+	pPatches->m_fpCenterHeight[iPatch]= pJob->m_ucpHeights[( int )pPatches->m_fpCenterZ[iPatch]*pJob->m_iSize+( int )pPatches->m_fpCenterX[iPatch]];
+	pPatches->m_fpMinHeight[iPatch]	  = ucMin;
+	pPatches->m_fpMaxHeight[iPatch]	  = ucMax;
+
+	//every point is a vertex at the highest level of detail
+	pPatches->m_fpErrors[0][iPatch]= 0.0f;
+
+	for( iLOD=1; iLOD<=pJob->m_iMaxLOD; iLOD++ )
+	{
+		//the same fans that BuildPatch makes
+		iFansPerSide= iSpan>>( iLOD+1 );
+		iFanSize	= iSpan/iFansPerSide;
+
+		fMaxError= 0.0f;
+		for( z=0; z<=iSpan; z++ )
+		{
+			cZ= MIN( z/iFanSize, iFansPerSide-1 )*iFanSize+iFanSize/2;
+
+			for( x=0; x<=iSpan; x++ )
+			{
+				cX= MIN( x/iFanSize, iFansPerSide-1 )*iFanSize+iFanSize/2;
+
+				fError= pJob->m_ucpHeights[( iStartZ+z )*pJob->m_iSize+iStartX+x]-
+						GetFanHeight( pJob, iStartX+cX, iStartZ+cZ, iFanSize/2, x-cX, z-cZ );
+				fError= ( float )fabs( fError );
+
+				if( fError>fMaxError )
+					fMaxError= fError;
+			}
+		}
+
+		//less detail never gets to look better than more detail
+		pPatches->m_fpErrors[iLOD][iPatch]= MAX( fMaxError, pPatches->m_fpErrors[iLOD-1][iPatch] );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			PatchErrorRow - global (this file only)
+// Description:		A thread pool job: work out the bounds and errors of a
+//					row of patches
+// Arguments:		-iJob: the row of patches
+//					-pData: the job (SGEOMM_ERROR_JOB)
+// Return Value:	None
+//--------------------------------------------------------------
+static void PatchErrorRow( int iJob, void* pData )
+{
+	SGEOMM_ERROR_JOB* pJob= ( SGEOMM_ERROR_JOB* )pData;
+	int PX;
+
+	for( PX=0; PX<pJob->m_iNumPatchesPerSide; PX++ )
+		CalculatePatch( pJob, PX, iJob );
+}
+
+//--------------------------------------------------------------
+// Name:			GetSuperFanHeight - global (this file only)
+// Description:		Get the height of a super-patch's surface (one fan
+//					from the center of the square out to vertices spaced
+//					along its edges, the way that BuildSuperPatch makes
+//					it) at a point inside of the square
+// Arguments:		-pJob: the height map
+//					-cX, cZ: the square's center
+//					-iHalfSize: the distance from the center to the edges
+//					-iRimStep: the spacing of the vertices along the edges
+//					-dX, dZ: the point, relative to the center
+// Return Value:	A float value: the surface's height (in height map units)
+//--------------------------------------------------------------
+static float GetSuperFanHeight( SGEOMM_ERROR_JOB* pJob, int cX, int cZ, int iHalfSize, int iRimStep, int dX, int dZ )
+{
+	unsigned char* ucpHeights= pJob->m_ucpHeights;
+	float fCenter, fEdge;
+	float fA, fB;
+	float fAlong;
+	int iDistance;
+	int iEdge;
+	int i;
+
+	fCenter	 = ucpHeights[cZ*pJob->m_iSize+cX];
+	iDistance= MAX( abs( dX ), abs( dZ ) );
+	if( iDistance==0 )
+		return fCenter;
+
+	//the line from the center through the point meets the edge fAlong
+	//units from the edge's start, between two of the edge's vertices
+	if( abs( dX )>=abs( dZ ) )
+	{
+		fAlong= ( float )dZ*iHalfSize/iDistance+iHalfSize;
+		i	  = MIN( ( int )( fAlong/iRimStep ), ( iHalfSize*2 )/iRimStep-1 )*iRimStep;
+		iEdge = cX+( ( dX<0 ) ? -iHalfSize : iHalfSize );
+
+		fA= ucpHeights[( cZ-iHalfSize+i )*pJob->m_iSize+iEdge];
+		fB= ucpHeights[( cZ-iHalfSize+i+iRimStep )*pJob->m_iSize+iEdge];
+	}
+	else
+	{
+		fAlong= ( float )dX*iHalfSize/iDistance+iHalfSize;
+		i	  = MIN( ( int )( fAlong/iRimStep ), ( iHalfSize*2 )/iRimStep-1 )*iRimStep;
+		iEdge = cZ+( ( dZ<0 ) ? -iHalfSize : iHalfSize );
+
+		fA= ucpHeights[iEdge*pJob->m_iSize+cX-iHalfSize+i];
+		fB= ucpHeights[iEdge*pJob->m_iSize+cX-iHalfSize+i+iRimStep];
+	}
+
+	fEdge= fA+( fB-fA )*( fAlong-i )/iRimStep;
+
+	//the fan's triangles are flat, so the height changes evenly from the
+	//center out to the edge
+	return fCenter+( fEdge-fCenter )*iDistance/iHalfSize;
+}
+
+//--------------------------------------------------------------
+// Name:			CalculateSuperPatch - global (this file only)
+// Description:		Work out a super-patch's error: how far its single fan
+//					is from the height map (or how far its patches are at
+//					their coarsest level of detail, if that is further)
+// Arguments:		-pJob: the height map and patches (and the merge level)
+//					-SX, SZ: the super-patch's square, in its level
+// Return Value:	None
+//--------------------------------------------------------------
+static void CalculateSuperPatch( SGEOMM_ERROR_JOB* pJob, int SX, int SZ )
+{
+	SGEOMM_PATCHES* pPatches= pJob->m_pPatches;
+	float fError, fMaxError;
+	int iLevel= pJob->m_iMergeLevel;
+	int iSpan, iHalf;
+	int iStartX, iStartZ;
+	int iChild;
+	int x, z;
+	int i;
+
+	iSpan  = ( pJob->m_iPatchSize-1 )<<iLevel;
+	iHalf  = iSpan/2;
+	iStartX= SX*iSpan;
+	iStartZ= SZ*iSpan;
+
+	fMaxError= 0.0f;
+	for( z=0; z<=iSpan; z++ )
+	{
+		for( x=0; x<=iSpan; x++ )
+		{
+			fError= pJob->m_ucpHeights[( iStartZ+z )*pJob->m_iSize+iStartX+x]-
+					GetSuperFanHeight( pJob, iStartX+iHalf, iStartZ+iHalf, iHalf, ( pJob->m_iPatchSize-1 )/2, x-iHalf, z-iHalf );
+			fError= ( float )fabs( fError );
+
+			if( fError>fMaxError )
+				fMaxError= fError;
+		}
+	}
+
+	//the four squares of the level below (the patches themselves, below
+	//the first level) never look worse than this one
+	for( i=0; i<4; i++ )
+	{
+		x= SX*2+( i & 1 );
+		z= SZ*2+( i>>1 );
+
+		if( iLevel==1 )
+			fError= pPatches->m_fpErrors[pJob->m_iMaxLOD][z*pJob->m_iNumPatchesPerSide+x];
+		else
+		{
+			iChild= z*( pJob->m_iNumPatchesPerSide>>( iLevel-1 ) )+x;
+			fError= pPatches->m_fpMergeErrors[iLevel-2][iChild];
+		}
+
+		if( fError>fMaxError )
+			fMaxError= fError;
+	}
+
+	pPatches->m_fpMergeErrors[iLevel-1][SZ*( pJob->m_iNumPatchesPerSide>>iLevel )+SX]= fMaxError;
+}
+
+//--------------------------------------------------------------
+// Name:			SuperPatchErrorRow - global (this file only)
+// Description:		A thread pool job: work out the errors of a row of
+//					super-patches (at the job's merge level)
+// Arguments:		-iJob: the row of super-patches
+//					-pData: the job (SGEOMM_ERROR_JOB)
+// Return Value:	None
+//--------------------------------------------------------------
+static void SuperPatchErrorRow( int iJob, void* pData )
+{
+	SGEOMM_ERROR_JOB* pJob= ( SGEOMM_ERROR_JOB* )pData;
+	int SX;
+
+	for( SX=0; SX<( pJob->m_iNumPatchesPerSide>>pJob->m_iMergeLevel ); SX++ )
+		CalculateSuperPatch( pJob, SX, iJob );
+}
+
+//--------------------------------------------------------------
+// Name:			UpdatePatch - global (this file only)
+// Description:		Cull a patch against the view frustum (with its
+//					bounding box), and find the distance to it and its
+//					level of detail if it is visible
+// Arguments:		-pJob: the update job
+//					-iPatch: the patch's number
+//					-iPlanes: the planes to test the patch against (a bit
+//							  for each plane, 0 if it is already known to
+//							  be inside of all of them)
+// Return Value:	A boolean value: -true: the patch is visible
+//									 -false: the patch was culled
+//--------------------------------------------------------------
+static bool UpdatePatch( SGEOMM_UPDATE_JOB* pJob, int iPatch, int iPlanes )
+{
+	SGEOMM_PATCHES* pPatches= pJob->m_pPatches;
+	float fX, fY, fZ;
+	float fBoxY, fHalfY;
+	float fMaxError;
+	int iLOD, iCoarser;
+	int i;
+
+	//only scale the X and Z values, the Y value has already been scaled
+	fX= pPatches->m_fpCenterX[iPatch]*pJob->m_fScale[0];
+	fY= pPatches->m_fpCenterHeight[iPatch]*pJob->m_fScale[1];
+	fZ= pPatches->m_fpCenterZ[iPatch]*pJob->m_fScale[2];
+
+	if( iPlanes )
+	{
+		fBoxY = ( pPatches->m_fpMaxHeight[iPatch]+pPatches->m_fpMinHeight[iPatch] )*0.5f*pJob->m_fScale[1];
+		fHalfY= ( float )fabs( ( pPatches->m_fpMaxHeight[iPatch]-pPatches->m_fpMinHeight[iPatch] )*0.5f*pJob->m_fScale[1] );
+
+		//the box is outside of a plane if its corner that is furthest
+		//along the plane's normal is outside of it
+		for( i=0; i<6; i++ )
+		{
+			if( ( iPlanes & ( 1<<i ) ) &&
+				pJob->m_fPlanes[i][0]*fX + pJob->m_fPlanes[i][1]*fBoxY + pJob->m_fPlanes[i][2]*fZ + pJob->m_fPlanes[i][3]+
+				( float )fabs( pJob->m_fPlanes[i][0] )*pJob->m_fHalfSpanX+
+				( float )fabs( pJob->m_fPlanes[i][1] )*fHalfY+
+				( float )fabs( pJob->m_fPlanes[i][2] )*pJob->m_fHalfSpanZ<=0 )
+			{
+				pPatches->m_ucpVisible[iPatch]= 0;
+				return false;
+			}
+		}
+	}
+
+	pPatches->m_ucpVisible[iPatch]= 1;
+
+	//get the distance from the camera to the patch
+	pPatches->m_fpDistances[iPatch]= sqrtf( SQR( ( fX-pJob->m_fEyePos[0] ) )+
+											SQR( ( fY-pJob->m_fEyePos[1] ) )+
+											SQR( ( fZ-pJob->m_fEyePos[2] ) ) );
+
+	//an error of d units, D units away, covers d*scale/D pixels,
+	//so find the least detail whose error is small enough
+	fMaxError= pPatches->m_fpDistances[iPatch]*pJob->m_fErrorPerUnit;
+
+	iLOD= 0;
+	while( iLOD<pJob->m_iMaxLOD && pPatches->m_fpErrors[iLOD+1][iPatch]<=fMaxError )
+		iLOD++;
+
+	//a patch only gives up detail once it would still be good enough
+	//with a bit less error (so it doesn't flip back and forth)
+	if( iLOD>pPatches->m_ipLODs[iPatch] )
+	{
+		fMaxError*= pJob->m_fHysteresis;
+
+		iCoarser= pPatches->m_ipLODs[iPatch];
+		while( iCoarser<iLOD && pPatches->m_fpErrors[iCoarser+1][iPatch]<=fMaxError )
+			iCoarser++;
+
+		iLOD= iCoarser;
+	}
+
+	pPatches->m_ipLODs[iPatch]= iLOD;
+	return true;
+}
+
+#ifdef USE_SSE2
+//--------------------------------------------------------------
+// Name:			UpdatePatches4 - global (this file only)
+// Description:		UpdatePatch for four patches at once (the culled
+//					patches' distances and levels of detail are left alone)
+// Arguments:		-pJob: the update job
+//					-iPatch: the first patch's number
+//					-iPlanes: the planes to test the patches against
+// Return Value:	An integer value: a bit for each visible patch
+//--------------------------------------------------------------
+static inline int UpdatePatches4( SGEOMM_UPDATE_JOB* pJob, int iPatch, int iPlanes )
+{
+	SGEOMM_PATCHES* pPatches= pJob->m_pPatches;
+	__m128 x, y, z;
+	__m128 boxY, halfY;
+	__m128 dX, dY, dZ;
+	__m128 distance, maxError, heldError;
+	__m128 visible;
+	__m128 absMask= _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) );
+	__m128i lod, held, lastLOD;
+	__m128i greater;
+	int iVisible;
+	int i;
+
+	x= _mm_mul_ps( _mm_loadu_ps( pPatches->m_fpCenterX+iPatch ), _mm_set1_ps( pJob->m_fScale[0] ) );
+	y= _mm_mul_ps( _mm_loadu_ps( pPatches->m_fpCenterHeight+iPatch ), _mm_set1_ps( pJob->m_fScale[1] ) );
+	z= _mm_mul_ps( _mm_loadu_ps( pPatches->m_fpCenterZ+iPatch ), _mm_set1_ps( pJob->m_fScale[2] ) );
+
+	visible= _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+	if( iPlanes )
+	{
+		boxY = _mm_add_ps( _mm_loadu_ps( pPatches->m_fpMaxHeight+iPatch ), _mm_loadu_ps( pPatches->m_fpMinHeight+iPatch ) );
+		boxY = _mm_mul_ps( boxY, _mm_set1_ps( 0.5f*pJob->m_fScale[1] ) );
+		halfY= _mm_sub_ps( _mm_loadu_ps( pPatches->m_fpMaxHeight+iPatch ), _mm_loadu_ps( pPatches->m_fpMinHeight+iPatch ) );
+		halfY= _mm_and_ps( _mm_mul_ps( halfY, _mm_set1_ps( 0.5f*pJob->m_fScale[1] ) ), absMask );
+
+		for( i=0; i<6; i++ )
+		{
+			if( !( iPlanes & ( 1<<i ) ) )
+				continue;
+
+			distance= _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( pJob->m_fPlanes[i][0] ), x ),
+											  _mm_mul_ps( _mm_set1_ps( pJob->m_fPlanes[i][1] ), boxY ) ),
+								  _mm_add_ps( _mm_mul_ps( _mm_set1_ps( pJob->m_fPlanes[i][2] ), z ),
+											  _mm_mul_ps( _mm_set1_ps( ( float )fabs( pJob->m_fPlanes[i][1] ) ), halfY ) ) );
+			distance= _mm_add_ps( distance, _mm_set1_ps( pJob->m_fPlanes[i][3]+
+														 ( float )fabs( pJob->m_fPlanes[i][0] )*pJob->m_fHalfSpanX+
+														 ( float )fabs( pJob->m_fPlanes[i][2] )*pJob->m_fHalfSpanZ ) );
+			visible = _mm_and_ps( visible, _mm_cmpgt_ps( distance, _mm_setzero_ps( ) ) );
+
+			//all four are already culled
+			if( _mm_movemask_ps( visible )==0 )
+				break;
+		}
+	}
+
+	iVisible= _mm_movemask_ps( visible );
+	for( i=0; i<4; i++ )
+		pPatches->m_ucpVisible[iPatch+i]= ( unsigned char )( ( iVisible>>i ) & 1 );
+
+	if( iVisible==0 )
+		return 0;
+
+	//get the distance from the camera to the patches
+	dX		= _mm_sub_ps( x, _mm_set1_ps( pJob->m_fEyePos[0] ) );
+	dY		= _mm_sub_ps( y, _mm_set1_ps( pJob->m_fEyePos[1] ) );
+	dZ		= _mm_sub_ps( z, _mm_set1_ps( pJob->m_fEyePos[2] ) );
+	distance= _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dX, dX ), _mm_mul_ps( dY, dY ) ), _mm_mul_ps( dZ, dZ ) ) );
+	maxError= _mm_mul_ps( distance, _mm_set1_ps( pJob->m_fErrorPerUnit ) );
+
+	//each level's error is at least as big as the last level's, so the
+	//least detail that is good enough is the number of levels (past the
+	//first) whose errors are small enough (each passing comparison is -1)
+	heldError= _mm_mul_ps( maxError, _mm_set1_ps( pJob->m_fHysteresis ) );
+
+	lod = _mm_setzero_si128( );
+	held= _mm_setzero_si128( );
+	for( i=1; i<=pJob->m_iMaxLOD; i++ )
+	{
+		lod = _mm_sub_epi32( lod, _mm_castps_si128( _mm_cmple_ps( _mm_loadu_ps( pPatches->m_fpErrors[i]+iPatch ), maxError ) ) );
+		held= _mm_sub_epi32( held, _mm_castps_si128( _mm_cmple_ps( _mm_loadu_ps( pPatches->m_fpErrors[i]+iPatch ), heldError ) ) );
+	}
+
+	//the hysteresis (see UpdatePatch): min( lod, max( last LOD, held ) )
+	lastLOD= _mm_loadu_si128( ( __m128i* )( pPatches->m_ipLODs+iPatch ) );
+	greater= _mm_cmpgt_epi32( lastLOD, held );
+	held   = _mm_or_si128( _mm_and_si128( greater, lastLOD ), _mm_andnot_si128( greater, held ) );
+	greater= _mm_cmpgt_epi32( held, lod );
+	lod	   = _mm_or_si128( _mm_and_si128( greater, lod ), _mm_andnot_si128( greater, held ) );
+
+	//only the visible patches get their new values
+	distance= _mm_or_ps( _mm_and_ps( visible, distance ),
+						 _mm_andnot_ps( visible, _mm_loadu_ps( pPatches->m_fpDistances+iPatch ) ) );
+	lod		= _mm_or_si128( _mm_and_si128( _mm_castps_si128( visible ), lod ),
+							_mm_andnot_si128( _mm_castps_si128( visible ), lastLOD ) );
+	_mm_storeu_ps( pPatches->m_fpDistances+iPatch, distance );
+	_mm_storeu_si128( ( __m128i* )( pPatches->m_ipLODs+iPatch ), lod );
+
+	return iVisible;
+}
+#endif
+
+//--------------------------------------------------------------
+// Name:			CullNode - global (this file only)
+// Description:		Test a quadtree node's bounding box against the view
+//					frustum, and pass its leaves on to be updated.  A node
+//					that is outside of a plane is dropped (along with
+//					everything under it), and a plane that a node is
+//					entirely inside of doesn't need to be tested again
+//					for anything under it.
+// Arguments:		-pJob: the update job
+//					-iNode: the node
+//					-iPlanes: the planes that the node's parent wasn't
+//							  entirely inside of
+// Return Value:	None
+//--------------------------------------------------------------
+static void CullNode( SGEOMM_UPDATE_JOB* pJob, int iNode, int iPlanes )
+{
+	SGEOMM_NODE* pNode= &pJob->m_pNodes[iNode];
+	float fX, fY, fZ;
+	float fHalfX, fHalfY, fHalfZ;
+	float fDistance, fRadius;
+	int i;
+
+	if( pNode->m_iMinX>=pNode->m_iMaxX || pNode->m_iMinZ>=pNode->m_iMaxZ )
+		return;
+
+	if( iPlanes )
+	{
+		fX	  = ( pNode->m_iMinX+pNode->m_iMaxX )*0.5f*pJob->m_iPatchSpan*pJob->m_fScale[0];
+		fZ	  = ( pNode->m_iMinZ+pNode->m_iMaxZ )*0.5f*pJob->m_iPatchSpan*pJob->m_fScale[2];
+		fY	  = ( pNode->m_fMaxHeight+pNode->m_fMinHeight )*0.5f*pJob->m_fScale[1];
+		fHalfX= ( float )fabs( ( pNode->m_iMaxX-pNode->m_iMinX )*0.5f*pJob->m_iPatchSpan*pJob->m_fScale[0] );
+		fHalfZ= ( float )fabs( ( pNode->m_iMaxZ-pNode->m_iMinZ )*0.5f*pJob->m_iPatchSpan*pJob->m_fScale[2] );
+		fHalfY= ( float )fabs( ( pNode->m_fMaxHeight-pNode->m_fMinHeight )*0.5f*pJob->m_fScale[1] );
+
+		for( i=0; i<6; i++ )
+		{
+			if( !( iPlanes & ( 1<<i ) ) )
+				continue;
+
+			fDistance= pJob->m_fPlanes[i][0]*fX + pJob->m_fPlanes[i][1]*fY + pJob->m_fPlanes[i][2]*fZ + pJob->m_fPlanes[i][3];
+			fRadius	 = ( float )fabs( pJob->m_fPlanes[i][0] )*fHalfX+
+					   ( float )fabs( pJob->m_fPlanes[i][1] )*fHalfY+
+					   ( float )fabs( pJob->m_fPlanes[i][2] )*fHalfZ;
+
+			//even the corner furthest along the normal is outside
+			if( fDistance+fRadius<=0 )
+				return;
+
+			//even the corner furthest against the normal is inside
+			if( fDistance-fRadius>0 )
+				iPlanes&= ~( 1<<i );
+		}
+	}
+
+	if( pNode->m_iFirstChild<0 )
+	{
+		pJob->m_ipLeaves[pJob->m_iNumLeaves]	= iNode;
+		pJob->m_ipLeafPlanes[pJob->m_iNumLeaves]= iPlanes;
+		pJob->m_iNumLeaves++;
+
+		if( iPlanes )
+			pJob->m_iPatchesTested+= ( pNode->m_iMaxX-pNode->m_iMinX )*( pNode->m_iMaxZ-pNode->m_iMinZ );
+		return;
+	}
+
+	for( i=0; i<4; i++ )
+		CullNode( pJob, pNode->m_iFirstChild+i, iPlanes );
+}
+
+//--------------------------------------------------------------
+// Name:			UpdateLeaf - global (this file only)
+// Description:		A thread pool job: update the patches of a quadtree
+//					leaf, eight at a time where possible, and list the
+//					visible ones (in the leaf's own part of the visible
+//					list)
+// Arguments:		-iJob: the leaf (in the list that CullNode made)
+//					-pData: the job (SGEOMM_UPDATE_JOB)
+// Return Value:	None
+//--------------------------------------------------------------
+static void UpdateLeaf( int iJob, void* pData )
+{
+	SGEOMM_UPDATE_JOB* pJob= ( SGEOMM_UPDATE_JOB* )pData;
+	SGEOMM_NODE* pNode= &pJob->m_pNodes[pJob->m_ipLeaves[iJob]];
+	int iPlanes= pJob->m_ipLeafPlanes[iJob];
+	int iPatch, iLast;
+	int iNumVisible;
+	int* ipVisible;
+	int z;
+#ifdef USE_SSE2
+	int iVisible;
+	int i;
+#endif
+
+	ipVisible  = pJob->m_ipVisible+iJob*GEOMM_LEAF_PATCHES*GEOMM_LEAF_PATCHES;
+	iNumVisible= 0;
+
+	for( z=pNode->m_iMinZ; z<pNode->m_iMaxZ; z++ )
+	{
+		iPatch= z*pJob->m_iNumPatchesPerSide+pNode->m_iMinX;
+		iLast = z*pJob->m_iNumPatchesPerSide+pNode->m_iMaxX;
+
+#ifdef USE_SSE2
+		for( ; iPatch+8<=iLast; iPatch+=8 )
+		{
+			iVisible= UpdatePatches4( pJob, iPatch, iPlanes ) | ( UpdatePatches4( pJob, iPatch+4, iPlanes )<<4 );
+
+			for( i=0; iVisible; i++, iVisible>>=1 )
+			{
+				if( iVisible & 1 )
+					ipVisible[iNumVisible++]= iPatch+i;
+			}
+		}
+#endif
+
+		for( ; iPatch<iLast; iPatch++ )
+		{
+			if( UpdatePatch( pJob, iPatch, iPlanes ) )
+				ipVisible[iNumVisible++]= iPatch;
+		}
+	}
+
+	pJob->m_ipLeafVisible[iJob]= iNumVisible;
+}
+
 //--------------------------------------------------------------
 // Name:			CGEOMIPMAPPING::Init - public
 // Description:		Initiate the geomipmapping system
-// Arguments:		- iPatchSize: the size of the patch (in vertices)
-//								  a good size is usually around 17 (17x17 verts)
+// Arguments:		- iPatchSize: the size of the patch (in vertices), a power
+//								  of two plus one from 3 to 129 (a good size
+//								  is usually around 17: 17x17 verts)
 // Return Value:	A boolean value: -true: successful initiation
 //									 -false: unsuccessful initiation
 //--------------------------------------------------------------
 bool CGEOMIPMAPPING::Init( int iPatchSize )
 {
-	int x, z;
 	int iLOD;
 	int iDivisor;
 	int iPatch;
@@ -45,21 +682,23 @@ bool CGEOMIPMAPPING::Init( int iPatchSize )
 	if( m_iSize==0 )
 		return false;
 
-	if( m_pPatches )
+	if( m_patches.m_ipLODs )
 		Shutdown( );
 
-	//initiate the patch information
-	m_iPatchSize= iPatchSize;
-	m_iNumPatchesPerSide= m_iSize/m_iPatchSize;
-	m_pPatches= new SGEOMM_PATCH [SQR( m_iNumPatchesPerSide )];
-	if( m_pPatches==NULL )
+	//every level of detail halves the patch's spacing, all the way down
+	//to a single fan, so the patch has to span a power of two units (and
+	//no more than 128, for the 16-bit template indices)
+	if( iPatchSize<3 || iPatchSize>129 || ( ( iPatchSize-1 ) & ( iPatchSize-2 ) )!=0 )
 	{
-		Shutdown( );
-
-		g_log.Write( LOG_SUCCESS, "Could not allocate memory for geomipmapping patch system" );
+		g_log.Write( LOG_FAILURE, "Geomipmapping patches must be a power of two plus one vertices on a side, from 3 to 129 (not %dx%d)", iPatchSize, iPatchSize );
 		return false;
 	}
 
+	//initiate the patch information (neighboring patches share their
+	//edge vertices)
+	m_iPatchSize= iPatchSize;
+	m_iNumPatchesPerSide= ( m_iSize-1 )/( m_iPatchSize-1 );
+
 	//figure out the maximum level of detail for a patch
 	iDivisor= m_iPatchSize-1;
 	iLOD= 0;
@@ -70,21 +709,39 @@ bool CGEOMIPMAPPING::Init( int iPatchSize )
 	}
 
 	//the max amount of detail
-	m_iMaxLOD= iLOD;
+	m_iMaxLOD= MIN( iLOD, GEOMM_MAX_LODS-1 );
+
+	SelectPatchKernels( );
 
-	//initialize the patch values
-	for( z=0; z<m_iNumPatchesPerSide; z++ )
+	if( !AllocatePatches( SQR( m_iNumPatchesPerSide ) ) )
 	{
-		for( x=0; x<m_iNumPatchesPerSide; x++ )
-		{
-			iPatch= GetPatchNumber( x, z );
+		Shutdown( );
 
-			//initialize the patches to the lowest level of detail
-			m_pPatches[iPatch].m_iLOD= m_iMaxLOD;
+		g_log.Write( LOG_FAILURE, "Could not allocate memory for geomipmapping patch system" );
+		return false;
+	}
 
-			m_pPatches[iPatch].m_bVisible= true;
-		}
+	//initialize the patches to the lowest level of detail, and all visible
+	for( iPatch=0; iPatch<SQR( m_iNumPatchesPerSide ); iPatch++ )
+	{
+		m_patches.m_fpDistances[iPatch]= 0.0f;
+		m_patches.m_ipLODs[iPatch]	   = m_iMaxLOD;
+		m_patches.m_ucpVisible[iPatch] = 1;
+		m_patches.m_fpMorphs[iPatch]   = 0.0f;
+		m_patches.m_ipLastFrames[iPatch]= -1;
+
+		m_ipVisiblePatches[iPatch]= iPatch;
+		m_ipDrawPatches[iPatch]	  = iPatch;
 	}
+	m_iNumVisiblePatches= SQR( m_iNumPatchesPerSide );
+	m_iNumDrawPatches	= m_iNumVisiblePatches;
+	m_iNumSuperPatches	= 0;
+	m_iPatchesMerged	= 0;
+
+	BuildTemplates( );
+	CalculatePatchErrors( );
+	CalculateMergeErrors( );
+	BuildQuadtree( );
 
 	g_log.Write( LOG_SUCCESS, "Geomipmapping system successfully initialized" );
 	return true;
@@ -98,85 +755,870 @@ bool CGEOMIPMAPPING::Init( int iPatchSize )
 //--------------------------------------------------------------
 void CGEOMIPMAPPING::Shutdown( void )
 {
-	//delete the patch buffer
-	if( m_pPatches )
-		delete[] m_pPatches;
+	//delete the patch buffers
+	FreePatches( );
+
+	delete[] m_uspTemplateIndices;
+	m_uspTemplateIndices = NULL;
+	m_iNumTemplateIndices= 0;
+
+	m_frameMesh.Free( );
 
 	//reset patch values
 	m_iPatchSize= 0;
 	m_iNumPatchesPerSide= 0;
 }
 
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::AllocatePatches - private
+// Description:		Allocate the patch arrays, the quadtree and the lists
+//					that Update makes
+// Arguments:		-iNumPatches: the number of patches
+// Return Value:	A boolean value: -true: everything was allocated
+//									 -false: out of memory
+//--------------------------------------------------------------
+bool CGEOMIPMAPPING::AllocatePatches( int iNumPatches )
+{
+	int iRootSize, iSize;
+	int iMaxNodes;
+	int iMaxLeaves;
+	int iLevel;
+	int iLOD;
+
+	m_patches.m_fpCenterX	  = new float [iNumPatches];
+	m_patches.m_fpCenterZ	  = new float [iNumPatches];
+	m_patches.m_fpCenterHeight= new float [iNumPatches];
+	m_patches.m_fpMinHeight	  = new float [iNumPatches];
+	m_patches.m_fpMaxHeight	  = new float [iNumPatches];
+	m_patches.m_fpDistances	  = new float [iNumPatches];
+	m_patches.m_ipLODs		  = new int [iNumPatches];
+	m_patches.m_ucpVisible	  = new unsigned char [iNumPatches];
+	m_patches.m_fpMorphs	  = new float [iNumPatches];
+	m_patches.m_ipLastFrames  = new int [iNumPatches];
+	m_patches.m_ipLastLODs	  = new int [iNumPatches];
+	m_patches.m_fpLastErrors  = new float [iNumPatches];
+
+	for( iLOD=0; iLOD<=m_iMaxLOD; iLOD++ )
+		m_patches.m_fpErrors[iLOD]= new float [iNumPatches];
+
+	for( iLevel=1; iLevel<=GEOMM_MERGE_LEVELS; iLevel++ )
+		m_patches.m_fpMergeErrors[iLevel-1]= new float [SQR( ( m_iNumPatchesPerSide>>iLevel ) )+1];
+
+	//the quadtree's root covers the smallest power of two (times a leaf)
+	//patches that the terrain fits in, and every node below it has all
+	//four of its children (some may be empty, past the terrain's edges)
+	iRootSize= GEOMM_LEAF_PATCHES;
+	while( iRootSize<m_iNumPatchesPerSide )
+		iRootSize*= 2;
+
+	iMaxNodes= 0;
+	for( iSize=iRootSize; iSize>=GEOMM_LEAF_PATCHES; iSize/=2 )
+		iMaxNodes+= SQR( iRootSize/iSize );
+	iMaxLeaves= SQR( iRootSize/GEOMM_LEAF_PATCHES );
+
+	m_pNodes		  = new SGEOMM_NODE [iMaxNodes];
+	m_ipCullLeaves	  = new int [iMaxLeaves];
+	m_ipCullPlanes	  = new int [iMaxLeaves];
+	m_ipLeafVisible	  = new int [iMaxLeaves];
+	m_ipVisiblePatches= new int [iMaxLeaves*GEOMM_LEAF_PATCHES*GEOMM_LEAF_PATCHES];
+
+	//the patches that are drawn on their own, and the super-patches (there
+	//can't be more than one for every four patches)
+	m_ipDrawPatches= new int [iNumPatches];
+	m_pSuperPatches= new SGEOMM_SUPER_PATCH [iNumPatches/4+1];
+
+	//the heights of the patch that is being built (geomorphing)
+	m_fpPatchHeights= new float [SQR( m_iPatchSize )];
+
+	//the vertex cache's entries (none of them cached yet), and a block
+	//for the patches that can't be kept
+	m_pCache		= new SGEOMM_CACHE_ENTRY [iNumPatches*( m_iMaxLOD+1 )];
+	m_pPatchVertices= new SBACKEND_VERTEX [SQR( m_iPatchSize )];
+	if( m_pCache )
+		memset( m_pCache, 0, iNumPatches*( m_iMaxLOD+1 )*sizeof( SGEOMM_CACHE_ENTRY ) );
+	m_iCacheHead  = -1;
+	m_iCacheTail  = -1;
+	m_uiCacheBytes= 0;
+
+	if( m_patches.m_fpCenterX==NULL || m_patches.m_fpCenterZ==NULL || m_patches.m_fpCenterHeight==NULL ||
+		m_patches.m_fpMinHeight==NULL || m_patches.m_fpMaxHeight==NULL || m_patches.m_fpDistances==NULL ||
+		m_patches.m_ipLODs==NULL || m_patches.m_ucpVisible==NULL || m_patches.m_fpMorphs==NULL ||
+		m_patches.m_ipLastFrames==NULL || m_patches.m_ipLastLODs==NULL || m_patches.m_fpLastErrors==NULL ||
+		m_pNodes==NULL || m_ipCullLeaves==NULL || m_ipCullPlanes==NULL || m_ipLeafVisible==NULL ||
+		m_ipVisiblePatches==NULL || m_fpPatchHeights==NULL || m_pCache==NULL || m_pPatchVertices==NULL ||
+		m_ipDrawPatches==NULL || m_pSuperPatches==NULL )
+		return false;
+
+	for( iLOD=0; iLOD<=m_iMaxLOD; iLOD++ )
+	{
+		if( m_patches.m_fpErrors[iLOD]==NULL )
+			return false;
+	}
+
+	for( iLevel=0; iLevel<GEOMM_MERGE_LEVELS; iLevel++ )
+	{
+		if( m_patches.m_fpMergeErrors[iLevel]==NULL )
+			return false;
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::FreePatches - private
+// Description:		Free the patch arrays (and the visible list)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::FreePatches( void )
+{
+	int iLOD;
+
+	delete[] m_patches.m_fpCenterX;
+	delete[] m_patches.m_fpCenterZ;
+	delete[] m_patches.m_fpCenterHeight;
+	delete[] m_patches.m_fpMinHeight;
+	delete[] m_patches.m_fpMaxHeight;
+	delete[] m_patches.m_fpDistances;
+	delete[] m_patches.m_ipLODs;
+	delete[] m_patches.m_ucpVisible;
+	delete[] m_patches.m_fpMorphs;
+	delete[] m_patches.m_ipLastFrames;
+	delete[] m_patches.m_ipLastLODs;
+	delete[] m_patches.m_fpLastErrors;
+
+	for( iLOD=0; iLOD<GEOMM_MAX_LODS; iLOD++ )
+		delete[] m_patches.m_fpErrors[iLOD];
+
+	for( iLOD=0; iLOD<GEOMM_MERGE_LEVELS; iLOD++ )
+		delete[] m_patches.m_fpMergeErrors[iLOD];
+
+	memset( &m_patches, 0, sizeof( SGEOMM_PATCHES ) );
+
+	delete[] m_pNodes;
+	m_pNodes	= NULL;
+	m_iNumNodes = 0;
+	m_iNumLeaves= 0;
+
+	delete[] m_ipCullLeaves;
+	delete[] m_ipCullPlanes;
+	m_ipCullLeaves	= NULL;
+	m_ipCullPlanes	= NULL;
+	m_iNumCullLeaves= 0;
+
+	delete[] m_ipVisiblePatches;
+	delete[] m_ipLeafVisible;
+	m_ipVisiblePatches	= NULL;
+	m_ipLeafVisible		= NULL;
+	m_iNumVisiblePatches= 0;
+
+	delete[] m_ipDrawPatches;
+	delete[] m_pSuperPatches;
+	m_ipDrawPatches	  = NULL;
+	m_pSuperPatches	  = NULL;
+	m_iNumDrawPatches = 0;
+	m_iNumSuperPatches= 0;
+	m_iPatchesMerged  = 0;
+
+	delete[] m_fpPatchHeights;
+	m_fpPatchHeights= NULL;
+
+	if( m_pCache )
+		FlushPatchCache( );
+
+	delete[] m_pCache;
+	delete[] m_pPatchVertices;
+	m_pCache		= NULL;
+	m_pPatchVertices= NULL;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildQuadtree - private
+// Description:		Build the quadtree that the patches are culled with
+//					(after the patches' bounds have been worked out)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::BuildQuadtree( void )
+{
+	int iRootSize;
+
+	iRootSize= GEOMM_LEAF_PATCHES;
+	while( iRootSize<m_iNumPatchesPerSide )
+		iRootSize*= 2;
+
+	m_iNumNodes = 1;
+	m_iNumLeaves= 0;
+	BuildNode( 0, 0, 0, iRootSize );
+	RefitNode( 0, 0, 0, m_iNumPatchesPerSide, m_iNumPatchesPerSide );
+
+	g_log.Write( LOG_SUCCESS, "Built a patch quadtree: %d nodes, %d leaves of up to %dx%d patches",
+				 m_iNumNodes, m_iNumLeaves, GEOMM_LEAF_PATCHES, GEOMM_LEAF_PATCHES );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildNode - private
+// Description:		Set up a quadtree node, and the nodes under it
+// Arguments:		-iNode: the node
+//					-iMinX, iMinZ: the first patch that it covers
+//					-iSize: the number of patches along each side (before
+//							it is clipped to the terrain)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::BuildNode( int iNode, int iMinX, int iMinZ, int iSize )
+{
+	SGEOMM_NODE* pNode= &m_pNodes[iNode];
+	int iHalf;
+	int i;
+
+	pNode->m_iMinX= MIN( iMinX, m_iNumPatchesPerSide );
+	pNode->m_iMinZ= MIN( iMinZ, m_iNumPatchesPerSide );
+	pNode->m_iMaxX= MIN( iMinX+iSize, m_iNumPatchesPerSide );
+	pNode->m_iMaxZ= MIN( iMinZ+iSize, m_iNumPatchesPerSide );
+
+	//the bounds are filled in by RefitNode
+	pNode->m_fMinHeight= 0.0f;
+	pNode->m_fMaxHeight= 0.0f;
+
+	if( iSize<=GEOMM_LEAF_PATCHES )
+	{
+		pNode->m_iFirstChild= -1;
+
+		if( pNode->m_iMinX<pNode->m_iMaxX && pNode->m_iMinZ<pNode->m_iMaxZ )
+			m_iNumLeaves++;
+		return;
+	}
+
+	pNode->m_iFirstChild= m_iNumNodes;
+	m_iNumNodes+= 4;
+
+	iHalf= iSize/2;
+	for( i=0; i<4; i++ )
+		BuildNode( pNode->m_iFirstChild+i, iMinX+( i & 1 )*iHalf, iMinZ+( i>>1 )*iHalf, iHalf );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::RefitNode - private
+// Description:		Recalculate the bounds of a node and the nodes under it,
+//					where they overlap a group of patches that changed
+// Arguments:		-iNode: the node
+//					-iMinX, iMinZ, iMaxX, iMaxZ: the patches that changed
+//												 ([min, max))
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::RefitNode( int iNode, int iMinX, int iMinZ, int iMaxX, int iMaxZ )
+{
+	SGEOMM_NODE* pNode= &m_pNodes[iNode];
+	SGEOMM_NODE* pChild;
+	bool bEmpty= true;
+	int iPatch;
+	int x, z;
+	int i;
+
+	if( pNode->m_iMinX>=iMaxX || pNode->m_iMaxX<=iMinX ||
+		pNode->m_iMinZ>=iMaxZ || pNode->m_iMaxZ<=iMinZ )
+		return;
+
+	if( pNode->m_iFirstChild<0 )
+	{
+		for( z=pNode->m_iMinZ; z<pNode->m_iMaxZ; z++ )
+		{
+			for( x=pNode->m_iMinX; x<pNode->m_iMaxX; x++ )
+			{
+				iPatch= GetPatchNumber( x, z );
+
+				if( bEmpty || m_patches.m_fpMinHeight[iPatch]<pNode->m_fMinHeight )
+					pNode->m_fMinHeight= m_patches.m_fpMinHeight[iPatch];
+				if( bEmpty || m_patches.m_fpMaxHeight[iPatch]>pNode->m_fMaxHeight )
+					pNode->m_fMaxHeight= m_patches.m_fpMaxHeight[iPatch];
+				bEmpty= false;
+			}
+		}
+
+		return;
+	}
+
+	for( i=0; i<4; i++ )
+	{
+		RefitNode( pNode->m_iFirstChild+i, iMinX, iMinZ, iMaxX, iMaxZ );
+
+		//skip the children past the terrain's edges
+		pChild= &m_pNodes[pNode->m_iFirstChild+i];
+		if( pChild->m_iMinX>=pChild->m_iMaxX || pChild->m_iMinZ>=pChild->m_iMaxZ )
+			continue;
+
+		if( bEmpty || pChild->m_fMinHeight<pNode->m_fMinHeight )
+			pNode->m_fMinHeight= pChild->m_fMinHeight;
+		if( bEmpty || pChild->m_fMaxHeight>pNode->m_fMaxHeight )
+			pNode->m_fMaxHeight= pChild->m_fMaxHeight;
+		bEmpty= false;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::RecalculateRegion - public
+// Description:		Bring the patches up to date after some of the height
+//					map has been changed (with SetHeightAtPoint): the
+//					normals around the changed points, the patches' bounds
+//					and errors, the quadtree's bounds above them, and the
+//					cached vertices
+// Arguments:		-iMinX, iMinZ: the first height map point that changed
+//					-iMaxX, iMaxZ: the last height map point that changed
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::RecalculateRegion( int iMinX, int iMinZ, int iMaxX, int iMaxZ )
+{
+	SGEOMM_ERROR_JOB job;
+	int iMinPX, iMinPZ, iMaxPX, iMaxPZ;
+	int iSpan;
+	int iEntry;
+	int iLevel;
+	int iLOD;
+	int PX, PZ;
+
+	if( m_pNodes==NULL )
+		return;
+
+	//(this does nothing if there is no normal map)
+	UpdateNormals( iMinX, iMinZ, iMaxX, iMaxZ );
+
+	//a point on the edge of a patch belongs to both of the patches
+	//that share the edge
+	iSpan = m_iPatchSize-1;
+	iMinPX= MAX( ( iMinX-1 )/iSpan, 0 );
+	iMinPZ= MAX( ( iMinZ-1 )/iSpan, 0 );
+	iMaxPX= MIN( iMaxX/iSpan, m_iNumPatchesPerSide-1 );
+	iMaxPZ= MIN( iMaxZ/iSpan, m_iNumPatchesPerSide-1 );
+
+	job.m_pPatches			= &m_patches;
+	job.m_ucpHeights		= m_heightData.m_ucpData;
+	job.m_iSize				= m_iSize;
+	job.m_iPatchSize		= m_iPatchSize;
+	job.m_iNumPatchesPerSide= m_iNumPatchesPerSide;
+	job.m_iMaxLOD			= m_iMaxLOD;
+
+	for( PZ=iMinPZ; PZ<=iMaxPZ; PZ++ )
+	{
+		for( PX=iMinPX; PX<=iMaxPX; PX++ )
+			CalculatePatch( &job, PX, PZ );
+	}
+
+	//the super-patches over the patches (a level at a time, since each
+	//one is based on the level below it)
+	for( iLevel=1; iLevel<=GEOMM_MERGE_LEVELS; iLevel++ )
+	{
+		job.m_iMergeLevel= iLevel;
+
+		for( PZ=iMinPZ>>iLevel; PZ<=MIN( iMaxPZ>>iLevel, ( m_iNumPatchesPerSide>>iLevel )-1 ); PZ++ )
+		{
+			for( PX=iMinPX>>iLevel; PX<=MIN( iMaxPX>>iLevel, ( m_iNumPatchesPerSide>>iLevel )-1 ); PX++ )
+				CalculateSuperPatch( &job, PX, PZ );
+		}
+	}
+
+	RefitNode( 0, iMinPX, iMinPZ, iMaxPX+1, iMaxPZ+1 );
+
+	//the cached vertices are out of date too (UpdateNormals changed the
+	//normals one point past the changed points along with them)
+	iMinPX= MAX( ( iMinX-2 )/iSpan, 0 );
+	iMinPZ= MAX( ( iMinZ-2 )/iSpan, 0 );
+	iMaxPX= MIN( ( iMaxX+1 )/iSpan, m_iNumPatchesPerSide-1 );
+	iMaxPZ= MIN( ( iMaxZ+1 )/iSpan, m_iNumPatchesPerSide-1 );
+
+	for( PZ=iMinPZ; PZ<=iMaxPZ; PZ++ )
+	{
+		for( PX=iMinPX; PX<=iMaxPX; PX++ )
+		{
+			for( iLOD=0; iLOD<=m_iMaxLOD; iLOD++ )
+			{
+				iEntry= iLOD*SQR( m_iNumPatchesPerSide )+GetPatchNumber( PX, PZ );
+				if( m_pCache[iEntry].m_pVertices )
+					EvictPatchVertices( iEntry );
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildTemplates - private
+// Description:		Build the index templates for every level of detail and
+//					set of neighbors, and order each one for the vertex
+//					cache
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::BuildTemplates( void )
+{
+	SGEOMM_NEIGHBOR neighbor;
+	unsigned int* uipIndices;
+	int iNumFans, iNumVerts;
+	int iMaxIndices;
+	int iLOD, iMask;
+	int i;
+
+	//the most indices that the templates could need (every fan drawn
+	//with eight triangles)
+	iMaxIndices= 0;
+	for( iLOD=0; iLOD<=m_iMaxLOD; iLOD++ )
+	{
+		iNumFans	= ( m_iPatchSize-1 )>>( iLOD+1 );
+		iMaxIndices+= iNumFans*iNumFans*8*3*GEOMM_NUM_NEIGHBOR_MASKS;
+	}
+
+	delete[] m_uspTemplateIndices;
+	m_uspTemplateIndices = new unsigned short [iMaxIndices];
+	m_iNumTemplateIndices= 0;
+
+	uipIndices= new unsigned int [( m_iPatchSize-1 )*( m_iPatchSize-1 )*8*3/4];
+
+	for( iLOD=0; iLOD<=m_iMaxLOD; iLOD++ )
+	{
+		iNumVerts= ( ( m_iPatchSize-1 )>>iLOD )+1;
+
+		for( iMask=0; iMask<GEOMM_NUM_NEIGHBOR_MASKS; iMask++ )
+		{
+			neighbor.m_bLeft = ( iMask & GEOMM_LEFT )!=0;
+			neighbor.m_bUp	 = ( iMask & GEOMM_UP )!=0;
+			neighbor.m_bRight= ( iMask & GEOMM_RIGHT )!=0;
+			neighbor.m_bDown = ( iMask & GEOMM_DOWN )!=0;
+
+			m_templates[iLOD][iMask].m_iFirstIndex= m_iNumTemplateIndices;
+			m_templates[iLOD][iMask].m_iNumIndices= BuildTemplate( iLOD, neighbor, uipIndices );
+
+			OptimizeVertexCache( uipIndices, m_templates[iLOD][iMask].m_iNumIndices, iNumVerts*iNumVerts );
+
+			for( i=0; i<m_templates[iLOD][iMask].m_iNumIndices; i++ )
+				m_uspTemplateIndices[m_iNumTemplateIndices++]= ( unsigned short )uipIndices[i];
+		}
+	}
+
+	delete[] uipIndices;
+
+	g_log.Write( LOG_SUCCESS, "Built %d patch index templates (%d LODs, %d neighbor masks): %d indices, %d bytes",
+				 ( m_iMaxLOD+1 )*GEOMM_NUM_NEIGHBOR_MASKS, m_iMaxLOD+1, GEOMM_NUM_NEIGHBOR_MASKS,
+				 m_iNumTemplateIndices, m_iNumTemplateIndices*sizeof( unsigned short ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildTemplate - private
+// Description:		Build the triangles of a patch at one level of detail:
+//					a triangle fan around every other vertex, with the
+//					middle vertex left off of the edges whose neighbors
+//					have less detail (to prevent cracking)
+// Arguments:		-iLOD: the level of detail
+//					-neighbor: the edges whose middle vertices are drawn
+//					-uipIndices: storage for the triangle list (indices
+//								 into the patch's vertex block at that
+//								 level of detail)
+// Return Value:	An integer value: the number of indices
+//--------------------------------------------------------------
+int CGEOMIPMAPPING::BuildTemplate( int iLOD, SGEOMM_NEIGHBOR neighbor, unsigned int* uipIndices )
+{
+	unsigned int uiFan[10];
+	int iNumFanVerts;
+	int iNumVerts, iNumFans;
+	int iNumIndices= 0;
+	int cX, cZ;
+	int x, z;
+	int i;
+
+	iNumVerts= ( ( m_iPatchSize-1 )>>iLOD )+1;
+	iNumFans = ( iNumVerts-1 )/2;
+
+	for( z=0; z<iNumFans; z++ )
+	{
+		for( x=0; x<iNumFans; x++ )
+		{
+			cX= x*2+1;
+			cZ= z*2+1;
+
+			//the center, and then the rim (the same order that the fans
+			//have always been built in)
+			iNumFanVerts= 0;
+			uiFan[iNumFanVerts++]= cZ*iNumVerts+cX;
+			uiFan[iNumFanVerts++]= ( cZ-1 )*iNumVerts+cX-1;
+
+			//only the left edge's fans may need to leave out the mid-left vertex
+			if( x>0 || neighbor.m_bLeft )
+				uiFan[iNumFanVerts++]= cZ*iNumVerts+cX-1;
+
+			uiFan[iNumFanVerts++]= ( cZ+1 )*iNumVerts+cX-1;
+
+			if( z<iNumFans-1 || neighbor.m_bUp )
+				uiFan[iNumFanVerts++]= ( cZ+1 )*iNumVerts+cX;
+
+			uiFan[iNumFanVerts++]= ( cZ+1 )*iNumVerts+cX+1;
+
+			if( x<iNumFans-1 || neighbor.m_bRight )
+				uiFan[iNumFanVerts++]= cZ*iNumVerts+cX+1;
+
+			uiFan[iNumFanVerts++]= ( cZ-1 )*iNumVerts+cX+1;
+
+			if( z>0 || neighbor.m_bDown )
+				uiFan[iNumFanVerts++]= ( cZ-1 )*iNumVerts+cX;
+
+			uiFan[iNumFanVerts++]= ( cZ-1 )*iNumVerts+cX-1;
+
+			//turn the fan into triangles
+			for( i=1; i<iNumFanVerts-1; i++ )
+			{
+				uipIndices[iNumIndices++]= uiFan[0];
+				uipIndices[iNumIndices++]= uiFan[i];
+				uipIndices[iNumIndices++]= uiFan[i+1];
+			}
+		}
+	}
+
+	return iNumIndices;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::CalculatePatchErrors - private
+// Description:		Work out how far each patch's surface strays from the
+//					height map at each level of detail (the rows of
+//					patches are split across the thread pool)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::CalculatePatchErrors( void )
+{
+	SGEOMM_ERROR_JOB job;
+
+	job.m_pPatches			= &m_patches;
+	job.m_ucpHeights		= m_heightData.m_ucpData;
+	job.m_iSize				= m_iSize;
+	job.m_iPatchSize		= m_iPatchSize;
+	job.m_iNumPatchesPerSide= m_iNumPatchesPerSide;
+	job.m_iMaxLOD			= m_iMaxLOD;
+
+	g_threadPool.Run( PatchErrorRow, &job, m_iNumPatchesPerSide );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::CalculateMergeErrors - private
+// Description:		Work out the errors of the super-patches, a level at a
+//					time (after the patches' errors), with each level's
+//					rows split across the thread pool
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::CalculateMergeErrors( void )
+{
+	SGEOMM_ERROR_JOB job;
+	int iLevel;
+
+	job.m_pPatches			= &m_patches;
+	job.m_ucpHeights		= m_heightData.m_ucpData;
+	job.m_iSize				= m_iSize;
+	job.m_iPatchSize		= m_iPatchSize;
+	job.m_iNumPatchesPerSide= m_iNumPatchesPerSide;
+	job.m_iMaxLOD			= m_iMaxLOD;
+
+	for( iLevel=1; iLevel<=GEOMM_MERGE_LEVELS; iLevel++ )
+	{
+		job.m_iMergeLevel= iLevel;
+		g_threadPool.Run( SuperPatchErrorRow, &job, m_iNumPatchesPerSide>>iLevel );
+	}
+}
+
 //--------------------------------------------------------------
 // Name:			CGEOMIPMAPPING::Update - public
-// Description:		Update the geomipmapping system
+// Description:		Update the geomipmapping system: cull the patches, and
+//					give each visible one the least detail that keeps its
+//					error on the screen within the pixel tolerance.  The
+//					patches are culled with the quadtree, its visible
+//					leaves are split across the thread pool, and the
+//					visible patches are listed for rendering (with their
+//					morph factors, if geomorphing is on).
 // Arguments:		-camera: the camera object your demo is using
 //					-bCullPatches: cull unseen patches (true by default)
 // Return Value:	None
 //--------------------------------------------------------------
 void CGEOMIPMAPPING::Update( CCAMERA camera, bool bCullPatches )
 {
-	float fX, fY, fZ;
-	float fScaledSize;
-	int x, z;
+	SGEOMM_UPDATE_JOB job;
+	int iLeaf;
+
+	if( m_pNodes==NULL )
+		return;
+
+	job.m_pPatches			= &m_patches;
+	job.m_pNodes			= m_pNodes;
+	job.m_iNumPatchesPerSide= m_iNumPatchesPerSide;
+	job.m_iPatchSpan		= m_iPatchSize-1;
+	job.m_iMaxLOD			= m_iMaxLOD;
+	job.m_ipLeaves			= m_ipCullLeaves;
+	job.m_ipLeafPlanes		= m_ipCullPlanes;
+	job.m_iNumLeaves		= 0;
+	job.m_iPatchesTested	= 0;
+	job.m_ipVisible			= m_ipVisiblePatches;
+	job.m_ipLeafVisible		= m_ipLeafVisible;
+
+	memcpy( job.m_fPlanes, camera.m_viewFrustum, sizeof( job.m_fPlanes ) );
+	job.m_fEyePos[0]= camera.m_vecEyePos[0];
+	job.m_fEyePos[1]= camera.m_vecEyePos[1];
+	job.m_fEyePos[2]= camera.m_vecEyePos[2];
+	job.m_fScale[0] = m_vecScale[0];
+	job.m_fScale[1] = m_vecScale[1];
+	job.m_fScale[2] = m_vecScale[2];
+
+	job.m_fHalfSpanX	= ( m_iPatchSize-1 )*0.5f*( float )fabs( m_vecScale[0] );
+	job.m_fHalfSpanZ	= ( m_iPatchSize-1 )*0.5f*( float )fabs( m_vecScale[2] );
+	job.m_fErrorPerUnit = m_fPixelTolerance/( m_fErrorScale*m_vecScale[1] );
+	job.m_fHysteresis	= 1.0f/( 1.0f+m_fLODHysteresis );
+
+	//the patches under the nodes that get culled are never looked at
+	memset( m_patches.m_ucpVisible, 0, SQR( m_iNumPatchesPerSide ) );
+
+	//find the leaves that are at least partly visible (and the planes
+	//that their patches still need to be tested against)
+	CullNode( &job, 0, bCullPatches ? GEOMM_ALL_PLANES : 0 );
+
+	m_iNumCullLeaves= job.m_iNumLeaves;
+	m_iPatchesTested= job.m_iPatchesTested;
+
+	g_threadPool.Run( UpdateLeaf, &job, job.m_iNumLeaves );
+
+	//pack the leaves' parts of the list together
+	m_iNumVisiblePatches= 0;
+	for( iLeaf=0; iLeaf<job.m_iNumLeaves; iLeaf++ )
+	{
+		if( m_ipLeafVisible[iLeaf]>0 )
+		{
+			memmove( &m_ipVisiblePatches[m_iNumVisiblePatches], &m_ipVisiblePatches[iLeaf*GEOMM_LEAF_PATCHES*GEOMM_LEAF_PATCHES],
+					 m_ipLeafVisible[iLeaf]*sizeof( int ) );
+			m_iNumVisiblePatches+= m_ipLeafVisible[iLeaf];
+		}
+	}
+
+	LimitLODSteps( );
+	CalculateMorphs( );
+	MergePatches( );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::LimitLODSteps - private
+// Description:		Add detail to patches until no visible patch is more
+//					than one level of detail coarser than a visible
+//					neighbor (BuildPatch can only hide the crack between
+//					patches that are one level apart).  Detail is only
+//					ever added, so every patch stays within the tolerance.
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::LimitLODSteps( void )
+{
+	bool bChanged;
 	int iPatch;
+	int i;
 
-	fScaledSize= m_iPatchSize*m_vecScale[0];
+	do
+	{
+		bChanged= false;
 
-	for( z=0; z<m_iNumPatchesPerSide; z++ )
+		for( i=0; i<m_iNumVisiblePatches; i++ )
+		{
+			iPatch= m_ipVisiblePatches[i];
+
+			//the patches to the right of and above this one (the other
+			//two neighbors check this patch themselves)
+			if( iPatch%m_iNumPatchesPerSide<m_iNumPatchesPerSide-1 )
+				bChanged|= LimitLODStep( iPatch, iPatch+1 );
+
+			if( iPatch/m_iNumPatchesPerSide<m_iNumPatchesPerSide-1 )
+				bChanged|= LimitLODStep( iPatch, iPatch+m_iNumPatchesPerSide );
+		}
+	} while( bChanged );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::CalculateMorphs - private
+// Description:		Work out how far each visible patch has morphed
+//					towards its next coarser level of detail (it starts
+//					once the error that the patch is allowed passes
+//					GEOMM_MORPH_START of that level's error, and is done
+//					when the patch would switch), and measure the pops of
+//					the patches whose levels of detail changed
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::CalculateMorphs( void )
+{
+	float fErrorPerUnit= m_fPixelTolerance/( m_fErrorScale*m_vecScale[1] );
+	float fMaxError, fStart, fEnd;
+	float fMorph;
+	float fError, fPop;
+	int iPatch, iLOD;
+	int i;
+
+	m_iUpdateFrame++;
+	m_iLODSwitches	 = 0;
+	m_fMaxPopPixels	 = 0.0f;
+	m_fTotalPopPixels= 0.0f;
+
+	for( i=0; i<m_iNumVisiblePatches; i++ )
 	{
-		for( x=0; x<m_iNumPatchesPerSide; x++ )
+		iPatch= m_ipVisiblePatches[i];
+		iLOD  = m_patches.m_ipLODs[iPatch];
+
+		fMorph= 0.0f;
+		if( m_bGeomorphing && iLOD<m_iMaxLOD )
 		{
-			iPatch= GetPatchNumber( x, z );
+			fMaxError= m_patches.m_fpDistances[iPatch]*fErrorPerUnit;
+
+			//the morph can't start before the patch got this level of
+			//detail, or it would pop when it did
+			fEnd  = m_patches.m_fpErrors[iLOD+1][iPatch];
+			fStart= MAX( fEnd*GEOMM_MORPH_START, m_patches.m_fpErrors[iLOD][iPatch] );
+
+			//(a patch that LimitLODSteps gave more detail is all of the
+			//way there)
+			if( fMaxError>=fEnd )
+				fMorph= 1.0f;
+			else if( fMaxError>fStart )
+				fMorph= ( fMaxError-fStart )/( fEnd-fStart );
+		}
+		m_patches.m_fpMorphs[iPatch]= fMorph;
 
-			//compute patch center (used for distance determination
-			fX= ( x*m_iPatchSize )+( m_iPatchSize/2.0f );
-			fZ= ( z*m_iPatchSize )+( m_iPatchSize/2.0f );
-			fY= GetScaledHeightAtPoint( ( int )fX, ( int )fZ );
+		//a patch that was also seen by the last update, at another level
+		//of detail, popped by (up to) the difference in their errors
+		fError= GetMorphedError( iPatch, iLOD, fMorph );
+		if( m_patches.m_ipLastFrames[iPatch]==m_iUpdateFrame-1 && m_patches.m_ipLastLODs[iPatch]!=iLOD &&
+			m_patches.m_fpDistances[iPatch]>0.0f )
+		{
+			fPop= ( float )fabs( fError-m_patches.m_fpLastErrors[iPatch] )*
+				  ( float )fabs( m_vecScale[1] )*m_fErrorScale/m_patches.m_fpDistances[iPatch];
 
-			//only scale the X and Z values, the Y value has already been scaled
-			fX*= m_vecScale[0];
-			fZ*= m_vecScale[2];
+			m_iLODSwitches++;
+			m_fTotalPopPixels+= fPop;
+			if( fPop>m_fMaxPopPixels )
+				m_fMaxPopPixels= fPop;
+		}
 
-			//check to see if the user wanted to cull the non-visible patches
-			if( bCullPatches )
-			{
-				//do a frustum test against the patch
-				if( camera.CubeFrustumTest( fX, fY, fZ, m_iPatchSize*m_vecScale[0] ) )
-					m_pPatches[iPatch].m_bVisible= true;
+		m_patches.m_ipLastFrames[iPatch]= m_iUpdateFrame;
+		m_patches.m_ipLastLODs[iPatch]	= iLOD;
+		m_patches.m_fpLastErrors[iPatch]= fError;
+	}
+}
 
-				//the patch is not visible
-				else
-					m_pPatches[iPatch].m_bVisible= false;
-			}
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::MergePatches - private
+// Description:		Split the visible patches into the ones that are drawn
+//					on their own and the squares of them that are drawn as
+//					super-patches: each quadtree leaf is merged into one
+//					super-patch if it can be, or else each quarter of it
+//					is tried, and so on down to the single patches
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::MergePatches( void )
+{
+	SGEOMM_NODE* pNode;
+	float fErrorPerUnit= m_fPixelTolerance/( m_fErrorScale*m_vecScale[1] );
+	int iLeaf;
 
-			//make all patches visible
-			else
-				m_pPatches[iPatch].m_bVisible= true;
+	m_iNumSuperPatches= 0;
+	m_iPatchesMerged  = 0;
+
+	if( !m_bMergePatches )
+	{
+		memcpy( m_ipDrawPatches, m_ipVisiblePatches, m_iNumVisiblePatches*sizeof( int ) );
+		m_iNumDrawPatches= m_iNumVisiblePatches;
+		return;
+	}
+
+	m_iNumDrawPatches= 0;
+	for( iLeaf=0; iLeaf<m_iNumCullLeaves; iLeaf++ )
+	{
+		pNode= &m_pNodes[m_ipCullLeaves[iLeaf]];
+		MergeSquare( GEOMM_MERGE_LEVELS, pNode->m_iMinX, pNode->m_iMinZ, fErrorPerUnit );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::MergeSquare - private
+// Description:		Draw a square of patches as one super-patch if it can
+//					be, or else try each quarter of it
+// Arguments:		-iLevel: the square is 2^level patches on a side
+//					-PX, PZ: the square's first patch
+//					-fErrorPerUnit: the biggest error allowed, one unit away
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::MergeSquare( int iLevel, int PX, int PZ, float fErrorPerUnit )
+{
+	SGEOMM_SUPER_PATCH* pSuperPatch;
+	int iPatch;
+	int iHalf;
+
+	//(the last leaves can run past the terrain's edges)
+	if( PX>=m_iNumPatchesPerSide || PZ>=m_iNumPatchesPerSide )
+		return;
+
+	if( iLevel==0 )
+	{
+		iPatch= GetPatchNumber( PX, PZ );
+		if( m_patches.m_ucpVisible[iPatch] )
+			m_ipDrawPatches[m_iNumDrawPatches++]= iPatch;
+		return;
+	}
+
+	if( CanMerge( iLevel, PX, PZ, fErrorPerUnit ) )
+	{
+		pSuperPatch= &m_pSuperPatches[m_iNumSuperPatches++];
+		pSuperPatch->m_iLevel= iLevel;
+		pSuperPatch->m_iPX	 = PX;
+		pSuperPatch->m_iPZ	 = PZ;
+
+		m_iPatchesMerged+= 1<<( iLevel*2 );
+		return;
+	}
+
+	iHalf= 1<<( iLevel-1 );
+	MergeSquare( iLevel-1, PX,		 PZ,		 fErrorPerUnit );
+	MergeSquare( iLevel-1, PX+iHalf, PZ,		 fErrorPerUnit );
+	MergeSquare( iLevel-1, PX,		 PZ+iHalf, fErrorPerUnit );
+	MergeSquare( iLevel-1, PX+iHalf, PZ+iHalf, fErrorPerUnit );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::CanMerge - private
+// Description:		Check whether a square of patches can be drawn as one
+//					super-patch: all of its patches have to be visible and
+//					at the coarsest level of detail (so their neighbors
+//					already treat the edges the way that the super-patch
+//					draws them), and the super-patch's error has to be
+//					within the tolerance at the closest patch's distance
+// Arguments:		-iLevel: the square is 2^level patches on a side
+//					-PX, PZ: the square's first patch
+//					-fErrorPerUnit: the biggest error allowed, one unit away
+// Return Value:	A boolean value: -true: the square can be merged
+//									 -false: it can't
+//--------------------------------------------------------------
+bool CGEOMIPMAPPING::CanMerge( int iLevel, int PX, int PZ, float fErrorPerUnit )
+{
+	float fDistance;
+	int iSize= 1<<iLevel;
+	int iPatch;
+	int x, z;
 
-			//only finish updating if the patch is visible
-			if( m_pPatches[iPatch].m_bVisible )
-			{
-				//get the distance from the camera to the patch
-				m_pPatches[iPatch].m_fDistance= sqrtf( SQR( ( fX-camera.m_vecEyePos[0] ) )+
-													   SQR( ( fY-camera.m_vecEyePos[1] ) )+
-													   SQR( ( fZ-camera.m_vecEyePos[2] ) ) );
-
-				//BAD way to determine patch LOD, we will be fixing this code a bit later in the chapter
-				if( m_pPatches[iPatch].m_fDistance<100 )
-					m_pPatches[iPatch].m_iLOD= 0;
-			
-				else if( m_pPatches[iPatch].m_fDistance<250 )
-					m_pPatches[iPatch].m_iLOD= 1;
+	if( PX+iSize>m_iNumPatchesPerSide || PZ+iSize>m_iNumPatchesPerSide )
+		return false;
 
-				else if( m_pPatches[iPatch].m_fDistance<750 )
-					m_pPatches[iPatch].m_iLOD= 2;
+	fDistance= -1.0f;
+	for( z=PZ; z<PZ+iSize; z++ )
+	{
+		for( x=PX; x<PX+iSize; x++ )
+		{
+			iPatch= GetPatchNumber( x, z );
+			if( !m_patches.m_ucpVisible[iPatch] || m_patches.m_ipLODs[iPatch]!=m_iMaxLOD )
+				return false;
 
-				else if( m_pPatches[iPatch].m_fDistance>=750 )
-					m_pPatches[iPatch].m_iLOD= 3;
-			}
+			if( fDistance<0.0f || m_patches.m_fpDistances[iPatch]<fDistance )
+				fDistance= m_patches.m_fpDistances[iPatch];
 		}
 	}
+
+	return ( m_patches.m_fpMergeErrors[iLevel-1][( PZ>>iLevel )*( m_iNumPatchesPerSide>>iLevel )+( PX>>iLevel )]<=fDistance*fErrorPerUnit );
 }
 
 //--------------------------------------------------------------
@@ -187,46 +1629,30 @@ void CGEOMIPMAPPING::Update( CCAMERA camera, bool bCullPatches )
 //--------------------------------------------------------------
 void CGEOMIPMAPPING::Render( void )
 {
-	int	x, z;
+	bool bMultiTex;
+	int iFormat;
 
-	//reset the counting variables
-	m_iPatchesPerFrame = 0;
-	
-	m_iVertsPerFrame= 0;
-	m_iTrisPerFrame = 0;
+	iFormat= PrepareMesh( &bMultiTex );
 
 	//enable back-face culling
-	glEnable( GL_CULL_FACE );
+	m_pBackend->SetState( BACKEND_CULL_FACE, true );
 
 	//render the multitexturing terrain
-	if( m_bMultitexture && m_bDetailMapping && m_bTextureMapping )
+	if( bMultiTex )
 	{
-		glDisable( GL_BLEND );
+		m_pBackend->SetState( BACKEND_BLEND, false );
 
 		//bind the primary color texture to the first texture unit
-		glActiveTextureARB( GL_TEXTURE0_ARB );
-		glEnable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
+		m_pBackend->SetState( BACKEND_TEXTURE0, true );
+		m_pBackend->BindTexture( 0, m_texture.GetID( ) );
 
 		//bind the detail color texture to the second texture unit
-		glActiveTextureARB( GL_TEXTURE1_ARB );
-		glEnable( GL_TEXTURE_2D );
-		glBindTexture( GL_TEXTURE_2D, m_detailMap.GetID( ) );
-		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB );
-		glTexEnvi( GL_TEXTURE_ENV, GL_RGB_SCALE_ARB, 2 );
+		m_pBackend->SetState( BACKEND_TEXTURE1, true );
+		m_pBackend->BindTexture( 1, m_detailMap.GetID( ) );
+		m_pBackend->SetCombineMode( 1, BACKEND_COMBINE_DETAIL );
 
 		//render the patches
-		for( z=0; z<m_iNumPatchesPerSide; z++ )
-		{
-			for( x=0; x<m_iNumPatchesPerSide; x++ )
-			{
-				if( m_pPatches[GetPatchNumber( x, z )].m_bVisible )
-				{
-					RenderPatch( x, z, true, true );
-					m_iPatchesPerFrame++;
-				}
-			}
-		}
+		DrawMesh( iFormat );
 	}
 	
 	//no hardware multitexturing available, or the user only wants to render
@@ -236,22 +1662,11 @@ void CGEOMIPMAPPING::Render( void )
 		if( m_bTextureMapping )
 		{
 			//bind the primary color texture (FOR THE PRIMARY TEXTURE PASS)
-			glActiveTextureARB( GL_TEXTURE0_ARB );
-			glEnable( GL_TEXTURE_2D );
-			glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
+			m_pBackend->SetState( BACKEND_TEXTURE0, true );
+			m_pBackend->BindTexture( 0, m_texture.GetID( ) );
 
 			//render the color texture
-			for( z=0; z<m_iNumPatchesPerSide; z++ )
-			{
-				for( x=0; x<m_iNumPatchesPerSide; x++ )
-				{
-					if( m_pPatches[GetPatchNumber( x, z )].m_bVisible )
-					{
-						RenderPatch( x, z, true, true );
-						m_iPatchesPerFrame++;
-					}
-				}
-			}
+			DrawMesh( iFormat );
 		}
 
 		if( !( m_bTextureMapping && !m_bDetailMapping ) )
@@ -260,242 +1675,771 @@ void CGEOMIPMAPPING::Render( void )
 			if( m_bDetailMapping )
 			{
 				//bind the detail texture
-				glActiveTextureARB( GL_TEXTURE0_ARB );
-				glEnable( GL_TEXTURE_2D );
-				glBindTexture( GL_TEXTURE_2D, m_detailMap.GetID( ) );
+				m_pBackend->SetState( BACKEND_TEXTURE0, true );
+				m_pBackend->BindTexture( 0, m_detailMap.GetID( ) );
 			
 				//only use blending if a texture pass was made
 				if( m_bTextureMapping )
 				{
-					glEnable( GL_BLEND );
-					glBlendFunc( GL_ZERO, GL_SRC_COLOR );
+					m_pBackend->SetState( BACKEND_BLEND, true );
+					m_pBackend->SetBlendMode( BACKEND_BLEND_MULTIPLY );
 				}
+
+				//the mesh only has the color map's texture coordinates, so
+				//the texture matrix stretches them for the detail map
+				m_pBackend->SetTextureScale( 0, ( float )m_iRepeatDetailMap );
 			}
 
 			//render either the detail map on top of the texture,
 			//only the detail map, or neither
-			for( z=0; z<m_iNumPatchesPerSide; z++ )
+			DrawMesh( iFormat );
+
+			if( m_bDetailMapping )
+				m_pBackend->SetTextureScale( 0, 1.0f );
+		}
+	}
+
+	m_pBackend->SetState( BACKEND_BLEND, false );
+
+	//unbind the texture occupying the second texture unit
+	m_pBackend->SetState( BACKEND_TEXTURE1, false );
+	m_pBackend->BindTexture( 1, 0 );
+
+	//unbind the texture occupying the first texture unit
+	m_pBackend->SetState( BACKEND_TEXTURE0, false );
+	m_pBackend->BindTexture( 0, 0 );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::PrepareMesh - private
+// Description:		Reset the frame's counters and build the frame's mesh
+//					(once, no matter how many passes it takes to draw it)
+// Arguments:		-pbMultiTex: storage for whether the mesh is drawn in
+//								 one multitextured pass
+// Return Value:	An integer value: the vertex format that the passes
+//					draw the mesh with (BACKEND_*)
+//--------------------------------------------------------------
+int CGEOMIPMAPPING::PrepareMesh( bool* pbMultiTex )
+{
+	bool bFog, bLighting;
+
+	//reset the counting variables
+	m_iPatchesPerFrame = 0;
+	m_iCacheHits	   = 0;
+	m_iPatchesRebuilt  = 0;
+	
+	m_iVertsPerFrame= 0;
+	m_iTrisPerFrame = 0;
+
+	//the light's color is the same for every vertex, so it only needs to
+	//be applied to each brightness value once
+	BuildShadeTable( );
+
+	//a fog depth of zero makes every fog coordinate zero, so there is no
+	//need to send any; normals are only sent once the normal map exists
+	*pbMultiTex= ( m_bMultitexture && m_bDetailMapping && m_bTextureMapping );
+	bFog	   = ( m_fFogDepth>0.0f );
+	bLighting  = ( m_uspNormals!=NULL );
+
+	BuildMesh( bFog );
+
+	return GetVertexFormat( *pbMultiTex, bFog, bLighting );
+}
+
+//--------------------------------------------------------------
+// Name:			MorphEdge - global (this file only)
+// Description:		Slide the vertices along one edge of a patch's vertex
+//					block towards the edge of the next coarser level
+// Arguments:		-fpHeights: the first vertex of the edge
+//					-iStride: the distance between the edge's vertices
+//					-iNumVerts: the number of vertices along the edge
+//					-iSpacing: the spacing of the vertices that are drawn
+//					-fMorph: how far to morph them
+// Return Value:	None
+//--------------------------------------------------------------
+static void MorphEdge( float* fpHeights, int iStride, int iNumVerts, int iSpacing, float fMorph )
+{
+	float fMiddle;
+	int i;
+
+	if( fMorph<=0.0f )
+		return;
+
+	//every other drawn vertex goes, and is replaced by the middle of the
+	//line between its neighbors
+	for( i=iSpacing; i<iNumVerts-1; i+= iSpacing*2 )
+	{
+		fMiddle= ( fpHeights[( i-iSpacing )*iStride]+fpHeights[( i+iSpacing )*iStride] )*0.5f;
+		fpHeights[i*iStride]+= ( fMiddle-fpHeights[i*iStride] )*fMorph;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::MorphPatch - private
+// Description:		Fill in the morphed heights of a patch's vertex block.
+//					The vertices that its next coarser level of detail
+//					doesn't have slide towards the coarser level's
+//					triangles, and the edges morph the way that the
+//					neighbors' edges do, so that they still line up.
+// Arguments:		-PX, PZ: the patch
+//					-pVertices: the patch's vertex block (unmorphed)
+//					-iWidth (template): the block's width (0: work it out)
+// Return Value:	None
+//--------------------------------------------------------------
+template< int iWidth >
+void CGEOMIPMAPPING::MorphPatch( int PX, int PZ, const SBACKEND_VERTEX* pVertices )
+{
+	float* fpHeights= m_fpPatchHeights;
+	float fMorph, fEdgeMorph;
+	float fMiddle;
+	int iPatch= GetPatchNumber( PX, PZ );
+	int iLOD= m_patches.m_ipLODs[iPatch];
+	int iNumVerts, iLast;
+	int iSpacing;
+	int iA, iB;
+	int x, z;
+
+	fMorph	 = m_patches.m_fpMorphs[iPatch];
+	iNumVerts= iWidth ? iWidth : ( ( m_iPatchSize-1 )>>iLOD )+1;
+	iLast	 = iNumVerts-1;
+
+	//start with every vertex at its real height
+	for( x=0; x<SQR( iNumVerts ); x++ )
+		fpHeights[x]= pVertices[x].m_fPosition[1];
+
+	//the edges (left, right, down, up)
+	fEdgeMorph= GetEdgeMorph( PX-1, PZ, iLOD, fMorph, &iSpacing );
+	MorphEdge( &fpHeights[0], iNumVerts, iNumVerts, iSpacing, fEdgeMorph );
+
+	fEdgeMorph= GetEdgeMorph( PX+1, PZ, iLOD, fMorph, &iSpacing );
+	MorphEdge( &fpHeights[iLast], iNumVerts, iNumVerts, iSpacing, fEdgeMorph );
+
+	fEdgeMorph= GetEdgeMorph( PX, PZ-1, iLOD, fMorph, &iSpacing );
+	MorphEdge( &fpHeights[0], 1, iNumVerts, iSpacing, fEdgeMorph );
+
+	fEdgeMorph= GetEdgeMorph( PX, PZ+1, iLOD, fMorph, &iSpacing );
+	MorphEdge( &fpHeights[iLast*iNumVerts], 1, iNumVerts, iSpacing, fEdgeMorph );
+
+	if( fMorph<=0.0f )
+		return;
+
+	//the inside: a vertex on an odd row or column is the middle of an
+	//edge of the coarser level's triangles (which only use the even rows
+	//and columns, so they have already been morphed)
+	for( z=1; z<iLast; z++ )
+	{
+		for( x=1; x<iLast; x++ )
+		{
+			if( x & 1 )
 			{
-				for( x=0; x<m_iNumPatchesPerSide; x++ )
+				if( z & 1 )
 				{
-					if( m_pPatches[GetPatchNumber( x, z )].m_bVisible )
+					//the middle of a diagonal (the coarser fans' diagonals
+					//alternate direction from one square to the next)
+					if( ( x & 2 )==( z & 2 ) )
 					{
-						RenderPatch( x, z, true, true );
-						m_iPatchesPerFrame++;
+						iA= ( z-1 )*iNumVerts+x-1;
+						iB= ( z+1 )*iNumVerts+x+1;
 					}
+					else
+					{
+						iA= ( z+1 )*iNumVerts+x-1;
+						iB= ( z-1 )*iNumVerts+x+1;
+					}
+				}
+				else
+				{
+					iA= z*iNumVerts+x-1;
+					iB= z*iNumVerts+x+1;
 				}
 			}
+			else if( z & 1 )
+			{
+				iA= ( z-1 )*iNumVerts+x;
+				iB= ( z+1 )*iNumVerts+x;
+			}
+			else
+				continue;
+
+			fMiddle= ( fpHeights[iA]+fpHeights[iB] )*0.5f;
+			fpHeights[z*iNumVerts+x]+= ( fMiddle-fpHeights[z*iNumVerts+x] )*fMorph;
 		}
 	}
+}
 
-	glDisable( GL_BLEND );
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::GetPatchVertices - private
+// Description:		Get a patch's vertex block at a level of detail: out
+//					of the cache if it is there, or built (and cached,
+//					throwing out the least recently used blocks to make
+//					room for it) if it isn't
+// Arguments:		-iPatch: the patch's number
+//					-iLOD: the level of detail
+// Return Value:	A pointer to the block's vertices (good until the next
+//					call)
+//--------------------------------------------------------------
+SBACKEND_VERTEX* CGEOMIPMAPPING::GetPatchVertices( int iPatch, int iLOD )
+{
+	SGEOMM_CACHE_ENTRY* pEntry;
+	unsigned int uiBytes;
+	int iEntry;
+	int iNumVerts;
 
-	//unbind the texture occupying the second texture unit
-	glActiveTextureARB( GL_TEXTURE1_ARB );
-	glDisable( GL_TEXTURE_2D );
-	glBindTexture( GL_TEXTURE_2D, 0 );
+	iEntry= iLOD*SQR( m_iNumPatchesPerSide )+iPatch;
+	pEntry= &m_pCache[iEntry];
 
-	//unbind the texture occupying the first texture unit
-	glActiveTextureARB( GL_TEXTURE0_ARB );
-	glDisable( GL_TEXTURE_2D );
-	glBindTexture( GL_TEXTURE_2D, 0 );
+	if( pEntry->m_pVertices )
+	{
+		m_iCacheHits++;
+		m_iTotalCacheHits++;
+
+		//it is now the most recently used block
+		if( m_iCacheHead!=iEntry )
+		{
+			UnlinkCacheEntry( iEntry );
+			LinkCacheEntry( iEntry );
+		}
+
+		return pEntry->m_pVertices;
+	}
+
+	m_iPatchesRebuilt++;
+	m_iTotalPatchesRebuilt++;
+
+	iNumVerts= ( ( m_iPatchSize-1 )>>iLOD )+1;
+	uiBytes	 = SQR( iNumVerts )*sizeof( SBACKEND_VERTEX );
+
+	//a block that could never fit is built where it isn't kept
+	if( uiBytes>m_uiCacheBudget )
+	{
+		BuildPatchVertices( iPatch, iLOD, m_pPatchVertices );
+		return m_pPatchVertices;
+	}
+
+	while( m_uiCacheBytes+uiBytes>m_uiCacheBudget )
+	{
+		EvictPatchVertices( m_iCacheTail );
+		m_iCacheEvictions++;
+	}
+
+	pEntry->m_pVertices= new SBACKEND_VERTEX [SQR( iNumVerts )];
+	if( pEntry->m_pVertices==NULL )
+	{
+		BuildPatchVertices( iPatch, iLOD, m_pPatchVertices );
+		return m_pPatchVertices;
+	}
+
+	m_uiCacheBytes+= uiBytes;
+	LinkCacheEntry( iEntry );
+
+	BuildPatchVertices( iPatch, iLOD, pEntry->m_pVertices );
+	return pEntry->m_pVertices;
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildPatchVertices - private
+// Description:		Build a patch's vertex block at a level of detail:
+//					every 2^LOD'th point of the patch
+// Arguments:		-iPatch: the patch's number
+//					-iLOD: the level of detail
+//					-pVertices: storage for the block
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::BuildPatchVertices( int iPatch, int iLOD, SBACKEND_VERTEX* pVertices )
+{
+	float fTexScale= 1.0f/m_iSize;
+	bool bNormals= HasNormals( );
+	int iStartX, iStartZ;
+	int iStep, iNumVerts;
+	int x, z;
+
+	iStep	 = 1<<iLOD;
+	iNumVerts= ( ( m_iPatchSize-1 )>>iLOD )+1;
+	iStartX	 = ( iPatch%m_iNumPatchesPerSide )*( m_iPatchSize-1 );
+	iStartZ	 = ( iPatch/m_iNumPatchesPerSide )*( m_iPatchSize-1 );
+
+	for( z=0; z<iNumVerts; z++ )
+	{
+		for( x=0; x<iNumVerts; x++ )
+			BuildVertex( pVertices++, iStartX+x*iStep, iStartZ+z*iStep, fTexScale, bNormals );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::EvictPatchVertices - private
+// Description:		Throw a vertex block out of the cache
+// Arguments:		-iEntry: the block's entry number
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::EvictPatchVertices( int iEntry )
+{
+	int iNumVerts;
+
+	iNumVerts= ( ( m_iPatchSize-1 )>>( iEntry/SQR( m_iNumPatchesPerSide ) ) )+1;
+
+	UnlinkCacheEntry( iEntry );
+
+	delete[] m_pCache[iEntry].m_pVertices;
+	m_pCache[iEntry].m_pVertices= NULL;
+
+	m_uiCacheBytes-= SQR( iNumVerts )*sizeof( SBACKEND_VERTEX );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::FlushPatchCache - public
+// Description:		Throw every vertex block out of the cache (the
+//					patches are built again as they are drawn)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::FlushPatchCache( void )
+{
+	while( m_iCacheHead>=0 )
+		EvictPatchVertices( m_iCacheHead );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::SetCacheSize - public
+// Description:		Set the most bytes of patch vertices that are kept
+//					from one frame to the next (0 builds every patch
+//					every frame)
+// Arguments:		-uiBytes: the cache's budget
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::SetCacheSize( unsigned int uiBytes )
+{
+	m_uiCacheBudget= uiBytes;
+
+	while( m_uiCacheBytes>m_uiCacheBudget )
+		EvictPatchVertices( m_iCacheTail );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::LogCacheStats - public
+// Description:		Write the vertex cache's statistics to the log
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::LogCacheStats( void )
+{
+	int iLookups= m_iTotalCacheHits+m_iTotalPatchesRebuilt;
+
+	g_log.Write( LOG_PLAINTEXT, "Patch cache: %d hits, %d patches rebuilt, %.1f%% hit rate, %d evictions, %u of %u KB used",
+				 m_iTotalCacheHits, m_iTotalPatchesRebuilt, iLookups ? ( 100.0f*m_iTotalCacheHits )/iLookups : 0.0f,
+				 m_iCacheEvictions, m_uiCacheBytes/1024, m_uiCacheBudget/1024 );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildMesh - private
+// Description:		Build the frame's mesh out of all of the visible
+//					patches, with the version of the patch building code
+//					that was compiled for the current fog setting (so that
+//					it is only looked at once, instead of once per vertex)
+// Arguments:		-bFog: fill in the fog coordinates
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::BuildMesh( bool bFog )
+{
+	//the vertex blocks are cached with everything in them (the vertex
+	//format picks what gets sent), so they are all built again if the
+	//scale, the normal map or the detail map's repeat changes
+	if( m_vecCacheScale!=m_vecScale || m_iCacheNormals!=GetNormalRevision( ) ||
+		m_iCacheDetailRepeat!=m_iRepeatDetailMap )
+	{
+		FlushPatchCache( );
+
+		m_vecCacheScale		= m_vecScale;
+		m_iCacheNormals		= GetNormalRevision( );
+		m_iCacheDetailRepeat= m_iRepeatDetailMap;
+	}
+
+	m_frameMesh.Reset( );
+
+	if( bFog )
+		BuildVisiblePatches<true>( );
+	else
+		BuildVisiblePatches<false>( );
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::DrawMesh - private
+// Description:		Draw the frame's mesh (for one rendering pass)
+// Arguments:		-iFormat: the vertex attributes to draw with (BACKEND_*)
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::DrawMesh( int iFormat )
+{
+	m_frameMesh.Draw( m_pBackend, iFormat );
+
+	m_iVertsPerFrame+= m_frameMesh.GetNumVertices( );
+	m_iTrisPerFrame += m_frameMesh.GetNumTriangles( );
 }
 
 //--------------------------------------------------------------
-// Name:			CGEOMIPMAPPING::RenderPatch - private
-// Description:		Render a patch of terrain
+// Name:			CGEOMIPMAPPING::BuildVisiblePatches - private
+// Description:		Add all of the visible patches to the frame's mesh (the
+//					lists that Update made: the patches drawn on their own,
+//					and the super-patches)
+// Arguments:		-bFog (template): fill in fog coordinates or not
+// Return Value:	None
+//--------------------------------------------------------------
+template< bool bFog >
+void CGEOMIPMAPPING::BuildVisiblePatches( void )
+{
+	int iPatch;
+	int i;
+
+	for( i=0; i<m_iNumDrawPatches; i++ )
+	{
+		iPatch= m_ipDrawPatches[i];
+
+		//the kernel for the patch's level of detail
+		( this->*m_pfnBuildPatch[bFog ? 1 : 0][m_patches.m_ipLODs[iPatch]] )( iPatch%m_iNumPatchesPerSide, iPatch/m_iNumPatchesPerSide );
+		m_iPatchesPerFrame++;
+	}
+
+	for( i=0; i<m_iNumSuperPatches; i++ )
+	{
+		BuildSuperPatch<bFog>( &m_pSuperPatches[i] );
+		m_iPatchesPerFrame++;
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::BuildPatch - private
+// Description:		Add a patch of terrain to the frame's mesh: the vertex
+//					block for its level of detail (out of the cache, with
+//					this frame's colors, morphing and fog put on it), and
+//					then the indices of the template for its level of
+//					detail and neighbors
 // Arguments:		-PX, PZ: the patch location
-//					-bMultitex: use multitexturing or not
-//					-bDetail: render with a detail map or not
+//					-bFog (template): fill in fog coordinates or not
+//					-iWidth (template): the width of the patch's vertex
+//										block (0: work it out from the level
+//										of detail)
 // Return Value:	None
 //--------------------------------------------------------------
-void CGEOMIPMAPPING::RenderPatch( int PX, int PZ, bool bMultiTex, bool bDetail )
+template< bool bFog, int iWidth >
+void CGEOMIPMAPPING::BuildPatch( int PX, int PZ )
 {
-	SGEOMM_NEIGHBOR patchNeighbor;
-	SGEOMM_NEIGHBOR fanNeighbor;
-	float fSize;
-	float fHalfSize;
-	float x, z;
+	SGEOMM_TEMPLATE* pTemplate;
+	SBACKEND_VERTEX* pBlock;
+	SBACKEND_VERTEX* pVertex;
+	unsigned char* ucpBrightness;
+	unsigned int uiBase;
 	int iPatch= GetPatchNumber( PX, PZ );
-	int iDivisor;
-	int iLOD;
+	int iLOD= m_patches.m_ipLODs[iPatch];
+	int iMask= 0;
+	int iStartX, iStartZ;
+	int iStep, iNumVerts;
+	int x, z;
+	int i;
 
 	//find out information about the patch to the current patch's left, if the patch is of a
-	//greater detail or there is no patch to the left, we can render the mid-left vertex
-	if( m_pPatches[GetPatchNumber( PX-1, PZ )].m_iLOD<=m_pPatches[iPatch].m_iLOD || PX==0 )
-		patchNeighbor.m_bLeft= true;
-	else
-		patchNeighbor.m_bLeft= false;
+	//greater detail or there is no patch to the left, we can render the mid-left vertices
+	//(the edges are checked first, so that there is never a patch read from outside of the grid)
+	if( PX==0 || m_patches.m_ipLODs[GetPatchNumber( PX-1, PZ )]<=iLOD )
+		iMask|= GEOMM_LEFT;
 
 	//find out about the upper patch
-	if( m_pPatches[GetPatchNumber( PX, PZ+1 )].m_iLOD<=m_pPatches[iPatch].m_iLOD || PZ==m_iNumPatchesPerSide )
-		patchNeighbor.m_bUp= true;
-	else
-		patchNeighbor.m_bUp= false;
+	if( PZ==m_iNumPatchesPerSide-1 || m_patches.m_ipLODs[GetPatchNumber( PX, PZ+1 )]<=iLOD )
+		iMask|= GEOMM_UP;
 
 	//find out about the right patch
-	if( m_pPatches[GetPatchNumber( PX+1, PZ )].m_iLOD<=m_pPatches[iPatch].m_iLOD || PX==m_iNumPatchesPerSide )
-		patchNeighbor.m_bRight= true;
-	else
-		patchNeighbor.m_bRight= false;
+	if( PX==m_iNumPatchesPerSide-1 || m_patches.m_ipLODs[GetPatchNumber( PX+1, PZ )]<=iLOD )
+		iMask|= GEOMM_RIGHT;
 
 	//find out about the lower patch
-	if( m_pPatches[GetPatchNumber( PX, PZ-1 )].m_iLOD<=m_pPatches[iPatch].m_iLOD || PZ==0 )
-		patchNeighbor.m_bDown= true;
-	else
-		patchNeighbor.m_bDown= false;
+	if( PZ==0 || m_patches.m_ipLODs[GetPatchNumber( PX, PZ-1 )]<=iLOD )
+		iMask|= GEOMM_DOWN;
 
-	//we need to determine the distance between each triangle-fan that
-	//we will be rendering
-	iLOD    = m_pPatches[GetPatchNumber( PX, PZ )].m_iLOD+1;
-	fSize   = ( float )m_iPatchSize;
-	iDivisor= m_iPatchSize-1;
+	//the vertex block: every 2^LOD'th point of the patch (a patch spans
+	//one less unit than it has vertices, since its edges are shared with
+	//its neighbors)
+	iStep	 = 1<<iLOD;
+	iNumVerts= iWidth ? iWidth : ( ( m_iPatchSize-1 )>>iLOD )+1;
+	iStartX	 = PX*( m_iPatchSize-1 );
+	iStartZ	 = PZ*( m_iPatchSize-1 );
 
-	//find out how many fan divisions we are going to have
-	while( --iLOD>-1 )
-		iDivisor= iDivisor>>1;
+	pBlock= GetPatchVertices( iPatch, iLOD );
 
-	//the size between the center of each triangle fan
-	fSize/= iDivisor;
+	uiBase = m_frameMesh.GetNumVertices( );
+	pVertex= m_frameMesh.AddVertices( SQR( iNumVerts ) );
+	memcpy( pVertex, pBlock, SQR( iNumVerts )*sizeof( SBACKEND_VERTEX ) );
 
-	//half the size between the center of each triangle fan (this will be
-	//the size between each vertex)
-	fHalfSize= fSize/2.0f;
-	for( z=fHalfSize; ( ( int )( z+fHalfSize ) )<m_iPatchSize+1; z+=fSize )
+	if( m_bGeomorphing )
 	{
-		for( x=fHalfSize; ( ( int )( x+fHalfSize ))<m_iPatchSize+1; x+=fSize )
-		{
-			//if this fan is in the left row, we may need to adjust it's rendering to
-			//prevent cracks
-			if( x==fHalfSize )
-				fanNeighbor.m_bLeft= patchNeighbor.m_bLeft;
-			else
-				fanNeighbor.m_bLeft= true;
+		MorphPatch<iWidth>( PX, PZ, pBlock );
 
-			//if this fan is in the bottom row, we may need to adjust it's rendering to
-			//prevent cracks
-			if( z==fHalfSize )
-				fanNeighbor.m_bDown= patchNeighbor.m_bDown;
-			else
-				fanNeighbor.m_bDown= true;
+		for( i=0; i<SQR( iNumVerts ); i++ )
+			pVertex[i].m_fPosition[1]= m_fpPatchHeights[i];
+	}
 
-			//if this fan is in the right row, we may need to adjust it's rendering to
-			//prevent cracks
-			if( x>=( m_iPatchSize-fHalfSize ) )
-				fanNeighbor.m_bRight= patchNeighbor.m_bRight;
-			else
-				fanNeighbor.m_bRight= true;
+	//the lighting and fog can change from frame to frame, so the colors
+	//and fog coordinates are never cached
+	for( z=0; z<iNumVerts; z++ )
+	{
+		ucpBrightness= &m_lightmap.m_ucpData[( ( iStartZ+z*iStep )*m_lightmap.m_iSize )+iStartX];
 
-			//if this fan is in the top row, we may need to adjust it's rendering to
-			//prevent cracks
-			if( z>=( m_iPatchSize-fHalfSize ) )
-				fanNeighbor.m_bUp= patchNeighbor.m_bUp;
-			else
-				fanNeighbor.m_bUp= true;
+		for( x=0; x<iNumVerts; x++, pVertex++ )
+		{
+			memcpy( pVertex->m_ucColor, m_ucShadeTable[ucpBrightness[x*iStep]], 4 );
 
-			//render the triangle fan
-			RenderFan( ( PX*m_iPatchSize )+x, ( PZ*m_iPatchSize )+z,
-					   fSize, fanNeighbor, bMultiTex, bDetail );
+			if( bFog )
+				pVertex->m_fFogCoord= GetFogCoord( pVertex->m_fPosition[1] );
 		}
 	}
+
+	pTemplate= &m_templates[iLOD][iMask];
+	m_frameMesh.AddIndices( &m_uspTemplateIndices[pTemplate->m_iFirstIndex], pTemplate->m_iNumIndices, uiBase );
 }
 
 //--------------------------------------------------------------
-// Name:			CGEOMIPMAPPING::RenderFan - private
-// Description:		Update the geomipmapping system
-// Arguments:		-cX, cZ: center of the triangle fan to render
-//					-fSize: half of the fan's entire size
-//					-neightbor: the fan's neighbor structure (used to avoid cracking)
-//					-bMultitex: use multitexturing or not
-//					-bDetail: render with a detail map or not
+// Name:			CGEOMIPMAPPING::BuildSuperPatch - private
+// Description:		Add a super-patch to the frame's mesh: one fan from the
+//					center of its square out to its edges, with a vertex
+//					everywhere that its patches would have had one along
+//					the edges at their coarsest level of detail (so the
+//					neighbors line up with it)
+// Arguments:		-pSuperPatch: the super-patch
+//					-bFog (template): fill in fog coordinates or not
 // Return Value:	None
 //--------------------------------------------------------------
-void CGEOMIPMAPPING::RenderFan( float cX, float cZ, float fSize, SGEOMM_NEIGHBOR neighbor, bool bMultiTex, bool bDetail )
+template< bool bFog >
+void CGEOMIPMAPPING::BuildSuperPatch( SGEOMM_SUPER_PATCH* pSuperPatch )
 {
-	float fTexLeft, fTexBottom, fMidX, fMidZ, fTexRight, fTexTop;
-	float fHalfSize= fSize/2.0f;
+	SBACKEND_VERTEX* pVertex;
+	float fTexScale= 1.0f/m_iSize;
+	bool bNormals= HasNormals( );
+	int iStartX, iStartZ;
+	int iSpan, iStep;
+	int iNumRim;
+	int x, z;
+	int i;
+
+	iSpan  = ( m_iPatchSize-1 )<<pSuperPatch->m_iLevel;
+	iStep  = ( m_iPatchSize-1 )/2;
+	iStartX= pSuperPatch->m_iPX*( m_iPatchSize-1 );
+	iStartZ= pSuperPatch->m_iPZ*( m_iPatchSize-1 );
 
-	//calculate the texture coordinates if we're not doing multitexturing, but still detail mapping
-	if( bDetail && !bMultiTex )
+	//the center, and then the rim, going around the same way as the
+	//patches' fans (up the left edge, along the top, down the right edge
+	//and back along the bottom, to the first rim vertex again)
+	iNumRim= ( iSpan/iStep )*4+1;
+
+	m_frameMesh.BeginFan( );
+	for( i=-1; i<iNumRim; i++ )
 	{
-		//calculate the texture coordinates
-		fTexLeft  = ( ( float )fabs( cX-fHalfSize )/m_iSize )*m_iRepeatDetailMap;
-		fTexBottom= ( ( float )fabs( cZ-fHalfSize )/m_iSize )*m_iRepeatDetailMap;
-		fTexRight = ( ( float )fabs( cX+fHalfSize )/m_iSize )*m_iRepeatDetailMap;
-		fTexTop	  = ( ( float )fabs( cZ+fHalfSize )/m_iSize )*m_iRepeatDetailMap;
+		if( i<0 )
+		{
+			x= iStartX+iSpan/2;
+			z= iStartZ+iSpan/2;
+		}
+		else if( i<iSpan/iStep )
+		{
+			x= iStartX;
+			z= iStartZ+i*iStep;
+		}
+		else if( i<( iSpan/iStep )*2 )
+		{
+			x= iStartX+( i-iSpan/iStep )*iStep;
+			z= iStartZ+iSpan;
+		}
+		else if( i<( iSpan/iStep )*3 )
+		{
+			x= iStartX+iSpan;
+			z= iStartZ+iSpan-( i-( iSpan/iStep )*2 )*iStep;
+		}
+		else
+		{
+			x= iStartX+iSpan-( i-( iSpan/iStep )*3 )*iStep;
+			z= iStartZ;
+		}
+
+		pVertex= m_frameMesh.AddVertex( );
+		BuildVertex( pVertex, x, z, fTexScale, bNormals );
+		memcpy( pVertex->m_ucColor, m_ucShadeTable[GetBrightnessAtPoint( x, z )], 4 );
 
-		fMidX= ( ( fTexLeft+fTexRight )/2 );
-		fMidZ= ( ( fTexBottom+fTexTop )/2 );
+		if( bFog )
+			pVertex->m_fFogCoord= GetFogCoord( pVertex->m_fPosition[1] );
 	}
+	m_frameMesh.EndFan( );
+}
 
-	//calculate the texture coordinates otherwise
-	else
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::SelectPatchKernels - private
+// Description:		Fill in the patch building kernel for each level of
+//					detail: the one compiled for the width of that level's
+//					vertex blocks (every level of 17x17, 33x33, 65x65 and
+//					129x129 patches has one, so their loops have fixed
+//					lengths), or the general one for any other width
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CGEOMIPMAPPING::SelectPatchKernels( void )
+{
+	int iWidth;
+	int iLOD;
+
+	for( iLOD=0; iLOD<GEOMM_MAX_LODS; iLOD++ )
 	{
-		//calculate the texture coordinates
-		fTexLeft  = ( ( float )fabs( cX-fHalfSize )/m_iSize );
-		fTexBottom= ( ( float )fabs( cZ-fHalfSize )/m_iSize );
-		fTexRight = ( ( float )fabs( cX+fHalfSize )/m_iSize );
-		fTexTop	  = ( ( float )fabs( cZ+fHalfSize )/m_iSize );
+		iWidth= ( m_iPatchSize>1 ) ? ( ( m_iPatchSize-1 )>>iLOD )+1 : 0;
+		if( !m_bSpecializeKernels )
+			iWidth= 0;
 
-		fMidX= ( ( fTexLeft+fTexRight )/2 );
-		fMidZ= ( ( fTexBottom+fTexTop )/2 );
+		switch( iWidth )
+		{
+			case 3:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 3>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 3>;
+				break;
+
+			case 5:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 5>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 5>;
+				break;
+
+			case 9:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 9>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 9>;
+				break;
+
+			case 17:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 17>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 17>;
+				break;
+
+			case 33:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 33>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 33>;
+				break;
+
+			case 65:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 65>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 65>;
+				break;
+
+			case 129:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 129>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 129>;
+				break;
+
+			default:
+				m_pfnBuildPatch[0][iLOD]= &CGEOMIPMAPPING::BuildPatch<false, 0>;
+				m_pfnBuildPatch[1][iLOD]= &CGEOMIPMAPPING::BuildPatch<true, 0>;
+				break;
+		}
 	}
+}
 
+//--------------------------------------------------------------
+// Name:			CGEOMIPMAPPING::CalibratePatchSize - public
+// Description:		Find the best patch size for the terrain: the camera
+//					path is drawn (through a recording backend) with each
+//					of the sizes that fit the height map, and the one with
+//					the lowest combined CPU time and triangle count (each
+//					taken as a fraction of the best size's) is kept.  The
+//					terrain is left initiated with that size.
+// Arguments:		-pPath: the camera path (each frame's camera, with its
+//							frustum already worked out)
+//					-iNumFrames: the number of frames in the path
+// Return Value:	An integer value: the patch size (0 if no size could be
+//					tried)
+//--------------------------------------------------------------
+int CGEOMIPMAPPING::CalibratePatchSize( CCAMERA* pPath, int iNumFrames )
+{
+	CRECORDING_BACKEND recorder;
+	CRENDER_BACKEND* pBackend= m_pBackend;
+	CTIMER timer;
+	float fTimes[GEOMM_NUM_CALIBRATION_SIZES];
+	float fTriangles[GEOMM_NUM_CALIBRATION_SIZES];
+	float fBestTime, fBestTriangles;
+	float fScore, fBestScore;
+	int iOldSize= m_iPatchSize;
+	int iSize, iBestSize;
+	int i, j;
+
+	if( m_iSize==0 || pPath==NULL || iNumFrames<=0 )
+		return 0;
+
+	timer.Init( );
+
+	fBestTime	  = -1.0f;
+	fBestTriangles= -1.0f;
+	for( i=0; i<GEOMM_NUM_CALIBRATION_SIZES; i++ )
+	{
+		iSize	  = g_iCalibrationSizes[i];
+		fTimes[i] = -1.0f;
 
-	//begin a new triangle strip
-	glBegin( GL_TRIANGLE_FAN );
-		//render the CENTER vertex
-		RenderVertex( cX, cZ, fMidX, fMidZ, bMultiTex );
+		//the patches have to cover the height map exactly
+		if( iSize>m_iSize || ( m_iSize-1 )%( iSize-1 )!=0 )
+			continue;
 
-		//render the LOWER-LEFT vertex
-		RenderVertex( cX-fHalfSize, cZ-fHalfSize, fTexLeft, fTexBottom, bMultiTex );		
+		if( !Init( iSize ) )
+			continue;
 
-		//only render the next vertex if the left patch is NOT of a lower LOD
-		if( neighbor.m_bLeft )
-		{
-			RenderVertex( cX-fHalfSize, cZ, fTexLeft, fMidZ, bMultiTex );
-			m_iTrisPerFrame++;
-		}
-	
-		//render the UPPER-LEFT vertex
-		RenderVertex( cX-fHalfSize, cZ+fHalfSize, fTexLeft, fTexTop, bMultiTex );
-		m_iTrisPerFrame++;
+		//every size starts out with nothing counted
+		recorder.ResetStats( );
+		m_pBackend= &recorder;
+
+		//the first frame is drawn once before the timing starts, so that
+		//every size starts out with the path's first vertex blocks cached
+		Update( pPath[0] );
+		Render( );
 
-		//only render the next vertex if the upper patch is NOT of a lower LOD
-		if( neighbor.m_bUp )
+		fTriangles[i]= 0.0f;
+		fTimes[i]	 = timer.GetTime( );
+		for( j=0; j<iNumFrames; j++ )
 		{
-			RenderVertex( cX, cZ+fHalfSize, fMidX, fTexTop, bMultiTex );
-			m_iTrisPerFrame++;
-		}
+			Update( pPath[j] );
 
-		//render the UPPER-RIGHT vertex
-		RenderVertex( cX+fHalfSize, cZ+fHalfSize, fTexRight, fTexTop, bMultiTex );
-		m_iTrisPerFrame++;
+			recorder.ResetStats( );
+			Render( );
 
-		//only render the next vertex if the right patch is NOT of a lower LOD
-		if( neighbor.m_bRight )
-		{
-			//render the MID-RIGHT vertex
-			RenderVertex( cX+fHalfSize, cZ, fTexRight, fMidZ, bMultiTex );
-			m_iTrisPerFrame++;
+			fTriangles[i]+= recorder.GetNumTriangles( );
 		}
+		fTimes[i]	 = ( timer.GetTime( )-fTimes[i] )/iNumFrames;
+		fTriangles[i]= fTriangles[i]/iNumFrames;
+
+		m_pBackend= pBackend;
+
+		if( fBestTime<0.0f || fTimes[i]<fBestTime )
+			fBestTime= fTimes[i];
+		if( fBestTriangles<0.0f || fTriangles[i]<fBestTriangles )
+			fBestTriangles= fTriangles[i];
+	}
+
+	//pick the size that does best on both counts
+	iBestSize = 0;
+	fBestScore= 0.0f;
+	for( i=0; i<GEOMM_NUM_CALIBRATION_SIZES; i++ )
+	{
+		if( fTimes[i]<0.0f )
+			continue;
+
+		fScore= fTimes[i]/MAX( fBestTime, 0.001f )+fTriangles[i]/MAX( fBestTriangles, 1.0f );
 
-		//render the LOWER-RIGHT vertex
-		RenderVertex( cX+fHalfSize, cZ-fHalfSize, fTexRight, fTexBottom, bMultiTex );
-		m_iTrisPerFrame++;	
+		g_log.Write( LOG_PLAINTEXT, "Patch size %dx%d: %.3f ms per frame, %.0f triangles per frame (score %.2f)",
+					 g_iCalibrationSizes[i], g_iCalibrationSizes[i], fTimes[i], fTriangles[i], fScore );
 
-		//only render the next vertex if the bottom patch is NOT of a lower LOD
-		if( neighbor.m_bDown )
+		if( iBestSize==0 || fScore<fBestScore )
 		{
-			//render the LOWER-MID vertex
-			RenderVertex( cX, cZ-fHalfSize, fMidX, fTexBottom, bMultiTex );	
-			m_iTrisPerFrame++;
+			iBestSize = g_iCalibrationSizes[i];
+			fBestScore= fScore;
 		}
+	}
+
+	if( iBestSize==0 )
+	{
+		g_log.Write( LOG_FAILURE, "None of the calibration patch sizes fit a %dx%d height map", m_iSize, m_iSize );
+
+		if( iOldSize )
+			Init( iOldSize );
+		return 0;
+	}
 
-		//render the LOWER-LEFT vertex
-		RenderVertex( cX-fHalfSize, cZ-fHalfSize, fTexLeft, fTexBottom, bMultiTex );
-		m_iTrisPerFrame++;	
+	Init( iBestSize );
+	g_log.Write( LOG_SUCCESS, "Calibrated the geomipmapping patch size over %d frames: %dx%d", iNumFrames, iBestSize, iBestSize );
 
-	//end the triangle strip
-	glEnd( );
-}
\ No newline at end of file
+	return iBestSize;
+}
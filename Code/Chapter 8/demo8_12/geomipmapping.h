@@ -16,22 +16,118 @@
 //- HEADERS AND LIBRARIES --------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
+#include <string.h>
+
 #include "terrain.h"
 
 #include "../Base Code/camera.h"
 
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- CONSTANTS --------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//enough for patches of up to 129x129 vertices (a patch's vertices are
+//reached with 16-bit indices, so it can't have more than 65536 of them)
+#define GEOMM_MAX_LODS 7
+
+#define GEOMM_DEFAULT_TOLERANCE 4.0f	//pixels
+
+//the bits of a patch's neighbor mask (a bit is set when the mid-edge
+//vertices on that side are drawn, like SGEOMM_NEIGHBOR)
+#define GEOMM_LEFT	1
+#define GEOMM_UP	2
+#define GEOMM_RIGHT 4
+#define GEOMM_DOWN	8
+#define GEOMM_NUM_NEIGHBOR_MASKS 16
+
+//the quadtree's leaves are (up to) 8x8 patches, so that each row of a
+//leaf is one step of Update's eight-at-a-time loop
+#define GEOMM_LEAF_PATCHES 8
+#define GEOMM_ALL_PLANES   0x3F	//a bit for each of the frustum's planes
+
+//a patch starts to morph towards its next coarser level of detail once
+//the error that it is allowed is this much of that level's error (so it
+//has finished morphing by the time that it switches)
+#define GEOMM_MORPH_START 0.5f
+
+//a patch only loses detail once the error that it is allowed is this
+//much past the coarser level's error (so that a patch sitting right on
+//a switch doesn't flip back and forth between two levels)
+#define GEOMM_DEFAULT_HYSTERESIS 0.25f
+
+//the bytes of patch vertices that are kept from one frame to the next
+#define GEOMM_DEFAULT_CACHE_SIZE ( 4*1024*1024 )
+
+//a square of up to 2^3 patches on a side (a quadtree leaf) that are all
+//at the coarsest level of detail can be drawn as one super-patch: a
+//single fan, if that is still accurate enough
+#define GEOMM_MERGE_LEVELS 3
+
+//the patch sizes that CalibratePatchSize tries (each one's vertex blocks
+//have a patch building kernel compiled for their width, at every level
+//of detail)
+#define GEOMM_NUM_CALIBRATION_SIZES 4
+
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- DATA STRUCTURES --------------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
-struct SGEOMM_PATCH
+//the patches, with an array for each value (instead of an array of
+//patch structures), so that Update can work on several patches at once
+struct SGEOMM_PATCHES
 {
-	float m_fDistance;
+	//the patch's center, and its lowest and highest points (in height
+	//map units, so that the terrain can still be scaled)
+	float* m_fpCenterX;
+	float* m_fpCenterZ;
+	float* m_fpCenterHeight;
+	float* m_fpMinHeight;
+	float* m_fpMaxHeight;
+
+	//the biggest difference between the height map and the patch's
+	//surface at each level of detail (an array for each level)
+	float* m_fpErrors[GEOMM_MAX_LODS];
+
+	float* m_fpDistances;
+	int*   m_ipLODs;
+	unsigned char* m_ucpVisible;
+
+	//how far each patch has morphed towards its next coarser level of
+	//detail (0-1, only used when geomorphing)
+	float* m_fpMorphs;
 
-	int  m_iLOD;
-	bool m_bVisible;
+	//the update that last saw the patch, and its level of detail and
+	//(morphed) error back then, for measuring how much it pops
+	int*   m_ipLastFrames;
+	int*   m_ipLastLODs;
+	float* m_fpLastErrors;
+
+	//the error of each super-patch (never less than its patches' errors
+	//at the coarsest level of detail): an array for each merge level,
+	//with a value for every square of 2^level patches on a side
+	float* m_fpMergeErrors[GEOMM_MERGE_LEVELS];
+};
+
+//a square of patches that is drawn as one fan
+struct SGEOMM_SUPER_PATCH
+{
+	int m_iLevel;			//2^level patches on a side
+	int m_iPX, m_iPZ;		//the first patch
+};
+
+//a node of the patch quadtree: a square of patches (clipped to the
+//edges of the terrain), and the lowest and highest points under them
+struct SGEOMM_NODE
+{
+	int m_iMinX, m_iMinZ;		//the patches covered, [min, max)
+	int m_iMaxX, m_iMaxZ;
+	float m_fMinHeight;			//height map units
+	float m_fMaxHeight;
+	int m_iFirstChild;			//the first of four children in a row (-1 for a leaf)
 };
 
 struct SGEOMM_NEIGHBOR
@@ -42,6 +138,24 @@ struct SGEOMM_NEIGHBOR
 	bool m_bDown;
 };
 
+//a patch's vertex block at one level of detail, kept from one frame to
+//the next (everything but the colors and fog coordinates, which are
+//filled in as the block is copied into the frame's mesh)
+struct SGEOMM_CACHE_ENTRY
+{
+	SBACKEND_VERTEX* m_pVertices;	//NULL if the block isn't cached
+	int m_iPrev;					//the cached blocks, most recently used first
+	int m_iNext;					//(entry numbers, -1 at the ends)
+};
+
+//a patch's triangles at one level of detail, with one set of neighbors
+//(indices into the patch's vertex block at that level of detail)
+struct SGEOMM_TEMPLATE
+{
+	int m_iFirstIndex;
+	int m_iNumIndices;
+};
+
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -51,77 +165,305 @@ struct SGEOMM_NEIGHBOR
 class CGEOMIPMAPPING : public CTERRAIN
 {
 	private:
-		SGEOMM_PATCH* m_pPatches;
-		float m_fFogDepth;
+		SGEOMM_PATCHES m_patches;
+
+		//the quadtree that the patches are culled with (node 0 is the root)
+		SGEOMM_NODE* m_pNodes;
+		int m_iNumNodes;
+		int m_iNumLeaves;
+
+		//the leaves that the last update found (partly) inside of the
+		//frustum, and the planes that each one still had to be tested
+		//against
+		int* m_ipCullLeaves;
+		int* m_ipCullPlanes;
+		int	 m_iNumCullLeaves;
+		int	 m_iPatchesTested;	//patches that were tested against any planes
+
+		//the visible patches' numbers (made by Update)
+		int* m_ipVisiblePatches;
+		int* m_ipLeafVisible;	//how many patches each leaf added to the list
+		int	 m_iNumVisiblePatches;
+
+		//the visible patches that are drawn on their own, and the squares
+		//of them that are drawn as super-patches (made by Update)
+		bool m_bMergePatches;
+		int* m_ipDrawPatches;
+		int	 m_iNumDrawPatches;
+		SGEOMM_SUPER_PATCH* m_pSuperPatches;
+		int	 m_iNumSuperPatches;
+		int	 m_iPatchesMerged;
 
 		int			  m_iPatchSize;
 		int			  m_iNumPatchesPerSide;
 
+		//the patch building kernel for each level of detail (with fog, and
+		//without it), picked for the patch size's vertex block widths
+		typedef void ( CGEOMIPMAPPING::*PFN_BUILD_PATCH )( int PX, int PZ );
+		PFN_BUILD_PATCH m_pfnBuildPatch[2][GEOMM_MAX_LODS];
+		bool m_bSpecializeKernels;
+
 		int	m_iMaxLOD;
 
 		int m_iPatchesPerFrame;	//the number of rendered patches per second
 
-	void RenderFan( float cX, float cZ, float iSize, SGEOMM_NEIGHBOR neighbor, bool bMultiTex, bool bDetail );
-	void RenderPatch( int PX, int PZ, bool bMultiTex= false, bool bDetail= false );
+		//a patch gets the least detail whose error, projected onto the
+		//screen, is no bigger than the tolerance
+		float m_fPixelTolerance;
+		float m_fErrorScale;	//pixels covered by one unit of error, one unit away
+		float m_fLODHysteresis;
+
+		//geomorphing: a patch's vertices slide towards its next coarser
+		//level of detail as it gets close to switching to it
+		bool   m_bGeomorphing;
+		float* m_fpPatchHeights;	//a patch's (morphed) heights, while it is being built
+
+		//how much the patches popped (in pixels) when their levels of
+		//detail changed during the last update
+		int   m_iUpdateFrame;
+		int   m_iLODSwitches;
+		float m_fMaxPopPixels;
+		float m_fTotalPopPixels;
+
+		//the patches' vertex blocks (an entry for each patch at each level
+		//of detail: LOD*patches+patch), and the list of the cached ones
+		SGEOMM_CACHE_ENTRY* m_pCache;
+		int m_iCacheHead, m_iCacheTail;
+		unsigned int m_uiCacheBytes;
+		unsigned int m_uiCacheBudget;
+		SBACKEND_VERTEX* m_pPatchVertices;	//a block that doesn't fit in the cache
+
+		//what the cached blocks were built with (they are all thrown out
+		//if any of it changes)
+		CVECTOR m_vecCacheScale;
+		int m_iCacheNormals;				//the normal map's revision
+		int m_iCacheDetailRepeat;
+
+		//the last frame's cache statistics, and the totals
+		int m_iCacheHits;
+		int m_iPatchesRebuilt;
+		int m_iTotalCacheHits;
+		int m_iTotalPatchesRebuilt;
+		int m_iCacheEvictions;
+
+		//the visible patches, built once a frame and then drawn for each pass
+		CFRAME_MESH m_frameMesh;
+
+		//every patch uses the same triangles for a given level of detail
+		//and set of neighbors, so they are built once (in Init)
+		SGEOMM_TEMPLATE m_templates[GEOMM_MAX_LODS][GEOMM_NUM_NEIGHBOR_MASKS];
+		unsigned short* m_uspTemplateIndices;
+		int m_iNumTemplateIndices;
+
+	bool AllocatePatches( int iNumPatches );
+	void FreePatches( void );
+	void BuildQuadtree( void );
+	void BuildNode( int iNode, int iMinX, int iMinZ, int iSize );
+	void RefitNode( int iNode, int iMinX, int iMinZ, int iMaxX, int iMaxZ );
+	void BuildTemplates( void );
+	int	 BuildTemplate( int iLOD, SGEOMM_NEIGHBOR neighbor, unsigned int* uipIndices );
+	void CalculatePatchErrors( void );
+	void CalculateMergeErrors( void );
+	void LimitLODSteps( void );
+	void CalculateMorphs( void );
+	void MergePatches( void );
+	void MergeSquare( int iLevel, int PX, int PZ, float fErrorPerUnit );
+	bool CanMerge( int iLevel, int PX, int PZ, float fErrorPerUnit );
+	void SelectPatchKernels( void );
+	SBACKEND_VERTEX* GetPatchVertices( int iPatch, int iLOD );
+	void BuildPatchVertices( int iPatch, int iLOD, SBACKEND_VERTEX* pVertices );
+	void EvictPatchVertices( int iEntry );
+	int PrepareMesh( bool* pbMultiTex );
+	void BuildMesh( bool bFog );
+	void DrawMesh( int iFormat );
+
+	template< bool bFog >
+	void BuildVisiblePatches( void );
+	template< bool bFog, int iWidth >
+	void BuildPatch( int PX, int PZ );
+	template< int iWidth >
+	void MorphPatch( int PX, int PZ, const SBACKEND_VERTEX* pVertices );
+	template< bool bFog >
+	void BuildSuperPatch( SGEOMM_SUPER_PATCH* pSuperPatch );
 
 	//--------------------------------------------------------------
-	// Name:		 CGEOMIPMAPPING::RenderVertex - private
-	// Description:	 Set the volumetric fog coordinate for the vertex in question
-	// Arguments:	 -fDepth: depth of the fog
-	//				 -fHeight: height for the current fog coordinate
-	// Return Value: None
+	// Name:			CGEOMIPMAPPING::LinkCacheEntry - private
+	// Description:		Put a cached vertex block at the front of the list
+	//					(it is the most recently used)
+	// Arguments:		-iEntry: the block's entry number
+	// Return Value:	None
 	//--------------------------------------------------------------
-	inline void SetFogCoord( float fHeight )
+	inline void LinkCacheEntry( int iEntry )
 	{
-		float fFogY= 0;
+		m_pCache[iEntry].m_iPrev= -1;
+		m_pCache[iEntry].m_iNext= m_iCacheHead;
 
-		//check to ensure that the height is not higher than the fog depth
-		if( fHeight>m_fFogDepth )
-			fFogY= 0;
-		//calculate the fog depth
+		if( m_iCacheHead>=0 )
+			m_pCache[m_iCacheHead].m_iPrev= iEntry;
 		else
-			fFogY= -( fHeight-m_fFogDepth );
+			m_iCacheTail= iEntry;
 
-		//send GL the fog depth
-		glFogCoordfEXT( fFogY );
+		m_iCacheHead= iEntry;
 	}
 
 	//--------------------------------------------------------------
-	// Name:			CGEOMIPMAPPING::RenderVertex - private
-	// Description:		Render a vertex, mostly used for saving space (in the code)
-	// Arguments:		- x, z: vertex to render
-	//					- u, v: texture coordinates
-	//					- bMultiTex: use multitexturing or not
+	// Name:			CGEOMIPMAPPING::UnlinkCacheEntry - private
+	// Description:		Take a cached vertex block out of the list
+	// Arguments:		-iEntry: the block's entry number
 	// Return Value:	None
 	//--------------------------------------------------------------
-	inline void RenderVertex( float x, float z, float u, float v, bool bMultiTex )
+	inline void UnlinkCacheEntry( int iEntry )
 	{
-		unsigned char ucColor;
-		int iX, iZ;
+		SGEOMM_CACHE_ENTRY* pEntry= &m_pCache[iEntry];
 
-		iX= ( int )x;
-		iZ= ( int )z;
-		ucColor= GetBrightnessAtPoint( iX, iZ );
+		if( pEntry->m_iPrev>=0 )
+			m_pCache[pEntry->m_iPrev].m_iNext= pEntry->m_iNext;
+		else
+			m_iCacheHead= pEntry->m_iNext;
 
-		//send the shaded color to the rendering API
-		glColor3ub( ( unsigned char )( ucColor*m_vecLightColor[0] ),
-				    ( unsigned char )( ucColor*m_vecLightColor[1] ),
-				    ( unsigned char )( ucColor*m_vecLightColor[2] ) );
+		if( pEntry->m_iNext>=0 )
+			m_pCache[pEntry->m_iNext].m_iPrev= pEntry->m_iPrev;
+		else
+			m_iCacheTail= pEntry->m_iPrev;
+	}
 
-		//send the texture coordinates to the rendering API	
-		glMultiTexCoord2fARB( GL_TEXTURE0_ARB, u, v );
-		if( bMultiTex )
-			glMultiTexCoord2fARB( GL_TEXTURE1_ARB, u*m_iRepeatDetailMap, v*m_iRepeatDetailMap );
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::LimitLODStep - private
+	// Description:		Give the coarser of two neighboring patches more
+	//					detail, if it is more than one level coarser
+	// Arguments:		-iPatch1, iPatch2: the neighbors' patch numbers
+	// Return Value:	A boolean value: -true: a patch's LOD changed
+	//									 -false: nothing changed
+	//--------------------------------------------------------------
+	inline bool LimitLODStep( int iPatch1, int iPatch2 )
+	{
+		int* ipLODs= m_patches.m_ipLODs;
 
-		SetFogCoord( GetScaledHeightAtPoint( iX, iZ ) );
+		if( !m_patches.m_ucpVisible[iPatch2] )
+			return false;
 
-		//output the vertex to the rendering API
-		glVertex3f( x*m_vecScale[0],
-					GetScaledHeightAtPoint( iX, iZ ),
-					z*m_vecScale[2] );
+		if( ipLODs[iPatch1]>ipLODs[iPatch2]+1 )
+			ipLODs[iPatch1]= ipLODs[iPatch2]+1;
+		else if( ipLODs[iPatch2]>ipLODs[iPatch1]+1 )
+			ipLODs[iPatch2]= ipLODs[iPatch1]+1;
+		else
+			return false;
 
-		//increase the number of vertices rendered
-		m_iVertsPerFrame++;
+		return true;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetMorphedError - private
+	// Description:		Get the sum of a patch's errors up to a (morphed)
+	//					level of detail: a bound on how far its vertices
+	//					have moved away from their real heights
+	// Arguments:		-iPatch: the patch's number
+	//					-iLOD: its level of detail
+	//					-fMorph: how far it has morphed towards the next one
+	// Return Value:	A float value: the error (in height map units)
+	//--------------------------------------------------------------
+	inline float GetMorphedError( int iPatch, int iLOD, float fMorph )
+	{
+		float fError= 0.0f;
+		int i;
+
+		for( i=1; i<=iLOD; i++ )
+			fError+= m_patches.m_fpErrors[i][iPatch];
+
+		if( iLOD<m_iMaxLOD )
+			fError+= fMorph*m_patches.m_fpErrors[iLOD+1][iPatch];
+
+		return fError;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetEdgeMorph - private
+	// Description:		Find out how a patch's edge should morph, so that
+	//					the patch on the other side of it morphs the edge
+	//					in exactly the same way (or there would be cracks)
+	// Arguments:		-NX, NZ: the neighbor on the other side of the edge
+	//					-iLOD: the patch's level of detail
+	//					-fMorph: the patch's morph factor
+	//					-ipSpacing: gets the spacing of the edge's vertices
+	//								(in the patch's vertex block): 1, or 2
+	//								if the neighbor has less detail
+	// Return Value:	A float value: the edge's morph factor
+	//--------------------------------------------------------------
+	inline float GetEdgeMorph( int NX, int NZ, int iLOD, float fMorph, int* ipSpacing )
+	{
+		int iNeighbor;
+		int iNeighborLOD;
+
+		*ipSpacing= 1;
+
+		//the edges of the terrain are only ever drawn by one patch
+		if( NX<0 || NZ<0 || NX>=m_iNumPatchesPerSide || NZ>=m_iNumPatchesPerSide )
+			return fMorph;
+
+		iNeighbor	= GetPatchNumber( NX, NZ );
+		iNeighborLOD= m_patches.m_ipLODs[iNeighbor];
+
+		//the edge goes at the pace of the coarser patch (or the faster
+		//of the two, if they have the same detail)
+		if( iNeighborLOD<iLOD )
+			return fMorph;
+
+		if( iNeighborLOD==iLOD )
+		{
+			if( m_patches.m_ucpVisible[iNeighbor] )
+				return MAX( fMorph, m_patches.m_fpMorphs[iNeighbor] );
+
+			return fMorph;
+		}
+
+		//the neighbor has less detail, so the edge only has every other vertex
+		*ipSpacing= 2;
+		if( iNeighborLOD==iLOD+1 && m_patches.m_ucpVisible[iNeighbor] )
+			return m_patches.m_fpMorphs[iNeighbor];
+
+		return 0.0f;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetVertexFormat - private
+	// Description:		Get the format of the vertices that BuildPatch makes
+	// Arguments:		- bMultiTex: send the detail map's texture coordinates
+	//					- bFog: send fog coordinates
+	//					- bLighting: send normals
+	// Return Value:	An integer value: the vertex format flags (BACKEND_*)
+	//--------------------------------------------------------------
+	inline int GetVertexFormat( bool bMultiTex, bool bFog, bool bLighting )
+	{
+		return BACKEND_COLOR | BACKEND_TEXCOORD0 | ( bMultiTex ? BACKEND_TEXCOORD1 : 0 ) |
+			   ( bFog ? BACKEND_FOGCOORD : 0 ) | ( bLighting ? BACKEND_NORMAL : 0 );
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::BuildVertex - private
+	// Description:		Fill in the parts of a vertex that can be kept from
+	//					frame to frame: everything but its color and fog
+	//					coordinate (which depend on the lighting and the fog)
+	// Arguments:		-pVertex: the vertex
+	//					- x, z: the height map point
+	//					-fTexScale: texture coordinates per height map unit
+	//					-bNormal: fill in the vertex's normal
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void BuildVertex( SBACKEND_VERTEX* pVertex, int x, int z, float fTexScale, bool bNormal )
+	{
+		//the texture coordinates
+		pVertex->m_fTexCoord0[0]= x*fTexScale;
+		pVertex->m_fTexCoord0[1]= z*fTexScale;
+		pVertex->m_fTexCoord1[0]= pVertex->m_fTexCoord0[0]*m_iRepeatDetailMap;
+		pVertex->m_fTexCoord1[1]= pVertex->m_fTexCoord0[1]*m_iRepeatDetailMap;
+
+		pVertex->m_fPosition[0]= x*m_vecScale[0];
+		pVertex->m_fPosition[1]= GetScaledHeightAtPoint( x, z );
+		pVertex->m_fPosition[2]= z*m_vecScale[2];
+
+		//the vertex's normal (from the normal map)
+		if( bNormal )
+			GetNormalAtPoint( x, z, pVertex->m_fNormal );
 	}
 
 	public:
@@ -132,14 +474,220 @@ class CGEOMIPMAPPING : public CTERRAIN
 	void Update( CCAMERA camera, bool bCullPatches= true );
 	void Render( void );
 
+	void RecalculateRegion( int iMinX, int iMinZ, int iMaxX, int iMaxZ );
+
+	void SetCacheSize( unsigned int uiBytes );
+	void FlushPatchCache( void );
+	void LogCacheStats( void );
+
+	int CalibratePatchSize( CCAMERA* pPath, int iNumFrames );
+
 	//--------------------------------------------------------------
-	// Name:		 CGEOMIPMAPPING::SetFogDepth - public
-	// Description:	 Set the depth of the volumetric fog
-	// Arguments:	 -fDepth: depth of the fog
-	// Return Value: None
+	// Name:			CGEOMIPMAPPING::SetProjection - public
+	// Description:		Tell the LOD selection how big the screen is, so that
+	//					it can work out how many pixels an error covers
+	// Arguments:		-fFOV: the vertical field of view (in degrees)
+	//					-iViewportHeight: the viewport's height (in pixels)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetProjection( float fFOV, int iViewportHeight )
+	{	m_fErrorScale= iViewportHeight/( 2.0f*( float )tan( DEG_TO_RAD( fFOV )/2.0f ) );	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::SetPixelTolerance - public
+	// Description:		Set the biggest error (on the screen) that a patch's
+	//					level of detail is allowed to have
+	// Arguments:		-fPixels: the tolerance, in pixels
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetPixelTolerance( float fPixels )
+	{	m_fPixelTolerance= ( fPixels>0.0f ) ? fPixels : 0.0f;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetPixelTolerance - public
+	// Description:		Get the screen-space error tolerance
+	// Arguments:		None
+	// Return Value:	A float value: the tolerance, in pixels
+	//--------------------------------------------------------------
+	inline float GetPixelTolerance( void )
+	{	return m_fPixelTolerance;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::SetLODHysteresis - public
+	// Description:		Set how far past a coarser level's error the error
+	//					that a patch is allowed has to go before the patch
+	//					switches to it (switches to more detail are always
+	//					made right away)
+	// Arguments:		-fHysteresis: the band, as a fraction of the error
+	//							  (0 switches right away)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetLODHysteresis( float fHysteresis )
+	{	m_fLODHysteresis= ( fHysteresis>0.0f ) ? fHysteresis : 0.0f;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetLODHysteresis - public
+	// Description:		Get the level of detail hysteresis band
+	// Arguments:		None
+	// Return Value:	A float value: the band, as a fraction of the error
+	//--------------------------------------------------------------
+	inline float GetLODHysteresis( void )
+	{	return m_fLODHysteresis;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetCacheSize - public
+	// Description:		Get the most bytes of patch vertices that are kept
+	//					from one frame to the next
+	// Arguments:		None
+	// Return Value:	An unsigned integer value: the cache's budget
+	//--------------------------------------------------------------
+	inline unsigned int GetCacheSize( void )
+	{	return m_uiCacheBudget;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumCacheHits - public
+	// Description:		Get the number of patches that the last frame found
+	//					in the vertex cache
+	// Arguments:		None
+	// Return Value:	An integer value: the number of patches
+	//--------------------------------------------------------------
+	inline int GetNumCacheHits( void )
+	{	return m_iCacheHits;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumPatchesRebuilt - public
+	// Description:		Get the number of patches whose vertices the last
+	//					frame had to build (they weren't in the cache)
+	// Arguments:		None
+	// Return Value:	An integer value: the number of patches
+	//--------------------------------------------------------------
+	inline int GetNumPatchesRebuilt( void )
+	{	return m_iPatchesRebuilt;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::DoGeomorphing - public
+	// Description:		Turn geomorphing on or off
+	// Arguments:		-bGeomorphing: morph the patches' levels of detail
+	//								   into each other
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoGeomorphing( bool bGeomorphing )
+	{	m_bGeomorphing= bGeomorphing;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::IsGeomorphing - public
+	// Description:		Find out if the patches are geomorphed
+	// Arguments:		None
+	// Return Value:	A boolean value: -true: geomorphing is on
+	//									 -false: geomorphing is off
+	//--------------------------------------------------------------
+	inline bool IsGeomorphing( void )
+	{	return m_bGeomorphing;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::DoPatchMerging - public
+	// Description:		Turn the merging of flat, far away patches into
+	//					super-patches on or off
+	// Arguments:		-bMerge: merge the patches
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoPatchMerging( bool bMerge )
+	{	m_bMergePatches= bMerge;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::IsMergingPatches - public
+	// Description:		Find out if patches are merged into super-patches
+	// Arguments:		None
+	// Return Value:	A boolean value: -true: patch merging is on
+	//									 -false: patch merging is off
 	//--------------------------------------------------------------
-	inline void SetFogDepth( float fDepth )
-	{	m_fFogDepth= fDepth;	}
+	inline bool IsMergingPatches( void )
+	{	return m_bMergePatches;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::DoSpecializedKernels - public
+	// Description:		Build the patches with the kernels that were compiled
+	//					for their vertex blocks' widths, or all with the
+	//					general one (that works the width out as it goes)
+	// Arguments:		-bSpecialize: use the specialized kernels
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoSpecializedKernels( bool bSpecialize )
+	{
+		m_bSpecializeKernels= bSpecialize;
+		SelectPatchKernels( );
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::IsSpecializingKernels - public
+	// Description:		Find out if the patches are built with specialized
+	//					kernels
+	// Arguments:		None
+	// Return Value:	A boolean value: -true: specialized kernels are used
+	//									 -false: the general kernel is used
+	//--------------------------------------------------------------
+	inline bool IsSpecializingKernels( void )
+	{	return m_bSpecializeKernels;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetPatchSize - public
+	// Description:		Get the size of the patches (in vertices on a side)
+	// Arguments:		None
+	// Return Value:	An integer value: the patch size
+	//--------------------------------------------------------------
+	inline int GetPatchSize( void )
+	{	return m_iPatchSize;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumSuperPatches - public
+	// Description:		Get the number of super-patches that the last update
+	//					made
+	// Arguments:		None
+	// Return Value:	An integer value: the number of super-patches
+	//--------------------------------------------------------------
+	inline int GetNumSuperPatches( void )
+	{	return m_iNumSuperPatches;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumPatchesMerged - public
+	// Description:		Get the number of visible patches that the last update
+	//					merged into super-patches
+	// Arguments:		None
+	// Return Value:	An integer value: the number of patches
+	//--------------------------------------------------------------
+	inline int GetNumPatchesMerged( void )
+	{	return m_iPatchesMerged;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumLODSwitches - public
+	// Description:		Get the number of visible patches whose level of
+	//					detail changed during the last update
+	// Arguments:		None
+	// Return Value:	An integer value: the number of patches
+	//--------------------------------------------------------------
+	inline int GetNumLODSwitches( void )
+	{	return m_iLODSwitches;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetMaxPopPixels - public
+	// Description:		Get the biggest pop that the last update's level of
+	//					detail switches made (an estimate: how far, on the
+	//					screen, a patch's vertices could have jumped)
+	// Arguments:		None
+	// Return Value:	A float value: the pop, in pixels
+	//--------------------------------------------------------------
+	inline float GetMaxPopPixels( void )
+	{	return m_fMaxPopPixels;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetTotalPopPixels - public
+	// Description:		Get the sum of the pops that the last update's level
+	//					of detail switches made
+	// Arguments:		None
+	// Return Value:	A float value: the pops, in pixels
+	//--------------------------------------------------------------
+	inline float GetTotalPopPixels( void )
+	{	return m_fTotalPopPixels;	}
 
 	//--------------------------------------------------------------
 	// Name:			CGEOMIPMAPPING::GetNumPatchesPerFrame - public
@@ -150,6 +698,27 @@ class CGEOMIPMAPPING : public CTERRAIN
 	inline int GetNumPatchesPerFrame( void )
 	{	return m_iPatchesPerFrame;	}
 
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumVisiblePatches - public
+	// Description:		Get the number of patches that the last update found
+	//					to be visible
+	// Arguments:		None
+	// Return Value:	An integer value: the number of visible patches
+	//--------------------------------------------------------------
+	inline int GetNumVisiblePatches( void )
+	{	return m_iNumVisiblePatches;	}
+
+	//--------------------------------------------------------------
+	// Name:			CGEOMIPMAPPING::GetNumPatchesTested - public
+	// Description:		Get the number of patches that the last update had to
+	//					test against the frustum one by one (the rest were
+	//					accepted or rejected a whole quadtree node at a time)
+	// Arguments:		None
+	// Return Value:	An integer value: the number of patches
+	//--------------------------------------------------------------
+	inline int GetNumPatchesTested( void )
+	{	return m_iPatchesTested;	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::GetPatchNumber - public
 	// Description:		Calculate the current patch number
@@ -159,8 +728,25 @@ class CGEOMIPMAPPING : public CTERRAIN
 	inline int GetPatchNumber( int PX, int PZ )
 	{	return ( ( PZ*m_iNumPatchesPerSide )+PX );	}
 
-	CGEOMIPMAPPING( void )
-	{	}
+	CGEOMIPMAPPING( void ) : m_pNodes( NULL ), m_iNumNodes( 0 ), m_iNumLeaves( 0 ),
+							 m_ipCullLeaves( NULL ), m_ipCullPlanes( NULL ), m_iNumCullLeaves( 0 ), m_iPatchesTested( 0 ),
+							 m_ipVisiblePatches( NULL ), m_ipLeafVisible( NULL ), m_iNumVisiblePatches( 0 ),
+							 m_bMergePatches( true ), m_ipDrawPatches( NULL ), m_iNumDrawPatches( 0 ),
+							 m_pSuperPatches( NULL ), m_iNumSuperPatches( 0 ), m_iPatchesMerged( 0 ),
+							 m_iPatchSize( 0 ), m_iNumPatchesPerSide( 0 ), m_bSpecializeKernels( true ), m_iMaxLOD( 0 ), m_iPatchesPerFrame( 0 ),
+							 m_fPixelTolerance( GEOMM_DEFAULT_TOLERANCE ), m_fLODHysteresis( GEOMM_DEFAULT_HYSTERESIS ),
+							 m_bGeomorphing( false ), m_fpPatchHeights( NULL ),
+							 m_iUpdateFrame( 0 ), m_iLODSwitches( 0 ), m_fMaxPopPixels( 0.0f ), m_fTotalPopPixels( 0.0f ),
+							 m_pCache( NULL ), m_iCacheHead( -1 ), m_iCacheTail( -1 ), m_uiCacheBytes( 0 ),
+							 m_uiCacheBudget( GEOMM_DEFAULT_CACHE_SIZE ), m_pPatchVertices( NULL ),
+							 m_iCacheNormals( -1 ), m_iCacheDetailRepeat( 0 ),
+							 m_iCacheHits( 0 ), m_iPatchesRebuilt( 0 ), m_iTotalCacheHits( 0 ), m_iTotalPatchesRebuilt( 0 ),
+							 m_iCacheEvictions( 0 ), m_uspTemplateIndices( NULL ), m_iNumTemplateIndices( 0 )
+	{
+		memset( &m_patches, 0, sizeof( SGEOMM_PATCHES ) );
+		SetProjection( 45.0f, 480 );
+		SelectPatchKernels( );
+	}
 	~CGEOMIPMAPPING( void )
 	{	}
 };
@@ -15,12 +15,19 @@
 //--------------------------------------------------------------
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <windows.h>
 
+#include "../Base Code/bake_cache.h"
 #include "../Base Code/gl_app.h"
 #include "../Base Code/math_ops.h"
 #include "../Base Code/camera.h"
+#include "../Base Code/render_queue.h"
+#include "../Base Code/render_stats.h"
 
+#include "benchmark.h"
+#include "chunklod.h"
+#include "geoclipmap.h"
 #include "geomipmapping.h"
 #include "particle.h"
 #include "skydome.h"
@@ -44,21 +51,70 @@ CGL_APP g_glApp;
 
 CCAMERA g_camera;
 CGEOMIPMAPPING g_geomipmapping;
+CGEOCLIPMAP g_geoclipmap;
+CCHUNKLOD g_chunkLOD;
+
+//the terrain engine that the demo is running ("-clipmap" on the command
+//line swaps geomipmapping for the geometry clipmap, and "-chunklod" swaps
+//it for chunked LOD)
+CTERRAIN* g_pTerrain= &g_geomipmapping;
+bool g_bClipmap= false;
+bool g_bChunkLOD= false;
+
 CWATER g_water;
 CSKYDOME g_skydome;
 
 CPARTICLE_ENGINE g_particleEngine;
 
+CRENDER_QUEUE g_renderQueue;
+
 float g_fFogDepth= 150.0f;
 
+//the biggest error (in pixels) that a terrain patch may have on the screen
+//(the terrain is geomorphed, which hides the pops, so it can get away with
+//twice the usual error)
+float g_fPixelTolerance= 2.0f*GEOMM_DEFAULT_TOLERANCE;
+
+//the camera's last few hundred frames (a ring, with g_iPathFrame where the
+//next one goes), which the geomipmapping patch size is calibrated over
+const int g_iMaxPathFrames= 600;
+CCAMERA g_cameraPath[g_iMaxPathFrames];
+int g_iPathFrame= 0;
+int g_iNumPathFrames= 0;
+
 int g_iLevel= 15;
 
+//time of day (0 is sunrise, 1 is sunset), for the moving sun
+float g_fTimeOfDay= 0.35f;
+bool g_bTimeOfDay= false;
+
+//the ambient occlusion starts out rough, and gets a direction better
+//every frame until it has this many
+const int g_iOcclusionDirections= 32;
+
+//the terrain is always made from the same seed, so that it can be
+//pulled out of the bake cache instead of being regenerated
+const unsigned int g_uiTerrainSeed= 20030101;
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- DEFINITIONS ------------------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 
+//--------------------------------------------------------------
+// Name:			SetSunPosition - global
+// Description:		Put the sun where it should be for the time of day,
+//					and relight the terrain from its horizon maps
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void SetSunPosition( void )
+{
+	//the sun rises in the east (+x), and sets in the west
+	g_pTerrain->Relight( g_fTimeOfDay*180.0f, 5.0f+55.0f*( float )sin( g_fTimeOfDay*PI ) );
+}
+
 //--------------------------------------------------------------
 // Name:			DemoInit - global
 // Description:		Initiate the things needed for the demo
@@ -70,8 +126,6 @@ bool DemoInit( void )
 {
 	static float fFogColor[4]= {	0.9f, 0.9f, 0.9f, 1.0f	};
 
-	srand( GetCurrentTime( ) );
-
 	g_glApp.Init( 10, 10, g_iScreenWidth, g_iScreenHeight, 16, "Demo 8_12: Applying a Particle Engine to the Outdoors (Rain)", IDI_ICON1, IDR_MENU1 );
 	g_glApp.CreateTTFont( "Lucida Console", 16 );
 
@@ -87,32 +141,76 @@ bool DemoInit( void )
 	glDepthFunc( GL_LEQUAL );								//set the type of depth test
 	glHint( GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST );	//the nicest perspective look
 
+	//set the bake cache up ("-invalidatecache" throws away everything in it,
+	//"-nocache" bakes everything from scratch without touching it)
+	g_bakeCache.Init( "Bake Cache" );
+	if( strstr( GetCommandLine( ), "-invalidatecache" ) )
+		g_bakeCache.Invalidate( );
+	if( strstr( GetCommandLine( ), "-nocache" ) )
+		g_bakeCache.Enable( false );
+
+	if( strstr( GetCommandLine( ), "-clipmap" ) )
+	{
+		g_pTerrain= &g_geoclipmap;
+		g_bClipmap= true;
+	}
+
+	else if( strstr( GetCommandLine( ), "-chunklod" ) )
+	{
+		g_pTerrain = &g_chunkLOD;
+		g_bChunkLOD= true;
+	}
+
 	//load the height map in
-	g_geomipmapping.MakeTerrainFault( 513, 64, 0, 255, 0.15f );
+	g_pTerrain->SetRandomSeed( g_uiTerrainSeed );
+	g_pTerrain->MakeTerrainFault( 513, 64, 0, 255, 0.15f );
 
-	//set the terrain's lighting system up
-	g_geomipmapping.SetLightingType( SLOPE_LIGHT );
-	g_geomipmapping.SetLightColor( CVECTOR( 0.3f, 0.3f, 0.3f ) );
-	g_geomipmapping.CustomizeSlopeLighting( 1, 1, 0.2f, 0.9f, 15 );
-	g_geomipmapping.CalculateLighting( );
+	//everything else (the particles) still gets a different seed every run
+	srand( GetCurrentTime( ) );
+
+	//set the terrain's lighting system up (the horizon maps depend on the
+	//terrain's scale, so it needs to be set first)
+	g_pTerrain->Scale( 2.0f, 1.0f, 2.0f );
+	g_pTerrain->CalculateNormals( );
+	g_pTerrain->SetLightingType( HORIZON_MAPPED );
+	g_pTerrain->SetLightColor( CVECTOR( 0.3f, 0.3f, 0.3f ) );
+	g_pTerrain->CustomizeShadowedLighting( 0.0f, 0.0f, 0.5f, 0.2f, 0.9f );
+	g_pTerrain->CustomizeAmbientOcclusion( 32.0f, 0.6f );
+	g_pTerrain->RefineAmbientOcclusion( 4 );
+	g_pTerrain->CalculateLighting( );
+	SetSunPosition( );
 	
 	//load the various terrain tiles
-	g_geomipmapping.LoadTile( LOWEST_TILE,  "../Data/lowestTile.tga" );
-	g_geomipmapping.LoadTile( LOW_TILE,     "../Data/lowTile.tga" );
-	g_geomipmapping.LoadTile( HIGH_TILE,    "../Data/highTile.tga" );
-	g_geomipmapping.LoadTile( HIGHEST_TILE, "../Data/highestTile.tga" );
+	g_pTerrain->LoadTile( LOWEST_TILE,  "../Data/lowestTile.tga" );
+	g_pTerrain->LoadTile( LOW_TILE,     "../Data/lowTile.tga" );
+	g_pTerrain->LoadTile( HIGH_TILE,    "../Data/highTile.tga" );
+	g_pTerrain->LoadTile( HIGHEST_TILE, "../Data/highestTile.tga" );
+
+	//compress the texture map and the detail map (if the video card can handle it)
+	if( g_glApp.CanCompressTextures( ) )
+		g_pTerrain->DoTextureCompression( IMAGE_BC1, COMPRESS_NORMAL );
 
 	//load the terrain's detail map
-	g_geomipmapping.LoadDetailMap( "../Data/detailMap.tga" );
-	g_geomipmapping.DoDetailMapping( true, 16 );
+	g_pTerrain->LoadDetailMap( "../Data/detailMap.tga" );
+	g_pTerrain->DoDetailMapping( true, 16 );
 
 	//make the texture map, and then save it
-	g_geomipmapping.GenerateTextureMap( 256 );
-	g_geomipmapping.DoTextureMapping( true );
-	g_geomipmapping.DoMultitexturing( g_glApp.CanMultitexture( ) );
+	g_pTerrain->GenerateTextureMap( 256 );
+	g_pTerrain->DoTextureMapping( true );
+	g_pTerrain->DoMultitexturing( g_glApp.CanMultitexture( ) );
 
-	//initiate the geomipmapping system
-	g_geomipmapping.Init( 17 );
+	//initiate the geometry clipmap, or the geomipmapping system (the
+	//patches' level of detail is picked using the same projection that
+	//ResizeScene sets up)
+	if( g_bClipmap )
+		g_geoclipmap.Init( GEOCM_DEFAULT_GRID_SIZE, GEOCM_DEFAULT_LEVELS );
+
+	else
+	{
+		g_geomipmapping.Init( 17 );
+		g_geomipmapping.SetProjection( 45.0f, g_iScreenHeight );
+		g_geomipmapping.DoGeomorphing( true );
+	}
 
 	glFogi( GL_FOG_MODE, GL_LINEAR );		//set a linear fog mode
 	glFogfv( GL_FOG_COLOR, fFogColor );		//set the color of the fog
@@ -120,6 +218,21 @@ bool DemoInit( void )
 	glFogf( GL_FOG_END, 150.0f );			//set the fog's depth to 150 world units
 
 	g_geomipmapping.SetFogDepth( g_fFogDepth );
+	g_geoclipmap.SetFogDepth( g_fFogDepth );
+	g_chunkLOD.SetFogDepth( g_fFogDepth );
+
+	//map the chunk file in (the terrain's lighting and fog are baked into
+	//it, so it is built again if it is missing or out of date)
+	if( g_bChunkLOD )
+	{
+		if( !g_chunkLOD.Init( "terrain.chunks" ) )
+		{
+			g_chunkLOD.Build( "terrain.chunks" );
+			g_chunkLOD.Init( "terrain.chunks" );
+		}
+
+		g_chunkLOD.SetProjection( 45.0f, g_iScreenHeight );
+	}
 
 	//turn the volumetric fog extension on
 	glFogi( GL_FOG_COORDINATE_SOURCE_EXT, GL_FOG_COORDINATE_EXT );
@@ -134,7 +247,7 @@ bool DemoInit( void )
 	g_skydome.LoadTexture( "../Data/clouds2.tga" );
 
 	//set the camera's position
-	g_camera.SetPosition( 128.0f, g_geomipmapping.GetScaledHeightAtPoint( 128, 256 )+50.0f , 256.0f );
+	g_camera.SetPosition( 128.0f, g_pTerrain->GetScaledHeightAtPoint( 128, 256 )+50.0f , 256.0f );
 
 	//initialize the particle engine
 	g_particleEngine.Init( 2000 );
@@ -179,14 +292,13 @@ void DemoRender( void )
 	//reset the modelview matrix
 	glLoadIdentity( );
 
-	fScale= g_geomipmapping.m_vecScale[0];
+	fScale= g_pTerrain->m_vecScale[0];
 
 	//perform collision detection and response against the terrain mesh
-	CLAMP( g_camera.m_vecEyePos[0], 100, ( g_geomipmapping.m_iSize*fScale )-100 );
-	CLAMP( g_camera.m_vecEyePos[2], 100, ( g_geomipmapping.m_iSize*fScale )-100 );
+	CLAMP( g_camera.m_vecEyePos[0], 100, ( g_pTerrain->m_iSize*fScale )-100 );
+	CLAMP( g_camera.m_vecEyePos[2], 100, ( g_pTerrain->m_iSize*fScale )-100 );
 
-	ucHeight= ( float )g_geomipmapping.GetScaledHeightAtPoint( ( int )( g_camera.m_vecEyePos[0]/fScale ),
-															   ( int )( g_camera.m_vecEyePos[2]/fScale ) );
+	ucHeight= g_pTerrain->SampleHeight( g_camera.m_vecEyePos[0], g_camera.m_vecEyePos[2] );
 
 	if( g_camera.m_vecEyePos[1]<( ucHeight+8 ) )
 		g_camera.m_vecEyePos[1]= ucHeight+8;
@@ -198,46 +310,53 @@ void DemoRender( void )
 	//calculate the viewing frustum
 	g_camera.CalculateViewFrustum( );
 
-	//render the skydome
-	glDisable( GL_CULL_FACE );
-	glDisable( GL_DEPTH_TEST );
-	glDepthMask( GL_FALSE );
-		g_skydome.Set( g_camera.m_vecEyePos[0], g_camera.m_vecEyePos[1]-200.0f, g_camera.m_vecEyePos[2] );
-		g_skydome.Render( 0.009f, true );
-	glDepthMask( GL_TRUE );
-	glEnable( GL_DEPTH_TEST );
-
-	glCullFace( GL_CCW );
-	glEnable( GL_CULL_FACE );
-
 	//update the water's vertices and re-calculate polygon normals
 	g_water.Update( 0.001f );
 	g_water.CalcNormals( );
 
-	//setup the terrain
-	g_geomipmapping.Update( g_camera );
-
-	g_geomipmapping.SetFogDepth( g_fFogDepth );
-	glEnable( GL_FOG );
+	//move the sun along, and relight the terrain for it (the chunks' lighting
+	//is baked, so chunked LOD has nothing to relight)
+	if( g_bTimeOfDay && !g_bChunkLOD )
+	{
+		g_fTimeOfDay+= 0.0005f;
+		if( g_fTimeOfDay>1.0f )
+			g_fTimeOfDay-= 1.0f;
 
-	//render the simple terrain!
-	glPushMatrix( );
-		g_geomipmapping.Scale( 2.0f, 1.0f, 2.0f );
-		g_geomipmapping.Render( );
-	glPopMatrix( );
+		SetSunPosition( );
+	}
 
-	glDisable( GL_FOG );
+	//refine the ambient occlusion a little bit more
+	else if( g_pTerrain->GetNumOcclusionDirections( )<g_iOcclusionDirections && !g_bChunkLOD )
+	{
+		g_pTerrain->RefineAmbientOcclusion( 1 );
+		SetSunPosition( );
+	}
 
-	glDisable( GL_CULL_FACE );
+	//setup the terrain
+	if( g_bClipmap )
+	{
+		g_geoclipmap.Update( g_camera );
+		g_geoclipmap.SetFogDepth( g_fFogDepth );
+	}
 
-	//render the water mesh
-	glPushMatrix( );
-		glTranslatef( 0.0f, 75.0f, 0.0f );
+	else if( g_bChunkLOD )
+	{
+		g_chunkLOD.SetPixelTolerance( g_fPixelTolerance );
+		g_chunkLOD.Update( g_camera );
+	}
 
-		glDepthMask( GL_FALSE );
-		g_water.Render( true );
-		glDepthMask( GL_TRUE );
-	glPopMatrix( );
+	else
+	{
+		g_geomipmapping.SetPixelTolerance( g_fPixelTolerance );
+		g_geomipmapping.Update( g_camera );
+		g_geomipmapping.SetFogDepth( g_fFogDepth );
+
+		//record the camera's path
+		g_cameraPath[g_iPathFrame]= g_camera;
+		g_iPathFrame= ( g_iPathFrame+1 )%g_iMaxPathFrames;
+		g_iNumPathFrames= MIN( g_iNumPathFrames+1, g_iMaxPathFrames );
+	}
+	g_pTerrain->Scale( 2.0f, 1.0f, 2.0f );
 
 	//update our particles
 	g_particleEngine.CreateRaindrops( g_camera.m_vecEyePos[0]-150.0f, g_camera.m_vecEyePos[1]-150.0f, g_camera.m_vecEyePos[2]-150.0f,
@@ -245,19 +364,24 @@ void DemoRender( void )
 									  6, 150 );
 	g_particleEngine.Update( );
 
-	//enable blending
-	glEnable( GL_BLEND );
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+	//queue up the skydome, the terrain, the water mesh and the particles,
+	//and then draw them all at once (sorted so that as little state as
+	//possible changes between them)
+	g_skydome.Set( g_camera.m_vecEyePos[0], g_camera.m_vecEyePos[1]-200.0f, g_camera.m_vecEyePos[2] );
+	g_skydome.Submit( &g_renderQueue, 0.009f, true );
 
-	//disable texturing and depth testing
-	glDisable( GL_DEPTH_TEST );
-	glDisable( GL_TEXTURE_2D );
+	if( g_bClipmap )
+		g_geoclipmap.Submit( &g_renderQueue );
+	else if( g_bChunkLOD )
+		g_chunkLOD.Submit( &g_renderQueue );
+	else
+		g_geomipmapping.Submit( &g_renderQueue );
+	g_water.Submit( &g_renderQueue, 75.0f, true );
+	g_particleEngine.Submit( &g_renderQueue );
 
-	//render our particles
-	g_particleEngine.Render( );
+	g_renderQueue.Flush( &g_glBackend );
 
 	//render some text to the screen
-	glDisable( GL_TEXTURE_2D );
 	g_glApp.BeginTextMode( );
 		//render the number of frames per second
 		g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-70, CVECTOR( 0.0f, 1.0f, 0.0f), 
@@ -265,21 +389,21 @@ void DemoRender( void )
 
 		//render the number of vertices per frame
 		g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-85, CVECTOR( 0.0f, 1.0f, 0.0f),
-					   "Vertices: %d", g_geomipmapping.GetNumVertsPerFrame( )+
+					   "Vertices: %d", g_pTerrain->GetNumVertsPerFrame( )+
 									   g_water.GetNumVertices( )+
 									   g_skydome.GetNumVertices( )+
 									   ( g_particleEngine.GetNumParticlesOnScreen( )*4 ) );
 
 		//render how many triangles are getting rendered per second
 		g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-100, CVECTOR( 0.0f, 1.0f, 0.0f),
-					   "Tris:   %d", g_geomipmapping.GetNumTrisPerFrame( )+
+					   "Tris:   %d", g_pTerrain->GetNumTrisPerFrame( )+
 									 g_water.GetNumTriangles( )+
 									 g_skydome.GetNumTriangles( )+
 									 ( g_particleEngine.GetNumParticlesOnScreen( )*2 ) );
 
 		//render how many million triangles are rendered per second
 		g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-115, CVECTOR( 0.0f, 1.0f, 0.0f),
-					   "MTris/S:  %.3f", ( ( g_geomipmapping.GetNumTrisPerFrame( )+
+					   "MTris/S:  %.3f", ( ( g_pTerrain->GetNumTrisPerFrame( )+
 											 g_water.GetNumTriangles( )+
 											 g_skydome.GetNumTriangles( )+
 											 ( g_particleEngine.GetNumParticlesOnScreen( )*2 ) )*g_glApp.GetFPS( ) )/1000000.0f );
@@ -287,10 +411,45 @@ void DemoRender( void )
 		//render volumetric fog control text
 		g_glApp.Print( 30, g_iScreenHeight-70, CVECTOR( 1.0f, 0.0f, 0.0f ), "+    Increase Fog Depth" );
 		g_glApp.Print( 30, g_iScreenHeight-86, CVECTOR( 1.0f, 0.0f, 0.0f ), "-    Decrease Fog Depth" );
+		g_glApp.Print( 30, g_iScreenHeight-102, CVECTOR( 1.0f, 0.0f, 0.0f ), "T    Toggle Time of Day" );
+		if( g_bClipmap )
+			g_glApp.Print( 30, g_iScreenHeight-118, CVECTOR( 1.0f, 0.0f, 0.0f ), "Clipmap levels: %d-%d", g_geoclipmap.GetFinestLevel( ), g_geoclipmap.GetNumLevels( )-1 );
+
+		else if( g_bChunkLOD )
+		{
+			g_glApp.Print( 30, g_iScreenHeight-118, CVECTOR( 1.0f, 0.0f, 0.0f ), "PgUp/PgDn  Pixel Error: %.1f", g_fPixelTolerance );
+			g_glApp.Print( 30, g_iScreenHeight-134, CVECTOR( 1.0f, 0.0f, 0.0f ), "Chunks: %d of %d", g_chunkLOD.GetNumChunksDrawn( ), g_chunkLOD.GetNumChunks( ) );
+		}
+
+		else
+		{
+			g_glApp.Print( 30, g_iScreenHeight-118, CVECTOR( 1.0f, 0.0f, 0.0f ), "PgUp/PgDn  Pixel Error: %.1f", g_fPixelTolerance );
+			g_glApp.Print( 30, g_iScreenHeight-134, CVECTOR( 1.0f, 0.0f, 0.0f ), "G    Geomorphing: %s", g_geomipmapping.IsGeomorphing( ) ? "on" : "off" );
+			g_glApp.Print( 30, g_iScreenHeight-150, CVECTOR( 1.0f, 0.0f, 0.0f ), "M    Patch Merging: %s", g_geomipmapping.IsMergingPatches( ) ? "on" : "off" );
+			g_glApp.Print( 30, g_iScreenHeight-166, CVECTOR( 1.0f, 0.0f, 0.0f ), "C    Calibrate Patch Size: %dx%d", g_geomipmapping.GetPatchSize( ), g_geomipmapping.GetPatchSize( ) );
+		}
+
+#ifdef RENDER_STATS
+		{
+			SRENDER_STATS totals;
+
+			//render what the last frame asked the driver to do
+			g_renderStats.GetFrameTotals( &totals );
+			g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-130, CVECTOR( 0.0f, 1.0f, 0.0f ),
+						   "Batches: %d", totals.m_iBatches );
+			g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-145, CVECTOR( 0.0f, 1.0f, 0.0f ),
+						   "Binds:   %d", totals.m_iTextureBinds );
+			g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-160, CVECTOR( 0.0f, 1.0f, 0.0f ),
+						   "States:  %d", totals.m_iStateToggles+totals.m_iStateChanges );
+			g_glApp.Print( 30, g_iScreenHeight-182, CVECTOR( 1.0f, 0.0f, 0.0f ), "L    Log Render Stats" );
+		}
+#endif
 	g_glApp.EndTextMode( );
 
 	//force a render finish, and then swap buffers
 	g_glApp.EndRendering( );
+
+	STATS_END_FRAME( );
 }
 
 //--------------------------------------------------------------
@@ -306,10 +465,27 @@ bool DemoShutdown( void )
 
 	g_skydome.Shutdown( );
 
-	g_geomipmapping.Shutdown( );
-	g_geomipmapping.UnloadAllTiles( );
-	g_geomipmapping.UnloadTexture( );
-	g_geomipmapping.UnloadHeightMap( );
+	g_renderQueue.Free( );
+
+	if( g_bClipmap )
+		g_geoclipmap.Shutdown( );
+
+	else if( g_bChunkLOD )
+		g_chunkLOD.Shutdown( );
+
+	else
+	{
+		g_geomipmapping.LogCacheStats( );
+		g_geomipmapping.Shutdown( );
+	}
+	g_pTerrain->UnloadAllTiles( );
+	g_pTerrain->UnloadTexture( );
+	g_pTerrain->UnloadHorizonMaps( );
+	g_pTerrain->UnloadAmbientOcclusion( );
+	g_pTerrain->UnloadNormals( );
+	g_pTerrain->UnloadHeightMap( );
+
+	g_bakeCache.LogStats( );
 
 	//exit the program
 	g_glApp.DestroyFont( );
@@ -330,6 +506,8 @@ bool DemoShutdown( void )
 bool DemoInput( void )
 {
 	static int iToggleWait;
+	CCAMERA* pPath;
+	int i;
 
 	//only move when a button is down (makes life so much easier)
 	if( g_glApp.MouseDown( MK_LBUTTON ) || g_glApp.MouseDown( MK_RBUTTON ) )
@@ -393,6 +571,91 @@ bool DemoInput( void )
 
 	CLAMP( g_fFogDepth, 0.0f, 250.0f );
 
+	//allow the terrain more error on the screen (fewer triangles)
+	if( g_glApp.KeyDown( VK_PRIOR ) )
+		g_fPixelTolerance+= 0.1f;
+
+	//allow less error (more triangles)
+	else if( g_glApp.KeyDown( VK_NEXT ) )
+		g_fPixelTolerance-= 0.1f;
+
+	CLAMP( g_fPixelTolerance, 0.5f, 32.0f );
+
+#ifdef RENDER_STATS
+	//write the last frame's render stats to the log
+	if( g_glApp.KeyDown( 'L' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		g_renderStats.LogFrame( );
+
+		iToggleWait= 0;
+	}
+#endif
+
+	//start/stop the sun
+	if( g_glApp.KeyDown( 'T' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bTimeOfDay )
+			g_bTimeOfDay= false;
+
+		else
+			g_bTimeOfDay= true;
+
+		iToggleWait= 0;
+	}
+
+	//morph the terrain's levels of detail, or let them pop
+	if( g_glApp.KeyDown( 'G' ) && !g_bClipmap && !g_bChunkLOD )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		g_geomipmapping.DoGeomorphing( !g_geomipmapping.IsGeomorphing( ) );
+
+		iToggleWait= 0;
+	}
+
+	//draw flat squares of coarse patches as one patch, or all on their own
+	if( g_glApp.KeyDown( 'M' ) && !g_bClipmap && !g_bChunkLOD )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		g_geomipmapping.DoPatchMerging( !g_geomipmapping.IsMergingPatches( ) );
+
+		iToggleWait= 0;
+	}
+
+	//try each patch size over the camera's recorded path, and keep the best
+	if( g_glApp.KeyDown( 'C' ) && !g_bClipmap && !g_bChunkLOD && g_iNumPathFrames>0 )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		//unroll the ring, oldest frame first
+		pPath= new CCAMERA [g_iNumPathFrames];
+		if( pPath )
+		{
+			for( i=0; i<g_iNumPathFrames; i++ )
+				pPath[i]= g_cameraPath[( g_iPathFrame-g_iNumPathFrames+i+g_iMaxPathFrames )%g_iMaxPathFrames];
+
+			g_geomipmapping.CalibratePatchSize( pPath, g_iNumPathFrames );
+			delete[] pPath;
+		}
+
+		iToggleWait= 0;
+	}
+
 	return true;
 }
 
@@ -411,6 +674,15 @@ int WINAPI WinMain( HINSTANCE hInstance,
 	if( !DemoInit( ) )
 		return false;
 
+	//run the benchmarks instead of the demo
+	if( strstr( lpCmdLine, "-benchmark" ) )
+	{
+		RunBenchmarks( );
+
+		DemoShutdown( );
+		return false;
+	}
+
 	while( true )
 	{
 		if( !g_glApp.HandleMessages( ) )
@@ -153,29 +153,75 @@ void CPARTICLE_ENGINE::Update( float fTimeStep )
 //--------------------------------------------------------------
 void CPARTICLE_ENGINE::Render( void )
 {
-	CVECTOR vecMtrxRight, vecMtrxUp;
-	CVECTOR vecPosition, vecSize, vecTemp;
-	float fMatrix[16];
-	int i;
-
 	//enable blending and texturing
-	glEnable( GL_BLEND );
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+	m_pBackend->SetState( BACKEND_BLEND, true );
+	m_pBackend->SetBlendMode( BACKEND_BLEND_ADDITIVE );
 
 	//turn off depth testing
-	glDisable( GL_DEPTH_TEST );
+	m_pBackend->SetState( BACKEND_DEPTH_TEST, false );
 
 	//bind the particle image
-	glEnable( GL_TEXTURE_2D );
-	glBindTexture( GL_TEXTURE_2D, m_uiTexID );
+	m_pBackend->SetState( BACKEND_TEXTURE0, true );
+	m_pBackend->BindTexture( 0, m_uiTexID );
+
+	Draw( );
+
+	m_pBackend->SetState( BACKEND_DEPTH_TEST, true );
+}
+
+//--------------------------------------------------------------
+// Name:		 CPARTICLE_ENGINE::Submit - public
+// Description:	 Add the particles to a render queue: they are drawn
+//				 over everything else, added to what is already there
+// Arguments:	 -pQueue: the render queue
+// Return Value: None
+//--------------------------------------------------------------
+void CPARTICLE_ENGINE::Submit( CRENDER_QUEUE* pQueue )
+{
+	SRENDER_PACKET* pPacket;
+
+	pPacket= pQueue->AddPacket( RENDER_PASS_OVERLAY, STATS_PARTICLES );
+	pPacket->m_state.m_bDepthTest	= false;
+	pPacket->m_state.m_bBlend		= true;
+	pPacket->m_state.m_blendMode	= BACKEND_BLEND_ADDITIVE;
+	pPacket->m_state.m_uiTextures[0]= m_uiTexID;
+
+	pPacket->m_pfnDraw= DrawPacket;
+	pPacket->m_pData  = this;
+}
+
+//--------------------------------------------------------------
+// Name:		 CPARTICLE_ENGINE::Draw - private
+// Description:	 Draw the living particles as billboards (the state has
+//				 already been set up)
+// Arguments:	 None
+// Return Value: None
+//--------------------------------------------------------------
+void CPARTICLE_ENGINE::Draw( void )
+{
+	SBACKEND_VERTEX vertices[4];
+	CVECTOR vecMtrxRight, vecMtrxUp;
+	CVECTOR vecPosition, vecSize, vecTemp;
+	float fMatrix[16];
+	float fColor;
+	int i, j;
 
 	//extract the up and right vectors (for billboarding) from the view matrix
-	glGetFloatv( GL_MODELVIEW_MATRIX, fMatrix );
+	m_pBackend->GetModelview( fMatrix );
 	vecMtrxRight.Set( fMatrix[0], fMatrix[4], fMatrix[8] );
 	vecMtrxUp.Set( fMatrix[1], fMatrix[5], fMatrix[9] );
 
+	//the texture coordinates are the same for every particle
+	vertices[0].m_fTexCoord0[0]= 1;	vertices[0].m_fTexCoord0[1]= 1;
+	vertices[1].m_fTexCoord0[0]= 0;	vertices[1].m_fTexCoord0[1]= 1;
+	vertices[2].m_fTexCoord0[0]= 1;	vertices[2].m_fTexCoord0[1]= 0;
+	vertices[3].m_fTexCoord0[0]= 0;	vertices[3].m_fTexCoord0[1]= 0;
+
 	m_iNumParticlesOnScreen= 0;
 
+	//all of the particles go into one triangle list
+	m_pBackend->Begin( BACKEND_TRIANGLES, BACKEND_COLOR | BACKEND_TEXCOORD0 );
+
 	for( i=0; i<m_iNumParticles; i++ )
 	{
 		if( m_pParticles[i].m_fLife>0.0f )
@@ -188,35 +234,57 @@ void CPARTICLE_ENGINE::Render( void )
 			vecSize[1]= m_pParticles[i].m_vecSize[2];
 			vecSize[2]= ( vecSize[0]+vecSize[2] )/2;
 
-			//render our particle (as a triangle strip)
-			glBegin(GL_TRIANGLE_STRIP);
-				glColor4f( m_pParticles[i].m_vecColor[0],
-						   m_pParticles[i].m_vecColor[1],
-						   m_pParticles[i].m_vecColor[2],
-						   m_pParticles[i].m_fTranslucency );
-
-				//top right
-				vecTemp= ( ( vecMtrxRight+vecMtrxUp )*vecSize )+vecPosition;
-				glTexCoord2f( 1, 1 );	glVertex3f( vecTemp[0], vecTemp[1], vecTemp[2] );
-
-				//top left
-				vecTemp= ( ( vecMtrxUp-vecMtrxRight )*vecSize )+vecPosition;
-				glTexCoord2f( 0, 1 );	glVertex3f( vecTemp[0], vecTemp[1], vecTemp[2] );
-
-				//bottom right
-				vecTemp= ( ( vecMtrxRight-vecMtrxUp )*vecSize )+vecPosition;
-				glTexCoord2f( 1, 0 );	glVertex3f( vecTemp[0], vecTemp[1], vecTemp[2] );
-
-				//bottom left
-				vecTemp= ( ( vecMtrxRight+vecMtrxUp )*-vecSize )+vecPosition;
-				glTexCoord2f( 0, 0 );	glVertex3f( vecTemp[0], vecTemp[1], vecTemp[2] );
-			glEnd( );
+			for( j=0; j<4; j++ )
+			{
+				fColor= ( j<3 ) ? m_pParticles[i].m_vecColor[j] : m_pParticles[i].m_fTranslucency;
+				CLAMP( fColor, 0.0f, 1.0f );
+				vertices[0].m_ucColor[j]= ( unsigned char )( fColor*255 );
+			}
+			for( j=1; j<4; j++ )
+				memcpy( vertices[j].m_ucColor, vertices[0].m_ucColor, 4 );
+
+			//top right
+			vecTemp= ( ( vecMtrxRight+vecMtrxUp )*vecSize )+vecPosition;
+			vertices[0].m_fPosition[0]= vecTemp[0];	vertices[0].m_fPosition[1]= vecTemp[1];	vertices[0].m_fPosition[2]= vecTemp[2];
+
+			//top left
+			vecTemp= ( ( vecMtrxUp-vecMtrxRight )*vecSize )+vecPosition;
+			vertices[1].m_fPosition[0]= vecTemp[0];	vertices[1].m_fPosition[1]= vecTemp[1];	vertices[1].m_fPosition[2]= vecTemp[2];
+
+			//bottom right
+			vecTemp= ( ( vecMtrxRight-vecMtrxUp )*vecSize )+vecPosition;
+			vertices[2].m_fPosition[0]= vecTemp[0];	vertices[2].m_fPosition[1]= vecTemp[1];	vertices[2].m_fPosition[2]= vecTemp[2];
+
+			//bottom left
+			vecTemp= ( ( vecMtrxRight+vecMtrxUp )*-vecSize )+vecPosition;
+			vertices[3].m_fPosition[0]= vecTemp[0];	vertices[3].m_fPosition[1]= vecTemp[1];	vertices[3].m_fPosition[2]= vecTemp[2];
+
+			//the two triangles of the quad (wound the same way the old
+			//per-particle triangle strip was)
+			m_pBackend->Vertex( vertices[0] );
+			m_pBackend->Vertex( vertices[1] );
+			m_pBackend->Vertex( vertices[2] );
+			m_pBackend->Vertex( vertices[2] );
+			m_pBackend->Vertex( vertices[1] );
+			m_pBackend->Vertex( vertices[3] );
 
 			m_iNumParticlesOnScreen++;
 		}
 	}
 
-	glEnable( GL_DEPTH_TEST );
+	m_pBackend->End( );
+}
+
+//--------------------------------------------------------------
+// Name:		 CPARTICLE_ENGINE::DrawPacket - private
+// Description:	 Draw the particles' render queue packet
+// Arguments:	 -pData: the particle engine
+//				 -iParam: not used
+// Return Value: None
+//--------------------------------------------------------------
+void CPARTICLE_ENGINE::DrawPacket( void* pData, int iParam )
+{
+	( ( CPARTICLE_ENGINE* )pData )->Draw( );
 }
 
 //--------------------------------------------------------------
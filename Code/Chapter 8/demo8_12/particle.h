@@ -16,6 +16,8 @@
 //--------------------------------------------------------------
 #include "../Base Code/math_ops.h"
 #include "../Base Code/image.h"
+#include "../Base Code/render_backend.h"
+#include "../Base Code/render_queue.h"
 
 
 //--------------------------------------------------------------
@@ -79,8 +81,13 @@ class CPARTICLE_ENGINE
 
 		unsigned int m_uiTexID;
 
+		CRENDER_BACKEND* m_pBackend;
+
 	void CreateParticle( float fVelX, float fVelY, float fVelZ );
 
+	void Draw( void );
+	static void DrawPacket( void* pData, int iParam );
+
 	//--------------------------------------------------------------
 	// Name:			CPARTICLE_ENGINE::RangedRandom - private
 	// Description:		Get a random value between the two arguments
@@ -97,6 +104,7 @@ class CPARTICLE_ENGINE
 
 	void Update( float fTimeStep= 1.0f );
 	void Render( void );
+	void Submit( CRENDER_QUEUE* pQueue );
 
 	void Explode( float fMagnitude, int iNumParticles );
 	void CreateRaindrops( float fMinX, float fMinY, float fMinZ,
@@ -158,7 +166,11 @@ class CPARTICLE_ENGINE
 	int GetNumParticlesOnScreen( void )
 	{	return m_iNumParticlesOnScreen;	}
 
-	CPARTICLE_ENGINE( void )
+	//set what the particles are drawn with (NULL for OpenGL)
+	void SetRenderBackend( CRENDER_BACKEND* pBackend )
+	{	m_pBackend= pBackend ? pBackend : &g_glBackend;	}
+
+	CPARTICLE_ENGINE( void ) : m_pBackend( &g_glBackend )
 	{	}
 	~CPARTICLE_ENGINE( void )
 	{	}
@@ -18,6 +18,7 @@
 #include "../Base Code/math_ops.h"
 #include "../Base Code/gl_app.h"
 #include "../Base Code/image.h"
+#include "../Base Code/render_stats.h"
 
 #include "skydome.h"
 
@@ -184,21 +185,56 @@ void CSKYDOME::Shutdown( void )
 //--------------------------------------------------------------
 void CSKYDOME::Render( float fDelta, bool bRotate )
 {
-	static float fRot= 0.0f;
-
 	//bind the dome texture
 	glBindTexture( GL_TEXTURE_2D, m_uiTexID );
 	glEnable( GL_TEXTURE_2D );
+	STATS_BINDS( 1 );
+	STATS_TOGGLES( 1 );
+
+	Rotate( fDelta, bRotate );
+	Draw( );
+}
+
+//--------------------------------------------------------------
+// Name:		 CSKYDOME::Submit - public
+// Description:	 Add the skydome to a render queue: it is drawn before
+//				 everything else, without depth testing or depth writes
+// Arguments:	 -pQueue: the render queue
+//				 -fDelta: time passed since the previous frame (for rotation purposes)
+//				 -bRotate: rotate the skydome or not to simulate cloud movement
+// Return Value: None
+//--------------------------------------------------------------
+void CSKYDOME::Submit( CRENDER_QUEUE* pQueue, float fDelta, bool bRotate )
+{
+	SRENDER_PACKET* pPacket;
+
+	Rotate( fDelta, bRotate );
+
+	pPacket= pQueue->AddPacket( RENDER_PASS_BACKGROUND, STATS_SKY );
+	pPacket->m_state.m_bDepthTest	= false;
+	pPacket->m_state.m_bDepthWrite	= false;
+	pPacket->m_state.m_uiTextures[0]= m_uiTexID;
 
+	pPacket->m_pfnDraw= DrawPacket;
+	pPacket->m_pData  = this;
+}
+
+//--------------------------------------------------------------
+// Name:		 CSKYDOME::Draw - private
+// Description:	 Draw the dome's triangle strip (the texture has already
+//				 been bound)
+// Arguments:	 None
+// Return Value: None
+//--------------------------------------------------------------
+void CSKYDOME::Draw( void )
+{
 	glPushMatrix( );
 		glTranslatef( m_vecCenter[0], m_vecCenter[1], m_vecCenter[2] );
 
 		//rotate the dome to simulate cloud movement
-		if( bRotate )
-		{
-			fRot+= fDelta;
-			glRotatef( fRot, 0.0f, 1.0f, 0.0f );
-		}
+		if( m_bRotate )
+			glRotatef( m_fRotation, 0.0f, 1.0f, 0.0f );
+
 		//orient the dome correctly
 		glRotatef( 270, 1.0f, 0.0f, 0.0f );
 
@@ -217,6 +253,7 @@ void CSKYDOME::Render( float fDelta, bool bRotate )
 
 		//render the skydome
 		glDrawArrays( GL_TRIANGLE_STRIP, 0, m_iNumVertices );
+		STATS_BATCH( m_iNumVertices-2, m_iNumVertices );
 
 		//unlock the arrays
 		glUnlockArraysEXT( );
@@ -227,6 +264,18 @@ void CSKYDOME::Render( float fDelta, bool bRotate )
 	glPopMatrix( );
 }
 
+//--------------------------------------------------------------
+// Name:		 CSKYDOME::DrawPacket - private
+// Description:	 Draw the skydome's render queue packet
+// Arguments:	 -pData: the skydome
+//				 -iParam: not used
+// Return Value: None
+//--------------------------------------------------------------
+void CSKYDOME::DrawPacket( void* pData, int iParam )
+{
+	( ( CSKYDOME* )pData )->Draw( );
+}
+
 //--------------------------------------------------------------
 // Name:		 CSKYDOME::GenCloudTexture - public
 // Description:	 Fractally generate a cloud texture
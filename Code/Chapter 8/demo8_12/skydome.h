@@ -17,6 +17,7 @@
 //--------------------------------------------------------------
 #include "../Base Code/math_ops.h"
 #include "../Base Code/image.h"
+#include "../Base Code/render_queue.h"
 
 
 //--------------------------------------------------------------
@@ -36,6 +37,10 @@ class CSKYDOME
 
 		unsigned int m_uiTexID;
 
+		//the dome's rotation (to simulate cloud movement)
+		float m_fRotation;
+		bool m_bRotate;
+
 	float CosineInterpolation( float fNum1, float fNum2, float x );
 	float RangedRandom( int x, int y );
 	float RangedSmoothRandom( int x, int y );
@@ -46,12 +51,30 @@ class CSKYDOME
 	void BlurBand( float* fpBand, int iStride, int iCount, float fFilter );
 	void Blur( float* fpData, int iSize, float fFilter  );
 
+	void Draw( void );
+	static void DrawPacket( void* pData, int iParam );
+
+	//--------------------------------------------------------------
+	// Name:		 CSKYDOME::Rotate - private
+	// Description:	 Turn the dome a little more
+	// Arguments:	 -fDelta: time passed since the previous frame
+	//				 -bRotate: rotate the skydome or not
+	// Return Value: None
+	//--------------------------------------------------------------
+	inline void Rotate( float fDelta, bool bRotate )
+	{
+		if( bRotate )
+			m_fRotation+= fDelta;
+		m_bRotate= bRotate;
+	}
+
 	public:
 
 	void Init( float fTheta, float fPhi, float fRadius );
 	void Shutdown( void );
 
 	void Render( float fDelta, bool bRotate );
+	void Submit( CRENDER_QUEUE* pQueue, float fDelta, bool bRotate );
 
 	void GenCloudTexture( int size, float fBlur, float fOctaves, float fAmplitude, float fFrequency, float fH, float fOffset );
 
@@ -97,7 +120,7 @@ class CSKYDOME
 	int GetNumTriangles( void )
 	{	return m_iNumVertices-2;	}
 
-	CSKYDOME( void )
+	CSKYDOME( void ) : m_fRotation( 0.0f ), m_bRotate( false )
 	{	}
 	~CSKYDOME( void )
 	{	}
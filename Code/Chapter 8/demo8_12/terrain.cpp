@@ -16,19 +16,1028 @@
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "../Base Code/gl_app.h"
+#include "../Base Code/simd.h"
+#include "../Base Code/thread_pool.h"
 
 #include "terrain.h"
 
 
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//- STRUCTURES -------------------------------------------------
+//--------------------------------------------------------------
+//--------------------------------------------------------------
+//what comes before the pixels/blocks of a baked texture map
+struct STRN_TEXTURE_BAKE
+{
+	unsigned int m_uiSize;
+	unsigned int m_uiCompression;		//EIMAGE_COMPRESSION
+	unsigned int m_uiNumLevels;
+};
+
+//a set of parallel lines swept across the height map (for the shadowed
+//lighting and the horizon maps).  the lines step one texel at a time
+//along the "major" axis (whichever axis the sweep's direction is
+//closest to), and slide along the "minor" axis by a fraction of a
+//texel each step.
+struct STRN_SWEEP
+{
+	unsigned char* m_ucpHeights;
+	int   m_iSize;
+	int   m_iFirstLine;			//minor coordinate that the first line starts at
+	int   m_iNumLines;
+	int   m_iLinesPerJob;
+	int   m_iMajorStart;		//the edge of the map that the lines start on
+	int   m_iMajorStep;			//+1 or -1
+	float m_fMinorStep;			//minor distance covered by each major step
+	float m_fStepLength;		//world distance covered by each step
+	float m_fHeightScale;
+	bool  m_bMajorX;			//the lines step along the x axis
+};
+
+//shadowed lighting: the lines head away from the sun
+struct STRN_SHADOW_JOB
+{
+	STRN_SWEEP m_sweep;
+	unsigned char* m_ucpLightmap;
+	float m_fTanElevation;
+	float m_fCos2Elevation;
+	float m_fPenumbraScale;		//1/( 2*the sun's angular radius ), 0 for hard shadows
+	float m_fNormalScaleX;		//height scale/( 2*horizontal scale )
+	float m_fNormalScaleZ;
+	float m_fLight[3];			//direction to the sun
+	float m_fMinBrightness;
+	float m_fBrightnessRange;
+	bool  m_bShadows;			//false if the sun is straight overhead
+};
+
+//one direction's horizon map: the lines head away from the direction
+//that the horizon is being looked for in
+struct STRN_HORIZON_JOB
+{
+	STRN_SWEEP m_sweep;
+	unsigned char* m_ucpHorizons;
+};
+
+//relighting from the horizon maps, a band of rows at a time
+struct STRN_RELIGHT_JOB
+{
+	unsigned char* m_ucpHeights;
+	unsigned char* m_ucpHorizons0;	//the two directions on either side of the sun
+	unsigned char* m_ucpHorizons1;
+	unsigned char* m_ucpSkyVisibility;
+	unsigned char* m_ucpLightmap;
+	int   m_iSize;
+	float m_fWeight;			//how far the sun is from direction 0 to direction 1
+	float m_fElevation;			//in horizon map units
+	float m_fPenumbraScale;		//in horizon map units, 0 for hard shadows
+	float m_fNormalScaleX;
+	float m_fNormalScaleZ;
+	float m_fLight[3];
+	float m_fAmbient;			//min brightness (scaled by the sky visibility)
+	float m_fDiffuse;			//brightness range*255
+};
+
+//normal map generation, a band of rows at a time (inside of a dirty
+//rectangle)
+struct STRN_NORMAL_JOB
+{
+	unsigned char*	m_ucpHeights;
+	unsigned short* m_uspNormals;
+	int   m_iSize;
+	int   m_iMinX, m_iMinZ;
+	int   m_iMaxX, m_iMaxZ;
+	float m_fScaleX;			//height scale/( 8*horizontal scale )
+	float m_fScaleZ;
+};
+
+//what comes before the horizon maps in the bake cache
+struct STRN_HORIZON_BAKE
+{
+	unsigned int m_uiSize;
+	unsigned int m_uiNumAzimuths;
+};
+
+//the min/max heights of ever bigger blocks of the height map (level 0 is
+//the height map itself, and each level after that halves the size)
+struct STRN_MINMAX_PYRAMID
+{
+	unsigned char* m_ucpMin[TRN_MAX_PYRAMID_LEVELS];
+	unsigned char* m_ucpMax[TRN_MAX_PYRAMID_LEVELS];
+	unsigned char* m_ucpData;
+	int m_iSize[TRN_MAX_PYRAMID_LEVELS];
+	int m_iNumLevels;
+};
+
+//ambient occlusion, a tile at a time, for a batch of directions (each
+//direction is a list of texel offsets that get further and further away)
+struct STRN_OCCLUSION_JOB
+{
+	STRN_MINMAX_PYRAMID* m_pPyramid;
+	unsigned char*	m_ucpHeights;
+	unsigned short* m_uspSums;
+	int   m_iSize;
+	int   m_iTilesPerSide;
+	int   m_iRadius;
+	int   m_iNumDirections;
+	int   m_iNumSteps[TRN_AO_DIRECTIONS_PER_PASS];
+	int   m_iStepX[TRN_AO_DIRECTIONS_PER_PASS][TRN_AO_MAX_STEPS];
+	int   m_iStepZ[TRN_AO_DIRECTIONS_PER_PASS][TRN_AO_MAX_STEPS];
+	int   m_iStepOffset[TRN_AO_DIRECTIONS_PER_PASS][TRN_AO_MAX_STEPS];	//z*size+x
+	float m_fStepScale[TRN_AO_DIRECTIONS_PER_PASS][TRN_AO_MAX_STEPS];	//height scale/distance
+	float m_fStepBound[TRN_AO_DIRECTIONS_PER_PASS][TRN_AO_MAX_STEPS];	//biggest scale from here on
+};
+
+//what comes before the ambient occlusion totals in the bake cache
+struct STRN_OCCLUSION_BAKE
+{
+	unsigned int m_uiSize;
+	unsigned int m_uiNumDirections;
+};
+
+
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 //- DEFINITIONS ------------------------------------------------
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 
+//--------------------------------------------------------------
+// Name:			GetTapIndex - global (this file only)
+// Description:		Apply a border mode to a height map coordinate
+// Arguments:		-i: the coordinate (may be outside of the map)
+//					-iSize: the size of the height map
+//					-border: clamp or wrap
+// Return Value:	An integer value: the coordinate inside of the map
+//--------------------------------------------------------------
+static inline int GetTapIndex( int i, int iSize, ETRN_BORDERS border )
+{
+	//the last row and column are copies of the first ones, so a wrapped
+	//map repeats every iSize-1 points
+	if( border==TRN_WRAP )
+	{
+		i%= iSize-1;
+		return ( i<0 ) ? i+iSize-1 : i;
+	}
+
+	if( i<0 )
+		return 0;
+	if( i>=iSize )
+		return iSize-1;
+
+	return i;
+}
+
+//--------------------------------------------------------------
+// Name:			SetupSweep - global (this file only)
+// Description:		Figure out how a set of parallel lines needs to be
+//					laid out to cover the whole height map (the height
+//					map and its size need to be filled in already)
+// Arguments:		-pSweep: the sweep to set up
+//					-fDirX, fDirZ: the direction that the lines head in,
+//								   in texels
+//					-fScaleX, fScaleZ: the terrain's horizontal scale
+// Return Value:	None
+//--------------------------------------------------------------
+static void SetupSweep( STRN_SWEEP* pSweep, float fDirX, float fDirZ, float fScaleX, float fScaleZ )
+{
+	int iSize= pSweep->m_iSize;
+	int iMinorSpan;
+
+	//step along whichever axis the direction is closest to
+	pSweep->m_bMajorX= ( fabs( fDirX )>=fabs( fDirZ ) );
+	if( pSweep->m_bMajorX )
+	{
+		pSweep->m_iMajorStep = ( fDirX>=0.0f ) ? 1 : -1;
+		pSweep->m_fMinorStep = ( fabs( fDirX )>SMALL ) ? fDirZ/( float )fabs( fDirX ) : 0.0f;
+		pSweep->m_fStepLength= ( float )sqrt( SQR( fScaleX )+SQR( pSweep->m_fMinorStep*fScaleZ ) );
+	}
+	else
+	{
+		pSweep->m_iMajorStep = ( fDirZ>=0.0f ) ? 1 : -1;
+		pSweep->m_fMinorStep = fDirX/( float )fabs( fDirZ );
+		pSweep->m_fStepLength= ( float )sqrt( SQR( fScaleZ )+SQR( pSweep->m_fMinorStep*fScaleX ) );
+	}
+	pSweep->m_iMajorStart= ( pSweep->m_iMajorStep>0 ) ? 0 : iSize-1;
+
+	//there needs to be enough lines to cover the map at both ends of the
+	//sweep (plus one on either side for the rounding)
+	iMinorSpan= ( int )ceil( fabs( pSweep->m_fMinorStep )*( iSize-1 ) );
+	pSweep->m_iFirstLine= ( pSweep->m_fMinorStep>0.0f ) ? -iMinorSpan-1 : -1;
+	pSweep->m_iNumLines = iSize+iMinorSpan+2;
+
+	//small bands of lines, so that the threads that finish early can help out
+	pSweep->m_iLinesPerJob= TRN_SWEEP_LINES_PER_JOB;
+}
+
+//--------------------------------------------------------------
+// Name:			GetSweepPoint - global (this file only)
+// Description:		Find where a line is after a number of steps
+// Arguments:		-pSweep: the sweep that the line is a part of
+//					-iLine, iStep: the line, and how far along it to go
+//					-ipX, ipZ: storage for the texel that the point is
+//							   closest to.  the lines are exactly one
+//							   texel apart, so every texel belongs to
+//							   exactly one line.
+//					-fpHeight: storage for the (scaled) height on the line
+//							   itself, between two rows of texels (the
+//							   texel's own height would be up to half a
+//							   texel off to the side of the line, which
+//							   makes slopes facing the sweep shadow
+//							   themselves)
+// Return Value:	A boolean value: -true: the point is on the map
+//									 -false: the line hasn't entered the
+//											 map yet, or it has left it
+//--------------------------------------------------------------
+static inline bool GetSweepPoint( STRN_SWEEP* pSweep, int iLine, int iStep, int* ipX, int* ipZ, float* fpHeight )
+{
+	unsigned char* ucpHeights= pSweep->m_ucpHeights;
+	float fMinor, fFraction;
+	int iSize= pSweep->m_iSize;
+	int iMajor, iMinor, iMinor0, iMinor1;
+	int iMajorStride, iMinorStride;
+
+	fMinor= ( float )( pSweep->m_iFirstLine+iLine )+pSweep->m_fMinorStep*iStep;
+	if( fMinor<-0.5f || fMinor>=iSize-0.5f )
+		return false;
+
+	//(fMinor is at least -0.5, so the casts can truncate instead of
+	//calling floor)
+	iMajor = pSweep->m_iMajorStart+iStep*pSweep->m_iMajorStep;
+	iMinor = ( int )( fMinor+0.5f );
+	iMinor0= ( int )( fMinor+1.0f )-1;
+	fFraction= fMinor-iMinor0;
+	iMinor1= MIN( iMinor0+1, iSize-1 );
+	iMinor0= MAX( iMinor0, 0 );
+
+	if( pSweep->m_bMajorX )
+	{
+		*ipX= iMajor;
+		*ipZ= iMinor;
+		iMajorStride= 1;
+		iMinorStride= iSize;
+	}
+	else
+	{
+		*ipX= iMinor;
+		*ipZ= iMajor;
+		iMajorStride= iSize;
+		iMinorStride= 1;
+	}
+
+	*fpHeight= ( ucpHeights[iMajor*iMajorStride+iMinor0*iMinorStride]*( 1.0f-fFraction ) +
+				 ucpHeights[iMajor*iMajorStride+iMinor1*iMinorStride]*fFraction )*pSweep->m_fHeightScale;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			ShadowLines - global (this file only)
+// Description:		Sweep a band of lines across the height map, keeping
+//					track of the highest horizon seen so far on each line,
+//					and shade every texel that the lines cover (a thread
+//					pool job)
+// Arguments:		-iJob: the band of lines to sweep
+//					-pData: the STRN_SHADOW_JOB structure
+// Return Value:	None
+//--------------------------------------------------------------
+static void ShadowLines( int iJob, void* pData )
+{
+	STRN_SHADOW_JOB* pJob= ( STRN_SHADOW_JOB* )pData;
+	STRN_SWEEP* pSweep= &pJob->m_sweep;
+	unsigned char* ucpHeights= pSweep->m_ucpHeights;
+	float fHorizon, fHorizonDist;
+	float fLineHeight, fDist;
+	float fNormal[3], fLength;
+	float fDiffuse, fVisibility, fExcess;
+	int iSize= pSweep->m_iSize;
+	int iLine, iLastLine;
+	int iStep;
+	int x, z;
+
+	iLine	 = iJob*pSweep->m_iLinesPerJob;
+	iLastLine= MIN( iLine+pSweep->m_iLinesPerJob, pSweep->m_iNumLines );
+
+	for( ; iLine<iLastLine; iLine++ )
+	{
+		//nothing blocks the sun at the start of a line
+		fHorizon	= -BIG;
+		fHorizonDist= 0.0f;
+
+		for( iStep=0; iStep<iSize; iStep++ )
+		{
+			if( !GetSweepPoint( pSweep, iLine, iStep, &x, &z, &fLineHeight ) )
+				continue;
+
+			fDist= iStep*pSweep->m_fStepLength;
+
+			fVisibility= 1.0f;
+			if( pJob->m_bShadows && fHorizon>-BIG )
+			{
+				//how far the horizon pokes up above the ray to the sun's
+				//center, as an angle (approximately)
+				fExcess= ( fHorizon-( fLineHeight+fDist*pJob->m_fTanElevation ) )/( fDist-fHorizonDist );
+				fExcess*= pJob->m_fCos2Elevation;
+
+				//a sun with a size gets partially covered near the edge of
+				//a shadow, which gives us a soft penumbra
+				if( pJob->m_fPenumbraScale>0.0f )
+				{
+					fVisibility= 0.5f-fExcess*pJob->m_fPenumbraScale;
+					CLAMP( fVisibility, 0.0f, 1.0f );
+				}
+				else if( fExcess>0.0f )
+					fVisibility= 0.0f;
+			}
+
+			//a plain diffuse term on top of the shadows
+			fDiffuse= 0.0f;
+			if( fVisibility>0.0f )
+			{
+				fNormal[0]= ( ucpHeights[z*iSize+MAX( x-1, 0 )]-ucpHeights[z*iSize+MIN( x+1, iSize-1 )] )*pJob->m_fNormalScaleX;
+				fNormal[1]= 1.0f;
+				fNormal[2]= ( ucpHeights[MAX( z-1, 0 )*iSize+x]-ucpHeights[MIN( z+1, iSize-1 )*iSize+x] )*pJob->m_fNormalScaleZ;
+				fLength	  = ( float )sqrt( fNormal[0]*fNormal[0]+fNormal[1]*fNormal[1]+fNormal[2]*fNormal[2] );
+
+				fDiffuse= ( fNormal[0]*pJob->m_fLight[0]+fNormal[1]*pJob->m_fLight[1]+fNormal[2]*pJob->m_fLight[2] )/fLength;
+				if( fDiffuse<0.0f )
+					fDiffuse= 0.0f;
+			}
+
+			pJob->m_ucpLightmap[z*iSize+x]= ( unsigned char )( ( pJob->m_fMinBrightness+
+																 pJob->m_fBrightnessRange*fDiffuse*fVisibility )*255 );
+
+			//the running horizon: the point on the line that sticks up the
+			//furthest above a ray heading towards the sun (the ray climbs
+			//as it heads back towards the start of the line)
+			fLineHeight+= fDist*pJob->m_fTanElevation;
+			if( fLineHeight>fHorizon )
+			{
+				fHorizon	= fLineHeight;
+				fHorizonDist= fDist;
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			HorizonLines - global (this file only)
+// Description:		Sweep a band of lines across the height map, and find
+//					the horizon angle for every texel that they cover (a
+//					thread pool job).  Each line keeps the upper convex
+//					hull of the points it has been through: the horizon
+//					is the hull point that a texel's tangent touches, and
+//					any points that the tangent skips over can never be
+//					the horizon for a texel further along, so they are
+//					thrown away.  That keeps the whole line O(N).
+// Arguments:		-iJob: the band of lines to sweep
+//					-pData: the STRN_HORIZON_JOB structure
+// Return Value:	None
+//--------------------------------------------------------------
+static void HorizonLines( int iJob, void* pData )
+{
+	STRN_HORIZON_JOB* pJob= ( STRN_HORIZON_JOB* )pData;
+	STRN_SWEEP* pSweep= &pJob->m_sweep;
+	float* fpHullDist;
+	float* fpHullHeight;
+	float fHeight, fDist;
+	float fSlope, fAngle;
+	int iSize= pSweep->m_iSize;
+	int iLine, iLastLine;
+	int iStep, iHull;
+	int x, z;
+
+	//a line can't cover more than iSize texels
+	fpHullDist  = new float [iSize];
+	fpHullHeight= new float [iSize];
+
+	iLine	 = iJob*pSweep->m_iLinesPerJob;
+	iLastLine= MIN( iLine+pSweep->m_iLinesPerJob, pSweep->m_iNumLines );
+
+	for( ; iLine<iLastLine; iLine++ )
+	{
+		iHull= 0;
+
+		for( iStep=0; iStep<iSize; iStep++ )
+		{
+			if( !GetSweepPoint( pSweep, iLine, iStep, &x, &z, &fHeight ) )
+				continue;
+
+			fDist= iStep*pSweep->m_fStepLength;
+
+			//pop hull points until the top of the hull is the one that the
+			//tangent from this point touches (the slopes are compared
+			//without dividing, the distances are always positive)
+			while( iHull>=2 &&
+				   ( fpHullHeight[iHull-2]-fHeight )*( fDist-fpHullDist[iHull-1] )>=
+				   ( fpHullHeight[iHull-1]-fHeight )*( fDist-fpHullDist[iHull-2] ) )
+				iHull--;
+
+			//horizons below flat are just stored as flat
+			fAngle= 0.0f;
+			if( iHull>0 )
+			{
+				fSlope= ( fpHullHeight[iHull-1]-fHeight )/( fDist-fpHullDist[iHull-1] );
+				if( fSlope>0.0f )
+					fAngle= ( float )atan( fSlope );
+			}
+			pJob->m_ucpHorizons[z*iSize+x]= ( unsigned char )( fAngle*TRN_HORIZON_UNITS+0.5f );
+
+			fpHullDist[iHull]  = fDist;
+			fpHullHeight[iHull]= fHeight;
+			iHull++;
+		}
+	}
+
+	delete[] fpHullDist;
+	delete[] fpHullHeight;
+}
+
+//--------------------------------------------------------------
+// Name:			RelightTexel - global (this file only)
+// Description:		Shade one texel from the horizon maps (the SSE2 path
+//					in RelightRows does the exact same math, four texels
+//					at a time)
+// Arguments:		-pJob: the STRN_RELIGHT_JOB structure
+//					-ucpRow, ucpUp, ucpDown: the texel's row of heights,
+//											 and the rows on either side
+//					-iOffset: the index of the row's first texel
+//					-x: the texel's column
+// Return Value:	An unsigned char value: the texel's brightness
+//--------------------------------------------------------------
+static inline unsigned char RelightTexel( STRN_RELIGHT_JOB* pJob, unsigned char* ucpRow,
+										  unsigned char* ucpUp, unsigned char* ucpDown, int iOffset, int x )
+{
+	float fHorizon0, fHorizon1, fHorizon;
+	float fVisibility;
+	float fNormalX, fNormalZ, fLength;
+	float fDiffuse, fShade;
+	int iSize= pJob->m_iSize;
+
+	//the horizon in the sun's direction
+	fHorizon0= ( float )pJob->m_ucpHorizons0[iOffset+x];
+	fHorizon1= ( float )pJob->m_ucpHorizons1[iOffset+x];
+	fHorizon = fHorizon0+( fHorizon1-fHorizon0 )*pJob->m_fWeight;
+
+	if( pJob->m_fPenumbraScale>0.0f )
+	{
+		fVisibility= 0.5f+( pJob->m_fElevation-fHorizon )*pJob->m_fPenumbraScale;
+		CLAMP( fVisibility, 0.0f, 1.0f );
+	}
+	else
+		fVisibility= ( pJob->m_fElevation>=fHorizon ) ? 1.0f : 0.0f;
+
+	fNormalX= ( ( float )ucpRow[MAX( x-1, 0 )]-( float )ucpRow[MIN( x+1, iSize-1 )] )*pJob->m_fNormalScaleX;
+	fNormalZ= ( ( float )ucpUp[x]-( float )ucpDown[x] )*pJob->m_fNormalScaleZ;
+	fLength = ( float )sqrt( ( fNormalX*fNormalX+1.0f )+fNormalZ*fNormalZ );
+
+	fDiffuse= ( ( fNormalX*pJob->m_fLight[0]+pJob->m_fLight[1] )+fNormalZ*pJob->m_fLight[2] )/fLength;
+	if( fDiffuse<0.0f )
+		fDiffuse= 0.0f;
+
+	fShade= pJob->m_fAmbient*( float )pJob->m_ucpSkyVisibility[iOffset+x]+pJob->m_fDiffuse*( fDiffuse*fVisibility );
+	if( fShade>255.0f )
+		fShade= 255.0f;
+
+	return ( unsigned char )fShade;
+}
+
+#ifdef USE_SSE2
+//--------------------------------------------------------------
+// Name:			LoadBytes4 - global (this file only)
+// Description:		Load four unsigned bytes into an SSE register as floats
+// Arguments:		-ucpData: the bytes (no alignment needed)
+// Return Value:	An __m128 value: the four floats
+//--------------------------------------------------------------
+static inline __m128 LoadBytes4( const unsigned char* ucpData )
+{
+	__m128i zero= _mm_setzero_si128( );
+	__m128i bytes;
+	int iBytes;
+
+	memcpy( &iBytes, ucpData, 4 );
+	bytes= _mm_cvtsi32_si128( iBytes );
+	bytes= _mm_unpacklo_epi8( bytes, zero );
+	bytes= _mm_unpacklo_epi16( bytes, zero );
+
+	return _mm_cvtepi32_ps( bytes );
+}
+#endif
+
+//--------------------------------------------------------------
+// Name:			RelightRows - global (this file only)
+// Description:		Shade a band of rows from the horizon maps (a thread
+//					pool job)
+// Arguments:		-iJob: the band of rows to shade
+//					-pData: the STRN_RELIGHT_JOB structure
+// Return Value:	None
+//--------------------------------------------------------------
+static void RelightRows( int iJob, void* pData )
+{
+	STRN_RELIGHT_JOB* pJob= ( STRN_RELIGHT_JOB* )pData;
+	unsigned char* ucpRow;
+	unsigned char* ucpUp;
+	unsigned char* ucpDown;
+	int iSize= pJob->m_iSize;
+	int iOffset;
+	int x, z, iLastRow;
+#ifdef USE_SSE2
+	__m128 horizon0, horizon1, horizon;
+	__m128 visibility;
+	__m128 normalX, normalZ, length;
+	__m128 diffuse, shade;
+	__m128 weight	= _mm_set1_ps( pJob->m_fWeight );
+	__m128 elevation= _mm_set1_ps( pJob->m_fElevation );
+	__m128 penumbra = _mm_set1_ps( pJob->m_fPenumbraScale );
+	__m128 scaleX	= _mm_set1_ps( pJob->m_fNormalScaleX );
+	__m128 scaleZ	= _mm_set1_ps( pJob->m_fNormalScaleZ );
+	__m128 lightX	= _mm_set1_ps( pJob->m_fLight[0] );
+	__m128 lightY	= _mm_set1_ps( pJob->m_fLight[1] );
+	__m128 lightZ	= _mm_set1_ps( pJob->m_fLight[2] );
+	__m128 ambient	= _mm_set1_ps( pJob->m_fAmbient );
+	__m128 diffuseScale= _mm_set1_ps( pJob->m_fDiffuse );
+	__m128 zero= _mm_setzero_ps( );
+	__m128 half= _mm_set1_ps( 0.5f );
+	__m128 one = _mm_set1_ps( 1.0f );
+	__m128 maxShade= _mm_set1_ps( 255.0f );
+	__m128i packed;
+	int iPacked;
+#endif
+
+	z		= iJob*TRN_ROWS_PER_JOB;
+	iLastRow= MIN( z+TRN_ROWS_PER_JOB, iSize );
+
+	for( ; z<iLastRow; z++ )
+	{
+		iOffset= z*iSize;
+		ucpRow = pJob->m_ucpHeights+iOffset;
+		ucpUp  = pJob->m_ucpHeights+MAX( z-1, 0 )*iSize;
+		ucpDown= pJob->m_ucpHeights+MIN( z+1, iSize-1 )*iSize;
+
+		x= 0;
+#ifdef USE_SSE2
+		//the edges need clamping, so they are left to the plain C version
+		pJob->m_ucpLightmap[iOffset]= RelightTexel( pJob, ucpRow, ucpUp, ucpDown, iOffset, 0 );
+
+		for( x=1; x+4<iSize; x+=4 )
+		{
+			horizon0= LoadBytes4( pJob->m_ucpHorizons0+iOffset+x );
+			horizon1= LoadBytes4( pJob->m_ucpHorizons1+iOffset+x );
+			horizon = _mm_add_ps( horizon0, _mm_mul_ps( _mm_sub_ps( horizon1, horizon0 ), weight ) );
+
+			if( pJob->m_fPenumbraScale>0.0f )
+			{
+				visibility= _mm_add_ps( half, _mm_mul_ps( _mm_sub_ps( elevation, horizon ), penumbra ) );
+				visibility= _mm_min_ps( _mm_max_ps( visibility, zero ), one );
+			}
+			else
+				visibility= _mm_and_ps( _mm_cmpge_ps( elevation, horizon ), one );
+
+			normalX= _mm_mul_ps( _mm_sub_ps( LoadBytes4( ucpRow+x-1 ), LoadBytes4( ucpRow+x+1 ) ), scaleX );
+			normalZ= _mm_mul_ps( _mm_sub_ps( LoadBytes4( ucpUp+x ), LoadBytes4( ucpDown+x ) ), scaleZ );
+			length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( normalX, normalX ), one ),
+											  _mm_mul_ps( normalZ, normalZ ) ) );
+
+			diffuse= _mm_add_ps( _mm_add_ps( _mm_mul_ps( normalX, lightX ), lightY ), _mm_mul_ps( normalZ, lightZ ) );
+			diffuse= _mm_max_ps( _mm_div_ps( diffuse, length ), zero );
+
+			shade= _mm_add_ps( _mm_mul_ps( ambient, LoadBytes4( pJob->m_ucpSkyVisibility+iOffset+x ) ),
+							   _mm_mul_ps( diffuseScale, _mm_mul_ps( diffuse, visibility ) ) );
+			shade= _mm_min_ps( shade, maxShade );
+
+			//truncate, like the cast in the C version
+			packed = _mm_cvttps_epi32( shade );
+			packed = _mm_packs_epi32( packed, packed );
+			packed = _mm_packus_epi16( packed, packed );
+			iPacked= _mm_cvtsi128_si32( packed );
+			memcpy( pJob->m_ucpLightmap+iOffset+x, &iPacked, 4 );
+		}
+#endif
+
+		for( ; x<iSize; x++ )
+			pJob->m_ucpLightmap[iOffset+x]= RelightTexel( pJob, ucpRow, ucpUp, ucpDown, iOffset, x );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			NormalTexel - global (this file only)
+// Description:		Find and pack the normal for one texel (the SSE2 path
+//					in NormalRows does the exact same math, four texels
+//					at a time)
+// Arguments:		-pJob: the STRN_NORMAL_JOB structure
+//					-ucpRow, ucpUp, ucpDown: the texel's row of heights,
+//											 and the rows on either side
+//					-x: the texel's column
+// Return Value:	An unsigned short value: the packed normal
+//--------------------------------------------------------------
+static inline unsigned short NormalTexel( STRN_NORMAL_JOB* pJob, unsigned char* ucpRow,
+										  unsigned char* ucpUp, unsigned char* ucpDown, int x )
+{
+	float fNormal[3];
+	int iLeft, iRight, iUp, iDown;
+	int x0, x1;
+
+	x0= MAX( x-1, 0 );
+	x1= MIN( x+1, pJob->m_iSize-1 );
+
+	//3x3 Sobel filter
+	iLeft = ucpUp[x0]+2*ucpRow[x0]+ucpDown[x0];
+	iRight= ucpUp[x1]+2*ucpRow[x1]+ucpDown[x1];
+	iUp	  = ucpUp[x0]+2*ucpUp[x]+ucpUp[x1];
+	iDown = ucpDown[x0]+2*ucpDown[x]+ucpDown[x1];
+
+	fNormal[0]= ( float )( iLeft-iRight )*pJob->m_fScaleX;
+	fNormal[1]= 1.0f;
+	fNormal[2]= ( float )( iUp-iDown )*pJob->m_fScaleZ;
+
+	return CTERRAIN::PackNormal( fNormal );
+}
+
+//--------------------------------------------------------------
+// Name:			NormalRows - global (this file only)
+// Description:		Find the normals for a band of rows (a thread pool job)
+// Arguments:		-iJob: the band of rows
+//					-pData: the STRN_NORMAL_JOB structure
+// Return Value:	None
+//--------------------------------------------------------------
+static void NormalRows( int iJob, void* pData )
+{
+	STRN_NORMAL_JOB* pJob= ( STRN_NORMAL_JOB* )pData;
+	unsigned short* uspNormals;
+	unsigned char* ucpRow;
+	unsigned char* ucpUp;
+	unsigned char* ucpDown;
+	int iSize= pJob->m_iSize;
+	int x, z, iLastRow;
+#ifdef USE_SSE2
+	__m128 up0, up1, up2;
+	__m128 row0, row2;
+	__m128 down0, down1, down2;
+	__m128 normalX, normalZ, sum;
+	__m128 scaleX  = _mm_set1_ps( pJob->m_fScaleX );
+	__m128 scaleZ  = _mm_set1_ps( pJob->m_fScaleZ );
+	__m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) );
+	__m128 one	   = _mm_set1_ps( 1.0f );
+	__m128 quantize= _mm_set1_ps( 127.0f );
+	__m128 bias	   = _mm_set1_ps( 127.5f );
+	__m128i u, v, bytes;
+	int iLastX;
+#endif
+
+	z		= pJob->m_iMinZ+iJob*TRN_ROWS_PER_JOB;
+	iLastRow= MIN( z+TRN_ROWS_PER_JOB, pJob->m_iMaxZ+1 );
+
+	for( ; z<iLastRow; z++ )
+	{
+		ucpRow = pJob->m_ucpHeights+z*iSize;
+		ucpUp  = pJob->m_ucpHeights+MAX( z-1, 0 )*iSize;
+		ucpDown= pJob->m_ucpHeights+MIN( z+1, iSize-1 )*iSize;
+		uspNormals= pJob->m_uspNormals+z*iSize;
+
+		x= pJob->m_iMinX;
+#ifdef USE_SSE2
+		//the edges need clamping, so they are left to the plain C version
+		if( x==0 )
+		{
+			uspNormals[0]= NormalTexel( pJob, ucpRow, ucpUp, ucpDown, 0 );
+			x++;
+		}
+
+		iLastX= MIN( pJob->m_iMaxX+1, iSize-1 );
+		for( ; x+4<=iLastX; x+=4 )
+		{
+			up0	 = LoadBytes4( ucpUp+x-1 );
+			up1	 = LoadBytes4( ucpUp+x );
+			up2	 = LoadBytes4( ucpUp+x+1 );
+			row0 = LoadBytes4( ucpRow+x-1 );
+			row2 = LoadBytes4( ucpRow+x+1 );
+			down0= LoadBytes4( ucpDown+x-1 );
+			down1= LoadBytes4( ucpDown+x );
+			down2= LoadBytes4( ucpDown+x+1 );
+
+			//3x3 Sobel filter (the sums are small whole numbers, so the
+			//order of the additions doesn't matter)
+			normalX= _mm_sub_ps( _mm_add_ps( _mm_add_ps( up0, down0 ), _mm_add_ps( row0, row0 ) ),
+								 _mm_add_ps( _mm_add_ps( up2, down2 ), _mm_add_ps( row2, row2 ) ) );
+			normalZ= _mm_sub_ps( _mm_add_ps( _mm_add_ps( up0, up2 ), _mm_add_ps( up1, up1 ) ),
+								 _mm_add_ps( _mm_add_ps( down0, down2 ), _mm_add_ps( down1, down1 ) ) );
+			normalX= _mm_mul_ps( normalX, scaleX );
+			normalZ= _mm_mul_ps( normalZ, scaleZ );
+
+			//project onto the octahedron (the y component is always 1, so
+			//the normals never need to be folded)
+			sum= _mm_add_ps( _mm_add_ps( _mm_and_ps( normalX, absMask ), one ), _mm_and_ps( normalZ, absMask ) );
+			u  = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_div_ps( normalX, sum ), quantize ), bias ) );
+			v  = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_div_ps( normalZ, sum ), quantize ), bias ) );
+
+			//u0 u1 u2 u3 v0 v1 v2 v3 -> u0 v0 u1 v1 u2 v2 u3 v3
+			bytes= _mm_packus_epi16( _mm_packs_epi32( u, v ), _mm_setzero_si128( ) );
+			bytes= _mm_unpacklo_epi8( bytes, _mm_srli_si128( bytes, 4 ) );
+			_mm_storel_epi64( ( __m128i* )( uspNormals+x ), bytes );
+		}
+#endif
+
+		for( ; x<=pJob->m_iMaxX; x++ )
+			uspNormals[x]= NormalTexel( pJob, ucpRow, ucpUp, ucpDown, x );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			BuildMinMaxPyramid - global (this file only)
+// Description:		Build a min/max pyramid for a height map (free it with
+//					FreeMinMaxPyramid)
+// Arguments:		-pPyramid: the pyramid to build
+//					-ucpHeights: the height map
+//					-iSize: the size of the height map
+// Return Value:	A boolean value: -true: the pyramid was built
+//									 -false: out of memory
+//--------------------------------------------------------------
+static bool BuildMinMaxPyramid( STRN_MINMAX_PYRAMID* pPyramid, unsigned char* ucpHeights, int iSize )
+{
+	unsigned char* ucpMin;
+	unsigned char* ucpMax;
+	unsigned char ucMin, ucMax;
+	int iTotalSize, iLastSize;
+	int x, z, x0, x1, z0, z1;
+	int i;
+
+	//level 0 is just the height map
+	pPyramid->m_ucpMin[0]= ucpHeights;
+	pPyramid->m_ucpMax[0]= ucpHeights;
+	pPyramid->m_iSize[0] = iSize;
+	pPyramid->m_iNumLevels= 1;
+
+	//figure out how big the rest of the levels are
+	iTotalSize= 0;
+	while( pPyramid->m_iSize[pPyramid->m_iNumLevels-1]>1 && pPyramid->m_iNumLevels<TRN_MAX_PYRAMID_LEVELS )
+	{
+		i= pPyramid->m_iNumLevels++;
+		pPyramid->m_iSize[i]= ( pPyramid->m_iSize[i-1]+1 )/2;
+		iTotalSize+= pPyramid->m_iSize[i]*pPyramid->m_iSize[i];
+	}
+
+	pPyramid->m_ucpData= new unsigned char [iTotalSize*2];
+	if( pPyramid->m_ucpData==NULL )
+		return false;
+
+	ucpMin= pPyramid->m_ucpData;
+	for( i=1; i<pPyramid->m_iNumLevels; i++ )
+	{
+		ucpMax= ucpMin+pPyramid->m_iSize[i]*pPyramid->m_iSize[i];
+		pPyramid->m_ucpMin[i]= ucpMin;
+		pPyramid->m_ucpMax[i]= ucpMax;
+
+		//each cell covers (up to) four cells of the level below it
+		iLastSize= pPyramid->m_iSize[i-1];
+		for( z=0; z<pPyramid->m_iSize[i]; z++ )
+		{
+			z0= ( z*2 )*iLastSize;
+			z1= MIN( z*2+1, iLastSize-1 )*iLastSize;
+
+			for( x=0; x<pPyramid->m_iSize[i]; x++ )
+			{
+				x0= x*2;
+				x1= MIN( x*2+1, iLastSize-1 );
+
+				ucMin= MIN( MIN( pPyramid->m_ucpMin[i-1][z0+x0], pPyramid->m_ucpMin[i-1][z0+x1] ),
+							MIN( pPyramid->m_ucpMin[i-1][z1+x0], pPyramid->m_ucpMin[i-1][z1+x1] ) );
+				ucMax= MAX( MAX( pPyramid->m_ucpMax[i-1][z0+x0], pPyramid->m_ucpMax[i-1][z0+x1] ),
+							MAX( pPyramid->m_ucpMax[i-1][z1+x0], pPyramid->m_ucpMax[i-1][z1+x1] ) );
+
+				ucpMin[( z*pPyramid->m_iSize[i] )+x]= ucMin;
+				ucpMax[( z*pPyramid->m_iSize[i] )+x]= ucMax;
+			}
+		}
+
+		ucpMin= ucpMax+pPyramid->m_iSize[i]*pPyramid->m_iSize[i];
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			FreeMinMaxPyramid - global (this file only)
+// Description:		Free a pyramid made by BuildMinMaxPyramid
+// Arguments:		-pPyramid: the pyramid to free
+// Return Value:	None
+//--------------------------------------------------------------
+static void FreeMinMaxPyramid( STRN_MINMAX_PYRAMID* pPyramid )
+{
+	delete[] pPyramid->m_ucpData;
+	pPyramid->m_ucpData= NULL;
+}
+
+//--------------------------------------------------------------
+// Name:			GetRegionMinMax - global (this file only)
+// Description:		Find (conservative) min/max heights for a rectangle of
+//					the height map, by looking at a handful of cells from
+//					the first pyramid level that is coarse enough
+// Arguments:		-pPyramid: the min/max pyramid
+//					-iMinX, iMinZ, iMaxX, iMaxZ: the rectangle (it is
+//												 clamped to the map)
+//					-ucpMin, ucpMax: storage for the min/max heights
+// Return Value:	None
+//--------------------------------------------------------------
+static void GetRegionMinMax( STRN_MINMAX_PYRAMID* pPyramid, int iMinX, int iMinZ, int iMaxX, int iMaxZ,
+							 unsigned char* ucpMin, unsigned char* ucpMax )
+{
+	int iLevel, iSize;
+	int x, z;
+
+	iMinX= MAX( iMinX, 0 );
+	iMinZ= MAX( iMinZ, 0 );
+	iMaxX= MIN( iMaxX, pPyramid->m_iSize[0]-1 );
+	iMaxZ= MIN( iMaxZ, pPyramid->m_iSize[0]-1 );
+
+	//go up the pyramid until the rectangle only covers a few cells
+	iLevel= 0;
+	while( ( ( iMaxX>>iLevel )-( iMinX>>iLevel )>3 || ( iMaxZ>>iLevel )-( iMinZ>>iLevel )>3 ) &&
+		   iLevel<pPyramid->m_iNumLevels-1 )
+		iLevel++;
+
+	iSize  = pPyramid->m_iSize[iLevel];
+	*ucpMin= 255;
+	*ucpMax= 0;
+	for( z=( iMinZ>>iLevel ); z<=( iMaxZ>>iLevel ); z++ )
+	{
+		for( x=( iMinX>>iLevel ); x<=( iMaxX>>iLevel ); x++ )
+		{
+			*ucpMin= MIN( *ucpMin, pPyramid->m_ucpMin[iLevel][( z*iSize )+x] );
+			*ucpMax= MAX( *ucpMax, pPyramid->m_ucpMax[iLevel][( z*iSize )+x] );
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			OcclusionTexel - global (this file only)
+// Description:		Trace a batch of directions from one texel (the SSE2
+//					path in OcclusionTile does the exact same math, four
+//					texels at a time)
+// Arguments:		-pJob: the STRN_OCCLUSION_JOB structure
+//					-x, z: the texel
+//					-ucRegionMax: the highest point within the radius
+//					-bInterior: every step is inside of the map
+// Return Value:	An integer value: the total visibility (0-255 for each
+//					direction)
+//--------------------------------------------------------------
+static inline int OcclusionTexel( STRN_OCCLUSION_JOB* pJob, int x, int z, unsigned char ucRegionMax, bool bInterior )
+{
+	unsigned char* ucpHeights= pJob->m_ucpHeights;
+	float fHeadroom, fMaxTangent, fTangent;
+	int iOffset, iHeight;
+	int iVisibility;
+	int iStepX, iStepZ;
+	int d, s;
+
+	iOffset= ( z*pJob->m_iSize )+x;
+	iHeight= ucpHeights[iOffset];
+
+	fHeadroom  = ( float )ucRegionMax-( float )iHeight;
+	iVisibility= 0;
+	for( d=0; d<pJob->m_iNumDirections; d++ )
+	{
+		fMaxTangent= 0.0f;
+
+		for( s=0; s<pJob->m_iNumSteps[d]; s++ )
+		{
+			//nothing further out can be any higher than this
+			if( fHeadroom*pJob->m_fStepBound[d][s]<=fMaxTangent )
+				break;
+
+			//off of the edge of the map is open sky
+			if( !bInterior )
+			{
+				iStepX= x+pJob->m_iStepX[d][s];
+				iStepZ= z+pJob->m_iStepZ[d][s];
+				if( iStepX<0 || iStepZ<0 || iStepX>=pJob->m_iSize || iStepZ>=pJob->m_iSize )
+					break;
+			}
+
+			fTangent= ( ( float )ucpHeights[iOffset+pJob->m_iStepOffset[d][s]]-( float )iHeight )*pJob->m_fStepScale[d][s];
+			if( fTangent>fMaxTangent )
+				fMaxTangent= fTangent;
+		}
+
+		//cos^2 of the horizon angle (each direction is rounded on its own,
+		//so that the totals don't depend on how the directions were split
+		//up into passes)
+		iVisibility+= ( int )( 255.0f/( 1.0f+fMaxTangent*fMaxTangent )+0.5f );
+	}
+
+	return iVisibility;
+}
+
+//--------------------------------------------------------------
+// Name:			OcclusionTile - global (this file only)
+// Description:		Trace a batch of directions for every texel in a tile,
+//					and add each direction's visibility (the cosine-
+//					weighted amount of sky above the horizon, 0-255) to
+//					the texels' running totals (a thread pool job).  The
+//					min/max pyramid lets whole tiles, and the far ends of
+//					the directions, be skipped when nothing around them
+//					is high enough to block the sky.
+// Arguments:		-iJob: the tile
+//					-pData: the STRN_OCCLUSION_JOB structure
+// Return Value:	None
+//--------------------------------------------------------------
+static void OcclusionTile( int iJob, void* pData )
+{
+	STRN_OCCLUSION_JOB* pJob= ( STRN_OCCLUSION_JOB* )pData;
+	unsigned char ucTileMin, ucTileMax;
+	unsigned char ucRegionMin, ucRegionMax;
+	int iSize= pJob->m_iSize;
+	int iMinX, iMinZ, iMaxX, iMaxZ;
+	int iUnoccluded;
+	int x, z;
+	bool bInterior;
+#ifdef USE_SSE2
+	SIMD_ALIGN( int iVisibility[4] );
+	unsigned char* ucpHeights= pJob->m_ucpHeights;
+	__m128 height, headroom;
+	__m128 maxTangent, tangent;
+	__m128 regionMax;
+	__m128 one	  = _mm_set1_ps( 1.0f );
+	__m128 full	  = _mm_set1_ps( 255.0f );
+	__m128 half	  = _mm_set1_ps( 0.5f );
+	__m128i visibility;
+	int iOffset;
+	int d, s;
+#endif
+
+	iMinX= ( iJob%pJob->m_iTilesPerSide )*TRN_AO_TILE_SIZE;
+	iMinZ= ( iJob/pJob->m_iTilesPerSide )*TRN_AO_TILE_SIZE;
+	iMaxX= MIN( iMinX+TRN_AO_TILE_SIZE, iSize )-1;
+	iMaxZ= MIN( iMinZ+TRN_AO_TILE_SIZE, iSize )-1;
+
+	//nothing outside of the radius can block the sky
+	GetRegionMinMax( pJob->m_pPyramid, iMinX, iMinZ, iMaxX, iMaxZ, &ucTileMin, &ucTileMax );
+	GetRegionMinMax( pJob->m_pPyramid, iMinX-pJob->m_iRadius, iMinZ-pJob->m_iRadius,
+					 iMaxX+pJob->m_iRadius, iMaxZ+pJob->m_iRadius, &ucRegionMin, &ucRegionMax );
+
+	iUnoccluded= 255*pJob->m_iNumDirections;
+	if( ucTileMin>=ucRegionMax )
+	{
+		for( z=iMinZ; z<=iMaxZ; z++ )
+		{
+			for( x=iMinX; x<=iMaxX; x++ )
+				pJob->m_uspSums[( z*iSize )+x]+= iUnoccluded;
+		}
+
+		return;
+	}
+
+	//away from the edges, every step can be taken without checking it
+	bInterior= ( iMinX-pJob->m_iRadius>=0 && iMinZ-pJob->m_iRadius>=0 &&
+				 iMaxX+pJob->m_iRadius<iSize && iMaxZ+pJob->m_iRadius<iSize );
+
+	for( z=iMinZ; z<=iMaxZ; z++ )
+	{
+		x= iMinX;
+
+#ifdef USE_SSE2
+		//four texels at a time (a direction is only finished early once
+		//all four of them are done with it)
+		regionMax= _mm_set1_ps( ( float )ucRegionMax );
+		for( ; bInterior && x+4<=iMaxX+1; x+=4 )
+		{
+			iOffset	  = ( z*iSize )+x;
+			height	  = LoadBytes4( ucpHeights+iOffset );
+			headroom  = _mm_sub_ps( regionMax, height );
+			visibility= _mm_setzero_si128( );
+
+			for( d=0; d<pJob->m_iNumDirections; d++ )
+			{
+				maxTangent= _mm_setzero_ps( );
+
+				for( s=0; s<pJob->m_iNumSteps[d]; s++ )
+				{
+					if( _mm_movemask_ps( _mm_cmple_ps( _mm_mul_ps( headroom, _mm_set1_ps( pJob->m_fStepBound[d][s] ) ), maxTangent ) )==0xF )
+						break;
+
+					tangent	  = _mm_mul_ps( _mm_sub_ps( LoadBytes4( ucpHeights+iOffset+pJob->m_iStepOffset[d][s] ), height ),
+											_mm_set1_ps( pJob->m_fStepScale[d][s] ) );
+					maxTangent= _mm_max_ps( maxTangent, tangent );
+				}
+
+				visibility= _mm_add_epi32( visibility, _mm_cvttps_epi32( _mm_add_ps( _mm_div_ps( full, _mm_add_ps( one, _mm_mul_ps( maxTangent, maxTangent ) ) ), half ) ) );
+			}
+
+			_mm_store_si128( ( __m128i* )iVisibility, visibility );
+			pJob->m_uspSums[iOffset  ]+= iVisibility[0];
+			pJob->m_uspSums[iOffset+1]+= iVisibility[1];
+			pJob->m_uspSums[iOffset+2]+= iVisibility[2];
+			pJob->m_uspSums[iOffset+3]+= iVisibility[3];
+		}
+#endif
+
+		for( ; x<=iMaxX; x++ )
+			pJob->m_uspSums[( z*iSize )+x]+= OcclusionTexel( pJob, x, z, ucRegionMax, bInterior );
+	}
+}
+
 //--------------------------------------------------------------
 // Name:			CTERRAIN::LoadHeightMap - public
 // Description:		Load a grayscale RAW height map
@@ -131,6 +1140,7 @@ void CTERRAIN::UnloadHeightMap( void )
 	{
 		//delete the data
 		delete[] m_heightData.m_ucpData;
+		m_heightData.m_ucpData= NULL;
 
 		//reset the map dimensions also
 		m_iSize= 0;
@@ -246,6 +1256,7 @@ void CTERRAIN::FilterHeightField( float* fpHeightData, float fFilter )
 //--------------------------------------------------------------
 bool CTERRAIN::MakeTerrainFault( int iSize, int iIterations, int iMinDelta, int iMaxDelta, float fFilter )
 {
+	BAKE_KEY key;
 	float* fTempBuffer;
 	int iCurrentIteration;
 	int iHeight;
@@ -256,6 +1267,23 @@ bool CTERRAIN::MakeTerrainFault( int iSize, int iIterations, int iMinDelta, int
 	int x, z;
 	int i;
 
+	//with a fixed seed, the same parameters always give the same terrain
+	if( m_bFixedSeed )
+	{
+		key= CBAKE_CACHE::HashBegin( "fault terrain" );
+		key= CBAKE_CACHE::HashInt( key, iSize );
+		key= CBAKE_CACHE::HashInt( key, iIterations );
+		key= CBAKE_CACHE::HashInt( key, iMinDelta );
+		key= CBAKE_CACHE::HashInt( key, iMaxDelta );
+		key= CBAKE_CACHE::HashFloat( key, fFilter );
+		key= CBAKE_CACHE::HashInt( key, m_uiSeed );
+
+		if( LoadCachedHeightMap( key, iSize ) )
+			return true;
+
+		srand( m_uiSeed );
+	}
+
 	if( m_heightData.m_ucpData )
 		UnloadHeightMap( );
 
@@ -343,6 +1371,9 @@ bool CTERRAIN::MakeTerrainFault( int iSize, int iIterations, int iMinDelta, int
 		delete[] fTempBuffer;
 	}
 
+	if( m_bFixedSeed )
+		g_bakeCache.Store( key, NULL, 0, m_heightData.m_ucpData, m_iSize*m_iSize );
+
 	return true;
 }
 
@@ -358,6 +1389,7 @@ bool CTERRAIN::MakeTerrainFault( int iSize, int iIterations, int iMinDelta, int
 //--------------------------------------------------------------
 bool CTERRAIN::MakeTerrainPlasma( int iSize, float fRoughness )
 {
+	BAKE_KEY key;
 	float* fTempBuffer;
 	float fHeight, fHeightReducer;
 	int iRectSize= iSize;
@@ -367,8 +1399,22 @@ bool CTERRAIN::MakeTerrainPlasma( int iSize, float fRoughness )
 	int i, j;
 	int x, z;
 
-	if( m_heightData.m_ucpData )
-		UnloadHeightMap( );
+	//with a fixed seed, the same parameters always give the same terrain
+	if( m_bFixedSeed )
+	{
+		key= CBAKE_CACHE::HashBegin( "plasma terrain" );
+		key= CBAKE_CACHE::HashInt( key, iSize );
+		key= CBAKE_CACHE::HashFloat( key, fRoughness );
+		key= CBAKE_CACHE::HashInt( key, m_uiSeed );
+
+		if( LoadCachedHeightMap( key, iSize ) )
+			return true;
+
+		srand( m_uiSeed );
+	}
+
+	if( m_heightData.m_ucpData )
+		UnloadHeightMap( );
 
 	if( fRoughness<0 )
 		fRoughness*= -1;
@@ -530,6 +1576,9 @@ bool CTERRAIN::MakeTerrainPlasma( int iSize, float fRoughness )
 		delete[] fTempBuffer;
 	}
 
+	if( m_bFixedSeed )
+		g_bakeCache.Store( key, NULL, 0, m_heightData.m_ucpData, m_iSize*m_iSize );
+
 	return true;
 }
 
@@ -649,52 +1698,6 @@ void CTERRAIN::GetTexCoords( CIMAGE texture, unsigned int* x, unsigned int* y )
 	*y= *y-( uiHeight*iRepeatY );
 }
 
-//--------------------------------------------------------------
-// Name:			CTERRAIN::InterpolateHeight - public
-// Description:		Interpolate the heights in the height map so that
-//					the generated texture map does not look incredibly blocky
-// Arguments:		-x, z: coordinates to get the height at
-//					-fHeightToTexRatio: Height map size to texture 
-//										map size ratio
-// Return Value:	An unsigned char value: the interpolated height
-//--------------------------------------------------------------
-unsigned char CTERRAIN::InterpolateHeight( int x, int z, float fHeightToTexRatio )
-{
-	unsigned char ucLow, ucHighX, ucHighZ;
-	float ucX, ucZ;
-	float fScaledX= x*fHeightToTexRatio;
-	float fScaledZ= z*fHeightToTexRatio;
-	float fInterpolation;
-
-	//set the middle boundary
-	ucLow= GetTrueHeightAtPoint( ( int )fScaledX, ( int )fScaledZ );
-
-	//start off by interpolating along the X axis
-	//set the high boundary
-	if( ( fScaledX+1 )>m_iSize )
-		return ucLow;
-	else
-		ucHighX= GetTrueHeightAtPoint( ( int )fScaledX+1, ( int )fScaledZ );
-
-	//calculate the interpolation (for the X axis)
-	fInterpolation= ( fScaledX-( int )fScaledX );
-	ucX= ( ( ucHighX-ucLow )*fInterpolation )+ucLow;
-
-	//interpolate along the Z axis now
-	//set the high boundary
-	if( ( fScaledZ+1 )>m_iSize )
-		return ucLow;
-	else
-		ucHighZ= GetTrueHeightAtPoint( ( int )fScaledX, ( int )fScaledZ+1 );
-
-	//calculate the interpolation (for the Z axis)
-	fInterpolation= ( fScaledZ-( int )fScaledZ );
-	ucZ= ( ( ucHighZ-ucLow )*fInterpolation )+ucLow;
-
-	//calculate the overall interpolation (average of the two values)
-	return ( ( unsigned char )( ( ucX+ucZ )/2 ) );
-}
-
 //--------------------------------------------------------------
 // Name:			CTERRAIN::GenerateTextureMap - public
 // Description:		Generate a texture map from the four tiles (that must
@@ -704,13 +1707,19 @@ unsigned char CTERRAIN::InterpolateHeight( int x, int z, float fHeightToTexRatio
 //--------------------------------------------------------------
 void CTERRAIN::GenerateTextureMap( unsigned int uiSize )
 {
+	STRN_TEXTURE_BAKE bake;
+	BAKE_KEY key;
 	unsigned char ucRed, ucGreen, ucBlue;
-	unsigned int iTempID;
 	unsigned int x, z;
 	unsigned int uiTexX, uiTexZ;
 	float fTotalRed, fTotalGreen, fTotalBlue;
 	float fBlend[4];
 	float fMapRatio;
+	float* fpRowX;
+	float* fpRowZ;
+	float* fpRowHeights;
+	float fHeight;
+	unsigned char ucHeight;
 	int iLastHeight;
 	int i;
 
@@ -740,6 +1749,35 @@ void CTERRAIN::GenerateTextureMap( unsigned int uiSize )
 		}
 	}
 
+	//the texture map depends on the heights, the tiles, and the regions
+	key= CBAKE_CACHE::HashBegin( "texture map" );
+	key= CBAKE_CACHE::Hash( key, &uiSize, sizeof( unsigned int ) );
+	key= CBAKE_CACHE::Hash( key, m_tiles.m_regions, sizeof( m_tiles.m_regions ) );
+	key= CBAKE_CACHE::HashInt( key, m_textureCompression );
+	key= CBAKE_CACHE::HashInt( key, m_compressionQuality );
+	key= CBAKE_CACHE::HashInt( key, TRN_BILINEAR );
+	key= CBAKE_CACHE::HashKey( key, GetHeightMapKey( ) );
+	for( i=0; i<TRN_NUM_TILES; i++ )
+	{
+		if( m_tiles.textureTiles[i].IsLoaded( ) )
+		{
+			key= CBAKE_CACHE::HashInt( key, i );
+			key= CBAKE_CACHE::HashInt( key, m_tiles.textureTiles[i].GetWidth( ) );
+			key= CBAKE_CACHE::HashInt( key, m_tiles.textureTiles[i].GetHeight( ) );
+			key= CBAKE_CACHE::HashInt( key, m_tiles.textureTiles[i].GetBPP( ) );
+			key= CBAKE_CACHE::Hash( key, m_tiles.textureTiles[i].GetData( ),
+									m_tiles.textureTiles[i].GetWidth( )*m_tiles.textureTiles[i].GetHeight( )*
+									( m_tiles.textureTiles[i].GetBPP( )/8 ) );
+		}
+	}
+
+	//we've made this texture map before
+	if( LoadCachedTextureMap( key, uiSize ) )
+	{
+		UploadTextureMap( );
+		return;
+	}
+
 	//create room for a new texture
 	m_texture.Create( uiSize, uiSize, 24 );
 
@@ -748,11 +1786,30 @@ void CTERRAIN::GenerateTextureMap( unsigned int uiSize )
 	//we need the ratio of height map pixels to texture map pixels)
 	fMapRatio= ( float )m_iSize/uiSize;
 
+	//the heights are interpolated a row of texels at a time (SampleHeights
+	//works in world space, so the texels are moved there first)
+	fpRowX		= new float [uiSize];
+	fpRowZ		= new float [uiSize];
+	fpRowHeights= new float [uiSize];
+
+	for( x=0; x<uiSize; x++ )
+		fpRowX[x]= x*fMapRatio*m_vecScale[0];
+
 	//time to create the texture data
 	for( z=0; z<uiSize; z++ )
 	{
+		for( x=0; x<uiSize; x++ )
+			fpRowZ[x]= z*fMapRatio*m_vecScale[2];
+
+		SampleHeights( fpRowX, fpRowZ, uiSize, fpRowHeights, NULL, TRN_BILINEAR, TRN_CLAMP );
+
 		for( x=0; x<uiSize; x++ )
 		{
+			//take the height map's scale back out of the height
+			fHeight= fpRowHeights[x]/m_vecScale[1];
+			CLAMP( fHeight, 0.0f, 255.0f );
+			ucHeight= ( unsigned char )fHeight;
+
 			//set our total color counters to 0.0f
 			fTotalRed  = 0.0f;
 			fTotalGreen= 0.0f;
@@ -775,7 +1832,7 @@ void CTERRAIN::GenerateTextureMap( unsigned int uiSize )
 					m_tiles.textureTiles[i].GetColor( uiTexX, uiTexZ, &ucRed, &ucGreen, &ucBlue );
 
 					//get the current coordinate's blending percentage for this tile
-					fBlend[i]= RegionPercent( i, Limit( InterpolateHeight( x, z, fMapRatio ) ) );
+					fBlend[i]= RegionPercent( i, ucHeight );
 
 					//calculate the RGB values that will be used
 					fTotalRed  += ucRed*fBlend[i];
@@ -791,6 +1848,51 @@ void CTERRAIN::GenerateTextureMap( unsigned int uiSize )
 		}
 	}
 
+	delete[] fpRowX;
+	delete[] fpRowZ;
+	delete[] fpRowHeights;
+
+	//compress the texture map
+	if( m_textureCompression!=IMAGE_UNCOMPRESSED )
+		m_texture.Compress( m_textureCompression, m_compressionQuality );
+
+	//save it for next time (only the blocks, if it was compressed)
+	bake.m_uiSize= uiSize;
+	if( m_texture.IsCompressed( ) )
+	{
+		bake.m_uiCompression= m_texture.GetCompression( );
+		bake.m_uiNumLevels	= 1;
+		g_bakeCache.Store( key, &bake, sizeof( STRN_TEXTURE_BAKE ),
+						   m_texture.GetCompressedData( ), m_texture.GetCompressedDataSize( ) );
+	}
+	else
+	{
+		bake.m_uiCompression= IMAGE_UNCOMPRESSED;
+		bake.m_uiNumLevels	= 1;
+		g_bakeCache.Store( key, &bake, sizeof( STRN_TEXTURE_BAKE ),
+						   m_texture.GetData( ), uiSize*uiSize*3 );
+	}
+
+	UploadTextureMap( );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::UploadTextureMap - private
+// Description:		Build the OpenGL texture for the texture map
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::UploadTextureMap( void )
+{
+	unsigned int iTempID;
+
+	//let the image send the compressed blocks itself
+	if( m_texture.IsCompressed( ) )
+	{
+		m_texture.Upload( GL_LINEAR, GL_LINEAR, false );
+		return;
+	}
+
 	//build the OpenGL texture
 	glGenTextures( 1, &iTempID );
 	glBindTexture( GL_TEXTURE_2D, iTempID );
@@ -798,12 +1900,116 @@ void CTERRAIN::GenerateTextureMap( unsigned int uiSize )
 	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );						
 
 	//make the texture
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, uiSize, uiSize, 0, GL_RGB, GL_UNSIGNED_BYTE, m_texture.GetData( ) );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, m_texture.GetWidth( ), m_texture.GetHeight( ), 0, GL_RGB, GL_UNSIGNED_BYTE, m_texture.GetData( ) );
 
 	//set the texture's ID
 	m_texture.SetID( iTempID );
 }
 
+//--------------------------------------------------------------
+// Name:			CTERRAIN::GetHeightMapKey - private
+// Description:		Get a bake cache key for the current height map
+// Arguments:		None
+// Return Value:	A BAKE_KEY value: the hash of the height data
+//--------------------------------------------------------------
+BAKE_KEY CTERRAIN::GetHeightMapKey( void )
+{
+	BAKE_KEY key;
+
+	key= CBAKE_CACHE::HashBegin( "height map" );
+	key= CBAKE_CACHE::HashInt( key, m_iSize );
+
+	if( m_heightData.m_ucpData )
+		key= CBAKE_CACHE::Hash( key, m_heightData.m_ucpData, m_iSize*m_iSize );
+
+	return key;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::LoadCachedHeightMap - private
+// Description:		Pull a generated height map out of the bake cache
+// Arguments:		-key: the height map's key
+//					-iSize: the size of the height map
+// Return Value:	A boolean value: -true: the height map was in the cache
+//									 -false: the height map needs to be made
+//--------------------------------------------------------------
+bool CTERRAIN::LoadCachedHeightMap( BAKE_KEY key, int iSize )
+{
+	SBAKE_ENTRY entry;
+
+	if( !g_bakeCache.Load( key, &entry ) )
+		return false;
+
+	if( entry.m_uiSize!=( unsigned int )( iSize*iSize ) )
+	{
+		g_bakeCache.Release( &entry );
+		return false;
+	}
+
+	if( m_heightData.m_ucpData )
+		UnloadHeightMap( );
+
+	m_iSize= iSize;
+	m_heightData.m_ucpData= new unsigned char [m_iSize*m_iSize];
+	memcpy( m_heightData.m_ucpData, entry.m_ucpData, m_iSize*m_iSize );
+
+	g_bakeCache.Release( &entry );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::LoadCachedTextureMap - private
+// Description:		Pull a generated texture map out of the bake cache
+// Arguments:		-key: the texture map's key
+//					-uiSize: the size of the texture map
+// Return Value:	A boolean value: -true: the texture map was in the cache
+//									 -false: the texture map needs to be made
+//--------------------------------------------------------------
+bool CTERRAIN::LoadCachedTextureMap( BAKE_KEY key, unsigned int uiSize )
+{
+	STRN_TEXTURE_BAKE* pBake;
+	SBAKE_ENTRY entry;
+	EIMAGE_COMPRESSION compression;
+	unsigned int uiDataSize;
+
+	if( !g_bakeCache.Load( key, &entry ) )
+		return false;
+
+	pBake= ( STRN_TEXTURE_BAKE* )entry.m_ucpData;
+	if( entry.m_uiSize<sizeof( STRN_TEXTURE_BAKE ) || pBake->m_uiSize!=uiSize )
+	{
+		g_bakeCache.Release( &entry );
+		return false;
+	}
+
+	compression= ( EIMAGE_COMPRESSION )pBake->m_uiCompression;
+	if( compression==IMAGE_UNCOMPRESSED )
+		uiDataSize= uiSize*uiSize*3;
+	else
+		uiDataSize= CIMAGE::GetCompressedSize( uiSize, uiSize, compression );
+
+	if( entry.m_uiSize!=sizeof( STRN_TEXTURE_BAKE )+uiDataSize )
+	{
+		g_bakeCache.Release( &entry );
+		return false;
+	}
+
+	//copy the pixels/blocks into the texture
+	if( compression==IMAGE_UNCOMPRESSED )
+	{
+		m_texture.Create( uiSize, uiSize, 24 );
+		memcpy( m_texture.GetData( ), entry.m_ucpData+sizeof( STRN_TEXTURE_BAKE ), uiDataSize );
+	}
+	else
+	{
+		m_texture.CreateCompressed( uiSize, uiSize, compression, pBake->m_uiNumLevels );
+		memcpy( m_texture.GetCompressedData( ), entry.m_ucpData+sizeof( STRN_TEXTURE_BAKE ), uiDataSize );
+	}
+
+	g_bakeCache.Release( &entry );
+	return true;
+}
+
 //--------------------------------------------------------------
 // Name:			CTERRAIN::LoadLightMap - public
 // Description:		Load a grayscale RAW light map
@@ -906,6 +2112,7 @@ void CTERRAIN::UnloadLightMap( void )
 	{
 		//delete the data
 		delete[] m_lightmap.m_ucpData;
+		m_lightmap.m_ucpData= NULL;
 
 		//reset the map dimensions also
 		m_iSize= 0;
@@ -924,6 +2131,8 @@ void CTERRAIN::UnloadLightMap( void )
 //--------------------------------------------------------------
 void CTERRAIN::CalculateLighting( void )
 {
+	SBAKE_ENTRY entry;
+	BAKE_KEY key;
 	float fShade;
 	int x, z;
 
@@ -942,6 +2151,63 @@ void CTERRAIN::CalculateLighting( void )
 		m_lightmap.m_iSize= m_iSize;
 	}
 
+	//the horizon maps have their own spot in the bake cache, and relighting
+	//from them is quicker than pulling a lightmap out of the cache
+	if( m_lightingType==HORIZON_MAPPED )
+	{
+		if( m_ucpHorizons==NULL || m_iHorizonSize!=m_iSize )
+			BuildHorizonMaps( );
+
+		Relight( m_fSunAzimuth, m_fSunElevation );
+		return;
+	}
+
+	//the lightmap depends on the heights and the lighting parameters
+	key= CBAKE_CACHE::HashBegin( "lightmap" );
+	key= CBAKE_CACHE::HashKey( key, GetHeightMapKey( ) );
+	key= CBAKE_CACHE::HashInt( key, m_lightingType );
+	if( m_lightingType==SLOPE_LIGHT )
+	{
+		key= CBAKE_CACHE::HashFloat( key, m_fMinBrightness );
+		key= CBAKE_CACHE::HashFloat( key, m_fMaxBrightness );
+		key= CBAKE_CACHE::HashFloat( key, m_fLightSoftness );
+		key= CBAKE_CACHE::HashInt( key, m_iDirectionX );
+		key= CBAKE_CACHE::HashInt( key, m_iDirectionZ );
+	}
+	else if( m_lightingType==SHADOWED_LIGHT )
+	{
+		key= CBAKE_CACHE::HashFloat( key, m_fMinBrightness );
+		key= CBAKE_CACHE::HashFloat( key, m_fMaxBrightness );
+		key= CBAKE_CACHE::HashFloat( key, m_fSunAzimuth );
+		key= CBAKE_CACHE::HashFloat( key, m_fSunElevation );
+		key= CBAKE_CACHE::HashFloat( key, m_fSunRadius );
+		key= CBAKE_CACHE::Hash( key, &m_vecScale, sizeof( CVECTOR ) );
+	}
+
+	if( g_bakeCache.Load( key, &entry ) )
+	{
+		if( entry.m_uiSize==( unsigned int )( m_iSize*m_iSize ) )
+		{
+			memcpy( m_lightmap.m_ucpData, entry.m_ucpData, m_iSize*m_iSize );
+			g_bakeCache.Release( &entry );
+
+			CombineAmbientOcclusion( );
+			return;
+		}
+
+		g_bakeCache.Release( &entry );
+	}
+
+	//shadowed lighting works on whole lines at a time, not single vertices
+	if( m_lightingType==SHADOWED_LIGHT )
+	{
+		CalculateShadowedLighting( );
+		g_bakeCache.Store( key, NULL, 0, m_lightmap.m_ucpData, m_iSize*m_iSize );
+
+		CombineAmbientOcclusion( );
+		return;
+	}
+
 	//loop through all vertices
 	for( z=0; z<m_iSize; z++ )
 	{
@@ -977,4 +2243,1128 @@ void CTERRAIN::CalculateLighting( void )
 			}
 		}
 	}
-}
\ No newline at end of file
+
+	g_bakeCache.Store( key, NULL, 0, m_lightmap.m_ucpData, m_iSize*m_iSize );
+
+	//the ambient occlusion is kept out of the cached lightmap, so that it
+	//can be refined (or turned off) without relighting
+	CombineAmbientOcclusion( );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::CalculateShadowedLighting - private
+// Description:		Fill the lightmap with cast shadows and diffuse
+//					lighting from the sun.  Lines are swept across the
+//					height map away from the sun, and each line keeps
+//					track of its horizon as it goes, so every texel is
+//					only visited once.  The lines are independent of each
+//					other, so they are split up across the thread pool.
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::CalculateShadowedLighting( void )
+{
+	STRN_SHADOW_JOB job;
+	float fAzimuth, fElevation;
+	float fDirX, fDirZ;
+	int iNumJobs;
+
+	fAzimuth  = DEG_TO_RAD( m_fSunAzimuth );
+	fElevation= DEG_TO_RAD( m_fSunElevation );
+
+	job.m_sweep.m_ucpHeights  = m_heightData.m_ucpData;
+	job.m_sweep.m_iSize		  = m_iSize;
+	job.m_sweep.m_fHeightScale= m_vecScale[1];
+	job.m_ucpLightmap= m_lightmap.m_ucpData;
+
+	//the direction to the sun
+	job.m_fLight[0]= ( float )( cos( fElevation )*cos( fAzimuth ) );
+	job.m_fLight[1]= ( float )sin( fElevation );
+	job.m_fLight[2]= ( float )( cos( fElevation )*sin( fAzimuth ) );
+
+	job.m_fNormalScaleX = m_vecScale[1]/( 2.0f*m_vecScale[0] );
+	job.m_fNormalScaleZ = m_vecScale[1]/( 2.0f*m_vecScale[2] );
+	job.m_fMinBrightness= m_fMinBrightness;
+	job.m_fBrightnessRange= m_fMaxBrightness-m_fMinBrightness;
+
+	//the sun's direction across the height map, in texels (the lines
+	//head away from the sun)
+	fDirX= -job.m_fLight[0]/m_vecScale[0];
+	fDirZ= -job.m_fLight[2]/m_vecScale[2];
+
+	job.m_bShadows	   = ( fabs( fDirX )>SMALL || fabs( fDirZ )>SMALL ) && fElevation<PI/2.0f;
+	job.m_fTanElevation= 0.0f;
+	job.m_fCos2Elevation= 0.0f;
+	job.m_fPenumbraScale= 0.0f;
+	if( job.m_bShadows )
+	{
+		job.m_fTanElevation = ( float )tan( fElevation );
+		job.m_fCos2Elevation= ( float )( cos( fElevation )*cos( fElevation ) );
+		if( m_fSunRadius>0.0f )
+			job.m_fPenumbraScale= 1.0f/( 2.0f*DEG_TO_RAD( m_fSunRadius ) );
+	}
+
+	SetupSweep( &job.m_sweep, fDirX, fDirZ, m_vecScale[0], m_vecScale[2] );
+
+	iNumJobs= ( job.m_sweep.m_iNumLines+job.m_sweep.m_iLinesPerJob-1 )/job.m_sweep.m_iLinesPerJob;
+	g_threadPool.Run( ShadowLines, &job, iNumJobs );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::BuildHorizonMaps - public
+// Description:		Find the horizon angle at every texel, for a number
+//					of directions spread evenly around the compass, and
+//					the amount of sky that every texel can see.  This is
+//					the slow part of HORIZON_MAPPED lighting (the results
+//					are kept in the bake cache); Relight can then light
+//					the terrain for any sun position very quickly.
+// Arguments:		-iNumAzimuths: the number of directions (at least 2)
+// Return Value:	A boolean value: -true: the maps were built
+//									 -false: the maps were not built
+//--------------------------------------------------------------
+bool CTERRAIN::BuildHorizonMaps( int iNumAzimuths )
+{
+	STRN_HORIZON_JOB job;
+	STRN_HORIZON_BAKE bake;
+	SBAKE_ENTRY entry;
+	BAKE_KEY key;
+	unsigned char* ucpHorizons;
+	float fCos2[256];
+	float fAzimuth, fAngle;
+	float fSky;
+	int iMapSize;
+	int iNumJobs;
+	int i, k;
+
+	if( m_heightData.m_ucpData==NULL || iNumAzimuths<2 )
+	{
+		g_log.Write( LOG_FAILURE, "Could not build the horizon maps" );
+		return false;
+	}
+
+	//get rid of the old maps
+	delete[] m_ucpHorizons;
+	m_ucpHorizons	  = NULL;
+	m_ucpSkyVisibility= NULL;
+
+	//one map per direction, and the sky visibility map at the end
+	iMapSize	 = m_iSize*m_iSize;
+	m_ucpHorizons= new unsigned char [iMapSize*( iNumAzimuths+1 )];
+	if( m_ucpHorizons==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not allocate memory for the horizon maps" );
+		return false;
+	}
+	m_ucpSkyVisibility= m_ucpHorizons+iMapSize*iNumAzimuths;
+	m_iNumAzimuths	  = iNumAzimuths;
+	m_iHorizonSize	  = m_iSize;
+
+	//the horizons depend on the heights, the scale, and the directions
+	key= CBAKE_CACHE::HashBegin( "horizons" );
+	key= CBAKE_CACHE::HashKey( key, GetHeightMapKey( ) );
+	key= CBAKE_CACHE::HashInt( key, iNumAzimuths );
+	key= CBAKE_CACHE::Hash( key, &m_vecScale, sizeof( CVECTOR ) );
+
+	if( g_bakeCache.Load( key, &entry ) )
+	{
+		memcpy( &bake, entry.m_ucpData, sizeof( STRN_HORIZON_BAKE ) );
+		if( entry.m_uiSize==sizeof( STRN_HORIZON_BAKE )+iMapSize*( iNumAzimuths+1 ) &&
+			bake.m_uiSize==( unsigned int )m_iSize && bake.m_uiNumAzimuths==( unsigned int )iNumAzimuths )
+		{
+			memcpy( m_ucpHorizons, entry.m_ucpData+sizeof( STRN_HORIZON_BAKE ), iMapSize*( iNumAzimuths+1 ) );
+			g_bakeCache.Release( &entry );
+
+			g_log.Write( LOG_SUCCESS, "Loaded %d horizon maps from the bake cache", iNumAzimuths );
+			return true;
+		}
+
+		g_bakeCache.Release( &entry );
+	}
+
+	job.m_sweep.m_ucpHeights  = m_heightData.m_ucpData;
+	job.m_sweep.m_iSize		  = m_iSize;
+	job.m_sweep.m_fHeightScale= m_vecScale[1];
+
+	for( k=0; k<iNumAzimuths; k++ )
+	{
+		//the lines head away from the direction that we are looking for
+		//the horizon in
+		fAzimuth= ( 2.0f*PI*k )/iNumAzimuths;
+		SetupSweep( &job.m_sweep, -( float )cos( fAzimuth )/m_vecScale[0], -( float )sin( fAzimuth )/m_vecScale[2],
+					m_vecScale[0], m_vecScale[2] );
+
+		job.m_ucpHorizons= m_ucpHorizons+iMapSize*k;
+
+		iNumJobs= ( job.m_sweep.m_iNumLines+job.m_sweep.m_iLinesPerJob-1 )/job.m_sweep.m_iLinesPerJob;
+		g_threadPool.Run( HorizonLines, &job, iNumJobs );
+	}
+
+	//the sky visibility is the cosine-weighted amount of sky above the
+	//horizon, averaged over all of the directions
+	for( i=0; i<256; i++ )
+	{
+		fAngle  = i/TRN_HORIZON_UNITS;
+		fCos2[i]= ( float )( cos( fAngle )*cos( fAngle ) );
+	}
+
+	for( i=0; i<iMapSize; i++ )
+	{
+		fSky= 0.0f;
+		for( k=0, ucpHorizons= m_ucpHorizons+i; k<iNumAzimuths; k++, ucpHorizons+= iMapSize )
+			fSky+= fCos2[*ucpHorizons];
+
+		m_ucpSkyVisibility[i]= ( unsigned char )( ( fSky*255.0f )/iNumAzimuths+0.5f );
+	}
+
+	bake.m_uiSize		 = m_iSize;
+	bake.m_uiNumAzimuths = iNumAzimuths;
+	g_bakeCache.Store( key, &bake, sizeof( STRN_HORIZON_BAKE ), m_ucpHorizons, iMapSize*( iNumAzimuths+1 ) );
+
+	g_log.Write( LOG_SUCCESS, "Built %d horizon maps", iNumAzimuths );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::UnloadHorizonMaps - public
+// Description:		Unload the horizon maps (and the sky visibility map)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::UnloadHorizonMaps( void )
+{
+	//check to see if the data has been set
+	if( m_ucpHorizons )
+	{
+		delete[] m_ucpHorizons;
+		m_ucpHorizons	  = NULL;
+		m_ucpSkyVisibility= NULL;
+
+		m_iNumAzimuths= 0;
+		m_iHorizonSize= 0;
+	}
+
+	g_log.Write( LOG_SUCCESS, "Successfully unloaded the horizon maps\n" );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::Relight - public
+// Description:		Light the terrain from the horizon maps (which need to
+//					be built first).  The horizon in the sun's direction
+//					is blended from the two closest maps, the shadows are
+//					softened by the sun's radius, and the ambient light is
+//					scaled by how much sky each texel can see.  This is
+//					quick enough to do every frame for a moving sun.
+// Arguments:		-fAzimuth: direction of the sun, in degrees
+//					-fElevation: height of the sun above the horizon,
+//								 in degrees
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::Relight( float fAzimuth, float fElevation )
+{
+	STRN_RELIGHT_JOB job;
+	float fIndex;
+	int iMapSize;
+	int iAzimuth0, iAzimuth1;
+
+	if( m_ucpHorizons==NULL || m_iHorizonSize!=m_iSize )
+		return;
+
+	//allocate memory if it is needed
+	if( m_lightmap.m_iSize!=m_iSize || m_lightmap.m_ucpData==NULL )
+	{
+		delete[] m_lightmap.m_ucpData;
+
+		m_lightmap.m_ucpData= new unsigned char [m_iSize*m_iSize];
+		m_lightmap.m_iSize= m_iSize;
+	}
+
+	m_fSunAzimuth  = fAzimuth;
+	m_fSunElevation= fElevation;
+
+	//find the two maps on either side of the sun
+	fIndex= ( fAzimuth/360.0f )*m_iNumAzimuths;
+	fIndex-= ( float )floor( fIndex/m_iNumAzimuths )*m_iNumAzimuths;
+	iAzimuth0= MIN( ( int )fIndex, m_iNumAzimuths-1 );
+	iAzimuth1= ( iAzimuth0+1 )%m_iNumAzimuths;
+
+	iMapSize= m_iSize*m_iSize;
+	job.m_ucpHeights	  = m_heightData.m_ucpData;
+	job.m_ucpHorizons0	  = m_ucpHorizons+iMapSize*iAzimuth0;
+	job.m_ucpHorizons1	  = m_ucpHorizons+iMapSize*iAzimuth1;
+	job.m_ucpSkyVisibility= m_ucpSkyVisibility;
+	job.m_ucpLightmap	  = m_lightmap.m_ucpData;
+	job.m_iSize			  = m_iSize;
+	job.m_fWeight		  = fIndex-iAzimuth0;
+
+	//work in the same units as the horizon maps
+	job.m_fElevation	= DEG_TO_RAD( fElevation )*TRN_HORIZON_UNITS;
+	job.m_fPenumbraScale= 0.0f;
+	if( m_fSunRadius>0.0f )
+		job.m_fPenumbraScale= 1.0f/( 2.0f*DEG_TO_RAD( m_fSunRadius )*TRN_HORIZON_UNITS );
+
+	job.m_fLight[0]= ( float )( cos( DEG_TO_RAD( fElevation ) )*cos( DEG_TO_RAD( fAzimuth ) ) );
+	job.m_fLight[1]= ( float )sin( DEG_TO_RAD( fElevation ) );
+	job.m_fLight[2]= ( float )( cos( DEG_TO_RAD( fElevation ) )*sin( DEG_TO_RAD( fAzimuth ) ) );
+
+	job.m_fNormalScaleX= m_vecScale[1]/( 2.0f*m_vecScale[0] );
+	job.m_fNormalScaleZ= m_vecScale[1]/( 2.0f*m_vecScale[2] );
+	job.m_fAmbient	   = m_fMinBrightness;
+	job.m_fDiffuse	   = ( m_fMaxBrightness-m_fMinBrightness )*255.0f;
+
+	g_threadPool.Run( RelightRows, &job, ( m_iSize+TRN_ROWS_PER_JOB-1 )/TRN_ROWS_PER_JOB );
+
+	CombineAmbientOcclusion( );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::BakeAmbientOcclusion - public
+// Description:		Bake the ambient occlusion for the whole height map
+//					in one go (the results are kept in the bake cache).
+//					The lightmap picks it up the next time it is
+//					calculated.
+// Arguments:		-iNumDirections: the number of directions to trace
+// Return Value:	A boolean value: -true: the occlusion was baked
+//									 -false: the occlusion was not baked
+//--------------------------------------------------------------
+bool CTERRAIN::BakeAmbientOcclusion( int iNumDirections )
+{
+	STRN_OCCLUSION_BAKE bake;
+	SBAKE_ENTRY entry;
+	BAKE_KEY key;
+	int iMapSize;
+
+	UnloadAmbientOcclusion( );
+
+	iNumDirections= MIN( iNumDirections, TRN_AO_MAX_DIRECTIONS );
+	iMapSize	  = m_iSize*m_iSize;
+
+	//the occlusion depends on the heights, the scale, and the directions
+	key= CBAKE_CACHE::HashBegin( "occlusion" );
+	key= CBAKE_CACHE::HashKey( key, GetHeightMapKey( ) );
+	key= CBAKE_CACHE::HashInt( key, iNumDirections );
+	key= CBAKE_CACHE::HashFloat( key, m_fOcclusionRadius );
+	key= CBAKE_CACHE::Hash( key, &m_vecScale, sizeof( CVECTOR ) );
+
+	if( m_heightData.m_ucpData && g_bakeCache.Load( key, &entry ) )
+	{
+		memcpy( &bake, entry.m_ucpData, sizeof( STRN_OCCLUSION_BAKE ) );
+		if( entry.m_uiSize==sizeof( STRN_OCCLUSION_BAKE )+iMapSize*sizeof( unsigned short ) &&
+			bake.m_uiSize==( unsigned int )m_iSize && bake.m_uiNumDirections==( unsigned int )iNumDirections )
+		{
+			m_uspOcclusionSums= new unsigned short [iMapSize];
+			m_ucpOcclusion	  = new unsigned char [iMapSize];
+			m_iOcclusionSize  = m_iSize;
+			memcpy( m_uspOcclusionSums, entry.m_ucpData+sizeof( STRN_OCCLUSION_BAKE ), iMapSize*sizeof( unsigned short ) );
+			g_bakeCache.Release( &entry );
+
+			//the averages are quick to redo
+			m_iNumOcclusionDirections= iNumDirections;
+			TraceAmbientOcclusion( iNumDirections, 0 );
+
+			g_log.Write( LOG_SUCCESS, "Loaded the ambient occlusion from the bake cache" );
+			return true;
+		}
+
+		g_bakeCache.Release( &entry );
+	}
+
+	if( !RefineAmbientOcclusion( iNumDirections ) )
+		return false;
+
+	bake.m_uiSize		  = m_iSize;
+	bake.m_uiNumDirections= iNumDirections;
+	g_bakeCache.Store( key, &bake, sizeof( STRN_OCCLUSION_BAKE ), m_uspOcclusionSums, iMapSize*sizeof( unsigned short ) );
+
+	g_log.Write( LOG_SUCCESS, "Baked the ambient occlusion (%d directions)", iNumDirections );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::RefineAmbientOcclusion - public
+// Description:		Trace some more directions for the ambient occlusion
+//					(starting from scratch if it hasn't been traced yet).
+//					The directions are spread out so that every extra one
+//					fills in the biggest gap, so a few directions can be
+//					added each frame until it looks good enough.  Call
+//					CalculateLighting (or Relight) to see the results.
+// Arguments:		-iNumDirections: the number of directions to add
+// Return Value:	A boolean value: -true: directions were added
+//									 -false: nothing was added (no height
+//											 map, or out of directions)
+//--------------------------------------------------------------
+bool CTERRAIN::RefineAmbientOcclusion( int iNumDirections )
+{
+	if( m_heightData.m_ucpData==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not trace the ambient occlusion, there is no height map" );
+		return false;
+	}
+
+	//start over if the height map has changed size
+	if( m_uspOcclusionSums==NULL || m_iOcclusionSize!=m_iSize )
+	{
+		UnloadAmbientOcclusion( );
+
+		m_uspOcclusionSums= new unsigned short [m_iSize*m_iSize];
+		m_ucpOcclusion	  = new unsigned char [m_iSize*m_iSize];
+		if( m_uspOcclusionSums==NULL || m_ucpOcclusion==NULL )
+		{
+			g_log.Write( LOG_FAILURE, "Could not allocate memory for the ambient occlusion" );
+			UnloadAmbientOcclusion( );
+			return false;
+		}
+
+		memset( m_uspOcclusionSums, 0, m_iSize*m_iSize*sizeof( unsigned short ) );
+		m_iOcclusionSize= m_iSize;
+	}
+
+	iNumDirections= MIN( iNumDirections, TRN_AO_MAX_DIRECTIONS-m_iNumOcclusionDirections );
+	if( iNumDirections<=0 )
+		return false;
+
+	TraceAmbientOcclusion( m_iNumOcclusionDirections, iNumDirections );
+	m_iNumOcclusionDirections+= iNumDirections;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::UnloadAmbientOcclusion - public
+// Description:		Unload the ambient occlusion
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::UnloadAmbientOcclusion( void )
+{
+	delete[] m_uspOcclusionSums;
+	delete[] m_ucpOcclusion;
+	m_uspOcclusionSums= NULL;
+	m_ucpOcclusion	  = NULL;
+
+	m_iOcclusionSize		 = 0;
+	m_iNumOcclusionDirections= 0;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::TraceAmbientOcclusion - private
+// Description:		Trace a range of directions for every texel, add
+//					them to the running totals, and then work out the
+//					averages again.  The map is split into tiles, which
+//					are shared out across the thread pool.
+// Arguments:		-iFirstDirection: the first direction to trace (the
+//									  directions before it have already
+//									  been traced)
+//					-iNumDirections: the number of directions to trace
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::TraceAmbientOcclusion( int iFirstDirection, int iNumDirections )
+{
+	STRN_MINMAX_PYRAMID pyramid;
+	STRN_OCCLUSION_JOB job;
+	float fAngle, fDistance;
+	float fDirX, fDirZ;
+	int iMapSize;
+	int iStepX, iStepZ;
+	int iNumSteps;
+	int d, s, i;
+
+	iMapSize= m_iSize*m_iSize;
+
+	if( iNumDirections>0 )
+	{
+		if( !BuildMinMaxPyramid( &pyramid, m_heightData.m_ucpData, m_iSize ) )
+		{
+			g_log.Write( LOG_FAILURE, "Could not allocate memory for the min/max pyramid" );
+			return;
+		}
+
+		job.m_pPyramid	   = &pyramid;
+		job.m_ucpHeights   = m_heightData.m_ucpData;
+		job.m_uspSums	   = m_uspOcclusionSums;
+		job.m_iSize		   = m_iSize;
+		job.m_iTilesPerSide= ( m_iSize+TRN_AO_TILE_SIZE-1 )/TRN_AO_TILE_SIZE;
+		job.m_iRadius	   = ( int )ceil( m_fOcclusionRadius );
+
+		while( iNumDirections>0 )
+		{
+			job.m_iNumDirections= MIN( iNumDirections, TRN_AO_DIRECTIONS_PER_PASS );
+
+			for( d=0; d<job.m_iNumDirections; d++ )
+			{
+				//golden ratio steps around the circle: any number of
+				//directions ends up evenly spread out
+				fAngle= 2.0f*PI*( float )fmod( ( iFirstDirection+d )*0.6180339887, 1.0 );
+				fDirX = ( float )cos( fAngle );
+				fDirZ = ( float )sin( fAngle );
+
+				//the steps start out a texel apart, and then spread out
+				iNumSteps= 0;
+				for( fDistance= 1.0f; fDistance<=m_fOcclusionRadius && iNumSteps<TRN_AO_MAX_STEPS;
+					 fDistance= MAX( fDistance+1.0f, fDistance*1.3f ) )
+				{
+					iStepX= ( int )floor( fDirX*fDistance+0.5f );
+					iStepZ= ( int )floor( fDirZ*fDistance+0.5f );
+
+					//skip texels that we have already looked at
+					if( iNumSteps>0 && iStepX==job.m_iStepX[d][iNumSteps-1] && iStepZ==job.m_iStepZ[d][iNumSteps-1] )
+						continue;
+
+					job.m_iStepX[d][iNumSteps]	   = iStepX;
+					job.m_iStepZ[d][iNumSteps]	   = iStepZ;
+					job.m_iStepOffset[d][iNumSteps]= ( iStepZ*m_iSize )+iStepX;
+					job.m_fStepScale[d][iNumSteps] = m_vecScale[1]/( float )sqrt( SQR( iStepX*m_vecScale[0] )+
+																				  SQR( iStepZ*m_vecScale[2] ) );
+					iNumSteps++;
+				}
+
+				job.m_iNumSteps[d]= iNumSteps;
+
+				//rounding to whole texels can bring a step a little closer
+				//than the one before it, so the early-out needs the biggest
+				//scale of all of the steps that are left
+				for( s=iNumSteps-1; s>=0; s-- )
+				{
+					job.m_fStepBound[d][s]= job.m_fStepScale[d][s];
+					if( s<iNumSteps-1 )
+						job.m_fStepBound[d][s]= MAX( job.m_fStepBound[d][s], job.m_fStepBound[d][s+1] );
+				}
+			}
+
+			g_threadPool.Run( OcclusionTile, &job, job.m_iTilesPerSide*job.m_iTilesPerSide );
+
+			iFirstDirection+= job.m_iNumDirections;
+			iNumDirections -= job.m_iNumDirections;
+		}
+
+		FreeMinMaxPyramid( &pyramid );
+	}
+
+	//every direction up to here has been traced now
+	if( iFirstDirection>0 )
+	{
+		for( i=0; i<iMapSize; i++ )
+			m_ucpOcclusion[i]= ( unsigned char )( ( m_uspOcclusionSums[i]+iFirstDirection/2 )/iFirstDirection );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::CombineAmbientOcclusion - private
+// Description:		Darken the lightmap by the ambient occlusion (if it
+//					has been traced)
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::CombineAmbientOcclusion( void )
+{
+	int iScale[256];
+	int iMapSize;
+	int i;
+
+	if( m_ucpOcclusion==NULL || m_iOcclusionSize!=m_iSize || m_iNumOcclusionDirections==0 ||
+		m_lightmap.m_ucpData==NULL || m_fOcclusionStrength<=0.0f )
+		return;
+
+	//8.8 fixed point brightness scales for every occlusion value
+	for( i=0; i<256; i++ )
+		iScale[i]= ( int )( ( 1.0f-m_fOcclusionStrength+m_fOcclusionStrength*( i/255.0f ) )*256.0f+0.5f );
+
+	iMapSize= m_iSize*m_iSize;
+	for( i=0; i<iMapSize; i++ )
+		m_lightmap.m_ucpData[i]= ( unsigned char )( ( m_lightmap.m_ucpData[i]*iScale[m_ucpOcclusion[i]] )>>8 );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::CalculateNormals - public
+// Description:		Calculate the normal map for the whole height map
+//					(it gets recalculated automatically if the terrain's
+//					scale changes)
+// Arguments:		None
+// Return Value:	A boolean value: -true: the normals were calculated
+//									 -false: the normals were not calculated
+//--------------------------------------------------------------
+bool CTERRAIN::CalculateNormals( void )
+{
+	if( m_heightData.m_ucpData==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not calculate the normals, there is no height map" );
+		return false;
+	}
+
+	delete[] m_uspNormals;
+	m_uspNormals= new unsigned short [m_iSize*m_iSize];
+	if( m_uspNormals==NULL )
+	{
+		g_log.Write( LOG_FAILURE, "Could not allocate memory for the normal map" );
+		return false;
+	}
+
+	m_vecNormalScale= m_vecScale;
+	UpdateNormals( 0, 0, m_iSize-1, m_iSize-1 );
+	m_iNormalRevision++;
+
+	g_log.Write( LOG_SUCCESS, "Calculated the normal map" );
+	return true;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::UpdateNormals - public
+// Description:		Recalculate the normals around a part of the height
+//					map that has changed (call this after editing the
+//					heights with SetHeightAtPoint).  The normals one texel
+//					outside of the rectangle are redone too, since they
+//					use the heights inside of it.
+// Arguments:		-iMinX, iMinZ: the first texel that changed
+//					-iMaxX, iMaxZ: the last texel that changed
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::UpdateNormals( int iMinX, int iMinZ, int iMaxX, int iMaxZ )
+{
+	STRN_NORMAL_JOB job;
+
+	if( m_uspNormals==NULL || m_heightData.m_ucpData==NULL )
+		return;
+
+	job.m_iMinX= MAX( iMinX-1, 0 );
+	job.m_iMinZ= MAX( iMinZ-1, 0 );
+	job.m_iMaxX= MIN( iMaxX+1, m_iSize-1 );
+	job.m_iMaxZ= MIN( iMaxZ+1, m_iSize-1 );
+	if( job.m_iMinX>job.m_iMaxX || job.m_iMinZ>job.m_iMaxZ )
+		return;
+
+	job.m_ucpHeights= m_heightData.m_ucpData;
+	job.m_uspNormals= m_uspNormals;
+	job.m_iSize		= m_iSize;
+
+	//the Sobel filter's weights add up to 8 on each side
+	job.m_fScaleX= m_vecScale[1]/( 8.0f*m_vecScale[0] );
+	job.m_fScaleZ= m_vecScale[1]/( 8.0f*m_vecScale[2] );
+
+	g_threadPool.Run( NormalRows, &job, ( job.m_iMaxZ-job.m_iMinZ+TRN_ROWS_PER_JOB )/TRN_ROWS_PER_JOB );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::UnloadNormals - public
+// Description:		Unload the normal map
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::UnloadNormals( void )
+{
+	//check to see if the data has been set
+	if( m_uspNormals )
+	{
+		delete[] m_uspNormals;
+		m_uspNormals= NULL;
+		m_iNormalRevision++;
+	}
+
+	g_log.Write( LOG_SUCCESS, "Successfully unloaded the normal map\n" );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::SampleNormal - public
+// Description:		Get a smoothly blended normal at a world-space
+//					position, from the normal map if there is one (or
+//					from the heights, if there isn't)
+// Arguments:		-fX, fZ: the position to sample
+//					-fpNormal: storage for the normal
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::SampleNormal( float fX, float fZ, float* fpNormal )
+{
+	float fNormals[4][3];
+	float fFractionX, fFractionZ;
+	float fLength, fHeight;
+	int x0, z0, x1, z1;
+	int i;
+
+	if( m_uspNormals==NULL )
+	{
+		SampleHeights( &fX, &fZ, 1, &fHeight, fpNormal );
+		return;
+	}
+
+	//into height map space, and stay on the map
+	fX/= m_vecScale[0];
+	fZ/= m_vecScale[2];
+	CLAMP( fX, 0.0f, ( float )( m_iSize-1 ) );
+	CLAMP( fZ, 0.0f, ( float )( m_iSize-1 ) );
+
+	x0= ( int )fX;
+	z0= ( int )fZ;
+	x1= MIN( x0+1, m_iSize-1 );
+	z1= MIN( z0+1, m_iSize-1 );
+	fFractionX= fX-x0;
+	fFractionZ= fZ-z0;
+
+	GetNormalAtPoint( x0, z0, fNormals[0] );
+	GetNormalAtPoint( x1, z0, fNormals[1] );
+	GetNormalAtPoint( x0, z1, fNormals[2] );
+	GetNormalAtPoint( x1, z1, fNormals[3] );
+
+	for( i=0; i<3; i++ )
+	{
+		fpNormal[i]= ( fNormals[0][i]*( 1.0f-fFractionX )+fNormals[1][i]*fFractionX )*( 1.0f-fFractionZ )+
+					 ( fNormals[2][i]*( 1.0f-fFractionX )+fNormals[3][i]*fFractionX )*fFractionZ;
+	}
+
+	fLength= ( float )sqrt( fpNormal[0]*fpNormal[0]+fpNormal[1]*fpNormal[1]+fpNormal[2]*fpNormal[2] );
+	fpNormal[0]/= fLength;
+	fpNormal[1]/= fLength;
+	fpNormal[2]/= fLength;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::PackNormal - public
+// Description:		Pack a normal into 16 bits: the normal is projected
+//					onto an octahedron (with the lower half folded over
+//					the upper half), which is then flattened out into a
+//					square with 8 bits on each side (only 255 of the 256
+//					steps are used, so that flat ground packs exactly)
+// Arguments:		-fpNormal: the normal (it doesn't need to be unit length)
+// Return Value:	An unsigned short value: the packed normal
+//--------------------------------------------------------------
+unsigned short CTERRAIN::PackNormal( const float* fpNormal )
+{
+	float fSum, fU, fV, fTemp;
+
+	fSum= ( ( float )fabs( fpNormal[0] )+( float )fabs( fpNormal[1] ) )+( float )fabs( fpNormal[2] );
+	fU	= fpNormal[0]/fSum;
+	fV	= fpNormal[2]/fSum;
+
+	if( fpNormal[1]<0.0f )
+	{
+		fTemp= fU;
+		fU	 = ( 1.0f-( float )fabs( fV ) )*( ( fTemp>=0.0f ) ? 1.0f : -1.0f );
+		fV	 = ( 1.0f-( float )fabs( fTemp ) )*( ( fV>=0.0f ) ? 1.0f : -1.0f );
+	}
+
+	return ( unsigned short )( ( int )( fU*127.0f+127.5f ) | ( ( int )( fV*127.0f+127.5f )<<8 ) );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::SampleHeights - public
+// Description:		Get filtered heights (and normals, if wanted) for a
+//					list of world-space positions.  Nothing in the terrain
+//					is modified, so any number of threads can call this at
+//					once (as long as the height map isn't being changed).
+// Arguments:		-fpX, fpZ: the positions to sample
+//					-iCount: the number of positions
+//					-fpHeights: storage for the scaled heights
+//					-fpNormals: storage for the normals (three floats per
+//								position), or NULL if they aren't needed
+//					-filter: TRN_BILINEAR or TRN_BICUBIC
+//					-border: what to do outside of the height map
+//							 (TRN_CLAMP or TRN_WRAP)
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::SampleHeights( const float* fpX, const float* fpZ, int iCount, float* fpHeights,
+							  float* fpNormals, ETRN_FILTERS filter, ETRN_BORDERS border )
+{
+	int i;
+
+	if( m_heightData.m_ucpData==NULL )
+		return;
+
+	for( i=0; i<iCount; i+=TRN_SAMPLE_BATCH )
+	{
+		SampleBatch( fpX+i, fpZ+i, MIN( TRN_SAMPLE_BATCH, iCount-i ), fpHeights+i,
+					 fpNormals ? fpNormals+( i*3 ) : NULL, filter, border );
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::SampleHeight - public
+// Description:		Get the filtered height at a single world-space
+//					position (batch up calls to SampleHeights if you
+//					need a lot of them)
+// Arguments:		-fX, fZ: the position to sample
+//					-filter: TRN_BILINEAR or TRN_BICUBIC
+//					-border: TRN_CLAMP or TRN_WRAP
+// Return Value:	A float value: the scaled height
+//--------------------------------------------------------------
+float CTERRAIN::SampleHeight( float fX, float fZ, ETRN_FILTERS filter, ETRN_BORDERS border )
+{
+	float fHeight= 0.0f;
+
+	SampleHeights( &fX, &fZ, 1, &fHeight, NULL, filter, border );
+	return fHeight;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::SampleBatch - private
+// Description:		Sample up to TRN_SAMPLE_BATCH positions at once.  The
+//					height values are gathered one at a time, but all of
+//					the filtering is done four samples at a time.
+// Arguments:		-fpX, fpZ: the positions to sample
+//					-iCount: the number of positions (TRN_SAMPLE_BATCH or less)
+//					-fpHeights: storage for the scaled heights
+//					-fpNormals: storage for the normals, or NULL
+//					-filter: TRN_BILINEAR or TRN_BICUBIC
+//					-border: TRN_CLAMP or TRN_WRAP
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::SampleBatch( const float* fpX, const float* fpZ, int iCount, float* fpHeights,
+							float* fpNormals, ETRN_FILTERS filter, ETRN_BORDERS border )
+{
+	SIMD_ALIGN( float fU[TRN_SAMPLE_BATCH] );
+	SIMD_ALIGN( float fV[TRN_SAMPLE_BATCH] );
+	SIMD_ALIGN( float fTaps[16][TRN_SAMPLE_BATCH] );
+	SIMD_ALIGN( float fHeight[TRN_SAMPLE_BATCH] );
+	SIMD_ALIGN( float fNormal[3][TRN_SAMPLE_BATCH] );
+	int iU[TRN_SAMPLE_BATCH];
+	int iV[TRN_SAMPLE_BATCH];
+	unsigned char* ucpRow;
+	float fInvScaleX= 1.0f/m_vecScale[0];
+	float fInvScaleZ= 1.0f/m_vecScale[2];
+	float fSlopeX	= m_vecScale[1]*fInvScaleX;
+	float fSlopeZ	= m_vecScale[1]*fInvScaleZ;
+	int iNumTaps	= ( filter==TRN_BICUBIC ) ? 4 : 2;
+	int iFirstTap	= ( filter==TRN_BICUBIC ) ? -1 : 0;
+	int i, j;
+	int x, z;
+
+	//move the positions into height map space (repeating the last one to
+	//fill up the batch)
+	for( i=0; i<TRN_SAMPLE_BATCH; i++ )
+	{
+		j= MIN( i, iCount-1 );
+
+		fU[i]= fpX[j]*fInvScaleX;
+		fV[i]= fpZ[j]*fInvScaleZ;
+	}
+
+#ifdef USE_SSE2
+	__m128 vOne= _mm_set1_ps( 1.0f );
+	__m128 vHalf= _mm_set1_ps( 0.5f );
+	__m128 vPos, vFloor;
+	__m128 vU, vV, vU2, vV2;
+	__m128 vHeight, vDU, vDV;
+	__m128 vTop, vBottom, vRow, vRowD;
+	__m128 vWeightU[4], vWeightV[4];
+	__m128 vDerivU[4], vDerivV[4];
+	__m128 vNX, vNZ, vLength;
+
+	//split the positions into whole and fractional parts
+	for( i=0; i<TRN_SAMPLE_BATCH; i+=4 )
+	{
+		vPos  = _mm_load_ps( fU+i );
+		vFloor= _mm_cvtepi32_ps( _mm_cvttps_epi32( vPos ) );
+		vFloor= _mm_sub_ps( vFloor, _mm_and_ps( _mm_cmpgt_ps( vFloor, vPos ), vOne ) );
+		_mm_storeu_si128( ( __m128i* )( iU+i ), _mm_cvttps_epi32( vFloor ) );
+		_mm_store_ps( fU+i, _mm_sub_ps( vPos, vFloor ) );
+
+		vPos  = _mm_load_ps( fV+i );
+		vFloor= _mm_cvtepi32_ps( _mm_cvttps_epi32( vPos ) );
+		vFloor= _mm_sub_ps( vFloor, _mm_and_ps( _mm_cmpgt_ps( vFloor, vPos ), vOne ) );
+		_mm_storeu_si128( ( __m128i* )( iV+i ), _mm_cvttps_epi32( vFloor ) );
+		_mm_store_ps( fV+i, _mm_sub_ps( vPos, vFloor ) );
+	}
+#else
+	float fFloor;
+	float fTop, fBottom, fRow, fRowD;
+	float fWeightU[4], fWeightV[4];
+	float fDerivU[4], fDerivV[4];
+	float fDU, fDV;
+	float fLength;
+	float t;
+
+	for( i=0; i<TRN_SAMPLE_BATCH; i++ )
+	{
+		fFloor= ( float )floor( fU[i] );
+		iU[i] = ( int )fFloor;
+		fU[i]-= fFloor;
+
+		fFloor= ( float )floor( fV[i] );
+		iV[i] = ( int )fFloor;
+		fV[i]-= fFloor;
+	}
+#endif
+
+	//gather the height values around each sample
+	for( i=0; i<TRN_SAMPLE_BATCH; i++ )
+	{
+		for( z=0; z<iNumTaps; z++ )
+		{
+			ucpRow= m_heightData.m_ucpData+GetTapIndex( iV[i]+iFirstTap+z, m_iSize, border )*m_iSize;
+
+			for( x=0; x<iNumTaps; x++ )
+				fTaps[( z*iNumTaps )+x][i]= ucpRow[GetTapIndex( iU[i]+iFirstTap+x, m_iSize, border )];
+		}
+	}
+
+#ifdef USE_SSE2
+	for( i=0; i<TRN_SAMPLE_BATCH; i+=4 )
+	{
+		vU= _mm_load_ps( fU+i );
+		vV= _mm_load_ps( fV+i );
+
+		if( filter==TRN_BICUBIC )
+		{
+			//Catmull-Rom weights (and their derivatives) for both axes
+			vU2= _mm_mul_ps( vU, vU );
+			vV2= _mm_mul_ps( vV, vV );
+
+			vWeightU[0]= _mm_mul_ps( vHalf, _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( 2.0f ), vU ), vU ), vOne ), vU ) );
+			vWeightU[1]= _mm_mul_ps( vHalf, _mm_add_ps( _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 3.0f ), vU ), _mm_set1_ps( 5.0f ) ), vU2 ), _mm_set1_ps( 2.0f ) ) );
+			vWeightU[2]= _mm_mul_ps( vHalf, _mm_mul_ps( _mm_add_ps( _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( 4.0f ), _mm_mul_ps( _mm_set1_ps( 3.0f ), vU ) ), vU ), vOne ), vU ) );
+			vWeightU[3]= _mm_mul_ps( vHalf, _mm_mul_ps( _mm_sub_ps( vU, vOne ), vU2 ) );
+			vDerivU[0] = _mm_mul_ps( vHalf, _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 4.0f ), vU ), _mm_mul_ps( _mm_set1_ps( 3.0f ), vU2 ) ), vOne ) );
+			vDerivU[1] = _mm_mul_ps( vHalf, _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 9.0f ), vU2 ), _mm_mul_ps( _mm_set1_ps( 10.0f ), vU ) ) );
+			vDerivU[2] = _mm_mul_ps( vHalf, _mm_add_ps( _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 8.0f ), vU ), _mm_mul_ps( _mm_set1_ps( 9.0f ), vU2 ) ), vOne ) );
+			vDerivU[3] = _mm_mul_ps( vHalf, _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 3.0f ), vU2 ), _mm_mul_ps( _mm_set1_ps( 2.0f ), vU ) ) );
+
+			vWeightV[0]= _mm_mul_ps( vHalf, _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( 2.0f ), vV ), vV ), vOne ), vV ) );
+			vWeightV[1]= _mm_mul_ps( vHalf, _mm_add_ps( _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 3.0f ), vV ), _mm_set1_ps( 5.0f ) ), vV2 ), _mm_set1_ps( 2.0f ) ) );
+			vWeightV[2]= _mm_mul_ps( vHalf, _mm_mul_ps( _mm_add_ps( _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( 4.0f ), _mm_mul_ps( _mm_set1_ps( 3.0f ), vV ) ), vV ), vOne ), vV ) );
+			vWeightV[3]= _mm_mul_ps( vHalf, _mm_mul_ps( _mm_sub_ps( vV, vOne ), vV2 ) );
+			vDerivV[0] = _mm_mul_ps( vHalf, _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 4.0f ), vV ), _mm_mul_ps( _mm_set1_ps( 3.0f ), vV2 ) ), vOne ) );
+			vDerivV[1] = _mm_mul_ps( vHalf, _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 9.0f ), vV2 ), _mm_mul_ps( _mm_set1_ps( 10.0f ), vV ) ) );
+			vDerivV[2] = _mm_mul_ps( vHalf, _mm_add_ps( _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 8.0f ), vV ), _mm_mul_ps( _mm_set1_ps( 9.0f ), vV2 ) ), vOne ) );
+			vDerivV[3] = _mm_mul_ps( vHalf, _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 3.0f ), vV2 ), _mm_mul_ps( _mm_set1_ps( 2.0f ), vV ) ) );
+
+			vHeight= _mm_setzero_ps( );
+			vDU	   = _mm_setzero_ps( );
+			vDV	   = _mm_setzero_ps( );
+
+			for( z=0; z<4; z++ )
+			{
+				vRow = _mm_setzero_ps( );
+				vRowD= _mm_setzero_ps( );
+
+				for( x=0; x<4; x++ )
+				{
+					vPos = _mm_load_ps( fTaps[( z*4 )+x]+i );
+					vRow = _mm_add_ps( vRow,  _mm_mul_ps( vWeightU[x], vPos ) );
+					vRowD= _mm_add_ps( vRowD, _mm_mul_ps( vDerivU[x], vPos ) );
+				}
+
+				vHeight= _mm_add_ps( vHeight, _mm_mul_ps( vWeightV[z], vRow ) );
+				vDU	   = _mm_add_ps( vDU, _mm_mul_ps( vWeightV[z], vRowD ) );
+				vDV	   = _mm_add_ps( vDV, _mm_mul_ps( vDerivV[z], vRow ) );
+			}
+		}
+
+		else
+		{
+			//blend the four corners together
+			vTop   = _mm_load_ps( fTaps[0]+i );
+			vBottom= _mm_load_ps( fTaps[2]+i );
+			vRow   = _mm_sub_ps( _mm_load_ps( fTaps[1]+i ), vTop );
+			vRowD  = _mm_sub_ps( _mm_load_ps( fTaps[3]+i ), vBottom );
+
+			vTop   = _mm_add_ps( vTop, _mm_mul_ps( vRow, vU ) );
+			vBottom= _mm_add_ps( vBottom, _mm_mul_ps( vRowD, vU ) );
+
+			vHeight= _mm_add_ps( vTop, _mm_mul_ps( _mm_sub_ps( vBottom, vTop ), vV ) );
+			vDU	   = _mm_add_ps( vRow, _mm_mul_ps( _mm_sub_ps( vRowD, vRow ), vV ) );
+			vDV	   = _mm_sub_ps( vBottom, vTop );
+		}
+
+		_mm_store_ps( fHeight+i, _mm_mul_ps( vHeight, _mm_set1_ps( m_vecScale[1] ) ) );
+
+		//turn the world-space slopes into a unit normal
+		vNX		= _mm_mul_ps( vDU, _mm_set1_ps( -fSlopeX ) );
+		vNZ		= _mm_mul_ps( vDV, _mm_set1_ps( -fSlopeZ ) );
+		vLength = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( vNX, vNX ), vOne ), _mm_mul_ps( vNZ, vNZ ) ) );
+		vLength = _mm_div_ps( vOne, vLength );
+
+		_mm_store_ps( fNormal[0]+i, _mm_mul_ps( vNX, vLength ) );
+		_mm_store_ps( fNormal[1]+i, vLength );
+		_mm_store_ps( fNormal[2]+i, _mm_mul_ps( vNZ, vLength ) );
+	}
+#else
+	for( i=0; i<TRN_SAMPLE_BATCH; i++ )
+	{
+		if( filter==TRN_BICUBIC )
+		{
+			//Catmull-Rom weights (and their derivatives) for both axes
+			t= fU[i];
+			fWeightU[0]= 0.5f*( ( ( 2.0f-t )*t-1.0f )*t );
+			fWeightU[1]= 0.5f*( ( 3.0f*t-5.0f )*t*t+2.0f );
+			fWeightU[2]= 0.5f*( ( ( 4.0f-3.0f*t )*t+1.0f )*t );
+			fWeightU[3]= 0.5f*( ( t-1.0f )*t*t );
+			fDerivU[0] = 0.5f*( 4.0f*t-3.0f*t*t-1.0f );
+			fDerivU[1] = 0.5f*( 9.0f*t*t-10.0f*t );
+			fDerivU[2] = 0.5f*( 8.0f*t-9.0f*t*t+1.0f );
+			fDerivU[3] = 0.5f*( 3.0f*t*t-2.0f*t );
+
+			t= fV[i];
+			fWeightV[0]= 0.5f*( ( ( 2.0f-t )*t-1.0f )*t );
+			fWeightV[1]= 0.5f*( ( 3.0f*t-5.0f )*t*t+2.0f );
+			fWeightV[2]= 0.5f*( ( ( 4.0f-3.0f*t )*t+1.0f )*t );
+			fWeightV[3]= 0.5f*( ( t-1.0f )*t*t );
+			fDerivV[0] = 0.5f*( 4.0f*t-3.0f*t*t-1.0f );
+			fDerivV[1] = 0.5f*( 9.0f*t*t-10.0f*t );
+			fDerivV[2] = 0.5f*( 8.0f*t-9.0f*t*t+1.0f );
+			fDerivV[3] = 0.5f*( 3.0f*t*t-2.0f*t );
+
+			fHeight[i]= 0.0f;
+			fDU		  = 0.0f;
+			fDV		  = 0.0f;
+
+			for( z=0; z<4; z++ )
+			{
+				fRow = 0.0f;
+				fRowD= 0.0f;
+
+				for( x=0; x<4; x++ )
+				{
+					fRow += fWeightU[x]*fTaps[( z*4 )+x][i];
+					fRowD+= fDerivU[x]*fTaps[( z*4 )+x][i];
+				}
+
+				fHeight[i]+= fWeightV[z]*fRow;
+				fDU		  += fWeightV[z]*fRowD;
+				fDV		  += fDerivV[z]*fRow;
+			}
+		}
+
+		else
+		{
+			//blend the four corners together
+			fRow   = fTaps[1][i]-fTaps[0][i];
+			fRowD  = fTaps[3][i]-fTaps[2][i];
+			fTop   = fTaps[0][i]+fRow*fU[i];
+			fBottom= fTaps[2][i]+fRowD*fU[i];
+
+			fHeight[i]= fTop+( fBottom-fTop )*fV[i];
+			fDU		  = fRow+( fRowD-fRow )*fV[i];
+			fDV		  = fBottom-fTop;
+		}
+
+		fHeight[i]*= m_vecScale[1];
+
+		//turn the world-space slopes into a unit normal
+		fNormal[0][i]= -fDU*fSlopeX;
+		fNormal[2][i]= -fDV*fSlopeZ;
+		fLength		 = 1.0f/( float )sqrt( fNormal[0][i]*fNormal[0][i] + 1.0f + fNormal[2][i]*fNormal[2][i] );
+
+		fNormal[0][i]*= fLength;
+		fNormal[1][i] = fLength;
+		fNormal[2][i]*= fLength;
+	}
+#endif
+
+	//copy the results out
+	for( i=0; i<iCount; i++ )
+	{
+		fpHeights[i]= fHeight[i];
+
+		if( fpNormals )
+		{
+			fpNormals[( i*3 )]  = fNormal[0][i];
+			fpNormals[( i*3 )+1]= fNormal[1][i];
+			fpNormals[( i*3 )+2]= fNormal[2][i];
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::Submit - public
+// Description:		Get the frame's mesh ready (with the level of detail
+//					system's PrepareMesh), and add a render queue packet
+//					for each pass that it is drawn with
+// Arguments:		-pQueue: the render queue
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::Submit( CRENDER_QUEUE* pQueue )
+{
+	SRENDER_PACKET* pPacket;
+	bool bMultiTex;
+	int iFormat;
+
+	iFormat= PrepareMesh( &bMultiTex );
+
+	//the color and detail maps in one pass
+	if( bMultiTex )
+	{
+		pPacket= AddPacket( pQueue, RENDER_PASS_OPAQUE, iFormat );
+		pPacket->m_state.m_uiTextures[0]  = m_texture.GetID( );
+		pPacket->m_state.m_uiTextures[1]  = m_detailMap.GetID( );
+		pPacket->m_state.m_combineModes[1]= BACKEND_COMBINE_DETAIL;
+		return;
+	}
+
+	if( m_bTextureMapping )
+	{
+		pPacket= AddPacket( pQueue, RENDER_PASS_OPAQUE, iFormat );
+		pPacket->m_state.m_uiTextures[0]= m_texture.GetID( );
+	}
+
+	if( !( m_bTextureMapping && !m_bDetailMapping ) )
+	{
+		//the detail map is multiplied into the color pass, if there was one
+		pPacket= AddPacket( pQueue, m_bTextureMapping ? RENDER_PASS_DECAL : RENDER_PASS_OPAQUE, iFormat );
+
+		if( m_bDetailMapping )
+		{
+			pPacket->m_state.m_uiTextures[0]	= m_detailMap.GetID( );
+			pPacket->m_state.m_fTextureScales[0]= ( float )m_iRepeatDetailMap;
+
+			if( m_bTextureMapping )
+			{
+				pPacket->m_state.m_bBlend	= true;
+				pPacket->m_state.m_blendMode= BACKEND_BLEND_MULTIPLY;
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::AddPacket - private
+// Description:		Add a render queue packet that draws the frame's mesh,
+//					with back-face culling (and fog, if the mesh has fog
+//					coordinates)
+// Arguments:		-pQueue: the render queue
+//					-pass: the pass that the packet is drawn in
+//					-iFormat: the vertex format to draw the mesh with
+// Return Value:	A pointer to the new packet (for the caller to fill in
+//					its textures)
+//--------------------------------------------------------------
+SRENDER_PACKET* CTERRAIN::AddPacket( CRENDER_QUEUE* pQueue, ERENDER_PASSES pass, int iFormat )
+{
+	SRENDER_PACKET* pPacket;
+
+	pPacket= pQueue->AddPacket( pass, STATS_TERRAIN );
+	pPacket->m_state.m_bCullFace= true;
+	pPacket->m_state.m_bFog		= ( iFormat & BACKEND_FOGCOORD )!=0;
+
+	pPacket->m_pfnDraw= DrawPacket;
+	pPacket->m_pData  = this;
+	pPacket->m_iParam = iFormat;
+
+	return pPacket;
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::DrawPacket - private
+// Description:		Draw one of the terrain's render queue packets (with
+//					the level of detail system's DrawMesh)
+// Arguments:		-pData: the terrain
+//					-iParam: the vertex format to draw the mesh with
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::DrawPacket( void* pData, int iParam )
+{
+	( ( CTERRAIN* )pData )->DrawMesh( iParam );
+}
+
+//--------------------------------------------------------------
+// Name:			CTERRAIN::BuildShadeTable - private
+// Description:		Multiply every possible lightmap brightness by the
+//					light's color
+// Arguments:		None
+// Return Value:	None
+//--------------------------------------------------------------
+void CTERRAIN::BuildShadeTable( void )
+{
+	int i;
+
+	for( i=0; i<256; i++ )
+	{
+		m_ucShadeTable[i][0]= ( unsigned char )( i*m_vecLightColor[0] );
+		m_ucShadeTable[i][1]= ( unsigned char )( i*m_vecLightColor[1] );
+		m_ucShadeTable[i][2]= ( unsigned char )( i*m_vecLightColor[2] );
+		m_ucShadeTable[i][3]= 255;
+	}
+}
@@ -19,8 +19,12 @@
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 #include <stdlib.h>
+#include <math.h>
 
+#include "../Base Code/bake_cache.h"
 #include "../Base Code/image.h"
+#include "../Base Code/render_backend.h"
+#include "../Base Code/render_queue.h"
 
 
 //--------------------------------------------------------------
@@ -30,6 +34,25 @@
 //--------------------------------------------------------------
 #define TRN_NUM_TILES 5
 
+#define TRN_SAMPLE_BATCH 8		//height samples processed together (two SSE registers)
+
+#define TRN_SWEEP_LINES_PER_JOB	 32	//lines swept by each thread pool job (shadows, horizons)
+#define TRN_ROWS_PER_JOB		 16	//rows handled by each thread pool job (relighting, normals)
+
+#define TRN_DEFAULT_AZIMUTHS 16		//number of horizon maps
+
+//horizon angles (0-90 degrees) are stored in a byte each
+#define TRN_HORIZON_UNITS ( 255.0f/( PI/2.0f ) )
+
+#define TRN_MAX_PYRAMID_LEVELS 16		//enough for a 32769x32769 height map
+
+//ambient occlusion
+#define TRN_AO_TILE_SIZE		   64	//texels on a side of each thread pool job's tile
+#define TRN_AO_DEFAULT_DIRECTIONS  16
+#define TRN_AO_MAX_DIRECTIONS	   256	//the running totals are 16 bits
+#define TRN_AO_DIRECTIONS_PER_PASS 16	//directions traced by each batch of jobs
+#define TRN_AO_MAX_STEPS		   32	//samples along each direction
+
 
 //--------------------------------------------------------------
 //--------------------------------------------------------------
@@ -48,7 +71,21 @@ enum ELIGHTING_TYPES
 {
 	HEIGHT_BASED= 0,
 	LIGHTMAP,
-	SLOPE_LIGHT
+	SLOPE_LIGHT,
+	SHADOWED_LIGHT,		//cast shadows from a sun at any angle
+	HORIZON_MAPPED		//shadows and sky light from precomputed horizon maps
+};
+
+enum ETRN_FILTERS
+{
+	TRN_BILINEAR= 0,
+	TRN_BICUBIC			//Catmull-Rom
+};
+
+enum ETRN_BORDERS
+{
+	TRN_CLAMP= 0,
+	TRN_WRAP
 };
 
 struct STRN_LIGHTMAP_DATA
@@ -97,6 +134,10 @@ class CTERRAIN
 		bool   m_bTextureMapping;
 		bool   m_bDetailMapping;
 
+		//block compression for the generated texture map and the detail map
+		EIMAGE_COMPRESSION m_textureCompression;
+		EIMAGE_QUALITY	   m_compressionQuality;
+
 		//lighting information
 		ELIGHTING_TYPES m_lightingType;
 		STRN_LIGHTMAP_DATA m_lightmap;
@@ -104,6 +145,44 @@ class CTERRAIN
 		float m_fMinBrightness, m_fMaxBrightness;
 		float m_fLightSoftness;
 		int m_iDirectionX, m_iDirectionZ;
+		float m_fSunAzimuth, m_fSunElevation;	//in degrees
+		float m_fSunRadius;						//angular radius, in degrees
+
+		//horizon angles for a number of directions, followed by the sky
+		//visibility (one byte per texel for each of them)
+		unsigned char* m_ucpHorizons;
+		unsigned char* m_ucpSkyVisibility;
+		int m_iNumAzimuths;
+		int m_iHorizonSize;
+
+		//ambient occlusion: the running total of every traced direction's
+		//visibility, and the average of them (0-255)
+		unsigned short* m_uspOcclusionSums;
+		unsigned char*	m_ucpOcclusion;
+		int   m_iOcclusionSize;
+		int   m_iNumOcclusionDirections;
+		float m_fOcclusionRadius;		//in texels
+		float m_fOcclusionStrength;		//how much of it goes into the lightmap
+
+		//normal map (octahedral, 8 bits for each of the two coordinates)
+		unsigned short* m_uspNormals;
+		CVECTOR m_vecNormalScale;		//the scale that the normals were made for
+		int m_iNormalRevision;			//counts up every time the whole normal map is made (or unloaded)
+
+		//seed for the fractal terrain generators (a fixed seed lets the
+		//results be pulled out of the bake cache)
+		unsigned int m_uiSeed;
+		bool m_bFixedSeed;
+
+		//what the terrain is drawn with (OpenGL, unless told otherwise)
+		CRENDER_BACKEND* m_pBackend;
+
+		//the depth of the volumetric fog (no fog if it is zero)
+		float m_fFogDepth;
+
+		//the lightmap's brightness values, already multiplied by the light's
+		//color (rebuilt every time that the terrain is rendered)
+		unsigned char m_ucShadeTable[256][4];
 
 		int m_iVertsPerFrame;		//stat variables
 		int m_iTrisPerFrame;
@@ -116,7 +195,29 @@ class CTERRAIN
 	//texture map generation functions
 	float RegionPercent( int tileType, unsigned char ucHeight );
 	void GetTexCoords( CIMAGE texture, unsigned int* x, unsigned int* y );
-	unsigned char InterpolateHeight( int x, int z, float fHeightToTexRatio );
+	void UploadTextureMap( void );
+
+	//lighting
+	void CalculateShadowedLighting( void );
+	void TraceAmbientOcclusion( int iFirstDirection, int iNumDirections );
+	void CombineAmbientOcclusion( void );
+
+	//height sampling
+	void SampleBatch( const float* fpX, const float* fpZ, int iCount, float* fpHeights,
+					  float* fpNormals, ETRN_FILTERS filter, ETRN_BORDERS border );
+
+	//bake cache helpers
+	BAKE_KEY GetHeightMapKey( void );
+	bool LoadCachedHeightMap( BAKE_KEY key, int iSize );
+	bool LoadCachedTextureMap( BAKE_KEY key, unsigned int uiSize );
+
+	//rendering (each level of detail system builds and draws its own
+	//mesh, and shares the passes that it is drawn with)
+	virtual int  PrepareMesh( bool* pbMultiTex )= 0;
+	virtual void DrawMesh( int iFormat )= 0;
+	void BuildShadeTable( void );
+	SRENDER_PACKET* AddPacket( CRENDER_QUEUE* pQueue, ERENDER_PASSES pass, int iFormat );
+	static void DrawPacket( void* pData, int iParam );
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::Limit - private
@@ -134,6 +235,22 @@ class CTERRAIN
 		return ucValue;
 	}
 
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetFogCoord - private
+	// Description:		Get the volumetric fog coordinate for the vertex in question
+	// Arguments:		-fHeight: the height of the vertex
+	// Return Value:	A float value: the vertex's fog coordinate
+	//--------------------------------------------------------------
+	inline float GetFogCoord( float fHeight )
+	{
+		//check to ensure that the height is not higher than the fog depth
+		if( fHeight>m_fFogDepth )
+			return 0;
+
+		//calculate the fog depth
+		return -( fHeight-m_fFogDepth );
+	}
+
 
 	public:
 		CVECTOR m_vecScale;		//scaling variable
@@ -141,6 +258,7 @@ class CTERRAIN
 
 
 	virtual void Render( void )= 0;
+	void Submit( CRENDER_QUEUE* pQueue );
 
 	bool LoadHeightMap( char* szFilename, int iSize );
 	bool SaveHeightMap( char* szFilename );
@@ -159,6 +277,104 @@ class CTERRAIN
 	
 	void CalculateLighting( void );
 
+	//horizon-mapped lighting
+	bool BuildHorizonMaps( int iNumAzimuths= TRN_DEFAULT_AZIMUTHS );
+	void UnloadHorizonMaps( void );
+	void Relight( float fAzimuth, float fElevation );
+
+	//ambient occlusion (combined into the lightmap)
+	bool BakeAmbientOcclusion( int iNumDirections= TRN_AO_DEFAULT_DIRECTIONS );
+	bool RefineAmbientOcclusion( int iNumDirections );
+	void UnloadAmbientOcclusion( void );
+
+	//height sampling (world space, safe to call from any number of threads)
+	void SampleHeights( const float* fpX, const float* fpZ, int iCount, float* fpHeights, float* fpNormals= NULL,
+						ETRN_FILTERS filter= TRN_BILINEAR, ETRN_BORDERS border= TRN_CLAMP );
+	float SampleHeight( float fX, float fZ, ETRN_FILTERS filter= TRN_BILINEAR, ETRN_BORDERS border= TRN_CLAMP );
+
+	//normal map
+	bool CalculateNormals( void );
+	void UpdateNormals( int iMinX, int iMinZ, int iMaxX, int iMaxZ );
+	void UnloadNormals( void );
+	void SampleNormal( float fX, float fZ, float* fpNormal );
+
+	static unsigned short PackNormal( const float* fpNormal );
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::UnpackNormal - public
+	// Description:		Unpack an octahedral normal (see PackNormal)
+	// Arguments:		-usNormal: the packed normal
+	//					-fpNormal: storage for the unit length normal
+	// Return Value:	None
+	//--------------------------------------------------------------
+	static inline void UnpackNormal( unsigned short usNormal, float* fpNormal )
+	{
+		float fU, fV, fTemp;
+		float fLength;
+
+		fU= ( usNormal & 0xFF )/127.0f-1.0f;
+		fV= ( usNormal>>8 )/127.0f-1.0f;
+
+		fpNormal[0]= fU;
+		fpNormal[1]= 1.0f-( float )fabs( fU )-( float )fabs( fV );
+		fpNormal[2]= fV;
+
+		//the lower half of the octahedron is folded over the upper half
+		if( fpNormal[1]<0.0f )
+		{
+			fTemp	   = fpNormal[0];
+			fpNormal[0]= ( 1.0f-( float )fabs( fpNormal[2] ) )*( ( fTemp>=0.0f ) ? 1.0f : -1.0f );
+			fpNormal[2]= ( 1.0f-( float )fabs( fTemp ) )*( ( fpNormal[2]>=0.0f ) ? 1.0f : -1.0f );
+		}
+
+		fLength= ( float )sqrt( fpNormal[0]*fpNormal[0]+fpNormal[1]*fpNormal[1]+fpNormal[2]*fpNormal[2] );
+		fpNormal[0]/= fLength;
+		fpNormal[1]/= fLength;
+		fpNormal[2]/= fLength;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetPackedNormalAtPoint - public
+	// Description:		Get the packed normal at a point (the normal map
+	//					needs to be calculated first)
+	// Arguments:		-x, z: which point to check
+	// Return Value:	An unsigned short value: the packed normal
+	//--------------------------------------------------------------
+	inline unsigned short GetPackedNormalAtPoint( int x, int z )
+	{	return m_uspNormals[( z*m_iSize )+x];	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetNormalAtPoint - public
+	// Description:		Get the normal at a point (the normal map needs to
+	//					be calculated first)
+	// Arguments:		-x, z: which point to check
+	//					-fpNormal: storage for the normal
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void GetNormalAtPoint( int x, int z, float* fpNormal )
+	{	UnpackNormal( m_uspNormals[( z*m_iSize )+x], fpNormal );	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::HasNormals - public
+	// Description:		Check to see if the normal map has been calculated
+	// Arguments:		None
+	// Return Value:	A boolean value: -true: there is a normal map
+	//									 -false: there is no normal map
+	//--------------------------------------------------------------
+	inline bool HasNormals( void )
+	{	return ( m_uspNormals!=NULL );	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetNormalRevision - public
+	// Description:		Get a number that changes every time that the whole
+	//					normal map is made or unloaded (so that anything that
+	//					keeps normals around can tell when they are stale)
+	// Arguments:		None
+	// Return Value:	An integer value: the normal map's revision
+	//--------------------------------------------------------------
+	inline int GetNormalRevision( void )
+	{	return m_iNormalRevision;	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::GetNumVertsPerFrame - public
 	// Description:		Get the number of vertices being sent to the
@@ -194,7 +410,13 @@ class CTERRAIN
 	// Return Value:	None
 	//--------------------------------------------------------------
 	inline void Scale( float x, float y, float z )
-	{	m_vecScale.Set( x, y, z );	}
+	{
+		m_vecScale.Set( x, y, z );
+
+		//the normals depend on the scale
+		if( m_uspNormals && ( x!=m_vecNormalScale[0] || y!=m_vecNormalScale[1] || z!=m_vecNormalScale[2] ) )
+			CalculateNormals( );
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::SetHeightAtPoint - public
@@ -236,8 +458,14 @@ class CTERRAIN
 	inline bool SaveTextureMap( char* szFilename )
 	{
 		//first check to see if a texture is loaded, if so, save it!
+		//(compressed textures are saved as DDS files)
 		if( m_texture.IsLoaded( ) )
+		{
+			if( m_texture.IsCompressed( ) )
+				return ( m_texture.SaveCompressed( szFilename ) );
+
 			return ( m_texture.Save( szFilename ) );
+		}
 
 		return false;
 	}
@@ -269,7 +497,16 @@ class CTERRAIN
 	//									 -false: unsuccessful load
 	//--------------------------------------------------------------
 	inline bool LoadDetailMap( char* szFilename )
-	{	return m_detailMap.Load( szFilename, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, true );	}
+	{
+		if( !m_detailMap.LoadData( szFilename ) )
+			return false;
+
+		//DDS detail maps come in already compressed (with their mipmaps)
+		if( !m_detailMap.IsCompressed( ) && m_textureCompression!=IMAGE_UNCOMPRESSED )
+			m_detailMap.Compress( m_textureCompression, m_compressionQuality, true );
+
+		return m_detailMap.Upload( GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, true );
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::UnloadDetailMap - public
@@ -311,6 +548,42 @@ class CTERRAIN
 	inline void DoMultitexturing( bool bDo )
 	{	m_bMultitexture= bDo;	}
 
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::SetRenderBackend - public
+	// Description:		Set what the terrain is drawn with
+	// Arguments:		-pBackend: the backend (NULL for OpenGL)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetRenderBackend( CRENDER_BACKEND* pBackend )
+	{	m_pBackend= pBackend ? pBackend : &g_glBackend;	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::SetRandomSeed - public
+	// Description:		Give the fractal terrain generators a fixed seed, so
+	//					that their results can come out of the bake cache
+	// Arguments:		-uiSeed: the random number seed
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetRandomSeed( unsigned int uiSeed )
+	{
+		m_uiSeed	= uiSeed;
+		m_bFixedSeed= true;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::DoTextureCompression - public
+	// Description:		Block compress the texture map and detail map
+	//					(must be set before they are generated/loaded)
+	// Arguments:		-compression: IMAGE_BC1, or IMAGE_UNCOMPRESSED to turn it off
+	//					-quality: speed/quality trade-off for the encoder
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void DoTextureCompression( EIMAGE_COMPRESSION compression, EIMAGE_QUALITY quality= COMPRESS_NORMAL )
+	{
+		m_textureCompression= compression;
+		m_compressionQuality= quality;
+	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::LoadTile - public
 	// Description:		Load a single tile for the texture generation
@@ -320,7 +593,16 @@ class CTERRAIN
 	//									 -false: unsuccessful load
 	//--------------------------------------------------------------
 	inline bool LoadTile( ETILE_TYPES tileType, char* szFilename )
-	{	return m_tiles.textureTiles[tileType].LoadData( szFilename );	}
+	{
+		if( !m_tiles.textureTiles[tileType].LoadData( szFilename ) )
+			return false;
+
+		//the texture generator needs the tile's pixels
+		if( m_tiles.textureTiles[tileType].IsCompressed( ) )
+			return m_tiles.textureTiles[tileType].Decompress( );
+
+		return true;
+	}
 
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::UnloadTile - public
@@ -376,6 +658,47 @@ class CTERRAIN
 	inline unsigned char GetBrightnessAtPoint( int x, int z )
 	{	return ( m_lightmap.m_ucpData[( z*m_lightmap.m_iSize )+x] );	}
 
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetSkyVisibility - public
+	// Description:		Get how much of the sky can be seen from a point
+	//					(the horizon maps need to be built first)
+	// Arguments:		-x, z: which point to check
+	// Return Value:	An unsigned char value: 0 (no sky) to 255 (the
+	//					whole sky)
+	//--------------------------------------------------------------
+	inline unsigned char GetSkyVisibility( int x, int z )
+	{	return ( m_ucpSkyVisibility[( z*m_iHorizonSize )+x] );	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetNumAzimuths - public
+	// Description:		Get the number of horizon maps that have been built
+	// Arguments:		None
+	// Return Value:	An integer value: the number of horizon maps
+	//--------------------------------------------------------------
+	inline int GetNumAzimuths( void )
+	{	return m_iNumAzimuths;	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetAmbientOcclusion - public
+	// Description:		Get how unoccluded a point is (the ambient
+	//					occlusion needs to be baked first)
+	// Arguments:		-x, z: which point to check
+	// Return Value:	An unsigned char value: 0 (fully occluded) to 255
+	//					(not occluded at all)
+	//--------------------------------------------------------------
+	inline unsigned char GetAmbientOcclusion( int x, int z )
+	{	return ( m_ucpOcclusion[( z*m_iOcclusionSize )+x] );	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::GetNumOcclusionDirections - public
+	// Description:		Get the number of directions that the ambient
+	//					occlusion has been traced in so far
+	// Arguments:		None
+	// Return Value:	An integer value: the number of directions
+	//--------------------------------------------------------------
+	inline int GetNumOcclusionDirections( void )
+	{	return m_iNumOcclusionDirections;	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::SetLightColor - public
 	// Description:		Set the color of the terrain's lighting system
@@ -385,6 +708,17 @@ class CTERRAIN
 	inline void SetLightColor( CVECTOR vecColor )
 	{	m_vecLightColor= vecColor;	}
 
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::SetFogDepth - public
+	// Description:		Set the depth of the volumetric fog (the chunked LOD
+	//					system bakes it into its chunks, so there it has to be
+	//					set before they are built)
+	// Arguments:		-fDepth: the depth of the fog
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void SetFogDepth( float fDepth )
+	{	m_fFogDepth= fDepth;	}
+
 	//--------------------------------------------------------------
 	// Name:			CTERRAIN::CustomizeSlopeLighting - public
 	// Description:		Customize the parameters for slope lighting
@@ -410,7 +744,54 @@ class CTERRAIN
 		m_fLightSoftness= fSoftness;
 	}
 
-	CTERRAIN( void ) : m_vecLightColor( 1.0f, 1.0f, 1.0f ), m_vecScale( 1.0f, 1.0f, 1.0f )
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::CustomizeShadowedLighting - public
+	// Description:		Customize the parameters for shadowed lighting
+	// Arguments:		-fAzimuth: direction of the sun, in degrees (0 is
+	//							   down the +x axis, 90 is down the +z axis)
+	//					-fElevation: height of the sun above the horizon,
+	//								 in degrees
+	//					-fSunRadius: angular radius of the sun, in degrees
+	//								 (the bigger it is, the softer the
+	//								 shadow edges are)
+	//					-fMinBrightness, fMaxBrightness: the min/max brightness
+	//													 of the light
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void CustomizeShadowedLighting( float fAzimuth, float fElevation, float fSunRadius,
+										   float fMinBrightness, float fMaxBrightness )
+	{
+		m_fSunAzimuth  = fAzimuth;
+		m_fSunElevation= fElevation;
+		m_fSunRadius   = fSunRadius;
+
+		m_fMinBrightness= fMinBrightness;
+		m_fMaxBrightness= fMaxBrightness;
+	}
+
+	//--------------------------------------------------------------
+	// Name:			CTERRAIN::CustomizeAmbientOcclusion - public
+	// Description:		Customize the parameters for the ambient occlusion
+	//					(bake it again after changing the radius)
+	// Arguments:		-fRadius: how far to look for occluders, in texels
+	//					-fStrength: how much the occlusion darkens the
+	//								lightmap (0-1)
+	// Return Value:	None
+	//--------------------------------------------------------------
+	inline void CustomizeAmbientOcclusion( float fRadius, float fStrength )
+	{
+		m_fOcclusionRadius  = fRadius;
+		m_fOcclusionStrength= fStrength;
+	}
+
+	CTERRAIN( void ) : m_textureCompression( IMAGE_UNCOMPRESSED ), m_compressionQuality( COMPRESS_NORMAL ),
+					   m_vecLightColor( 1.0f, 1.0f, 1.0f ), m_fSunAzimuth( 45.0f ), m_fSunElevation( 30.0f ),
+					   m_fSunRadius( 0.27f ), m_ucpHorizons( NULL ), m_ucpSkyVisibility( NULL ),
+					   m_iNumAzimuths( 0 ), m_iHorizonSize( 0 ), m_uspOcclusionSums( NULL ),
+					   m_ucpOcclusion( NULL ), m_iOcclusionSize( 0 ), m_iNumOcclusionDirections( 0 ),
+					   m_fOcclusionRadius( 32.0f ), m_fOcclusionStrength( 1.0f ), m_uspNormals( NULL ), m_iNormalRevision( 0 ),
+					   m_uiSeed( 0 ), m_bFixedSeed( false ), m_pBackend( &g_glBackend ), m_fFogDepth( 0.0f ),
+					   m_vecScale( 1.0f, 1.0f, 1.0f )
 	{	}
 	~CTERRAIN( void )
 	{	}
@@ -16,6 +16,7 @@
 #include "../Base Code/math_ops.h"
 #include "../Base Code/gl_app.h"
 #include "../Base Code/image.h"
+#include "../Base Code/render_stats.h"
 
 #include "water.h"
 
@@ -299,13 +300,63 @@ void CWATER::Render( bool bUseCVA )
 	glBindTexture( GL_TEXTURE_2D, m_refmapID );
 	glEnable( GL_TEXTURE_2D );
 
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+	STATS_BINDS( 1 );
+	STATS_TOGGLES( 2 );
+	STATS_CHANGES( 1 );
+
+	Draw( bUseCVA );
+
+	glDisable( GL_TEXTURE_2D );
+	glDisable( GL_BLEND );
+	STATS_TOGGLES( 2 );
+}
+
+//--------------------------------------------------------------
+// Name:		 CWATER::Submit - public
+// Description:	 Add the water mesh to a render queue: it is blended
+//				 on top of the terrain, without depth writes
+// Arguments:	 -pQueue: the render queue
+//				 -fHeight: how far up to draw the mesh
+//				 -bUseCVA: use compiled vertex arrays or not
+// Return Value: None
+//--------------------------------------------------------------
+void CWATER::Submit( CRENDER_QUEUE* pQueue, float fHeight, bool bUseCVA )
+{
+	SRENDER_PACKET* pPacket;
+
+	m_fHeight= fHeight;
+
+	pPacket= pQueue->AddPacket( RENDER_PASS_TRANSLUCENT, STATS_WATER );
+	pPacket->m_state.m_bDepthWrite	= false;
+	pPacket->m_state.m_bBlend		= true;
+	pPacket->m_state.m_blendMode	= BACKEND_BLEND_ADDITIVE;
+	pPacket->m_state.m_uiTextures[0]= m_refmapID;
+
+	pPacket->m_pfnDraw= DrawPacket;
+	pPacket->m_pData  = this;
+	pPacket->m_iParam = bUseCVA ? 1 : 0;
+}
+
+//--------------------------------------------------------------
+// Name:		 CWATER::Draw - private
+// Description:	 Draw the water mesh, with sphere mapped texture
+//				 coordinates (the texture and blending have already
+//				 been set up)
+// Arguments:	 -bUseCVA: use compiled vertex arrays or not
+// Return Value: None
+//--------------------------------------------------------------
+void CWATER::Draw( bool bUseCVA )
+{
+	//the texture coordinates are generated for the first texture unit
+	glActiveTextureARB( GL_TEXTURE0_ARB );
+
 	//use sphere mapping to auto-gen texture coordinates
 	glTexGeni( GL_S, GL_TEXTURE_GEN_MODE, GL_SPHERE_MAP );
 	glTexGeni( GL_T, GL_TEXTURE_GEN_MODE, GL_SPHERE_MAP );
 	glTexGeni( GL_R, GL_TEXTURE_GEN_MODE, GL_SPHERE_MAP );
-
-	glEnable( GL_BLEND );
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+	STATS_CHANGES( 3 );
 
 	glColor4f( m_vecColor[0], m_vecColor[1], m_vecColor[2], m_fTransparency );
 
@@ -320,6 +371,7 @@ void CWATER::Render( bool bUseCVA )
 	glEnable( GL_TEXTURE_GEN_S );
 	glEnable( GL_TEXTURE_GEN_T );
 	glEnable( GL_TEXTURE_GEN_R );
+	STATS_TOGGLES( 3 );
 
 	//lock the arrays
 	if( bUseCVA )
@@ -327,6 +379,7 @@ void CWATER::Render( bool bUseCVA )
 
 	//draw the water patch
 	glDrawElements( GL_TRIANGLES, m_iNumIndices, GL_UNSIGNED_INT, m_pPolyIndexArray );
+	STATS_BATCH( m_iNumIndices/3, m_iNumIndices );
 
 	//unlock the arrays
 	if( bUseCVA )
@@ -336,13 +389,28 @@ void CWATER::Render( bool bUseCVA )
 	glDisableClientState( GL_VERTEX_ARRAY );
 	glDisableClientState( GL_NORMAL_ARRAY );
 
-	glDisable( GL_TEXTURE_2D );
-	glDisable( GL_BLEND );
-
 	//disable automatic tex-coordinate generation
 	glDisable( GL_TEXTURE_GEN_S );
 	glDisable( GL_TEXTURE_GEN_T );
 	glDisable( GL_TEXTURE_GEN_R );
+	STATS_TOGGLES( 3 );
+}
+
+//--------------------------------------------------------------
+// Name:		 CWATER::DrawPacket - private
+// Description:	 Draw the water's render queue packet
+// Arguments:	 -pData: the water
+//				 -iParam: 1 to use compiled vertex arrays
+// Return Value: None
+//--------------------------------------------------------------
+void CWATER::DrawPacket( void* pData, int iParam )
+{
+	CWATER* pWater= ( CWATER* )pData;
+
+	glPushMatrix( );
+		glTranslatef( 0.0f, pWater->m_fHeight, 0.0f );
+		pWater->Draw( iParam!=0 );
+	glPopMatrix( );
 }
 
 //--------------------------------------------------------------
@@ -15,6 +15,7 @@
 //--------------------------------------------------------------
 //--------------------------------------------------------------
 #include "../Base Code/math_ops.h"
+#include "../Base Code/render_queue.h"
 
 
 //--------------------------------------------------------------
@@ -50,6 +51,11 @@ class CWATER
 
 		unsigned int m_refmapID;
 
+		float m_fHeight;	//how far up the queued mesh is drawn
+
+	void Draw( bool bUseCVA );
+	static void DrawPacket( void* pData, int iParam );
+
 	public:
 
 	void Init( float fWorldSize );
@@ -57,6 +63,7 @@ class CWATER
 	void Update( float fDelta );
 	void CalcNormals( void );
 	void Render( bool bUseCVA );
+	void Submit( CRENDER_QUEUE* pQueue, float fHeight, bool bUseCVA );
 
 	void LoadReflectionMap( char* szFilename );
 
@@ -96,7 +103,7 @@ class CWATER
 	// Arguments:		None
 	// Return Value:	None
 	//--------------------------------------------------------------
-	CWATER( void ) : m_vecColor( 1.0f, 1.0f, 1.0f ), m_fTransparency( 1.0f )
+	CWATER( void ) : m_vecColor( 1.0f, 1.0f, 1.0f ), m_fTransparency( 1.0f ), m_fHeight( 0.0f )
 	{	}
 
 	//--------------------------------------------------------------
@@ -18,6 +18,9 @@
 #include <math.h>
 #include <GL/gl.h>
 
+#include "../Base Code/log.h"
+#include "../Base Code/vertex_cache.h"
+
 #include "ROAM.h"
 
 
@@ -60,8 +63,11 @@ void CROAM::Init( int iMaxLevel, int iPoolSize, CCAMERA* pCamera )
 	m_iMaxTriChunks= TRI_IMAX;
 	m_ipPDmndIS= new int [m_iMaxTriChunks];
 
-	//allocate memory for the vertex/texture coordinates
-	m_fVertTexBuffer= new float [m_iMaxTriChunks*15];
+	//allocate memory for the vertex/texture coordinates (one vertex for each
+	//diamond), and for the triangles' indices into them
+	m_fVertTexBuffer= new float [m_iPoolSize*5];
+	m_uipTriIndices = new unsigned int [m_iMaxTriChunks*3];
+	m_uipDrawIndices= new unsigned int [m_iMaxTriChunks*3];
 
 	//start all diamonds on the free list
 	for( i=0; i + 1 < m_iPoolSize; i++ )
@@ -160,6 +166,7 @@ void CROAM::Init( int iMaxLevel, int iPoolSize, CCAMERA* pCamera )
 
 		pDmnd->m_fVert[1]= ( float )GetTrueHeightAtPoint( ( int )( fabs( pDmnd->m_fVert[0] ) ),
 														  ( int )( fabs( pDmnd->m_fVert[2] ) ) );
+		SetVertex( pDmnd );
 		pDmnd->m_usTriIndex[0]= pDmnd->m_usTriIndex[1]= 0;
 
 		pDmnd->m_fBoundRad= ( float )SQR( m_iSize );
@@ -250,6 +257,8 @@ void CROAM::Init( int iMaxLevel, int iPoolSize, CCAMERA* pCamera )
 void CROAM::Shutdown( void )
 {
 	delete[] m_fVertTexBuffer;
+	delete[] m_uipTriIndices;
+	delete[] m_uipDrawIndices;
 	delete[] m_ipPDmndIS;
 	delete[] m_pDmndPool;
 	delete[] m_fpLevelMDSize;
@@ -365,32 +374,39 @@ void CROAM::Update( void )
 //--------------------------------------------------------------
 void CROAM::Render( void )
 {
-	float* fpVB;
+	unsigned int* uipIndices;
+	int iNumIndices;
 
 	//bind the primary color texture to the first texture unit
 	glEnable( GL_TEXTURE_2D );
 	glBindTexture( GL_TEXTURE_2D, m_texture.GetID( ) );
 
-	//render the mesh using vertex/texture arrays
-	fpVB= m_fVertTexBuffer + 15;
+	//the render list starts at triangle 1 (0 means "no triangle")
+	uipIndices = m_uipTriIndices+3;
+	iNumIndices= 3*( m_iFreeTri-1 );
+
+	//the diamonds point into the render list, so a copy of it is reordered
+	if( m_bCacheOptimize )
+	{
+		memcpy( m_uipDrawIndices, uipIndices, iNumIndices*sizeof( unsigned int ) );
+		uipIndices= m_uipDrawIndices;
 
+		OrderTris( uipIndices, iNumIndices );
+	}
+
+	//render the mesh using vertex/texture arrays
 	glEnableClientState( GL_VERTEX_ARRAY );
 	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
 
 	//render using a base texture and vertex info
 	//NOTE: lighting/detail map has been eliminated from this demo for simplicity's sake
 	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
-	glVertexPointer( 3,   GL_FLOAT, 20, fpVB+2 );
-	glTexCoordPointer( 2, GL_FLOAT, 20, fpVB );
+	glVertexPointer( 3,   GL_FLOAT, 20, m_fVertTexBuffer+2 );
+	glTexCoordPointer( 2, GL_FLOAT, 20, m_fVertTexBuffer );
 
-	//lock the arrays (provides a speed-up)
-	glLockArraysEXT( 0, 3*( m_iFreeTri-1 ) );
-
-	//draw the water patch
-	glDrawArrays( GL_TRIANGLES, 0, 3*( m_iFreeTri-1 ) );
-
-	//unlock the arrays
-	glUnlockArraysEXT( );
+	//draw the mesh (the arrays hold the whole diamond pool, so they are not
+	//locked, or every diamond's vertex would be transformed)
+	glDrawElements( GL_TRIANGLES, iNumIndices, GL_UNSIGNED_INT, uipIndices );
 
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 	glDisableClientState( GL_VERTEX_ARRAY );
@@ -399,6 +415,45 @@ void CROAM::Render( void )
 	glDisable( GL_TEXTURE_2D );
 }
 
+//--------------------------------------------------------------
+// Name:		 CROAM::OrderTris - private
+// Description:	 Reorder the frame's triangles for the vertex cache, and
+//				 log how much it helped (for the first frame after the
+//				 option is turned on, since the mesh changes every frame)
+// Arguments:	 -uipIndices: the triangles' diamond indices
+//				 -iNumIndices: the number of indices
+// Return Value: None
+//--------------------------------------------------------------
+void CROAM::OrderTris( unsigned int* uipIndices, int iNumIndices )
+{
+	int iListMisses, iOrderedMisses;
+	int iNumVertices;
+
+	if( iNumIndices==0 )
+		return;
+
+	iListMisses= 0;
+	if( m_bLogCacheOrder )
+		iListMisses= CountCacheMisses( uipIndices, iNumIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE );
+
+	OptimizeVertexCache( uipIndices, iNumIndices, m_iPoolSize );
+
+	if( m_bLogCacheOrder )
+	{
+		iOrderedMisses= CountCacheMisses( uipIndices, iNumIndices, VCACHE_FIFO, VCACHE_FIFO_SIZE );
+		iNumVertices  = CountUniqueVertices( uipIndices, iNumIndices, m_iPoolSize );
+
+		//the average number of vertices transformed for each triangle (it
+		//was 3.0 when each triangle had its own copies), and for each vertex
+		g_log.Write( LOG_PLAINTEXT, "Ordered %d ROAM triangles for the vertex cache: ACMR %.3f (render list), %.3f (ordered), ATVR %.3f (render list), %.3f (ordered)\n",
+					 iNumIndices/3,
+					 ( float )iListMisses*3/iNumIndices, ( float )iOrderedMisses*3/iNumIndices,
+					 ( float )iListMisses/iNumVertices, ( float )iOrderedMisses/iNumVertices );
+
+		m_bLogCacheOrder= false;
+	}
+}
+
 //--------------------------------------------------------------
 // Name:		 CROAM::AllocateTri - private
 // Description:	 Allocate a triangle for the triangle render list
@@ -467,7 +522,7 @@ void CROAM::FreeTri( SROAM_DIAMOND* pDmnd, int j )
 void CROAM::AddTri( SROAM_DIAMOND* pDmnd, int j )
 {
 	SROAM_DIAMOND* pDmndTable[3];
-	float* fpVB;
+	unsigned int* uipIndex;
 	int i, vi;
 
 	/* grab free tri and fill in */
@@ -496,17 +551,11 @@ void CROAM::AddTri( SROAM_DIAMOND* pDmnd, int j )
 		pDmndTable[2]= pDmnd->m_pParent[3];
 	}
 
-	//fill the vertex buffer with the information
-	fpVB= ( float * )m_fVertTexBuffer+15*i;
-	for( vi=0; vi<3; vi++, fpVB+=5 )
-	{
-		fpVB[2]= pDmndTable[vi]->m_fVert[0];
-		fpVB[3]= pDmndTable[vi]->m_fVert[1];
-		fpVB[4]= pDmndTable[vi]->m_fVert[2];
-
-		fpVB[0]= fpVB[2]/m_iSize;
-		fpVB[1]= fpVB[4]/m_iSize;
-	}
+	//the triangle's corners are its diamonds' vertices (which the
+	//neighbouring triangles share)
+	uipIndex= m_uipTriIndices+3*i;
+	for( vi=0; vi<3; vi++ )
+		uipIndex[vi]= ( unsigned int )( pDmndTable[vi]-m_pDmndPool );
 
 	m_iVertsPerFrame+= 3;
 	m_iTrisPerFrame++;
@@ -522,7 +571,6 @@ void CROAM::AddTri( SROAM_DIAMOND* pDmnd, int j )
 void CROAM::RemoveTri( SROAM_DIAMOND* pDmnd, int j )
 {
 	SROAM_DIAMOND *pDmndX;
-	float *fpVB, *fpVBIndex;
 	int iDmndIS, ix, jx, i;
 
 	i= pDmnd->m_usTriIndex[j];
@@ -541,10 +589,7 @@ void CROAM::RemoveTri( SROAM_DIAMOND* pDmnd, int j )
 	pDmndX->m_usTriIndex[jx]= i;
 	m_ipPDmndIS[i]= iDmndIS;
 		
-	fpVB = ( float * )m_fVertTexBuffer;
-	fpVBIndex= fpVB+15*ix;
-	fpVB+= 15*i;
-	memcpy( ( void* )fpVB, ( void* )fpVBIndex, 15*sizeof( float ) );
+	memcpy( ( void* )( m_uipTriIndices+3*i ), ( void* )( m_uipTriIndices+3*ix ), 3*sizeof( unsigned int ) );
 
 	m_iVertsPerFrame-= 3;
 	m_iTrisPerFrame--;
@@ -674,6 +719,7 @@ SROAM_DIAMOND* CROAM::GetChild( SROAM_DIAMOND* pDmnd, int i )
 	k->m_fVert[2]= ( float )fabs( ( pParentVert0[2] + pParentVert1[2] )/2.0f );
 	k->m_fVert[1]= GetTrueHeightAtPoint( ( int )k->m_fVert[0],
 										 ( int )k->m_fVert[2] );
+	SetVertex( k );
 
     //compute radius of diamond bounding sphere (squared)
 	//calculate the bounding sphere for the current triangle
@@ -50,14 +50,16 @@ CLEAN :
 	-@erase "$(INTDIR)\resource.res"
 	-@erase "$(INTDIR)\ROAM.obj"
 	-@erase "$(INTDIR)\terrain.obj"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(INTDIR)\water.obj"
 	-@erase "$(OUTDIR)\demo8_2.exe"
 
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /ML /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_2.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
+CPP_PROJ=/nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_2.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
 MTL_PROJ=/nologo /D "NDEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "NDEBUG" 
 BSC32=bscmake.exe
@@ -76,7 +78,9 @@ LINK32_OBJS= \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
 	"$(INTDIR)\math_ops.obj" \
-	"$(INTDIR)\ROAM.obj"
+	"$(INTDIR)\vertex_cache.obj" \
+	"$(INTDIR)\ROAM.obj" \
+	"$(INTDIR)\thread_pool.obj"
 
 "$(OUTDIR)\demo8_2.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -104,8 +108,10 @@ CLEAN :
 	-@erase "$(INTDIR)\resource.res"
 	-@erase "$(INTDIR)\ROAM.obj"
 	-@erase "$(INTDIR)\terrain.obj"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
 	-@erase "$(INTDIR)\vc60.pdb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(INTDIR)\water.obj"
 	-@erase "$(OUTDIR)\demo8_2.exe"
 	-@erase "$(OUTDIR)\demo8_2.ilk"
@@ -114,7 +120,7 @@ CLEAN :
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /MLd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_2.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
+CPP_PROJ=/nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_2.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
 MTL_PROJ=/nologo /D "_DEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "_DEBUG" 
 BSC32=bscmake.exe
@@ -133,7 +139,9 @@ LINK32_OBJS= \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
 	"$(INTDIR)\math_ops.obj" \
-	"$(INTDIR)\ROAM.obj"
+	"$(INTDIR)\vertex_cache.obj" \
+	"$(INTDIR)\ROAM.obj" \
+	"$(INTDIR)\thread_pool.obj"
 
 "$(OUTDIR)\demo8_2.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -233,6 +241,18 @@ SOURCE="..\Base Code\math_ops.cpp"
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE="..\Base Code\vertex_cache.cpp"
+
+"$(INTDIR)\vertex_cache.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\thread_pool.cpp"
+
+"$(INTDIR)\thread_pool.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\resource.rc
 
 "$(INTDIR)\resource.res" : $(SOURCE) "$(INTDIR)"
@@ -51,14 +51,16 @@ CLEAN :
 	-@erase "$(INTDIR)\ROAM.obj"
 	-@erase "$(INTDIR)\skybox.obj"
 	-@erase "$(INTDIR)\terrain.obj"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(INTDIR)\water.obj"
 	-@erase "$(OUTDIR)\demo8_3.exe"
 
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /ML /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_3.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
+CPP_PROJ=/nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_3.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /c 
 MTL_PROJ=/nologo /D "NDEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "NDEBUG" 
 BSC32=bscmake.exe
@@ -73,12 +75,14 @@ LINK32_OBJS= \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
 	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\vertex_cache.obj" \
 	"$(INTDIR)\main.obj" \
 	"$(INTDIR)\resource.res" \
 	"$(INTDIR)\ROAM.obj" \
 	"$(INTDIR)\terrain.obj" \
 	"$(INTDIR)\water.obj" \
-	"$(INTDIR)\skybox.obj"
+	"$(INTDIR)\skybox.obj" \
+	"$(INTDIR)\thread_pool.obj"
 
 "$(OUTDIR)\demo8_3.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -107,8 +111,10 @@ CLEAN :
 	-@erase "$(INTDIR)\ROAM.obj"
 	-@erase "$(INTDIR)\skybox.obj"
 	-@erase "$(INTDIR)\terrain.obj"
+	-@erase "$(INTDIR)\thread_pool.obj"
 	-@erase "$(INTDIR)\vc60.idb"
 	-@erase "$(INTDIR)\vc60.pdb"
+	-@erase "$(INTDIR)\vertex_cache.obj"
 	-@erase "$(INTDIR)\water.obj"
 	-@erase "$(OUTDIR)\demo8_3.exe"
 	-@erase "$(OUTDIR)\demo8_3.ilk"
@@ -117,7 +123,7 @@ CLEAN :
 "$(OUTDIR)" :
     if not exist "$(OUTDIR)/$(NULL)" mkdir "$(OUTDIR)"
 
-CPP_PROJ=/nologo /MLd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_3.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
+CPP_PROJ=/nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_WINDOWS" /D "_MBCS" /Fp"$(INTDIR)\demo8_3.pch" /YX /Fo"$(INTDIR)\\" /Fd"$(INTDIR)\\" /FD /GZ /c 
 MTL_PROJ=/nologo /D "_DEBUG" /mktyplib203 /win32 
 RSC_PROJ=/l 0x409 /fo"$(INTDIR)\resource.res" /d "_DEBUG" 
 BSC32=bscmake.exe
@@ -132,12 +138,14 @@ LINK32_OBJS= \
 	"$(INTDIR)\image.obj" \
 	"$(INTDIR)\log.obj" \
 	"$(INTDIR)\math_ops.obj" \
+	"$(INTDIR)\vertex_cache.obj" \
 	"$(INTDIR)\main.obj" \
 	"$(INTDIR)\resource.res" \
 	"$(INTDIR)\ROAM.obj" \
 	"$(INTDIR)\terrain.obj" \
 	"$(INTDIR)\water.obj" \
-	"$(INTDIR)\skybox.obj"
+	"$(INTDIR)\skybox.obj" \
+	"$(INTDIR)\thread_pool.obj"
 
 "$(OUTDIR)\demo8_3.exe" : "$(OUTDIR)" $(DEF_FILE) $(LINK32_OBJS)
     $(LINK32) @<<
@@ -242,6 +250,18 @@ SOURCE="..\Base Code\math_ops.cpp"
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE="..\Base Code\vertex_cache.cpp"
+
+"$(INTDIR)\vertex_cache.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE="..\Base Code\thread_pool.cpp"
+
+"$(INTDIR)\thread_pool.obj" : $(SOURCE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\resource.rc
 
 "$(INTDIR)\resource.res" : $(SOURCE) "$(INTDIR)"
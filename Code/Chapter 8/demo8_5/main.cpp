@@ -47,6 +47,7 @@ CWATER g_water;
 CSKYDOME g_skydome;
 
 int g_iLevel= 15;
+bool g_bCacheOrder= false;
 
 
 //--------------------------------------------------------------
@@ -154,6 +155,7 @@ void DemoRender( void )
 	glEnable( GL_CULL_FACE );
 
 	//update the ROAM mesh
+	g_ROAM.DoCacheOptimization( g_bCacheOrder );
 	g_ROAM.Update( );
 
 	//update the water's vertices and re-calculate polygon normals
@@ -192,6 +194,12 @@ void DemoRender( void )
 		//render how many million triangles are rendered per second
 		g_glApp.Print( g_iScreenWidth-175, g_iScreenHeight-115, CVECTOR( 0.0f, 1.0f, 0.0f),
 					   "MTris/S:  %.3f", ( ( g_ROAM.GetNumTrisPerFrame( )+g_water.GetNumTriangles( )+g_skydome.GetNumTriangles( ) )*g_glApp.GetFPS( ) )/1000000.0f );
+
+		//print other info text
+		if( g_bCacheOrder )
+			g_glApp.Print( 0, g_iScreenHeight-70, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Enabled" );
+		else
+			g_glApp.Print( 0, g_iScreenHeight-70, CVECTOR( 0.0f, 1.0f, 0.0f), "Vertex Cache Order: Disabled" );
 	g_glApp.EndTextMode( );
 
 	//force a render finish, and then swap buffers
@@ -287,6 +295,22 @@ bool DemoInput( void )
 	else if( g_glApp.KeyDown( 'S' ) )
 		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 
+	//toggle the vertex cache ordering of the ROAM mesh
+	if( g_glApp.KeyDown( 'V' ) )
+	{
+		//wait a few seconds after the last press
+		if( iToggleWait<10 )
+			return true;
+
+		if( g_bCacheOrder )
+			g_bCacheOrder= false;
+
+		else
+			g_bCacheOrder= true;
+
+		iToggleWait= 0;
+	}
+
 	return true;
 }
 